@@ -49,6 +49,7 @@ suscan_analyzer_baseband_filter_new(
 
   filter->func = func;
   filter->privdata = privdata;
+  filter->tap = NULL;
 
   return filter;
 }
@@ -57,6 +58,9 @@ SUPRIVATE void
 suscan_analyzer_baseband_filter_destroy(
     struct suscan_analyzer_baseband_filter *filter)
 {
+  if (filter->tap != NULL)
+    (void) suscan_bbtap_destroy(filter->tap);
+
   free(filter);
 }
 
@@ -92,6 +96,68 @@ fail:
   return SU_FALSE;
 }
 
+const struct suscan_analyzer_baseband_filter *
+suscan_analyzer_register_baseband_filter_async(
+    suscan_analyzer_t *self,
+    suscan_analyzer_baseband_filter_func_t func,
+    void *privdata,
+    SUSCOUNT depth)
+{
+  struct suscan_analyzer_baseband_filter *new = NULL;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_CHANNEL,
+      goto fail);
+
+  SU_TRYCATCH(
+      new = suscan_analyzer_baseband_filter_new(func, privdata),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->tap = suscan_bbtap_new(
+          func,
+          privdata,
+          self,
+          depth > 0 ? depth : SUSCAN_BBTAP_DEFAULT_DEPTH),
+      goto fail);
+
+  SU_TRYCATCH(
+      PTR_LIST_APPEND_CHECK(self->bbfilt, new) != -1,
+      goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_baseband_filter_destroy(new);
+
+  return NULL;
+}
+
+/*
+ * Attaches a spectrum history to the analyzer, which takes ownership of
+ * it. Any previous history is closed. Pass NULL to stop recording.
+ */
+SUBOOL
+suscan_analyzer_set_psd_history(
+    suscan_analyzer_t *self,
+    suscan_spectrum_history_t *hist)
+{
+  suscan_spectrum_history_t *prev;
+
+  SU_TRYCATCH(hist == NULL || hist->writable, return SU_FALSE);
+
+  SU_TRYCATCH(suscan_analyzer_lock_loop(self), return SU_FALSE);
+  prev = self->psd_history;
+  self->psd_history = hist;
+  suscan_analyzer_unlock_loop(self);
+
+  if (prev != NULL)
+    suscan_spectrum_history_destroy(prev);
+
+  return SU_TRUE;
+}
+
 /************************ Source worker callback *****************************/
 
 SUBOOL
@@ -180,7 +246,7 @@ suscan_analyzer_reset_throttle(suscan_analyzer_t *analyzer)
 {
   return suscan_analyzer_override_throttle(
       analyzer,
-      suscan_analyzer_get_samp_rate(analyzer));
+      suscan_source_get_samp_rate(analyzer->source));
 }
 
 SUPRIVATE SUBOOL
@@ -200,17 +266,123 @@ suscan_analyzer_readjust_detector(
 
     su_channel_detector_destroy(analyzer->detector);
     analyzer->detector = new_detector;
+
+    /* Fresh detector: realign window skipping with its first window */
+    analyzer->det_phase = 0;
   }
 
   return SU_TRUE;
 }
 
+/*
+ * (Re)creates the parallel PSD estimator after the detector, with one
+ * slice per inspector worker. Channel mode only.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_init_parallel_psd(suscan_analyzer_t *self, SUSCOUNT batch)
+{
+  suscan_parallel_psd_t *parpsd = NULL;
+
+  if (batch > 0 && self->params.mode == SUSCAN_ANALYZER_MODE_CHANNEL)
+    SU_TRYCATCH(
+        parpsd = suscan_parallel_psd_new(
+            self->detector->params.window_size,
+            self->detector->params.window,
+            self->detector->params.alpha,
+            suscan_inspsched_get_num_workers(self->sched),
+            batch),
+        return SU_FALSE);
+
+  if (self->parpsd != NULL)
+    suscan_parallel_psd_destroy(self->parpsd);
+
+  self->parpsd = parpsd;
+
+  return SU_TRUE;
+}
+
+/*
+ * Called by the channel worker with the loop mutex held. Once per
+ * control interval, feeds the load controller with the current CPU
+ * usage and sample loss, and applies its decisions to the detector.
+ * PSD intervals are scaled by the worker itself.
+ */
+SUBOOL
+suscan_analyzer_control_load(suscan_analyzer_t *self)
+{
+  struct sigutils_channel_detector_params params;
+  struct timespec sub;
+  unsigned int prev;
+  SUSCOUNT stride;
+
+  if (!suscan_load_controller_is_active(&self->loadctl))
+    return SU_TRUE;
+
+  timespecsub(&self->read_start, &self->last_loadctl, &sub);
+  if (sub.tv_sec + sub.tv_nsec * 1e-9 < SUSCAN_LOAD_CONTROLLER_INTERVAL)
+    return SU_TRUE;
+
+  self->last_loadctl = self->read_start;
+
+  prev = suscan_load_controller_get_level(&self->loadctl);
+  if (!suscan_load_controller_update(
+      &self->loadctl,
+      self->cpu_usage,
+      suscan_source_get_overflow_count(self->source)))
+    return SU_TRUE;
+
+  /* Leaving full quality: remember the averaging we started with */
+  if (prev == 0)
+    self->det_base_alpha = self->detector->params.alpha;
+
+  /*
+   * Skipping windows reduces the number of FFTs averaged per second. Scale
+   * alpha so the averaging time constant stays the same.
+   */
+  stride = suscan_load_controller_get_stride(&self->loadctl);
+  params = self->detector->params;
+  params.alpha = SU_MIN(1, self->det_base_alpha * stride);
+
+  if (params.alpha != self->detector->params.alpha) {
+    SU_TRYCATCH(
+        suscan_analyzer_readjust_detector(self, &params),
+        return SU_FALSE);
+    __atomic_add_fetch(&self->det_params_gen, 1, __ATOMIC_RELEASE);
+
+    if (self->parpsd != NULL)
+      suscan_parallel_psd_set_alpha(self->parpsd, params.alpha);
+  }
+
+  SU_TRYCATCH(
+      suscan_analyzer_send_status(
+          self,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_LOAD_CONTROL,
+          suscan_load_controller_get_level(&self->loadctl),
+          "Load control (CPU %.0f%%): PSD interval x%g, detector stride %d",
+          100. * self->cpu_usage,
+          suscan_load_controller_get_psd_factor(&self->loadctl),
+          (int) stride),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
 /* Locally-defined prototypes. These should not appear in analyzer.h */
 SUBOOL suscan_source_wide_wk_cb(
     struct suscan_mq *mq_out,
     void *wk_private,
     void *cb_private);
 
+struct suscan_analyzer_sweep_unit *suscan_analyzer_sweep_unit_new(
+    suscan_analyzer_t *self,
+    suscan_source_config_t *config);
+
+void suscan_analyzer_sweep_unit_force_eos(
+    struct suscan_analyzer_sweep_unit *unit);
+
+void suscan_analyzer_sweep_unit_destroy(
+    struct suscan_analyzer_sweep_unit *unit);
+
 SUBOOL suscan_source_channel_wk_cb(
     struct suscan_mq *mq_out,
     void *wk_private,
@@ -248,7 +420,7 @@ suscan_analyzer_thread(void *data)
       if (!suscan_worker_push(
             self->source_wk,
             suscan_source_wide_wk_cb,
-            self->source)) {
+            self->sweep_unit_list[0])) {
           suscan_analyzer_send_status(
               self,
               SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT,
@@ -297,6 +469,7 @@ suscan_analyzer_thread(void *data)
         /* Forward these messages to output */
         case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
         case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL:
+        case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA:
           SU_TRYCATCH(
               suscan_mq_write(self->mq_out, type, private),
               goto done);
@@ -345,9 +518,19 @@ suscan_analyzer_thread(void *data)
           SU_TRYCATCH(
               suscan_analyzer_readjust_detector(self, &new_det_params),
               goto done);
+          __atomic_add_fetch(&self->det_params_gen, 1, __ATOMIC_RELEASE);
+
+          SU_TRYCATCH(
+              suscan_analyzer_init_parallel_psd(self, new_params->psd_batch),
+              goto done);
 
           self->interval_channels = new_params->channel_update_int;
           self->interval_psd      = new_params->psd_update_int;
+          self->psd_sub           = new_params->psd_sub;
+          self->channel_snapshot_int = new_params->channel_snapshot_int;
+          suscan_load_controller_set_budget(
+              &self->loadctl,
+              new_params->cpu_budget);
           /* ^^^^^^^^^^^^^ Source parameters update end ^^^^^^^^^^^^^^^^^  */
 
           SU_TRYCATCH(
@@ -635,6 +818,10 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
   if (analyzer->source != NULL)
     suscan_source_force_eos(analyzer->source);
 
+  for (i = 0; i < analyzer->sweep_unit_count; ++i)
+    if (analyzer->sweep_unit_list[i] != NULL)
+      suscan_analyzer_sweep_unit_force_eos(analyzer->sweep_unit_list[i]);
+
   if (analyzer->running) {
     if (!analyzer->halt_requested) {
       suscan_analyzer_req_halt(analyzer);
@@ -667,6 +854,17 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
       return;
     }
 
+  /* Halt sweep devices, along with their workers */
+  for (i = 0; i < analyzer->sweep_unit_count; ++i)
+    if (analyzer->sweep_unit_list[i] != NULL)
+      suscan_analyzer_sweep_unit_destroy(analyzer->sweep_unit_list[i]);
+
+  if (analyzer->sweep_unit_list != NULL)
+    free(analyzer->sweep_unit_list);
+
+  if (analyzer->sweep_mutex_init)
+    pthread_mutex_destroy(&analyzer->sweep_mutex);
+
   /* Halt all inspector scheduler workers */
   if (analyzer->sched != NULL) {
     if (!suscan_inspsched_destroy(analyzer->sched)) {
@@ -687,9 +885,34 @@ suscan_analyzer_destroy(suscan_analyzer_t *analyzer)
   if (analyzer->detector != NULL)
     su_channel_detector_destroy(analyzer->detector);
 
+  if (analyzer->frontend != NULL)
+    suscan_frontend_destroy(analyzer->frontend);
+
+  if (analyzer->parpsd != NULL)
+    suscan_parallel_psd_destroy(analyzer->parpsd);
+
   if (analyzer->loop_init)
     pthread_mutex_destroy(&analyzer->loop_mutex);
 
+  /* Close spectrum history */
+  if (analyzer->psd_history != NULL)
+    suscan_spectrum_history_destroy(analyzer->psd_history);
+
+  /* Free PSD pyramid */
+  if (analyzer->psd_pyramid != NULL)
+    suscan_psd_pyramid_destroy(analyzer->psd_pyramid);
+
+  /* Free stitched PSD */
+  if (analyzer->panorama != NULL)
+    suscan_panorama_destroy(analyzer->panorama);
+
+  /* Free signal catalog */
+  if (analyzer->signal_catalog != NULL)
+    suscan_signal_catalog_destroy(analyzer->signal_catalog);
+
+  if (analyzer->channel_tracker != NULL)
+    suscan_channel_tracker_destroy(analyzer->channel_tracker);
+
   /* Free spectral tuner */
   if (analyzer->stuner != NULL)
     su_specttuner_destroy(analyzer->stuner);
@@ -783,6 +1006,7 @@ suscan_analyzer_new(
   struct sigutils_specttuner_params st_params =
       sigutils_specttuner_params_INITIALIZER;
   struct sigutils_channel_detector_params det_params;
+  struct suscan_analyzer_sweep_unit *unit = NULL;
   unsigned int worker_count;
   unsigned int i;
 
@@ -821,8 +1045,12 @@ suscan_analyzer_new(
   /* Periodic updates */
   new->interval_channels = params->channel_update_int;
   new->interval_psd      = params->psd_update_int;
+  new->psd_sub           = params->psd_sub;
+  new->channel_snapshot_int = params->channel_snapshot_int;
   clock_gettime(CLOCK_MONOTONIC_RAW, &new->last_psd);
   clock_gettime(CLOCK_MONOTONIC_RAW, &new->last_channels);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &new->last_loadctl);
+  suscan_load_controller_init(&new->loadctl, params->cpu_budget);
 
   /* Create channel detector */
   (void) pthread_mutex_init(&new->loop_mutex, NULL); /* Always succeeds */
@@ -832,6 +1060,7 @@ suscan_analyzer_new(
   SU_TRYCATCH(
       new->detector = su_channel_detector_new(&det_params),
       goto fail);
+  new->det_base_alpha = new->detector->params.alpha;
 
   /* Create source worker */
   if ((new->source_wk = suscan_worker_new(&new->mq_in, new))
@@ -880,6 +1109,15 @@ suscan_analyzer_new(
   SU_TRYCATCH(suscan_source_start_capture(new->source), goto fail);
   new->effective_samp_rate = suscan_analyzer_get_samp_rate(new);
 
+  /* Narrowband focus: everything past the front-end sees its rate */
+  if (params->mode == SUSCAN_ANALYZER_MODE_CHANNEL && params->focus_bw > 0)
+    SU_TRYCATCH(
+        new->frontend = suscan_frontend_new(
+            suscan_source_get_samp_rate(new->source),
+            params->focus_offset,
+            params->focus_bw),
+        goto fail);
+
   /*
    * In case the source rejected our initial sample rate configuration, we
    * update the detector accordingly.
@@ -888,14 +1126,18 @@ suscan_analyzer_new(
    * can be slower, we ensure this way we can provide an accurate value of the
    * sample rate right after the analyzer object is created.
    */
-  if (new->effective_samp_rate != new->detector->params.samp_rate) {
+  if (suscan_analyzer_get_samp_rate(new) != new->detector->params.samp_rate) {
     det_params = new->detector->params;
-    det_params.samp_rate = new->effective_samp_rate;
+    det_params.samp_rate = suscan_analyzer_get_samp_rate(new);
     SU_TRYCATCH(
         suscan_analyzer_readjust_detector(new, &det_params),
         goto fail);
   }
 
+  SU_TRYCATCH(
+      suscan_analyzer_init_parallel_psd(new, params->psd_batch),
+      goto fail);
+
   /* In wide spectrum mode, additional tests are required */
   if (params->mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM) {
     SU_TRYCATCH(
@@ -906,6 +1148,19 @@ suscan_analyzer_new(
             SUSCAN_ANALYZER_MIN_POST_HOP_FFTS * det_params.window_size;
     new->current_sweep_params.max_freq = params->max_freq;
     new->current_sweep_params.min_freq = params->min_freq;
+    new->current_sweep_params.overlap  = SUSCAN_ANALYZER_DEFAULT_SWEEP_OVERLAP;
+    new->current_sweep_params.catalog_snr = SUSCAN_SIGNAL_CATALOG_DEFAULT_SNR;
+    new->pending_sweep_params = new->current_sweep_params;
+    new->sweep_params_gen = 1;
+    new->det_params_gen   = 1;
+
+    SU_TRYCATCH(pthread_mutex_init(&new->sweep_mutex, NULL) == 0, goto fail);
+    new->sweep_mutex_init = SU_TRUE;
+
+    /* Unit 0: the analyzer's own source */
+    SU_TRYCATCH(unit = suscan_analyzer_sweep_unit_new(new, NULL), goto fail);
+    SU_TRYCATCH(PTR_LIST_APPEND_CHECK(new->sweep_unit, unit) != -1, goto fail);
+    unit = NULL;
   }
 
   if (pthread_create(
@@ -922,6 +1177,9 @@ suscan_analyzer_new(
   return new;
 
 fail:
+  if (unit != NULL)
+    suscan_analyzer_sweep_unit_destroy(unit);
+
   if (new != NULL)
     suscan_analyzer_destroy(new);
 
@@ -28,6 +28,17 @@
 #include "worker.h"
 #include "source.h"
 #include "throttle.h"
+#include "psdpyr.h"
+#include "spechist.h"
+#include "sweep.h"
+#include "panorama.h"
+#include "settle.h"
+#include "catalog.h"
+#include "chtrack.h"
+#include "loadctl.h"
+#include "frontend.h"
+#include "parpsd.h"
+#include "bbtap.h"
 #include "inspector/inspector.h"
 #include "inspsched.h"
 
@@ -39,12 +50,25 @@ extern "C" {
 #define SUSCAN_ANALYZER_FS_MEASURE_INTERVAL   1.0
 
 #define SUSCAN_ANALYZER_MIN_POST_HOP_FFTS     7
+#define SUSCAN_ANALYZER_DEFAULT_SWEEP_OVERLAP .1
+#define SUSCAN_ANALYZER_MAX_SWEEP_BANDS       16
 
 enum suscan_analyzer_mode {
   SUSCAN_ANALYZER_MODE_CHANNEL,
   SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM
 };
 
+/*
+ * PSD subscription: clients displaying a limited number of pixels may
+ * request decimated PSD messages. If bins is 0, the full-resolution PSD
+ * is sent in FFT order, as usual.
+ */
+struct suscan_analyzer_psd_subscription {
+  SUSCOUNT bins;   /* Target bin count */
+  SUFREQ   f_lo;   /* Span, relative to the center frequency */
+  SUFREQ   f_hi;   /* If f_lo == f_hi, the whole spectrum is sent */
+};
+
 struct suscan_analyzer_params {
   enum suscan_analyzer_mode mode;
   struct sigutils_channel_detector_params detector_params;
@@ -52,6 +76,12 @@ struct suscan_analyzer_params {
   SUFLOAT  psd_update_int;
   SUFREQ   min_freq;
   SUFREQ   max_freq;
+  struct suscan_analyzer_psd_subscription psd_sub;
+  SUSCOUNT channel_snapshot_int; /* 0: send full channel lists */
+  SUFLOAT  cpu_budget;           /* 0: no load control */
+  SUFREQ   focus_offset;         /* Relative to the source frequency */
+  SUFLOAT  focus_bw;             /* 0: process the whole source band */
+  SUSCOUNT psd_batch;            /* Windows per parallel PSD batch */
 };
 
 #define suscan_analyzer_params_INITIALIZER {                               \
@@ -61,6 +91,12 @@ struct suscan_analyzer_params {
   SU_ADDSFX(.04),                               /* psd_update_int */        \
   0,                                            /* min_freq */              \
   0,                                            /* max_freq */              \
+  {0, 0, 0},                                    /* psd_sub */               \
+  0,                                            /* channel_snapshot_int */  \
+  0,                                            /* cpu_budget */            \
+  0,                                            /* focus_offset */          \
+  0,                                            /* focus_bw */              \
+  0,                                            /* psd_batch */             \
 }
 
 typedef SUBOOL (*suscan_analyzer_baseband_filter_func_t) (
@@ -72,8 +108,17 @@ typedef SUBOOL (*suscan_analyzer_baseband_filter_func_t) (
 struct suscan_analyzer_baseband_filter {
   suscan_analyzer_baseband_filter_func_t func;
   void *privdata;
+  suscan_bbtap_t *tap; /* NULL: called from the source worker */
 };
 
+/* Blocks dropped by asynchronous filters because their queue was full */
+SUINLINE SUSCOUNT
+suscan_analyzer_baseband_filter_get_drops(
+    const struct suscan_analyzer_baseband_filter *filter)
+{
+  return filter->tap != NULL ? suscan_bbtap_get_drops(filter->tap) : 0;
+}
+
 struct suscan_analyzer_gain_request {
   char *name;
   SUFLOAT value;
@@ -82,9 +127,19 @@ struct suscan_analyzer_gain_request {
 struct suscan_analyzer_sweep_params {
   SUFREQ min_freq;
   SUFREQ max_freq;
-  SUSCOUNT fft_min_samples; /* Minimum number of FFT frames before updating */
+  SUSCOUNT fft_min_samples; /* Samples discarded after hop until calibrated */
+  SUFLOAT overlap;          /* Fraction of the sample rate shared by hops */
+  unsigned int band_count;  /* Bands of interest */
+  struct suscan_sweep_band bands[SUSCAN_ANALYZER_MAX_SWEEP_BANDS];
+  SUBOOL   panorama;        /* Send stitched PSDs instead of hop PSDs */
+  SUSCOUNT panorama_bins;   /* 0: detector resolution */
+  SUFLOAT  panorama_int;    /* Seconds between updates (0: every sweep) */
+  SUBOOL   catalog;         /* Look for signals in every hop */
+  SUFLOAT  catalog_snr;     /* Detection threshold (dB over noise floor) */
 };
 
+struct suscan_analyzer_sweep_unit;
+
 struct suscan_analyzer {
   struct suscan_analyzer_params params;
   struct suscan_mq mq_in;   /* To-thread messages */
@@ -110,6 +165,19 @@ struct suscan_analyzer {
   SUFLOAT  interval_channels;
   SUFLOAT  interval_psd;
 
+  /* Channel deltas, with a full snapshot every channel_snapshot_int */
+  SUSCOUNT channel_snapshot_int;
+  suscan_channel_tracker_t *channel_tracker;
+  SUSCOUNT channel_updates;
+  uint64_t channel_delta_seq;
+
+  /* PSD decimation */
+  struct suscan_analyzer_psd_subscription psd_sub;
+  suscan_psd_pyramid_t *psd_pyramid;
+
+  /* Spectrum history, fed with every PSD update */
+  suscan_spectrum_history_t *psd_history;
+
   /* This mutex shall protect hot-config requests */
   /* XXX: This is cumbersome. Create a hotconf object to handle these things */
   pthread_mutex_t hotconf_mutex;
@@ -138,8 +206,16 @@ struct suscan_analyzer {
   struct timespec last_psd;
   struct timespec last_channels;
 
+  /* Load control, channel mode only */
+  suscan_load_controller_t loadctl;
+  struct timespec last_loadctl;
+  SUFLOAT  det_base_alpha; /* Detector alpha at full quality */
+  SUSCOUNT det_phase;      /* Samples into the current skip period */
+
   /* Source worker objects */
+  suscan_frontend_t *frontend; /* Narrowband focus, if any */
   su_channel_detector_t *detector; /* Channel detector */
+  suscan_parallel_psd_t *parpsd; /* PSD computed by the inspector workers */
   suscan_worker_t *source_wk; /* Used by one source only */
   suscan_worker_t *slow_wk; /* Worker for slow operations */
   SUCOMPLEX *read_buf;
@@ -150,11 +226,22 @@ struct suscan_analyzer {
   su_specttuner_t    *stuner;
 
   /* Wide sweep parameters */
-  SUBOOL sweep_params_requested;
+  unsigned int sweep_params_gen; /* Bumped on every request */
+  unsigned int det_params_gen;   /* Bumped on every detector update */
+  /* Both protected by the sweep mutex. Setters only touch the pending one */
   struct suscan_analyzer_sweep_params current_sweep_params;
   struct suscan_analyzer_sweep_params pending_sweep_params;
-  SUFREQ   curr_freq;
-  SUSCOUNT fft_samples; /* Number of FFT frames */
+
+  /* Sweep devices. The sweep mutex protects everything below */
+  SUBOOL   sweep_mutex_init;
+  pthread_mutex_t sweep_mutex;
+  PTR_LIST(struct suscan_analyzer_sweep_unit, sweep_unit);
+  SUFREQ   curr_freq;   /* Center frequency of the hop being sent */
+  suscan_panorama_t *panorama;
+  suscan_signal_catalog_t *signal_catalog;
+  unsigned int panorama_gen;
+  double   last_panorama;
+  SUSCOUNT panorama_sweeps;
 
   /* Inspector objects */
   PTR_LIST(suscan_inspector_t, inspector); /* This list owns inspectors */
@@ -174,12 +261,28 @@ suscan_analyzer_is_real_time(const suscan_analyzer_t *analyzer)
   return suscan_source_get_type(analyzer->source) == SUSCAN_SOURCE_TYPE_SDR;
 }
 
+/* Sample rate seen by the detector, the inspectors and baseband filters */
 SUINLINE unsigned int
 suscan_analyzer_get_samp_rate(const suscan_analyzer_t *analyzer)
 {
+  if (analyzer->frontend != NULL)
+    return suscan_frontend_get_samp_rate(analyzer->frontend);
+
   return suscan_source_get_samp_rate(analyzer->source);
 }
 
+/* Absolute frequency of the center of that band */
+SUINLINE SUFREQ
+suscan_analyzer_get_center_freq(const suscan_analyzer_t *analyzer)
+{
+  SUFREQ fc = (suscan_source_get_config(analyzer->source))->freq;
+
+  if (analyzer->frontend != NULL)
+    fc += suscan_frontend_get_offset(analyzer->frontend);
+
+  return fc;
+}
+
 SUINLINE SUFLOAT
 suscan_analyzer_get_measured_samp_rate(const suscan_analyzer_t *self)
 {
@@ -218,6 +321,54 @@ suscan_analyzer_set_hop_range(
     SUFREQ min,
     SUFREQ max);
 
+SUBOOL suscan_analyzer_set_sweep_overlap(
+    suscan_analyzer_t *self,
+    SUFLOAT overlap);
+
+/* Replaces the list of bands of interest. A count of 0 clears it. */
+SUBOOL suscan_analyzer_set_sweep_bands(
+    suscan_analyzer_t *self,
+    const struct suscan_sweep_band *bands,
+    unsigned int count);
+
+/*
+ * Adds another device to the wide spectrum sweep. The sweep range is split
+ * evenly among all devices, which must run at the analyzer's sample rate.
+ */
+SUBOOL suscan_analyzer_add_sweep_source(
+    suscan_analyzer_t *self,
+    suscan_source_config_t *config);
+
+/*
+ * Stitches hop PSDs into a single PSD over the sweep range, sent every
+ * `interval' seconds (of sweep time) or, if 0, after every full sweep.
+ */
+SUBOOL suscan_analyzer_set_panorama(
+    suscan_analyzer_t *self,
+    SUBOOL enabled,
+    SUSCOUNT bins,
+    SUFLOAT interval);
+
+/*
+ * Keeps a catalog of the signals found in every hop, exceeding the noise
+ * floor by `snr' dB. Disabling it discards its contents.
+ */
+SUBOOL suscan_analyzer_set_signal_catalog(
+    suscan_analyzer_t *self,
+    SUBOOL enabled,
+    SUFLOAT snr);
+
+/*
+ * Returns a copy of the catalog entries between f_lo and f_hi (or all of
+ * them, if f_lo == f_hi). The caller must free the returned array.
+ */
+SUBOOL suscan_analyzer_get_signal_catalog(
+    suscan_analyzer_t *self,
+    SUFREQ f_lo,
+    SUFREQ f_hi,
+    struct suscan_signal_entry **entries,
+    unsigned int *count);
+
 SUBOOL suscan_analyzer_set_freq(
     suscan_analyzer_t *analyzer,
     SUFREQ freq,
@@ -268,6 +419,22 @@ SUBOOL suscan_analyzer_register_baseband_filter(
     suscan_analyzer_baseband_filter_func_t func,
     void *privdata);
 
+/*
+ * Same as above, but func runs on its own thread and receives the blocks
+ * through a queue of `depth' blocks (0: default). The returned filter
+ * belongs to the analyzer and can be used to query drop counts.
+ */
+const struct suscan_analyzer_baseband_filter *
+suscan_analyzer_register_baseband_filter_async(
+    suscan_analyzer_t *analyzer,
+    suscan_analyzer_baseband_filter_func_t func,
+    void *privdata,
+    SUSCOUNT depth);
+
+SUBOOL suscan_analyzer_set_psd_history(
+    suscan_analyzer_t *analyzer,
+    suscan_spectrum_history_t *hist);
+
 su_specttuner_channel_t *suscan_analyzer_open_channel_ex(
     suscan_analyzer_t *analyzer,
     const struct sigutils_channel *chan_info,
@@ -368,6 +535,32 @@ SUBOOL suscan_analyzer_set_inspector_watermark_async(
     SUSCOUNT watermark,
     uint32_t req_id);
 
+SUBOOL suscan_analyzer_set_inspector_latency_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT latency,
+    uint32_t req_id);
+
+SUBOOL suscan_analyzer_set_inspector_estimator_interval_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT interval,
+    uint32_t req_id);
+
+SUBOOL suscan_analyzer_set_inspector_wall_clock_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUBOOL wall_clock,
+    uint32_t req_id);
+
+SUBOOL suscan_analyzer_set_inspector_squelch_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUBOOL enabled,
+    SUFLOAT level_db,
+    SUFLOAT hang,
+    uint32_t req_id);
+
 SUBOOL suscan_analyzer_inspector_estimator_cmd_async(
     suscan_analyzer_t *analyzer,
     SUHANDLE handle,
@@ -0,0 +1,191 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "bbtap"
+
+#include "bbtap.h"
+
+suscan_sample_buffer_t *
+suscan_sample_buffer_new(const SUCOMPLEX *data, SUSCOUNT size)
+{
+  suscan_sample_buffer_t *new = NULL;
+
+  SU_TRYCATCH(
+      new = malloc(sizeof(suscan_sample_buffer_t) + size * sizeof(SUCOMPLEX)),
+      return NULL);
+
+  new->refcnt = 1;
+  new->size   = size;
+  memcpy(new->data, data, size * sizeof(SUCOMPLEX));
+
+  return new;
+}
+
+SUPRIVATE suscan_sample_buffer_t *
+suscan_bbtap_pop(suscan_bbtap_t *self)
+{
+  suscan_sample_buffer_t *buf = NULL;
+
+  pthread_mutex_lock(&self->mutex);
+
+  if (self->count > 0) {
+    buf = self->queue[self->head];
+    if (++self->head == self->depth)
+      self->head = 0;
+    --self->count;
+  }
+
+  pthread_mutex_unlock(&self->mutex);
+
+  return buf;
+}
+
+SUPRIVATE SUBOOL
+suscan_bbtap_work_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_bbtap_t *self = (suscan_bbtap_t *) wk_private;
+  suscan_sample_buffer_t *buf;
+
+  /*
+   * One callback is queued per buffer, but drain the queue anyways: a
+   * buffer whose callback could not be queued is processed here too.
+   */
+  while ((buf = suscan_bbtap_pop(self)) != NULL) {
+    if (!self->failed
+        && !(self->func) (
+            self->privdata,
+            self->analyzer,
+            buf->data,
+            buf->size)) {
+      SU_WARNING("Baseband tap failed, disabling it\n");
+      __atomic_store_n(&self->failed, SU_TRUE, __ATOMIC_RELEASE);
+    }
+
+    suscan_sample_buffer_unref(buf);
+  }
+
+  return SU_FALSE;
+}
+
+SUBOOL
+suscan_bbtap_push(suscan_bbtap_t *self, suscan_sample_buffer_t *buf)
+{
+  SUSCOUNT tail;
+  SUBOOL queued = SU_FALSE;
+
+  pthread_mutex_lock(&self->mutex);
+
+  if (!__atomic_load_n(&self->failed, __ATOMIC_ACQUIRE)
+      && self->count < self->depth) {
+    tail = (self->head + self->count) % self->depth;
+    suscan_sample_buffer_ref(buf);
+    self->queue[tail] = buf;
+    ++self->count;
+    queued = SU_TRUE;
+  } else {
+    __atomic_add_fetch(&self->drops, 1, __ATOMIC_RELAXED);
+  }
+
+  pthread_mutex_unlock(&self->mutex);
+
+  /* If the worker cannot be woken up now, the next callback will do */
+  if (queued && !suscan_worker_push(self->worker, suscan_bbtap_work_cb, NULL))
+    SU_WARNING("Cannot wake up baseband tap worker\n");
+
+  return queued;
+}
+
+SUBOOL
+suscan_bbtap_destroy(suscan_bbtap_t *self)
+{
+  suscan_sample_buffer_t *buf;
+
+  if (self->worker != NULL)
+    if (!suscan_worker_halt(self->worker)) {
+      SU_ERROR("Failed to halt baseband tap worker, memory leak ahead\n");
+      return SU_FALSE;
+    }
+
+  if (self->queue != NULL) {
+    while ((buf = suscan_bbtap_pop(self)) != NULL)
+      suscan_sample_buffer_unref(buf);
+
+    free(self->queue);
+  }
+
+  if (self->mutex_init)
+    pthread_mutex_destroy(&self->mutex);
+
+  if (self->mq_init)
+    suscan_mq_finalize(&self->mq_out);
+
+  free(self);
+
+  return SU_TRUE;
+}
+
+suscan_bbtap_t *
+suscan_bbtap_new(
+    SUBOOL (*func) (
+        void *privdata,
+        struct suscan_analyzer *analyzer,
+        const SUCOMPLEX *samples,
+        SUSCOUNT length),
+    void *privdata,
+    struct suscan_analyzer *analyzer,
+    SUSCOUNT depth)
+{
+  suscan_bbtap_t *new = NULL;
+
+  SU_TRYCATCH(depth > 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_bbtap_t)), goto fail);
+
+  new->func     = func;
+  new->privdata = privdata;
+  new->analyzer = analyzer;
+  new->depth    = depth;
+
+  SU_TRYCATCH(
+      new->queue = calloc(depth, sizeof(suscan_sample_buffer_t *)),
+      goto fail);
+
+  SU_TRYCATCH(pthread_mutex_init(&new->mutex, NULL) == 0, goto fail);
+  new->mutex_init = SU_TRUE;
+
+  SU_TRYCATCH(suscan_mq_init(&new->mq_out), goto fail);
+  new->mq_init = SU_TRUE;
+
+  SU_TRYCATCH(new->worker = suscan_worker_new(&new->mq_out, new), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_bbtap_destroy(new);
+
+  return NULL;
+}
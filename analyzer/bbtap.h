@@ -0,0 +1,122 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _BBTAP_H
+#define _BBTAP_H
+
+#include <sigutils/sigutils.h>
+
+#include "worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_BBTAP_DEFAULT_DEPTH 16
+
+struct suscan_analyzer;
+
+/* Sample block shared by several consumers, released by the last one */
+struct suscan_sample_buffer {
+  unsigned int refcnt;
+  SUSCOUNT     size;
+  SUCOMPLEX    data[];
+};
+
+typedef struct suscan_sample_buffer suscan_sample_buffer_t;
+
+/* Initial reference belongs to the caller */
+suscan_sample_buffer_t *suscan_sample_buffer_new(
+    const SUCOMPLEX *data,
+    SUSCOUNT size);
+
+SUINLINE void
+suscan_sample_buffer_ref(suscan_sample_buffer_t *self)
+{
+  __atomic_add_fetch(&self->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+SUINLINE void
+suscan_sample_buffer_unref(suscan_sample_buffer_t *self)
+{
+  if (__atomic_sub_fetch(&self->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+    free(self);
+}
+
+/*
+ * Asynchronous baseband tap. Sample blocks are queued to a bounded queue
+ * and consumed by a dedicated worker, so a slow consumer never blocks the
+ * thread pushing the samples: blocks that find the queue full are dropped
+ * and counted instead. If the tap function fails, the tap is disabled and
+ * drops every subsequent block.
+ */
+struct suscan_bbtap {
+  SUBOOL (*func) (
+      void *privdata,
+      struct suscan_analyzer *analyzer,
+      const SUCOMPLEX *samples,
+      SUSCOUNT length);
+  void *privdata;
+  struct suscan_analyzer *analyzer;
+
+  /* Bounded queue */
+  pthread_mutex_t mutex;
+  SUBOOL          mutex_init;
+  suscan_sample_buffer_t **queue;
+  SUSCOUNT        depth;
+  SUSCOUNT        head;
+  SUSCOUNT        count;
+
+  SUSCOUNT        drops;  /* Written under mutex */
+  SUBOOL          failed;
+
+  struct suscan_mq mq_out; /* Halt notifications only */
+  SUBOOL          mq_init;
+  suscan_worker_t *worker;
+};
+
+typedef struct suscan_bbtap suscan_bbtap_t;
+
+SUINLINE SUSCOUNT
+suscan_bbtap_get_drops(const suscan_bbtap_t *self)
+{
+  return __atomic_load_n(&self->drops, __ATOMIC_RELAXED);
+}
+
+suscan_bbtap_t *suscan_bbtap_new(
+    SUBOOL (*func) (
+        void *privdata,
+        struct suscan_analyzer *analyzer,
+        const SUCOMPLEX *samples,
+        SUSCOUNT length),
+    void *privdata,
+    struct suscan_analyzer *analyzer,
+    SUSCOUNT depth);
+
+/* Never blocks. Returns SU_FALSE if the buffer was dropped. */
+SUBOOL suscan_bbtap_push(suscan_bbtap_t *self, suscan_sample_buffer_t *buf);
+
+SUBOOL suscan_bbtap_destroy(suscan_bbtap_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _BBTAP_H */
@@ -0,0 +1,358 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "signal-catalog"
+
+#include "catalog.h"
+
+#define SUSCAN_SIGNAL_CATALOG_ALPHA .25
+
+void
+suscan_signal_catalog_destroy(suscan_signal_catalog_t *self)
+{
+  if (self->entries != NULL)
+    free(self->entries);
+
+  if (self->scratch != NULL)
+    free(self->scratch);
+
+  free(self);
+}
+
+suscan_signal_catalog_t *
+suscan_signal_catalog_new(SUFLOAT snr, SUFLOAT edge)
+{
+  suscan_signal_catalog_t *new = NULL;
+
+  SU_TRYCATCH(edge >= 0 && edge < .5, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_signal_catalog_t)), goto fail);
+
+  SU_TRYCATCH(
+      new->entries = calloc(
+          SUSCAN_SIGNAL_CATALOG_MAX_ENTRIES,
+          sizeof(struct suscan_signal_entry)),
+      goto fail);
+
+  new->snr  = snr;
+  new->edge = edge;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_signal_catalog_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_signal_catalog_set_threshold(
+    suscan_signal_catalog_t *self,
+    SUFLOAT snr,
+    SUFLOAT edge)
+{
+  self->snr  = snr;
+  self->edge = edge;
+}
+
+void
+suscan_signal_catalog_clear(suscan_signal_catalog_t *self)
+{
+  self->count = 0;
+}
+
+/* Index of the first entry whose center frequency is not below freq */
+SUPRIVATE unsigned int
+suscan_signal_catalog_lower_bound(
+    const suscan_signal_catalog_t *self,
+    SUFREQ freq)
+{
+  unsigned int lo = 0, hi = self->count, mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (self->entries[mid].fc < freq)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/* Quickselect: leaves the k-th smallest element at position k */
+SUPRIVATE SUFLOAT
+suscan_signal_catalog_select(SUFLOAT *data, SUSCOUNT size, SUSCOUNT k)
+{
+  SUSCOUNT lo = 0, hi = size - 1, i, j;
+  SUFLOAT pivot, tmp;
+
+  while (lo < hi) {
+    pivot = data[(lo + hi) / 2];
+    i = lo;
+    j = hi;
+
+    while (i <= j) {
+      while (data[i] < pivot)
+        ++i;
+      while (data[j] > pivot)
+        --j;
+
+      if (i <= j) {
+        tmp = data[i];
+        data[i] = data[j];
+        data[j] = tmp;
+        ++i;
+        if (j == 0)
+          break;
+        --j;
+      }
+    }
+
+    if (k <= j)
+      hi = j;
+    else if (k >= i)
+      lo = i;
+    else
+      break;
+  }
+
+  return data[k];
+}
+
+SUPRIVATE void
+suscan_signal_catalog_merge(
+    suscan_signal_catalog_t *self,
+    SUFREQ fc,
+    SUFLOAT bw,
+    SUFLOAT snr,
+    const struct timeval *now)
+{
+  struct suscan_signal_entry *entry = NULL;
+  struct suscan_signal_entry tmp;
+  unsigned int i, pos, oldest;
+  SUFREQ dist, best = 0;
+
+  pos = suscan_signal_catalog_lower_bound(self, fc);
+
+  /* Only the neighbors of the insertion point may overlap */
+  for (i = pos > 0 ? pos - 1 : 0; i < pos + 1 && i < self->count; ++i) {
+    dist = SU_ABS(self->entries[i].fc - fc);
+    if (dist < .5 * (self->entries[i].bw + bw)
+        && (entry == NULL || dist < best)) {
+      entry = self->entries + i;
+      best  = dist;
+    }
+  }
+
+  if (entry != NULL) {
+    entry->fc += SUSCAN_SIGNAL_CATALOG_ALPHA * (fc - entry->fc);
+    entry->bw += SUSCAN_SIGNAL_CATALOG_ALPHA * (bw - entry->bw);
+    entry->snr = snr;
+    if (snr > entry->peak_snr)
+      entry->peak_snr = snr;
+
+    /* A hop may split a signal in several runs: count it once */
+    if (timercmp(&entry->last_seen, now, !=))
+      ++entry->hits;
+    entry->last_seen = *now;
+
+    /* Restore order, if the center frequency moved past a neighbor */
+    i = entry - self->entries;
+    while (i > 0 && self->entries[i - 1].fc > self->entries[i].fc) {
+      tmp = self->entries[i - 1];
+      self->entries[i - 1] = self->entries[i];
+      self->entries[i] = tmp;
+      --i;
+    }
+
+    while (i + 1 < self->count
+        && self->entries[i + 1].fc < self->entries[i].fc) {
+      tmp = self->entries[i + 1];
+      self->entries[i + 1] = self->entries[i];
+      self->entries[i] = tmp;
+      ++i;
+    }
+
+    return;
+  }
+
+  /* New signal. If full, forget the one silent for longer. */
+  if (self->count == SUSCAN_SIGNAL_CATALOG_MAX_ENTRIES) {
+    oldest = 0;
+    for (i = 1; i < self->count; ++i)
+      if (timercmp(
+          &self->entries[i].last_seen,
+          &self->entries[oldest].last_seen,
+          <))
+        oldest = i;
+
+    memmove(
+        self->entries + oldest,
+        self->entries + oldest + 1,
+        (self->count - oldest - 1) * sizeof(struct suscan_signal_entry));
+    --self->count;
+
+    pos = suscan_signal_catalog_lower_bound(self, fc);
+  }
+
+  memmove(
+      self->entries + pos + 1,
+      self->entries + pos,
+      (self->count - pos) * sizeof(struct suscan_signal_entry));
+  ++self->count;
+
+  entry = self->entries + pos;
+  entry->fc         = fc;
+  entry->bw         = bw;
+  entry->snr        = snr;
+  entry->peak_snr   = snr;
+  entry->first_seen = *now;
+  entry->last_seen  = *now;
+  entry->hits       = 1;
+  entry->visits     = 1;
+}
+
+SUBOOL
+suscan_signal_catalog_feed(
+    suscan_signal_catalog_t *self,
+    SUFREQ fc,
+    SUFLOAT fs,
+    const SUFLOAT *psd,
+    SUSCOUNT size,
+    const struct timeval *now)
+{
+  SUFREQ f_start = fc - .5 * fs;
+  SUFLOAT rbw = fs / size;
+  SUFLOAT floor, thres, peak, psum, wsum;
+  SUSCOUNT first, last, n, i, j, start, end, gap;
+  unsigned int k;
+  SUFLOAT *tmp;
+
+  first = (SUSCOUNT) SU_CEIL(self->edge * size);
+  last  = size - first;
+
+  if (last <= first + SUSCAN_SIGNAL_CATALOG_MIN_BINS)
+    return SU_TRUE;
+
+  n = last - first;
+
+  /* Noise floor: median of the useful part of the PSD */
+  if (n > self->scratch_size) {
+    SU_TRYCATCH(
+        tmp = realloc(self->scratch, n * sizeof(SUFLOAT)),
+        return SU_FALSE);
+    self->scratch = tmp;
+    self->scratch_size = n;
+  }
+
+  memcpy(self->scratch, psd + first, n * sizeof(SUFLOAT));
+  floor = suscan_signal_catalog_select(self->scratch, n, n / 2);
+
+  if (floor <= 0)
+    return SU_TRUE;
+
+  thres = floor * SU_POW(10., self->snr / 10);
+
+  /* Visit every entry within the useful part of the hop */
+  for (k = suscan_signal_catalog_lower_bound(self, f_start + first * rbw);
+      k < self->count && self->entries[k].fc < f_start + last * rbw;
+      ++k)
+    ++self->entries[k].visits;
+
+  /* Look for runs above the threshold, tolerating short gaps */
+  i = first;
+  while (i < last) {
+    if (psd[i] <= thres) {
+      ++i;
+      continue;
+    }
+
+    start = i;
+    end   = i;
+    gap   = 0;
+    peak  = psum = wsum = 0;
+
+    for (j = i; j < last; ++j) {
+      if (psd[j] > thres) {
+        end   = j + 1;
+        gap   = 0;
+        psum += psd[j];
+        wsum += psd[j] * j;
+        if (psd[j] > peak)
+          peak = psd[j];
+      } else if (++gap > SUSCAN_SIGNAL_CATALOG_MAX_GAP) {
+        break;
+      }
+    }
+
+    i = end;
+
+    if (end - start < SUSCAN_SIGNAL_CATALOG_MIN_BINS)
+      continue;
+
+    suscan_signal_catalog_merge(
+        self,
+        f_start + (wsum / psum + .5) * rbw,
+        (end - start) * rbw,
+        SU_POWER_DB(peak / floor),
+        now);
+  }
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_signal_catalog_query(
+    const suscan_signal_catalog_t *self,
+    SUFREQ f_lo,
+    SUFREQ f_hi,
+    struct suscan_signal_entry **entries,
+    unsigned int *count)
+{
+  unsigned int first = 0, last = self->count;
+  struct suscan_signal_entry *copy = NULL;
+
+  if (f_lo < f_hi) {
+    first = suscan_signal_catalog_lower_bound(self, f_lo);
+    last  = first;
+    while (last < self->count && self->entries[last].fc <= f_hi)
+      ++last;
+  }
+
+  if (last > first) {
+    SU_TRYCATCH(
+        copy = malloc((last - first) * sizeof(struct suscan_signal_entry)),
+        return SU_FALSE);
+    memcpy(
+        copy,
+        self->entries + first,
+        (last - first) * sizeof(struct suscan_signal_entry));
+  }
+
+  *entries = copy;
+  *count   = last - first;
+
+  return SU_TRUE;
+}
@@ -0,0 +1,109 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CATALOG_H
+#define _CATALOG_H
+
+#include <sigutils/sigutils.h>
+#include <sys/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_SIGNAL_CATALOG_MAX_ENTRIES   4096
+#define SUSCAN_SIGNAL_CATALOG_DEFAULT_SNR   10.
+#define SUSCAN_SIGNAL_CATALOG_MIN_BINS      2
+#define SUSCAN_SIGNAL_CATALOG_MAX_GAP       2
+
+struct suscan_signal_entry {
+  SUFREQ   fc;          /* Absolute center frequency */
+  SUFLOAT  bw;
+  SUFLOAT  snr;         /* Last SNR (dB) */
+  SUFLOAT  peak_snr;    /* Peak SNR (dB) */
+  struct timeval first_seen;
+  struct timeval last_seen;
+  SUSCOUNT hits;        /* Hops in which it was detected */
+  SUSCOUNT visits;      /* Hops covering it */
+};
+
+SUINLINE SUFLOAT
+suscan_signal_entry_get_duty_cycle(const struct suscan_signal_entry *entry)
+{
+  return entry->visits > 0 ? (SUFLOAT) entry->hits / entry->visits : 0;
+}
+
+/*
+ * Persistent catalog of signals found by sweeping. Every hop PSD is
+ * searched for runs of bins exceeding the noise floor (the median of the
+ * PSD) by `snr' dB, and detections are merged with the entries of
+ * overlapping frequency. Entries are kept sorted by center frequency.
+ * When full, the entry that has been silent for longer is evicted.
+ */
+struct suscan_signal_catalog {
+  SUFLOAT  snr;
+  SUFLOAT  edge;        /* Fraction of the hop discarded at both sides */
+  struct suscan_signal_entry *entries;
+  unsigned int count;
+  SUFLOAT *scratch;     /* For noise floor estimation */
+  SUSCOUNT scratch_size;
+};
+
+typedef struct suscan_signal_catalog suscan_signal_catalog_t;
+
+SUINLINE unsigned int
+suscan_signal_catalog_get_count(const suscan_signal_catalog_t *self)
+{
+  return self->count;
+}
+
+suscan_signal_catalog_t *suscan_signal_catalog_new(SUFLOAT snr, SUFLOAT edge);
+
+void suscan_signal_catalog_set_threshold(
+    suscan_signal_catalog_t *self,
+    SUFLOAT snr,
+    SUFLOAT edge);
+
+/* Searches a hop PSD (ascending frequency order) centered at fc */
+SUBOOL suscan_signal_catalog_feed(
+    suscan_signal_catalog_t *self,
+    SUFREQ fc,
+    SUFLOAT fs,
+    const SUFLOAT *psd,
+    SUSCOUNT size,
+    const struct timeval *now);
+
+/* Copies the entries within [f_lo, f_hi]. If f_lo == f_hi, copies all */
+SUBOOL suscan_signal_catalog_query(
+    const suscan_signal_catalog_t *self,
+    SUFREQ f_lo,
+    SUFREQ f_hi,
+    struct suscan_signal_entry **entries,
+    unsigned int *count);
+
+void suscan_signal_catalog_clear(suscan_signal_catalog_t *self);
+
+void suscan_signal_catalog_destroy(suscan_signal_catalog_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _CATALOG_H */
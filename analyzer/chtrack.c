@@ -0,0 +1,257 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "channel-tracker"
+
+#include "chtrack.h"
+
+void
+suscan_channel_tracker_destroy(suscan_channel_tracker_t *self)
+{
+  unsigned int i;
+
+  for (i = 0; i < self->track_count; ++i)
+    if (self->track_list[i] != NULL)
+      free(self->track_list[i]);
+
+  if (self->track_list != NULL)
+    free(self->track_list);
+
+  if (self->delta_list != NULL)
+    free(self->delta_list);
+
+  free(self);
+}
+
+suscan_channel_tracker_t *
+suscan_channel_tracker_new(void)
+{
+  suscan_channel_tracker_t *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(suscan_channel_tracker_t)),
+      goto fail);
+
+  new->next_id = 1;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_channel_tracker_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_channel_tracker_push_delta(
+    suscan_channel_tracker_t *self,
+    const struct suscan_channel_track *track,
+    enum suscan_channel_delta_kind kind)
+{
+  struct suscan_channel_delta *tmp;
+  unsigned int alloc;
+
+  if (self->delta_count == self->delta_alloc) {
+    alloc = self->delta_alloc == 0 ? 16 : 2 * self->delta_alloc;
+    SU_TRYCATCH(
+        tmp = realloc(
+            self->delta_list,
+            alloc * sizeof(struct suscan_channel_delta)),
+        return SU_FALSE);
+
+    self->delta_list  = tmp;
+    self->delta_alloc = alloc;
+  }
+
+  self->delta_list[self->delta_count].id      = track->id;
+  self->delta_list[self->delta_count].kind    = kind;
+  self->delta_list[self->delta_count].channel = track->channel;
+  ++self->delta_count;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE struct suscan_channel_track *
+suscan_channel_tracker_match(
+    suscan_channel_tracker_t *self,
+    const struct sigutils_channel *channel)
+{
+  struct suscan_channel_track *best = NULL;
+  struct suscan_channel_track *track;
+  SUFLOAT dist, best_dist = 0;
+  unsigned int i;
+
+  for (i = 0; i < self->track_count; ++i) {
+    track = self->track_list[i];
+
+    if (track == NULL || track->claimed)
+      continue;
+
+    /* Spans must overlap */
+    if (channel->f_lo > track->channel.f_hi
+        || channel->f_hi < track->channel.f_lo)
+      continue;
+
+    dist = SU_ABS(channel->fc - track->channel.fc);
+    if (best == NULL || dist < best_dist) {
+      best      = track;
+      best_dist = dist;
+    }
+  }
+
+  return best;
+}
+
+SUPRIVATE SUBOOL
+suscan_channel_tracker_has_changed(
+    const struct suscan_channel_track *track,
+    const struct sigutils_channel *channel)
+{
+  SUFLOAT tol = SUSCAN_CHANNEL_TRACKER_FREQ_TOL * track->channel.bw;
+
+  return SU_ABS(channel->fc - track->channel.fc) > tol
+      || SU_ABS(channel->bw - track->channel.bw) > tol
+      || SU_ABS(channel->snr - track->channel.snr)
+          > SUSCAN_CHANNEL_TRACKER_SNR_TOL;
+}
+
+SUPRIVATE struct suscan_channel_track *
+suscan_channel_tracker_add_track(
+    suscan_channel_tracker_t *self,
+    const struct sigutils_channel *channel)
+{
+  struct suscan_channel_track *new = NULL;
+  unsigned int i;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_channel_track)), goto fail);
+
+  new->id      = self->next_id++;
+  new->claimed = SU_TRUE;
+  new->channel = *channel;
+
+  /* Reuse slots of removed tracks first */
+  for (i = 0; i < self->track_count; ++i)
+    if (self->track_list[i] == NULL) {
+      self->track_list[i] = new;
+      return new;
+    }
+
+  SU_TRYCATCH(PTR_LIST_APPEND_CHECK(self->track, new) != -1, goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    free(new);
+
+  return NULL;
+}
+
+SUBOOL
+suscan_channel_tracker_update(
+    suscan_channel_tracker_t *self,
+    struct sigutils_channel **list,
+    unsigned int count,
+    SUFREQ fc,
+    SUBOOL snapshot)
+{
+  struct suscan_channel_track *track;
+  struct sigutils_channel channel;
+  unsigned int i;
+
+  self->delta_count = 0;
+
+  for (i = 0; i < self->track_count; ++i)
+    if (self->track_list[i] != NULL)
+      self->track_list[i]->claimed = SU_FALSE;
+
+  for (i = 0; i < count; ++i) {
+    if (list[i] == NULL || !SU_CHANNEL_IS_VALID(list[i]))
+      continue;
+
+    channel       = *list[i];
+    channel.fc   += fc;
+    channel.f_lo += fc;
+    channel.f_hi += fc;
+    channel.ft    = fc;
+
+    if ((track = suscan_channel_tracker_match(self, &channel)) != NULL) {
+      track->claimed = SU_TRUE;
+
+      /*
+       * Keep the last reported state, so slow drifts are eventually
+       * reported too.
+       */
+      if (suscan_channel_tracker_has_changed(track, &channel)) {
+        track->channel = channel;
+        if (!snapshot)
+          SU_TRYCATCH(
+              suscan_channel_tracker_push_delta(
+                  self,
+                  track,
+                  SUSCAN_CHANNEL_DELTA_CHANGED),
+              return SU_FALSE);
+      }
+    } else {
+      SU_TRYCATCH(
+          track = suscan_channel_tracker_add_track(self, &channel),
+          return SU_FALSE);
+
+      if (!snapshot)
+        SU_TRYCATCH(
+            suscan_channel_tracker_push_delta(
+                self,
+                track,
+                SUSCAN_CHANNEL_DELTA_ADDED),
+            return SU_FALSE);
+    }
+  }
+
+  for (i = 0; i < self->track_count; ++i) {
+    if ((track = self->track_list[i]) == NULL)
+      continue;
+
+    if (!track->claimed) {
+      /* Snapshots replace the whole list, no need to report these */
+      if (!snapshot)
+        SU_TRYCATCH(
+            suscan_channel_tracker_push_delta(
+                self,
+                track,
+                SUSCAN_CHANNEL_DELTA_REMOVED),
+            return SU_FALSE);
+      free(track);
+      self->track_list[i] = NULL;
+    } else if (snapshot) {
+      SU_TRYCATCH(
+          suscan_channel_tracker_push_delta(
+              self,
+              track,
+              SUSCAN_CHANNEL_DELTA_ADDED),
+          return SU_FALSE);
+    }
+  }
+
+  return SU_TRUE;
+}
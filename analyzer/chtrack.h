@@ -0,0 +1,102 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _CHTRACK_H
+#define _CHTRACK_H
+
+#include <util.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_CHANNEL_TRACKER_FREQ_TOL  .02 /* Fraction of the bandwidth */
+#define SUSCAN_CHANNEL_TRACKER_SNR_TOL   1.  /* dB */
+
+enum suscan_channel_delta_kind {
+  SUSCAN_CHANNEL_DELTA_ADDED,
+  SUSCAN_CHANNEL_DELTA_CHANGED,
+  SUSCAN_CHANNEL_DELTA_REMOVED
+};
+
+struct suscan_channel_delta {
+  uint32_t id;
+  enum suscan_channel_delta_kind kind;
+  struct sigutils_channel channel; /* Last known state, if removed */
+};
+
+struct suscan_channel_track {
+  uint32_t id;
+  SUBOOL   claimed;
+  struct sigutils_channel channel;
+};
+
+/*
+ * Channel tracker. Assigns persistent IDs to the channels reported by the
+ * detector, matching every channel of an update against the track with
+ * overlapping span and closest center frequency, and keeps the list of
+ * changes with respect to the previous update. Channels whose frequency,
+ * bandwidth and SNR did not move beyond the tolerances are not reported
+ * as changed.
+ */
+struct suscan_channel_tracker {
+  uint32_t next_id;
+  PTR_LIST(struct suscan_channel_track, track);
+  struct suscan_channel_delta *delta_list;
+  unsigned int delta_count;
+  unsigned int delta_alloc;
+};
+
+typedef struct suscan_channel_tracker suscan_channel_tracker_t;
+
+SUINLINE const struct suscan_channel_delta *
+suscan_channel_tracker_get_deltas(
+    const suscan_channel_tracker_t *self,
+    unsigned int *count)
+{
+  *count = self->delta_count;
+
+  return self->delta_list;
+}
+
+suscan_channel_tracker_t *suscan_channel_tracker_new(void);
+
+/*
+ * Updates the tracks with a channel list, shifted `fc' Hz (invalid
+ * channels are ignored). If snapshot is set, the resulting deltas list
+ * every channel as added.
+ */
+SUBOOL suscan_channel_tracker_update(
+    suscan_channel_tracker_t *self,
+    struct sigutils_channel **list,
+    unsigned int count,
+    SUFREQ fc,
+    SUBOOL snapshot);
+
+void suscan_channel_tracker_destroy(suscan_channel_tracker_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _CHTRACK_H */
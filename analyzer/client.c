@@ -580,3 +580,161 @@ done:
 }
 
 
+
+SUBOOL
+suscan_analyzer_set_inspector_latency_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT latency,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_LATENCY,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->latency = latency;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send set_latency command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
+
+
+
+SUBOOL
+suscan_analyzer_set_inspector_estimator_interval_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUFLOAT interval,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_ESTIMATOR_INTERVAL,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->interval = interval;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send set_estimator_interval command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_inspector_wall_clock_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUBOOL wall_clock,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_WALL_CLOCK,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->wall_clock = wall_clock;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send set_wall_clock command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_inspector_squelch_async(
+    suscan_analyzer_t *analyzer,
+    SUHANDLE handle,
+    SUBOOL enabled,
+    SUFLOAT level_db,
+    SUFLOAT hang,
+    uint32_t req_id)
+{
+  struct suscan_analyzer_inspector_msg *req = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      req = suscan_analyzer_inspector_msg_new(
+          SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_SQUELCH,
+          req_id),
+      goto done);
+
+  req->handle = handle;
+  req->squelch_enabled = enabled;
+  req->squelch_level = level_db;
+  req->squelch_hang = hang;
+
+  if (!suscan_analyzer_write(
+      analyzer,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+      req)) {
+    SU_ERROR("Failed to send set_squelch command\n");
+    goto done;
+  }
+
+  req = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (req != NULL)
+    suscan_analyzer_inspector_msg_destroy(req);
+
+  return ok;
+}
@@ -23,6 +23,8 @@
 #define SU_LOG_DOMAIN "estimator"
 
 #include "estimator.h"
+#include "inspector/pipeline.h"
+#include <sigutils/taps.h>
 
 PTR_LIST_CONST(struct suscan_estimator_class, estimator_class);
 
@@ -47,7 +49,12 @@ suscan_estimator_class_register(const struct suscan_estimator_class *class)
   SU_TRYCATCH(class->ctor  != NULL, return SU_FALSE);
   SU_TRYCATCH(class->dtor  != NULL, return SU_FALSE);
   SU_TRYCATCH(class->read  != NULL, return SU_FALSE);
-  SU_TRYCATCH(class->feed  != NULL, return SU_FALSE);
+  SU_TRYCATCH(
+      class->feed != NULL || class->update != NULL,
+      return SU_FALSE);
+  SU_TRYCATCH(
+      class->update == NULL || class->stages != 0,
+      return SU_FALSE);
 
   SU_TRYCATCH(
       suscan_estimator_class_lookup(class->name) == NULL,
@@ -86,9 +93,27 @@ suscan_estimator_feed(
     const SUCOMPLEX *samples,
     SUSCOUNT size)
 {
+  if (estimator->classptr->feed == NULL)
+    return SU_TRUE;
+
   return (estimator->classptr->feed) (estimator->privdata, samples, size);
 }
 
+SUBOOL
+suscan_estimator_update(
+    suscan_estimator_t *estimator,
+    const suscan_estimator_frontend_t *fe)
+{
+  if (estimator->classptr->update == NULL)
+    return SU_TRUE;
+
+  /* Front-end did not compute what we need in this window */
+  if (!suscan_estimator_frontend_has_stage(fe, estimator->classptr->stages))
+    return SU_TRUE;
+
+  return (estimator->classptr->update) (estimator->privdata, fe);
+}
+
 SUBOOL
 suscan_estimator_read(const suscan_estimator_t *estimator, SUFLOAT *out)
 {
@@ -104,11 +129,204 @@ suscan_estimator_destroy(suscan_estimator_t *estimator)
   free(estimator);
 }
 
+/************************* Shared estimator front-end ************************/
+void
+suscan_estimator_frontend_destroy(suscan_estimator_frontend_t *fe)
+{
+  suscan_inspector_fftw_lock();
+  if (fe->fft_plan != NULL)
+    SU_FFTW(_destroy_plan) (fe->fft_plan);
+  if (fe->ifft_plan != NULL)
+    SU_FFTW(_destroy_plan) (fe->ifft_plan);
+  if (fe->diff_plan != NULL)
+    SU_FFTW(_destroy_plan) (fe->diff_plan);
+  suscan_inspector_fftw_unlock();
+
+  if (fe->fft != NULL)
+    SU_FFTW(_free) (fe->fft);
+
+  if (fe->diff != NULL)
+    SU_FFTW(_free) (fe->diff);
+
+  if (fe->buffer != NULL)
+    free(fe->buffer);
+
+  if (fe->window_func != NULL)
+    free(fe->window_func);
+
+  if (fe->psd != NULL)
+    free(fe->psd);
+
+  if (fe->acorr != NULL)
+    free(fe->acorr);
+
+  if (fe->diff_psd != NULL)
+    free(fe->diff_psd);
+
+  free(fe);
+}
+
+suscan_estimator_frontend_t *
+suscan_estimator_frontend_new(SUFLOAT fs, SUSCOUNT size)
+{
+  suscan_estimator_frontend_t *new = NULL;
+  unsigned int i;
+
+  SU_TRYCATCH(size > 1, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_estimator_frontend_t)), goto fail);
+
+  new->fs = fs;
+  new->size = size;
+
+  SU_TRYCATCH(new->buffer = malloc(size * sizeof(SUCOMPLEX)), goto fail);
+  SU_TRYCATCH(new->window_func = malloc(size * sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->psd = calloc(size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->acorr = calloc(size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->diff_psd = calloc(size, sizeof(SUFLOAT)), goto fail);
+
+  for (i = 0; i < size; ++i)
+    new->window_func[i] = 1;
+
+  su_taps_apply_hann(new->window_func, size);
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(size * sizeof(SU_FFTW(_complex))),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->diff = SU_FFTW(_malloc)(size * sizeof(SU_FFTW(_complex))),
+      goto fail);
+
+  suscan_inspector_fftw_lock();
+  new->fft_plan = SU_FFTW(_plan_dft_1d)(
+      size,
+      new->fft,
+      new->fft,
+      FFTW_FORWARD,
+      FFTW_MEASURE);
+
+  /* Wiener-Khinchin: autocorrelation is the IFFT of the PSD */
+  new->ifft_plan = SU_FFTW(_plan_dft_1d)(
+      size,
+      new->fft,
+      new->fft,
+      FFTW_BACKWARD,
+      FFTW_MEASURE);
+
+  new->diff_plan = SU_FFTW(_plan_dft_1d)(
+      size,
+      new->diff,
+      new->diff,
+      FFTW_FORWARD,
+      FFTW_MEASURE);
+  suscan_inspector_fftw_unlock();
+
+  SU_TRYCATCH(new->fft_plan != NULL, goto fail);
+  SU_TRYCATCH(new->ifft_plan != NULL, goto fail);
+  SU_TRYCATCH(new->diff_plan != NULL, goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_estimator_frontend_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_estimator_frontend_compute(suscan_estimator_frontend_t *fe)
+{
+  unsigned int i;
+  SUCOMPLEX *fft = (SUCOMPLEX *) fe->fft;
+  SUCOMPLEX *diff = (SUCOMPLEX *) fe->diff;
+  SUCOMPLEX prev;
+  SUFLOAT k = 1. / fe->size;
+  SUFLOAT norm;
+
+  fe->computed = 0;
+
+  if (fe->stages & (SUSCAN_ESTIMATOR_STAGE_SPECTRUM
+      | SUSCAN_ESTIMATOR_STAGE_ACORR)) {
+    for (i = 0; i < fe->size; ++i)
+      fft[i] = fe->buffer[i] * fe->window_func[i];
+
+    SU_FFTW(_execute) (fe->fft_plan);
+
+    for (i = 0; i < fe->size; ++i) {
+      fe->psd[i] = k * SU_C_REAL(fft[i] * SU_C_CONJ(fft[i]));
+      fft[i] = fe->psd[i];
+    }
+
+    fe->computed |= SUSCAN_ESTIMATOR_STAGE_SPECTRUM;
+
+    if (fe->stages & SUSCAN_ESTIMATOR_STAGE_ACORR) {
+      SU_FFTW(_execute) (fe->ifft_plan);
+
+      norm = SU_C_REAL(fft[0]);
+      if (norm > 0) {
+        norm = 1. / norm;
+        for (i = 0; i < fe->size; ++i)
+          fe->acorr[i] = norm * SU_C_REAL(fft[i]);
+
+        fe->computed |= SUSCAN_ESTIMATOR_STAGE_ACORR;
+      }
+    }
+  }
+
+  if (fe->stages & SUSCAN_ESTIMATOR_STAGE_DIFF) {
+    prev = fe->prev;
+    for (i = 0; i < fe->size; ++i) {
+      diff[i] = fe->buffer[i] - prev;
+      diff[i] *= SU_C_CONJ(diff[i]);
+      prev = fe->buffer[i];
+    }
+
+    SU_FFTW(_execute) (fe->diff_plan);
+
+    for (i = 0; i < fe->size; ++i)
+      fe->diff_psd[i] = k * SU_C_REAL(diff[i] * SU_C_CONJ(diff[i]));
+
+    fe->computed |= SUSCAN_ESTIMATOR_STAGE_DIFF;
+  }
+
+  fe->prev = fe->buffer[fe->size - 1];
+  ++fe->windows;
+}
+
+SUSCOUNT
+suscan_estimator_frontend_feed(
+    suscan_estimator_frontend_t *fe,
+    const SUCOMPLEX *samples,
+    SUSCOUNT size)
+{
+  SUSCOUNT avail = fe->size - fe->ptr;
+
+  fe->computed = 0;
+
+  if (size > avail)
+    size = avail;
+
+  memcpy(fe->buffer + fe->ptr, samples, size * sizeof(SUCOMPLEX));
+  fe->ptr += size;
+
+  if (fe->ptr == fe->size) {
+    fe->ptr = 0;
+    if (fe->stages != 0)
+      suscan_estimator_frontend_compute(fe);
+  }
+
+  return size;
+}
+
 SUBOOL
 suscan_init_estimators(void)
 {
   SU_TRYCATCH(suscan_estimator_fac_register(), return SU_FALSE);
   SU_TRYCATCH(suscan_estimator_nonlinear_register(), return SU_FALSE);
+  SU_TRYCATCH(suscan_estimator_carrier_register(), return SU_FALSE);
+  SU_TRYCATCH(suscan_estimator_snr_register(), return SU_FALSE);
 
   return SU_TRUE;
 }
@@ -28,6 +28,82 @@ extern "C" {
 #include <sigutils/sigutils.h>
 
 #define SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ 1024
+#define SUSCAN_DEFAULT_ESTIMATOR_INTERVAL .1
+
+/*
+ * Stages of the shared estimator front-end. Every estimator declares
+ * the stages it consumes, and the front-end computes the union of them
+ * once per window, no matter how many estimators are attached to it.
+ */
+#define SUSCAN_ESTIMATOR_STAGE_SPECTRUM 1 /* Windowed PSD of the signal */
+#define SUSCAN_ESTIMATOR_STAGE_ACORR    2 /* Autocorrelation (from PSD) */
+#define SUSCAN_ESTIMATOR_STAGE_DIFF     4 /* PSD of |x[n] - x[n - 1]|^2 */
+
+struct suscan_estimator_frontend {
+  SUFLOAT  fs;
+  SUSCOUNT size;
+  SUSCOUNT ptr;
+  SUSCOUNT windows;         /* Number of windows processed so far */
+  unsigned int stages;      /* Stages requested by enabled estimators */
+  unsigned int computed;    /* Stages available for the last window */
+  SUCOMPLEX prev;           /* Last sample of the previous window */
+
+  SUCOMPLEX *buffer;        /* Raw samples */
+  SUFLOAT   *window_func;
+
+  SU_FFTW(_complex) *fft;
+  SU_FFTW(_plan)     fft_plan;
+  SU_FFTW(_plan)     ifft_plan;
+
+  SU_FFTW(_complex) *diff;
+  SU_FFTW(_plan)     diff_plan;
+
+  SUFLOAT *psd;             /* |X[k]|^2 / N */
+  SUFLOAT *acorr;           /* Autocorrelation, normalized to acorr[0] */
+  SUFLOAT *diff_psd;        /* Spectrum of the nonlinear difference */
+};
+
+typedef struct suscan_estimator_frontend suscan_estimator_frontend_t;
+
+SUINLINE SUBOOL
+suscan_estimator_frontend_has_stage(
+    const suscan_estimator_frontend_t *fe,
+    unsigned int stage)
+{
+  return (fe->computed & stage) == stage;
+}
+
+suscan_estimator_frontend_t *suscan_estimator_frontend_new(
+    SUFLOAT fs,
+    SUSCOUNT size);
+
+/*
+ * Consumes samples until the current window is full. Returns the number
+ * of samples consumed, which is never zero if size is not. This cannot
+ * fail. When a window is complete, the requested stages are computed and
+ * suscan_estimator_frontend_ready returns SU_TRUE until the next call to
+ * feed.
+ */
+SUSCOUNT suscan_estimator_frontend_feed(
+    suscan_estimator_frontend_t *fe,
+    const SUCOMPLEX *samples,
+    SUSCOUNT size);
+
+SUINLINE SUBOOL
+suscan_estimator_frontend_ready(const suscan_estimator_frontend_t *fe)
+{
+  return fe->computed != 0;
+}
+
+SUINLINE void
+suscan_estimator_frontend_set_stages(
+    suscan_estimator_frontend_t *fe,
+    unsigned int stages)
+{
+  fe->stages = stages;
+}
+
+void suscan_estimator_frontend_destroy(suscan_estimator_frontend_t *fe);
 
 struct suscan_estimator_class {
   const char *name;
@@ -36,8 +112,17 @@ struct suscan_estimator_class {
 
   void * (*ctor) (SUSCOUNT fs);
 
+  /* Raw sample feed. Optional if the estimator relies on the front-end */
   SUBOOL (*feed) (void *privdata, const SUCOMPLEX *samples, SUSCOUNT size);
 
+  /* Front-end stages consumed by update() */
+  unsigned int stages;
+
+  /* Called once per front-end window. Optional */
+  SUBOOL (*update) (
+      void *privdata,
+      const suscan_estimator_frontend_t *fe);
+
   SUBOOL (*read) (const void *privdata, SUFLOAT *out);
 
   void (*dtor) (void *privdata);
@@ -47,6 +132,7 @@ struct suscan_estimator {
   const struct suscan_estimator_class *classptr;
   void *privdata;
   SUBOOL enabled;
+  SUBOOL new_enabled; /* Requested state, only accessed atomically */
 };
 
 typedef struct suscan_estimator suscan_estimator_t;
@@ -60,10 +146,18 @@ suscan_estimator_is_enabled(const suscan_estimator_t *estimator)
   return estimator->enabled;
 }
 
+/* Called from any thread. The state changes when the owner applies it */
 SUINLINE void
 suscan_estimator_set_enabled(suscan_estimator_t *estimator, SUBOOL state)
 {
-  estimator->enabled = state;
+  __atomic_store_n(&estimator->new_enabled, state, __ATOMIC_RELAXED);
+}
+
+SUINLINE void
+suscan_estimator_apply_enabled(suscan_estimator_t *estimator)
+{
+  estimator->enabled =
+      __atomic_load_n(&estimator->new_enabled, __ATOMIC_RELAXED);
 }
 
 SUBOOL suscan_estimator_class_register(
@@ -78,6 +172,22 @@ SUBOOL suscan_estimator_feed(
     const SUCOMPLEX *samples,
     SUSCOUNT size);
 
+SUBOOL suscan_estimator_update(
+    suscan_estimator_t *estimator,
+    const suscan_estimator_frontend_t *fe);
+
+SUINLINE unsigned int
+suscan_estimator_get_stages(const suscan_estimator_t *estimator)
+{
+  return estimator->classptr->stages;
+}
+
+SUINLINE SUBOOL
+suscan_estimator_wants_samples(const suscan_estimator_t *estimator)
+{
+  return estimator->classptr->feed != NULL;
+}
+
 SUBOOL suscan_estimator_read(
     const suscan_estimator_t *estimator,
     SUFLOAT *out);
@@ -87,6 +197,8 @@ void suscan_estimator_destroy(suscan_estimator_t *estimator);
 /******************** Builtin channel estimators *****************************/
 SUBOOL suscan_estimator_fac_register(void);
 SUBOOL suscan_estimator_nonlinear_register(void);
+SUBOOL suscan_estimator_carrier_register(void);
+SUBOOL suscan_estimator_snr_register(void);
 
 SUBOOL suscan_init_estimators(void);
 
@@ -0,0 +1,258 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "carrier-estimator"
+
+#include "estimator.h"
+
+#define SUSCAN_ESTIMATOR_CARRIER_BINS    17 /* Bins tracked around the peak */
+#define SUSCAN_ESTIMATOR_CARRIER_DAMPING .99999
+
+/*
+ * Carrier offset estimator. Instead of computing a full FFT every time,
+ * we run a sliding DFT on a handful of bins around the expected carrier.
+ * Each sample costs SUSCAN_ESTIMATOR_CARRIER_BINS complex products. If the
+ * peak drifts to the edge of the tracked bins, they are re-centered and
+ * recomputed from the sample history (this should happen rarely).
+ */
+struct suscan_estimator_carrier {
+  SUFLOAT    fs;
+  SUSCOUNT   size;
+  SUCOMPLEX *history;
+  SUSCOUNT   ptr;
+  SUSCOUNT   filled;
+  SUSCOUNT   since_check;
+  int        center;
+  SUFLOAT    r;
+  SUFLOAT    rN;
+  SUCOMPLEX  bins[SUSCAN_ESTIMATOR_CARRIER_BINS];
+  SUCOMPLEX  twiddle[SUSCAN_ESTIMATOR_CARRIER_BINS];
+};
+
+SUINLINE int
+suscan_estimator_carrier_bin_index(
+    const struct suscan_estimator_carrier *carrier,
+    unsigned int j)
+{
+  return carrier->center + (int) j - SUSCAN_ESTIMATOR_CARRIER_BINS / 2;
+}
+
+SUPRIVATE void
+suscan_estimator_carrier_dtor(void *private)
+{
+  struct suscan_estimator_carrier *carrier =
+      (struct suscan_estimator_carrier *) private;
+
+  if (carrier->history != NULL)
+    free(carrier->history);
+
+  free(carrier);
+}
+
+SUPRIVATE void
+suscan_estimator_carrier_init_twiddles(struct suscan_estimator_carrier *carrier)
+{
+  unsigned int j;
+  int k;
+
+  for (j = 0; j < SUSCAN_ESTIMATOR_CARRIER_BINS; ++j) {
+    k = suscan_estimator_carrier_bin_index(carrier, j);
+    carrier->twiddle[j] = SU_C_EXP(I * 2 * PI * k / (SUFLOAT) carrier->size);
+  }
+}
+
+SUPRIVATE void *
+suscan_estimator_carrier_ctor(SUSCOUNT fs)
+{
+  struct suscan_estimator_carrier *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_estimator_carrier)),
+      goto fail);
+
+  new->fs = fs;
+  new->size = SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ;
+  new->r  = SUSCAN_ESTIMATOR_CARRIER_DAMPING;
+  new->rN = SU_POW(new->r, new->size);
+
+  SU_TRYCATCH(new->history = calloc(new->size, sizeof(SUCOMPLEX)), goto fail);
+
+  suscan_estimator_carrier_init_twiddles(new);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_estimator_carrier_dtor(new);
+
+  return NULL;
+}
+
+SUPRIVATE unsigned int
+suscan_estimator_carrier_find_peak(
+    const struct suscan_estimator_carrier *carrier,
+    SUFLOAT *mag)
+{
+  unsigned int j, max_j = 0;
+  SUFLOAT max = 0, this;
+
+  for (j = 0; j < SUSCAN_ESTIMATOR_CARRIER_BINS; ++j) {
+    this = SU_C_REAL(carrier->bins[j] * SU_C_CONJ(carrier->bins[j]));
+    if (this > max) {
+      max = this;
+      max_j = j;
+    }
+  }
+
+  if (mag != NULL)
+    *mag = max;
+
+  return max_j;
+}
+
+/* Re-centers the tracked bins and recomputes them from the history */
+SUPRIVATE void
+suscan_estimator_carrier_recenter(
+    struct suscan_estimator_carrier *carrier,
+    int center)
+{
+  unsigned int j, m;
+  SUSCOUNT p;
+  SUCOMPLEX acc, w, wm;
+  int k;
+
+  /* Keep the center within the unambiguous range */
+  if (center >= (int) carrier->size / 2)
+    center -= carrier->size;
+  else if (center < -(int) carrier->size / 2)
+    center += carrier->size;
+
+  carrier->center = center;
+  suscan_estimator_carrier_init_twiddles(carrier);
+
+  for (j = 0; j < SUSCAN_ESTIMATOR_CARRIER_BINS; ++j) {
+    k = suscan_estimator_carrier_bin_index(carrier, j);
+    w = SU_C_EXP(-I * 2 * PI * k / (SUFLOAT) carrier->size);
+    wm = 1;
+    acc = 0;
+    p = carrier->ptr; /* Oldest sample */
+
+    for (m = 0; m < carrier->size; ++m) {
+      acc += carrier->history[p] * wm;
+      wm *= w;
+      if (++p == carrier->size)
+        p = 0;
+    }
+
+    carrier->bins[j] = acc;
+  }
+}
+
+SUPRIVATE SUBOOL
+suscan_estimator_carrier_feed(
+    void *private,
+    const SUCOMPLEX *x,
+    SUSCOUNT size)
+{
+  struct suscan_estimator_carrier *carrier =
+      (struct suscan_estimator_carrier *) private;
+  SUSCOUNT i;
+  unsigned int j;
+  SUCOMPLEX delta;
+
+  for (i = 0; i < size; ++i) {
+    delta = x[i] - carrier->rN * carrier->history[carrier->ptr];
+    carrier->history[carrier->ptr] = x[i];
+    if (++carrier->ptr == carrier->size)
+      carrier->ptr = 0;
+
+    for (j = 0; j < SUSCAN_ESTIMATOR_CARRIER_BINS; ++j)
+      carrier->bins[j] =
+          carrier->twiddle[j] * (carrier->r * carrier->bins[j] + delta);
+  }
+
+  if (carrier->filled < carrier->size)
+    carrier->filled += size;
+
+  /* Check whether the peak went out of the tracked range */
+  carrier->since_check += size;
+  if (carrier->filled >= carrier->size
+      && carrier->since_check >= carrier->size) {
+    carrier->since_check = 0;
+    j = suscan_estimator_carrier_find_peak(carrier, NULL);
+    if (j == 0 || j == SUSCAN_ESTIMATOR_CARRIER_BINS - 1)
+      suscan_estimator_carrier_recenter(
+          carrier,
+          suscan_estimator_carrier_bin_index(carrier, j));
+  }
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_estimator_carrier_read(const void *private, SUFLOAT *out)
+{
+  const struct suscan_estimator_carrier *carrier =
+      (const struct suscan_estimator_carrier *) private;
+  unsigned int j;
+  SUFLOAT max, prev, next, denom, delta = 0;
+
+  if (carrier->filled < carrier->size)
+    return SU_FALSE;
+
+  j = suscan_estimator_carrier_find_peak(carrier, &max);
+  if (max == 0)
+    return SU_FALSE;
+
+  /* Parabolic interpolation of the peak */
+  if (j > 0 && j < SUSCAN_ESTIMATOR_CARRIER_BINS - 1) {
+    prev = SU_C_ABS(carrier->bins[j - 1]);
+    next = SU_C_ABS(carrier->bins[j + 1]);
+    max  = SU_SQRT(max);
+    denom = prev - 2 * max + next;
+    if (denom != 0)
+      delta = .5 * (prev - next) / denom;
+  }
+
+  *out = (suscan_estimator_carrier_bin_index(carrier, j) + delta)
+      * carrier->fs / carrier->size;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_estimator_carrier_register(void)
+{
+  static struct suscan_estimator_class class = {
+      .name  = "carrier-sdft",
+      .desc  = "Sliding DFT carrier offset estimator",
+      .field = "afc.offset",
+      .ctor  = suscan_estimator_carrier_ctor,
+      .feed  = suscan_estimator_carrier_feed,
+      .read  = suscan_estimator_carrier_read,
+      .dtor  = suscan_estimator_carrier_dtor
+  };
+
+  SU_TRYCATCH(suscan_estimator_class_register(&class), return SU_FALSE);
+
+  return SU_TRUE;
+}
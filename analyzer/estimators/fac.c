@@ -22,33 +22,105 @@
 
 #define SU_LOG_DOMAIN "fac-estimator"
 
-#include <sigutils/detect.h>
-#include "source.h"
 #include "estimator.h"
 
+#define SUSCAN_ESTIMATOR_FAC_ALPHA .1
+
+/*
+ * FAC (fast autocorrelation) baud estimator. The autocorrelation is
+ * provided by the shared estimator front-end, and here we just average it
+ * and look for its first valley, which lies around the symbol period.
+ */
+struct suscan_estimator_fac {
+  SUFLOAT  fs;
+  SUSCOUNT size;
+  SUBOOL   primed;
+  SUFLOAT *acorr;
+  SUFLOAT  baud;
+};
+
+SUPRIVATE void
+suscan_estimator_fac_dtor(void *private)
+{
+  struct suscan_estimator_fac *fac = (struct suscan_estimator_fac *) private;
+
+  if (fac->acorr != NULL)
+    free(fac->acorr);
+
+  free(fac);
+}
+
 SUPRIVATE void *
 suscan_estimator_fac_ctor(SUSCOUNT fs)
 {
-  struct sigutils_channel_detector_params cd_params =
-      sigutils_channel_detector_params_INITIALIZER;
+  struct suscan_estimator_fac *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_estimator_fac)), goto fail);
+
+  new->fs = fs;
+  new->size = SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ;
+
+  SU_TRYCATCH(new->acorr = calloc(new->size, sizeof(SUFLOAT)), goto fail);
 
-  cd_params.samp_rate = fs;
-  cd_params.window_size = SUSCAN_SOURCE_DEFAULT_BUFSIZ;
-  cd_params.tune = SU_FALSE; /* Estimators expect baseband signals */
-  cd_params.mode = SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION;
+  return new;
 
-  return su_channel_detector_new(&cd_params);
+fail:
+  if (new != NULL)
+    suscan_estimator_fac_dtor(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_estimator_fac_find_baud(struct suscan_estimator_fac *fac)
+{
+  unsigned int i;
+  SUFLOAT prev, this, next;
+  SUFLOAT tau;
+
+  fac->baud = 0;
+
+  /* Only the first half makes sense: the rest is the mirrored lag */
+  for (i = 1; i < fac->size / 2 - 1; ++i) {
+    prev = fac->acorr[i - 1];
+    this = fac->acorr[i];
+    next = fac->acorr[i + 1];
+
+    if (this < prev && this < next) {
+      /* Weighted interpolation between the valley and its lowest neighbor */
+      if (prev < next)
+        tau = (prev * (i - 1) + this * i) / (prev + this);
+      else
+        tau = (next * (i + 1) + this * i) / (next + this);
+
+      if (tau > 0)
+        fac->baud = fac->fs / tau;
+
+      break;
+    }
+  }
 }
 
 SUPRIVATE SUBOOL
-suscan_estimator_fac_feed(void *private, const SUCOMPLEX *x, SUSCOUNT size)
+suscan_estimator_fac_update(
+    void *private,
+    const suscan_estimator_frontend_t *fe)
 {
-  SU_TRYCATCH(
-      su_channel_detector_feed_bulk(
-          (su_channel_detector_t *) private,
-          x,
-          size) == size,
-      return SU_FALSE);
+  struct suscan_estimator_fac *fac = (struct suscan_estimator_fac *) private;
+  unsigned int i;
+
+  SU_TRYCATCH(fe->size == fac->size, return SU_FALSE);
+
+  if (!fac->primed) {
+    memcpy(fac->acorr, fe->acorr, fac->size * sizeof(SUFLOAT));
+    fac->primed = SU_TRUE;
+  } else {
+    for (i = 0; i < fac->size; ++i)
+      fac->acorr[i] +=
+          SUSCAN_ESTIMATOR_FAC_ALPHA * (fe->acorr[i] - fac->acorr[i]);
+  }
+
+  suscan_estimator_fac_find_baud(fac);
 
   return SU_TRUE;
 }
@@ -56,28 +128,23 @@ suscan_estimator_fac_feed(void *private, const SUCOMPLEX *x, SUSCOUNT size)
 SUPRIVATE SUBOOL
 suscan_estimator_fac_read(const void *private, SUFLOAT *out)
 {
-  *out = su_channel_detector_get_baud((const su_channel_detector_t *) private);
+  *out = ((const struct suscan_estimator_fac *) private)->baud;
 
   return SU_TRUE;
 }
 
-SUPRIVATE void
-suscan_estimator_fac_dtor(void *private)
-{
-  su_channel_detector_destroy((su_channel_detector_t *) private);
-}
-
 SUBOOL
 suscan_estimator_fac_register(void)
 {
   static struct suscan_estimator_class class = {
-      .name  = "baud-fac",
-      .desc  = "FAC baud estimator",
-      .field = "clock.baud",
-      .ctor  = suscan_estimator_fac_ctor,
-      .feed  = suscan_estimator_fac_feed,
-      .read  = suscan_estimator_fac_read,
-      .dtor  = suscan_estimator_fac_dtor
+      .name   = "baud-fac",
+      .desc   = "FAC baud estimator",
+      .field  = "clock.baud",
+      .ctor   = suscan_estimator_fac_ctor,
+      .stages = SUSCAN_ESTIMATOR_STAGE_ACORR,
+      .update = suscan_estimator_fac_update,
+      .read   = suscan_estimator_fac_read,
+      .dtor   = suscan_estimator_fac_dtor
   };
 
   SU_TRYCATCH(suscan_estimator_class_register(&class), return SU_FALSE);
@@ -22,72 +22,149 @@
 
 #define SU_LOG_DOMAIN "nonlinear-estimator"
 
-#include <sigutils/detect.h>
-#include "source.h"
 #include "estimator.h"
 
+#define SUSCAN_ESTIMATOR_NONLINEAR_ALPHA .1
+#define SUSCAN_ESTIMATOR_NONLINEAR_SNR   2. /* Peak-to-mean ratio */
+
+/*
+ * Non-linear baud estimator. Squared differences of the signal exhibit
+ * a spectral line at the symbol rate. The spectrum of this nonlinear
+ * signal is provided by the shared front-end.
+ */
+struct suscan_estimator_nonlinear {
+  SUFLOAT  fs;
+  SUSCOUNT size;
+  SUBOOL   primed;
+  SUFLOAT *spect;
+  SUFLOAT  baud;
+};
+
+SUPRIVATE void
+suscan_estimator_nonlinear_dtor(void *private)
+{
+  struct suscan_estimator_nonlinear *nl =
+      (struct suscan_estimator_nonlinear *) private;
+
+  if (nl->spect != NULL)
+    free(nl->spect);
+
+  free(nl);
+}
+
 SUPRIVATE void *
 suscan_estimator_nonlinear_ctor(SUSCOUNT fs)
 {
-  struct sigutils_channel_detector_params cd_params =
-      sigutils_channel_detector_params_INITIALIZER;
+  struct suscan_estimator_nonlinear *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_estimator_nonlinear)),
+      goto fail);
+
+  new->fs = fs;
+  new->size = SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ;
+
+  SU_TRYCATCH(new->spect = calloc(new->size, sizeof(SUFLOAT)), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_estimator_nonlinear_dtor(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_estimator_nonlinear_find_baud(struct suscan_estimator_nonlinear *nl)
+{
+  unsigned int i, start, max_idx;
+  SUSCOUNT half = nl->size / 2;
+  SUFLOAT mean = 0;
+  SUFLOAT max = 0;
+  SUFLOAT prev, next, denom, delta = 0;
+
+  nl->baud = 0;
+
+  /* Skip the DC lobe: start after the spectrum stops decreasing */
+  for (start = 1; start < half - 1; ++start)
+    if (nl->spect[start] < nl->spect[start + 1])
+      break;
+
+  if (start >= half - 1)
+    return;
+
+  max_idx = start;
+  for (i = start; i < half; ++i) {
+    mean += nl->spect[i];
+    if (nl->spect[i] > max) {
+      max = nl->spect[i];
+      max_idx = i;
+    }
+  }
 
-  cd_params.samp_rate = fs;
-  cd_params.window_size = SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ;
-  cd_params.tune = SU_FALSE; /* Estimators expect baseband signals */
-  cd_params.mode = SU_CHANNEL_DETECTOR_MODE_NONLINEAR_DIFF;
+  mean /= half - start;
 
-  return su_channel_detector_new(&cd_params);
+  if (max < SUSCAN_ESTIMATOR_NONLINEAR_SNR * mean)
+    return;
+
+  /* Parabolic interpolation of the peak */
+  if (max_idx > 0 && max_idx < half - 1) {
+    prev = nl->spect[max_idx - 1];
+    next = nl->spect[max_idx + 1];
+    denom = prev - 2 * max + next;
+    if (denom != 0)
+      delta = .5 * (prev - next) / denom;
+  }
+
+  nl->baud = (max_idx + delta) * nl->fs / nl->size;
 }
 
 SUPRIVATE SUBOOL
-suscan_estimator_nonlinear_feed(
+suscan_estimator_nonlinear_update(
     void *private,
-    const SUCOMPLEX *x,
-    SUSCOUNT size)
+    const suscan_estimator_frontend_t *fe)
 {
-  SUSCOUNT got;
-
-  while (size > 0) {
-    SU_TRYCATCH(
-        (got = su_channel_detector_feed_bulk(
-            (su_channel_detector_t *) private,
-            x,
-            size)) == size,
-        return SU_FALSE);
-
-    size -= got;
-    x += got;
+  struct suscan_estimator_nonlinear *nl =
+      (struct suscan_estimator_nonlinear *) private;
+  unsigned int i;
+
+  SU_TRYCATCH(fe->size == nl->size, return SU_FALSE);
+
+  if (!nl->primed) {
+    memcpy(nl->spect, fe->diff_psd, nl->size * sizeof(SUFLOAT));
+    nl->primed = SU_TRUE;
+  } else {
+    for (i = 0; i < nl->size; ++i)
+      nl->spect[i] +=
+          SUSCAN_ESTIMATOR_NONLINEAR_ALPHA * (fe->diff_psd[i] - nl->spect[i]);
   }
 
+  suscan_estimator_nonlinear_find_baud(nl);
+
   return SU_TRUE;
 }
 
 SUPRIVATE SUBOOL
 suscan_estimator_nonlinear_read(const void *private, SUFLOAT *out)
 {
-  *out = su_channel_detector_get_baud((const su_channel_detector_t *) private);
+  *out = ((const struct suscan_estimator_nonlinear *) private)->baud;
 
   return SU_TRUE;
 }
 
-SUPRIVATE void
-suscan_estimator_nonlinear_dtor(void *private)
-{
-  su_channel_detector_destroy((su_channel_detector_t *) private);
-}
-
 SUBOOL
 suscan_estimator_nonlinear_register(void)
 {
   static struct suscan_estimator_class class = {
-      .name  = "baud-nonlinear",
-      .desc  = "Non-linear baud estimator",
-      .field = "clock.baud",
-      .ctor  = suscan_estimator_nonlinear_ctor,
-      .feed  = suscan_estimator_nonlinear_feed,
-      .read  = suscan_estimator_nonlinear_read,
-      .dtor  = suscan_estimator_nonlinear_dtor
+      .name   = "baud-nonlinear",
+      .desc   = "Non-linear baud estimator",
+      .field  = "clock.baud",
+      .ctor   = suscan_estimator_nonlinear_ctor,
+      .stages = SUSCAN_ESTIMATOR_STAGE_DIFF,
+      .update = suscan_estimator_nonlinear_update,
+      .read   = suscan_estimator_nonlinear_read,
+      .dtor   = suscan_estimator_nonlinear_dtor
   };
 
   SU_TRYCATCH(suscan_estimator_class_register(&class), return SU_FALSE);
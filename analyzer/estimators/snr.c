@@ -0,0 +1,125 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "snr-estimator"
+
+#include "estimator.h"
+
+#define SUSCAN_ESTIMATOR_SNR_TAU 1e-2 /* Averaging time constant (s) */
+
+/*
+ * M2M4 SNR estimator. Second and fourth order moments are tracked with
+ * single-pole averagers whose time constant does not depend on the channel
+ * rate. For constant envelope signals in complex AWGN:
+ *
+ *   S = sqrt(2 M2^2 - M4), N = M2 - S
+ */
+struct suscan_estimator_snr {
+  SUFLOAT alpha;
+  SUFLOAT m2;
+  SUFLOAT m4;
+  SUSCOUNT count;
+};
+
+SUPRIVATE void *
+suscan_estimator_snr_ctor(SUSCOUNT fs)
+{
+  struct suscan_estimator_snr *new = NULL;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(struct suscan_estimator_snr)), return NULL);
+
+  new->alpha = fs > 0 ? SU_MIN(1. / (SUSCAN_ESTIMATOR_SNR_TAU * fs), 1) : 1;
+
+  return new;
+}
+
+SUPRIVATE SUBOOL
+suscan_estimator_snr_feed(void *private, const SUCOMPLEX *x, SUSCOUNT size)
+{
+  struct suscan_estimator_snr *snr = (struct suscan_estimator_snr *) private;
+  SUSCOUNT i;
+  SUFLOAT p;
+  SUFLOAT alpha = snr->alpha;
+  SUFLOAT m2 = snr->m2;
+  SUFLOAT m4 = snr->m4;
+
+  for (i = 0; i < size; ++i) {
+    p = SU_C_REAL(x[i] * SU_C_CONJ(x[i]));
+    m2 += alpha * (p - m2);
+    m4 += alpha * (p * p - m4);
+  }
+
+  snr->m2 = m2;
+  snr->m4 = m4;
+  snr->count += size;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_estimator_snr_read(const void *private, SUFLOAT *out)
+{
+  const struct suscan_estimator_snr *snr =
+      (const struct suscan_estimator_snr *) private;
+  SUFLOAT S2, S, N;
+
+  /* Wait until averagers have settled */
+  if (snr->count < 1. / snr->alpha)
+    return SU_FALSE;
+
+  S2 = 2 * snr->m2 * snr->m2 - snr->m4;
+  if (S2 <= 0)
+    return SU_FALSE;
+
+  S = SU_SQRT(S2);
+  N = snr->m2 - S;
+  if (N <= 0)
+    return SU_FALSE;
+
+  *out = SU_POWER_DB(S / N);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_estimator_snr_dtor(void *private)
+{
+  free(private);
+}
+
+SUBOOL
+suscan_estimator_snr_register(void)
+{
+  static struct suscan_estimator_class class = {
+      .name  = "snr-m2m4",
+      .desc  = "M2M4 SNR estimator (dB)",
+      .field = "snr",
+      .ctor  = suscan_estimator_snr_ctor,
+      .feed  = suscan_estimator_snr_feed,
+      .read  = suscan_estimator_snr_read,
+      .dtor  = suscan_estimator_snr_dtor
+  };
+
+  SU_TRYCATCH(suscan_estimator_class_register(&class), return SU_FALSE);
+
+  return SU_TRUE;
+}
@@ -0,0 +1,227 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "frontend"
+
+#include "frontend.h"
+#include "inspector/pipeline.h"
+
+/* Hamming-windowed sinc of cutoff fc (cycles per sample), t in samples */
+SUPRIVATE SUFLOAT
+suscan_frontend_lpf(SUFLOAT t, SUFLOAT fc, SUFLOAT width)
+{
+  SUFLOAT x = 2 * fc * t;
+  SUFLOAT w;
+
+  if (SU_ABS(t) >= .5 * width)
+    return 0;
+
+  w = .54 + .46 * SU_COS(2 * PI * t / width);
+
+  if (SU_ABS(x) < 1e-6)
+    return w;
+
+  return w * SU_SIN(PI * x) / (PI * x);
+}
+
+void
+suscan_frontend_destroy(suscan_frontend_t *self)
+{
+  if (self->taps != NULL)
+    free(self->taps);
+
+  if (self->history != NULL)
+    free(self->history);
+
+  free(self);
+}
+
+suscan_frontend_t *
+suscan_frontend_new(SUFLOAT fs, SUFREQ offset, SUFLOAT bw)
+{
+  suscan_frontend_t *new = NULL;
+  unsigned int j;
+  SUFLOAT center, fc, sum;
+  SUFLOAT omega;
+
+  SU_TRYCATCH(fs > 0, goto fail);
+  SU_TRYCATCH(bw > 0 && bw < fs, goto fail);
+  SU_TRYCATCH(SU_ABS(offset) + .5 * bw <= .5 * fs, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_frontend_t)), goto fail);
+
+  new->fs     = fs;
+  new->offset = offset;
+  new->bw     = bw;
+
+  /* Decimate while the band still fits in the next output rate */
+  new->fs_out = fs;
+  while (new->stages < SUSCAN_FRONTEND_MAX_STAGES
+      && .5 * new->fs_out >= SUSCAN_FRONTEND_BW_MARGIN * bw) {
+    new->fs_out *= .5;
+    ++new->stages;
+  }
+
+  omega = -2 * PI * offset / fs;
+  new->phase      = 1;
+  new->phase_step = SU_COS(omega) + I * SU_SIN(omega);
+
+  /* Half-band: every other tap but the center one is zero */
+  center = .5 * (SUSCAN_FRONTEND_HALFBAND_TAPS - 1);
+  sum = 0;
+  for (j = 0; j < SUSCAN_FRONTEND_HALFBAND_TAPS; ++j) {
+    new->hb_taps[j] = suscan_frontend_lpf(
+        j - center,
+        .25,
+        SUSCAN_FRONTEND_HALFBAND_TAPS + 1);
+    sum += new->hb_taps[j];
+  }
+
+  for (j = 0; j < SUSCAN_FRONTEND_HALFBAND_TAPS; ++j)
+    new->hb_taps[j] /= sum;
+
+  /*
+   * Channel filter. Whatever the half-band filters folded back lies
+   * above bw / 2, and is removed here.
+   */
+  fc = .5 * bw / new->fs_out;
+  new->span = 2 * SU_CEIL(SUSCAN_FRONTEND_ZERO_CROSSINGS / (2 * fc)) + 1;
+
+  SU_TRYCATCH(new->taps = malloc(new->span * sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(
+      new->history = calloc(2 * new->span, sizeof(SUCOMPLEX)),
+      goto fail);
+
+  center = .5 * (new->span - 1);
+  sum = 0;
+  for (j = 0; j < new->span; ++j) {
+    new->taps[j] = suscan_frontend_lpf(j - center, fc, new->span + 1);
+    sum += new->taps[j];
+  }
+
+  for (j = 0; j < new->span; ++j)
+    new->taps[j] /= sum;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_frontend_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_frontend_mix(suscan_frontend_t *self, SUCOMPLEX *data, SUSCOUNT len)
+{
+  SUSCOUNT i;
+  SUCOMPLEX phase = self->phase;
+  SUCOMPLEX step = self->phase_step;
+  unsigned int renorm = self->renorm;
+
+  for (i = 0; i < len; ++i) {
+    data[i] *= phase;
+    phase   *= step;
+
+    /* Keep rounding errors from changing the oscillator amplitude */
+    if (++renorm == SUSCAN_FRONTEND_RENORM_INTERVAL) {
+      phase /= SU_C_ABS(phase);
+      renorm = 0;
+    }
+  }
+
+  self->phase  = phase;
+  self->renorm = renorm;
+}
+
+SUPRIVATE SUSCOUNT
+suscan_frontend_halfband_feed(
+    struct suscan_frontend_halfband *hb,
+    const SUFLOAT *taps,
+    SUCOMPLEX *data,
+    SUSCOUNT len)
+{
+  SUSCOUNT i, n = 0;
+  unsigned int j;
+  unsigned int ptr = hb->ptr;
+  SUBOOL odd = hb->odd;
+  const SUCOMPLEX *x;
+  SUCOMPLEX y;
+
+  for (i = 0; i < len; ++i) {
+    hb->history[ptr] = hb->history[ptr + SUSCAN_FRONTEND_HALFBAND_TAPS]
+        = data[i];
+    if (++ptr == SUSCAN_FRONTEND_HALFBAND_TAPS)
+      ptr = 0;
+
+    /* Keep one of every two outputs */
+    if ((odd = !odd)) {
+      x = hb->history + ptr;
+      y = taps[SUSCAN_FRONTEND_HALFBAND_TAPS / 2]
+          * x[SUSCAN_FRONTEND_HALFBAND_TAPS / 2];
+
+      /* Symmetric taps, only even ones are non-zero */
+      for (j = 0; j < SUSCAN_FRONTEND_HALFBAND_TAPS / 2; j += 2)
+        y += taps[j] * (x[j] + x[SUSCAN_FRONTEND_HALFBAND_TAPS - 1 - j]);
+
+      /* n <= i: in-place processing is safe */
+      data[n++] = y;
+    }
+  }
+
+  hb->ptr = ptr;
+  hb->odd = odd;
+
+  return n;
+}
+
+SUSCOUNT
+suscan_frontend_feed(suscan_frontend_t *self, SUCOMPLEX *data, SUSCOUNT len)
+{
+  SUSCOUNT i;
+  unsigned int s;
+  SUSCOUNT span = self->span;
+  SUSCOUNT ptr = self->ptr;
+
+  suscan_frontend_mix(self, data, len);
+
+  for (s = 0; s < self->stages; ++s)
+    len = suscan_frontend_halfband_feed(
+        self->hb + s,
+        self->hb_taps,
+        data,
+        len);
+
+  for (i = 0; i < len; ++i) {
+    self->history[ptr] = self->history[ptr + span] = data[i];
+    if (++ptr == span)
+      ptr = 0;
+
+    /* Taps are symmetric: no need to reverse them */
+    data[i] = suscan_inspector_dot_real(self->history + ptr, self->taps, span);
+  }
+
+  self->ptr = ptr;
+
+  return len;
+}
@@ -0,0 +1,106 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _FRONTEND_H
+#define _FRONTEND_H
+
+#include <sigutils/sigutils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_FRONTEND_MAX_STAGES      16
+#define SUSCAN_FRONTEND_HALFBAND_TAPS   23  /* Must be 4k + 3 */
+#define SUSCAN_FRONTEND_ZERO_CROSSINGS  8   /* Channel filter lobes per side */
+#define SUSCAN_FRONTEND_BW_MARGIN       1.25 /* Output rate over bandwidth */
+#define SUSCAN_FRONTEND_RENORM_INTERVAL 1024
+
+struct suscan_frontend_halfband {
+  SUCOMPLEX history[2 * SUSCAN_FRONTEND_HALFBAND_TAPS]; /* Doubled */
+  unsigned int ptr;
+  SUBOOL   odd;
+};
+
+/*
+ * Decimating front-end. Moves the band of interest to baseband with a
+ * complex oscillator, halves the sample rate as many times as the band
+ * allows with a cascade of half-band filters (only the non-zero taps of
+ * the retained outputs are evaluated) and finally limits the bandwidth
+ * with a FIR filter at the output rate.
+ */
+struct suscan_frontend {
+  SUFLOAT   fs;
+  SUFLOAT   fs_out;
+  SUFREQ    offset;  /* Center of the band, relative to the input */
+  SUFLOAT   bw;
+
+  /* Oscillator */
+  SUCOMPLEX phase;
+  SUCOMPLEX phase_step;
+  unsigned int renorm;
+
+  /* Half-band cascade */
+  unsigned int stages;
+  SUFLOAT   hb_taps[SUSCAN_FRONTEND_HALFBAND_TAPS];
+  struct suscan_frontend_halfband hb[SUSCAN_FRONTEND_MAX_STAGES];
+
+  /* Channel filter */
+  SUSCOUNT  span;
+  SUFLOAT  *taps;
+  SUCOMPLEX *history; /* Doubled */
+  SUSCOUNT  ptr;
+};
+
+typedef struct suscan_frontend suscan_frontend_t;
+
+SUINLINE SUFLOAT
+suscan_frontend_get_samp_rate(const suscan_frontend_t *self)
+{
+  return self->fs_out;
+}
+
+SUINLINE SUFREQ
+suscan_frontend_get_offset(const suscan_frontend_t *self)
+{
+  return self->offset;
+}
+
+SUINLINE SUSCOUNT
+suscan_frontend_get_decimation(const suscan_frontend_t *self)
+{
+  return 1 << self->stages;
+}
+
+suscan_frontend_t *suscan_frontend_new(SUFLOAT fs, SUFREQ offset, SUFLOAT bw);
+
+/* Processes data in place, returning the number of output samples */
+SUSCOUNT suscan_frontend_feed(
+    suscan_frontend_t *self,
+    SUCOMPLEX *data,
+    SUSCOUNT len);
+
+void suscan_frontend_destroy(suscan_frontend_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FRONTEND_H */
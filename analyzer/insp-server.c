@@ -37,6 +37,168 @@
  * forwards samples to the inspector
  */
 
+/* Channel offset with respect to the source center frequency */
+SUPRIVATE SUFREQ
+suscan_inspector_get_lo(const suscan_inspector_t *insp)
+{
+  SUFLOAT fs = insp->samp_info.equiv_fs * insp->samp_info.schan->decimation;
+  SUFREQ lo;
+
+  lo = SU_NORM2ABS_FREQ(
+      fs,
+      SU_ANG2NORM_FREQ(su_specttuner_channel_get_f0(insp->samp_info.schan)));
+  if (lo > .5 * fs)
+    lo -= fs;
+
+  return lo;
+}
+
+/*
+ * Events (bursts, detections) are timestamped when retrieved, after
+ * `delay' samples have been fed since they started.
+ */
+SUPRIVATE void
+suscan_inspector_get_event_time(
+    const suscan_inspector_t *insp,
+    SUSCOUNT delay,
+    struct timeval *tv)
+{
+  struct timeval now, sub;
+  SUFLOAT seconds;
+
+  seconds = delay / insp->samp_info.equiv_fs;
+  sub.tv_sec  = (time_t) seconds;
+  sub.tv_usec = (suseconds_t) (1e6 * (seconds - sub.tv_sec));
+
+  gettimeofday(&now, NULL);
+  timersub(&now, &sub, tv);
+}
+
+SUPRIVATE SUBOOL
+suscan_inspector_send_burst(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_burst *burst,
+    struct suscan_mq *mq_out)
+{
+  struct suscan_analyzer_burst_msg *msg = NULL;
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_burst_msg_new(insp->inspector_id, burst),
+      goto fail);
+
+  msg->samp_rate = insp->samp_info.equiv_fs;
+  msg->lo = suscan_inspector_get_lo(insp);
+  suscan_inspector_get_event_time(insp, burst->delay, &msg->timestamp);
+
+  SU_TRYCATCH(
+      suscan_mq_write(mq_out, SUSCAN_ANALYZER_MESSAGE_TYPE_BURST, msg),
+      goto fail);
+
+  return SU_TRUE;
+
+fail:
+  if (msg != NULL)
+    suscan_analyzer_burst_msg_destroy(msg);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUBOOL
+suscan_inspector_send_detection(
+    suscan_inspector_t *insp,
+    const struct suscan_inspector_detection *detection,
+    struct suscan_mq *mq_out)
+{
+  struct suscan_analyzer_detection_msg *msg = NULL;
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_detection_msg_new(insp->inspector_id, detection),
+      goto fail);
+
+  msg->samp_rate = insp->samp_info.equiv_fs;
+  msg->lo = suscan_inspector_get_lo(insp);
+  suscan_inspector_get_event_time(insp, detection->delay, &msg->timestamp);
+
+  SU_TRYCATCH(
+      suscan_mq_write(mq_out, SUSCAN_ANALYZER_MESSAGE_TYPE_DETECTION, msg),
+      goto fail);
+
+  return SU_TRUE;
+
+fail:
+  if (msg != NULL)
+    suscan_analyzer_detection_msg_destroy(msg);
+
+  return SU_FALSE;
+}
+
+/*
+ * Sample messages are sent when the watermark is reached, when the oldest
+ * buffered sample exceeds the latency limit, or when the buffer is full
+ * and cannot grow any further. A full buffer is grown instead of flushed,
+ * so that inspectors with high output rates do not exit their feed loops
+ * early on every block.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_flush_samples(
+    suscan_inspector_t *insp,
+    struct suscan_mq *mq_out)
+{
+  struct suscan_analyzer_sample_batch_msg *msg = NULL;
+  struct suscan_analyzer_soft_symbol_msg *soft = NULL;
+
+  if (suscan_inspector_get_output_length(insp) > 0) {
+    SU_TRYCATCH(
+        msg = suscan_analyzer_sample_batch_msg_new(
+            insp->inspector_id,
+            suscan_inspector_get_output_buffer(insp),
+            suscan_inspector_get_output_length(insp)),
+        goto fail);
+
+    SU_TRYCATCH(
+        suscan_mq_write(mq_out, SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES, msg),
+        goto fail);
+
+    msg = NULL; /* We don't own this anymore */
+  }
+
+  if (suscan_inspector_get_soft_count(insp) > 0) {
+    SU_TRYCATCH(
+        soft = suscan_analyzer_soft_symbol_msg_new(
+            insp->inspector_id,
+            suscan_inspector_get_soft_buffer(insp),
+            insp->soft_bits,
+            suscan_inspector_get_soft_count(insp)),
+        goto fail);
+
+    SU_TRYCATCH(
+        suscan_mq_write(
+            mq_out,
+            SUSCAN_ANALYZER_MESSAGE_TYPE_SOFT_SYMBOLS,
+            soft),
+        goto fail);
+
+    soft = NULL;
+  }
+
+  /* Reset size */
+  insp->sampler_ptr = 0;
+  insp->soft_count  = 0;
+  insp->soft_ptr    = 0;
+  insp->sampler_age = 0;
+
+  return SU_TRUE;
+
+fail:
+  if (msg != NULL)
+    suscan_analyzer_sample_batch_msg_destroy(msg);
+
+  if (soft != NULL)
+    suscan_analyzer_soft_symbol_msg_destroy(soft);
+
+  return SU_FALSE;
+}
+
 SUBOOL
 suscan_inspector_sampler_loop(
     suscan_inspector_t *insp,
@@ -44,34 +206,74 @@ suscan_inspector_sampler_loop(
     SUSCOUNT samp_count,
     struct suscan_mq *mq_out)
 {
-  struct suscan_analyzer_sample_batch_msg *msg = NULL;
+  struct suscan_inspector_burst burst;
+  struct suscan_inspector_detection detection;
+  SUSCOUNT watermark, size, pending;
+  SUFLOAT latency;
+  SUBOOL flush;
   SUSDIFF fed;
 
   while (samp_count > 0) {
+    /* The number of soft values per symbol may change with the config */
+    if (suscan_inspector_get_soft_count(insp) > 0
+        && __atomic_load_n(&insp->pending_config, __ATOMIC_RELAXED) != NULL)
+      SU_TRYCATCH(suscan_inspector_flush_samples(insp, mq_out), goto fail);
+
     /* Ensure the current inspector parameters are up-to-date */
     suscan_inspector_assert_params(insp);
 
+    watermark = __atomic_load_n(&insp->sample_msg_watermark, __ATOMIC_RELAXED);
+    __atomic_load(&insp->sample_msg_latency, &latency, __ATOMIC_RELAXED);
+
+    if (watermark > insp->sampler_size)
+      SU_TRYCATCH(
+          suscan_inspector_resize_sampler_buf(insp, watermark),
+          goto fail);
+
     SU_TRYCATCH(
         (fed = suscan_inspector_feed_bulk(insp, samp_buf, samp_count)) >= 0,
         goto fail);
 
-    if (suscan_inspector_get_output_length(insp) > insp->sample_msg_watermark) {
-      /* New samples produced by sampler: send to client */
+    /* Ship completed bursts, if any */
+    while (suscan_inspector_pop_burst(insp, &burst))
+      if (!suscan_inspector_send_burst(insp, &burst, mq_out)) {
+        if (burst.samples != NULL)
+          free(burst.samples);
+        goto fail;
+      }
+
+    /* Same for template matches */
+    while (suscan_inspector_pop_detection(insp, &detection))
       SU_TRYCATCH(
-          msg = suscan_analyzer_sample_batch_msg_new(
-              insp->inspector_id,
-              suscan_inspector_get_output_buffer(insp),
-              suscan_inspector_get_output_length(insp)),
+          suscan_inspector_send_detection(insp, &detection, mq_out),
           goto fail);
 
-      /* Reset size */
-      insp->sampler_ptr = 0;
+    pending = suscan_inspector_get_output_length(insp)
+        + suscan_inspector_get_soft_count(insp);
 
-      SU_TRYCATCH(
-          suscan_mq_write(mq_out, SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES, msg),
-          goto fail);
+    if (pending > 0) {
+      insp->sampler_age += fed;
+
+      flush = pending >= watermark
+          || (latency > 0
+          && insp->sampler_age >= latency * insp->samp_info.equiv_fs);
 
-      msg = NULL; /* We don't own this anymore */
+      /* Feed stopped early: not enough room for its output */
+      if (!flush && fed < samp_count) {
+        size = 2 * insp->sampler_size;
+        if (size > SUSCAN_INSPECTOR_SAMPLER_MAX_BUF_SIZE)
+          size = SUSCAN_INSPECTOR_SAMPLER_MAX_BUF_SIZE;
+
+        if (size == insp->sampler_size)
+          flush = SU_TRUE;
+        else
+          SU_TRYCATCH(
+              suscan_inspector_resize_sampler_buf(insp, size),
+              goto fail);
+      }
+
+      if (flush)
+        SU_TRYCATCH(suscan_inspector_flush_samples(insp, mq_out), goto fail);
     }
 
     samp_buf   += fed;
@@ -81,8 +283,55 @@ suscan_inspector_sampler_loop(
   return SU_TRUE;
 
 fail:
-  if (msg != NULL)
-    suscan_analyzer_sample_batch_msg_destroy(msg);
+  return SU_FALSE;
+}
+
+/*
+ * Called instead of the sampler loop while the activity gate keeps the
+ * inspector dormant. No more output is coming for a while, so whatever
+ * is buffered is sent right away instead of waiting for the watermark
+ * or the latency limit. Configuration requests are applied as usual.
+ */
+SUBOOL
+suscan_inspector_dormant_loop(
+    suscan_inspector_t *insp,
+    struct suscan_mq *mq_out)
+{
+  if (suscan_inspector_get_output_length(insp) > 0
+      || suscan_inspector_get_soft_count(insp) > 0)
+    SU_TRYCATCH(suscan_inspector_flush_samples(insp, mq_out), return SU_FALSE);
+
+  suscan_inspector_assert_params(insp);
+
+  return SU_TRUE;
+}
+
+/*
+ * Decides whether an update interval has elapsed. Unless the inspector
+ * runs in wall clock mode, time is measured in processed samples.
+ */
+SUPRIVATE SUBOOL
+suscan_inspector_interval_elapsed(
+    const suscan_inspector_t *insp,
+    SUFLOAT interval,
+    SUSCOUNT *samples,
+    struct timespec *last)
+{
+  struct timespec now, sub;
+  SUFLOAT seconds;
+
+  if (insp->wall_clock) {
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    timespecsub(&now, last, &sub);
+    seconds = sub.tv_sec + 1e-9 * sub.tv_nsec;
+    if (seconds >= interval) {
+      *last = now;
+      return SU_TRUE;
+    }
+  } else if (*samples >= interval * insp->samp_info.equiv_fs) {
+    *samples = 0;
+    return SU_TRUE;
+  }
 
   return SU_FALSE;
 }
@@ -95,23 +344,22 @@ suscan_inspector_spectrum_loop(
     struct suscan_mq *mq_out)
 {
   struct suscan_analyzer_inspector_msg *msg = NULL;
-  struct timespec now, sub;
   suscan_spectsrc_t *src = NULL;
   unsigned int i;
   SUFLOAT N0;
   SUSDIFF fed;
-  SUFLOAT seconds;
 
   if (insp->spectsrc_index > 0) {
     src = insp->spectsrc_list[insp->spectsrc_index - 1];
     while (samp_count > 0) {
       fed = suscan_spectsrc_feed(src, samp_buf, samp_count);
+      insp->samples_spectrum += fed;
       if (fed < samp_count) {
-        clock_gettime(CLOCK_MONOTONIC_RAW, &now);
-        timespecsub(&now, &insp->last_spectrum, &sub);
-        seconds = sub.tv_sec + 1e-9 * sub.tv_nsec;
-        if (seconds >= insp->interval_spectrum) {
-          insp->last_spectrum = now;
+        if (suscan_inspector_interval_elapsed(
+            insp,
+            insp->interval_spectrum,
+            &insp->samples_spectrum,
+            &insp->last_spectrum)) {
           SU_TRYCATCH(
               msg = suscan_analyzer_inspector_msg_new(
                   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SPECTRUM,
@@ -174,49 +422,92 @@ suscan_inspector_estimator_loop(
     struct suscan_mq *mq_out)
 {
   struct suscan_analyzer_inspector_msg *msg = NULL;
-  struct timespec now, sub;
   unsigned int i;
-  SUFLOAT value;
-  SUFLOAT seconds;
+  unsigned int stages = 0;
+  SUBOOL enabled = SU_FALSE;
+  SUFLOAT value, interval;
+  SUSCOUNT got;
 
-  /* Check esimator state and update clients */
-  if (insp->interval_estimator > 0) {
-    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
-    timespecsub(&now, &insp->last_estimator, &sub);
-    seconds = sub.tv_sec + 1e-9 * sub.tv_nsec;
-    if (seconds >= insp->interval_estimator) {
-      insp->last_estimator = now;
-      for (i = 0; i < insp->estimator_count; ++i)
-        if (suscan_estimator_is_enabled(insp->estimator_list[i])) {
+  __atomic_load(&insp->interval_estimator, &interval, __ATOMIC_RELAXED);
+  if (interval <= 0)
+    return SU_TRUE;
+
+  /* Collect the front-end stages needed by the enabled estimators */
+  for (i = 0; i < insp->estimator_count; ++i)
+    if (suscan_estimator_is_enabled(insp->estimator_list[i])) {
+      stages |= suscan_estimator_get_stages(insp->estimator_list[i]);
+      enabled = SU_TRUE;
+    }
+
+  if (!enabled)
+    return SU_TRUE;
+
+  insp->samples_estimator += samp_count;
+
+  /* Estimators working on raw samples are fed directly */
+  for (i = 0; i < insp->estimator_count; ++i)
+    if (suscan_estimator_is_enabled(insp->estimator_list[i])
+        && suscan_estimator_wants_samples(insp->estimator_list[i]))
+      SU_TRYCATCH(
+          suscan_estimator_feed(
+              insp->estimator_list[i],
+              samp_buf,
+              samp_count),
+          goto fail);
+
+  /* The rest share the front-end, which is computed once per window */
+  if (stages != 0) {
+    suscan_estimator_frontend_set_stages(insp->estimator_fe, stages);
+
+    while (samp_count > 0) {
+      got = suscan_estimator_frontend_feed(
+          insp->estimator_fe,
+          samp_buf,
+          samp_count);
+
+      if (suscan_estimator_frontend_ready(insp->estimator_fe))
+        for (i = 0; i < insp->estimator_count; ++i)
           if (suscan_estimator_is_enabled(insp->estimator_list[i]))
             SU_TRYCATCH(
-                suscan_estimator_feed(
+                suscan_estimator_update(
                     insp->estimator_list[i],
-                    samp_buf,
-                    samp_count),
+                    insp->estimator_fe),
                 goto fail);
 
-          if (suscan_estimator_read(insp->estimator_list[i], &value)) {
-            SU_TRYCATCH(
-                msg = suscan_analyzer_inspector_msg_new(
-                    SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ESTIMATOR,
-                    rand()),
-                goto fail);
+      samp_buf   += got;
+      samp_count -= got;
+    }
+  }
 
-            msg->enabled = SU_TRUE;
-            msg->estimator_id = i;
-            msg->value = value;
-            msg->inspector_id = insp->inspector_id;
+  /* Publish estimations at the requested rate */
+  if (suscan_inspector_interval_elapsed(
+      insp,
+      interval,
+      &insp->samples_estimator,
+      &insp->last_estimator)) {
+    for (i = 0; i < insp->estimator_count; ++i)
+      if (suscan_estimator_is_enabled(insp->estimator_list[i])
+          && suscan_estimator_read(insp->estimator_list[i], &value)) {
+        SU_TRYCATCH(
+            msg = suscan_analyzer_inspector_msg_new(
+                SUSCAN_ANALYZER_INSPECTOR_MSGKIND_ESTIMATOR,
+                rand()),
+            goto fail);
+
+        msg->enabled = SU_TRUE;
+        msg->estimator_id = i;
+        msg->value = value;
+        msg->inspector_id = insp->inspector_id;
 
-            SU_TRYCATCH(
-                suscan_mq_write(
-                    mq_out,
-                    SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
-                    msg),
-                goto fail);
-          }
-        }
-    }
+        SU_TRYCATCH(
+            suscan_mq_write(
+                mq_out,
+                SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR,
+                msg),
+            goto fail);
+
+        msg = NULL; /* We don't own this anymore */
+      }
   }
 
   return SU_TRUE;
@@ -237,6 +528,7 @@ suscan_analyzer_on_channel_data(
 {
   struct suscan_inspector_task_info *task_info =
       (struct suscan_inspector_task_info *) private;
+  const suscan_parallel_psd_t *parpsd;
 
   /* Channel is not bound yet. No processing is performed */
   if (task_info == NULL)
@@ -273,6 +565,22 @@ suscan_analyzer_on_channel_data(
     return SU_TRUE;
   }
 
+  /*
+   * Channel noise reference for the activity detector. With a parallel
+   * PSD, the detector may not be fed at all: take it from there.
+   */
+  parpsd = task_info->sched->analyzer->parpsd;
+  if (parpsd != NULL) {
+    if (suscan_parallel_psd_is_valid(parpsd))
+      suscan_inspector_set_noise_floor(
+          task_info->inspector,
+          suscan_parallel_psd_get_noise(parpsd));
+  } else if (task_info->sched->analyzer->detector != NULL) {
+    suscan_inspector_set_noise_floor(
+        task_info->inspector,
+        task_info->sched->analyzer->detector->N0);
+  }
+
   task_info->data = data;
   task_info->size = size;
 
@@ -537,12 +845,11 @@ suscan_analyzer_parse_inspector_msg(
           msg->handle)) == NULL) {
         /* No such handle */
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
-      } else if (msg->estimator_id >= insp->estimator_count) {
+      } else if (!suscan_inspector_set_estimator_enabled(
+          insp,
+          msg->estimator_id,
+          msg->enabled)) {
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT;
-      } else {
-        suscan_estimator_set_enabled(
-            insp->estimator_list[msg->estimator_id],
-            msg->enabled);
       }
       break;
 
@@ -552,10 +859,8 @@ suscan_analyzer_parse_inspector_msg(
           msg->handle)) == NULL) {
         /* No such handle */
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
-      } else if (msg->spectsrc_id > insp->spectsrc_count) {
+      } else if (!suscan_inspector_set_spectsrc(insp, msg->spectsrc_id)) {
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT;
-      } else {
-        insp->spectsrc_index = msg->spectsrc_id;
       }
       break;
 
@@ -584,8 +889,9 @@ suscan_analyzer_parse_inspector_msg(
         /* No such handle */
         msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
       } else {
-        /* Configuration stored as a config request */
-        SU_TRYCATCH(suscan_inspector_set_config(insp, msg->config), goto done);
+        /* Configuration stored as a config request, if valid */
+        if (!suscan_inspector_set_config(insp, msg->config))
+          msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT;
       }
       break;
 
@@ -614,6 +920,57 @@ suscan_analyzer_parse_inspector_msg(
       }
       break;
 
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_LATENCY:
+      if ((insp = suscan_analyzer_get_inspector(
+          analyzer,
+          msg->handle)) == NULL) {
+        /* No such handle */
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+      } else {
+        if (!suscan_inspector_set_msg_latency(insp, msg->latency))
+          msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT;
+      }
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_ESTIMATOR_INTERVAL:
+      if ((insp = suscan_analyzer_get_inspector(
+          analyzer,
+          msg->handle)) == NULL) {
+        /* No such handle */
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+      } else {
+        if (!suscan_inspector_set_estimator_interval(insp, msg->interval))
+          msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT;
+      }
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_WALL_CLOCK:
+      if ((insp = suscan_analyzer_get_inspector(
+          analyzer,
+          msg->handle)) == NULL) {
+        /* No such handle */
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+      } else {
+        suscan_inspector_set_wall_clock(insp, msg->wall_clock);
+      }
+      break;
+
+    case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_SQUELCH:
+      if ((insp = suscan_analyzer_get_inspector(
+          analyzer,
+          msg->handle)) == NULL) {
+        /* No such handle */
+        msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE;
+      } else {
+        if (!suscan_inspector_set_squelch(
+            insp,
+            msg->squelch_enabled,
+            msg->squelch_level,
+            msg->squelch_hang))
+          msg->kind = SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT;
+      }
+      break;
+
     case SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_FREQ:
       if ((insp = suscan_analyzer_get_inspector(
           analyzer,
@@ -0,0 +1,190 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "channelizer"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/channelizer.h"
+#include "inspector/pipeline.h"
+
+void
+suscan_channelizer_destroy(suscan_channelizer_t *self)
+{
+  if (self->plan != NULL) {
+    suscan_inspector_fftw_lock();
+    SU_FFTW(_destroy_plan) (self->plan);
+    suscan_inspector_fftw_unlock();
+  }
+
+  if (self->fft != NULL)
+    SU_FFTW(_free) (self->fft);
+
+  if (self->twiddle[0] != NULL)
+    free(self->twiddle[0]);
+
+  if (self->twiddle[1] != NULL)
+    free(self->twiddle[1]);
+
+  if (self->taps != NULL)
+    free(self->taps);
+
+  if (self->history != NULL)
+    free(self->history);
+
+  free(self);
+}
+
+suscan_channelizer_t *
+suscan_channelizer_new(unsigned int bins)
+{
+  suscan_channelizer_t *new = NULL;
+  SUSCOUNT i;
+  SUFLOAT t, sinc, sum = 0;
+  unsigned int k;
+
+  SU_TRYCATCH(bins >= 2 && (bins & 1) == 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_channelizer_t)), goto fail);
+
+  new->bins = bins;
+  new->decimation = bins / 2;
+  new->length = bins * SUSCAN_CHANNELIZER_TAPS_PER_BRANCH;
+
+  SU_TRYCATCH(new->taps = malloc(new->length * sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(
+      new->history = calloc(2 * new->length, sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(new->twiddle[0] = malloc(bins * sizeof(SUCOMPLEX)), goto fail);
+  SU_TRYCATCH(new->twiddle[1] = malloc(bins * sizeof(SUCOMPLEX)), goto fail);
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(bins * sizeof(SU_FFTW(_complex))),
+      goto fail);
+
+  suscan_inspector_fftw_lock();
+  new->plan = SU_FFTW(_plan_dft_1d)(
+      bins,
+      new->fft,
+      new->fft,
+      FFTW_BACKWARD,
+      FFTW_ESTIMATE);
+  suscan_inspector_fftw_unlock();
+
+  SU_TRYCATCH(new->plan != NULL, goto fail);
+
+  /*
+   * Prototype: Hamming-windowed sinc, cut off at the channel edge. Since
+   * channels are 2x oversampled, the transition band does not alias
+   * back into the channel.
+   */
+  for (i = 0; i < new->length; ++i) {
+    t = PI * (i - .5 * (new->length - 1)) / bins;
+    sinc = SU_ABS(t) < 1e-6 ? 1 : SU_SIN(t) / t;
+    new->taps[i] = sinc * (.54 - .46 * SU_COS(2 * PI * i / (new->length - 1)));
+    sum += new->taps[i];
+  }
+
+  for (i = 0; i < new->length; ++i)
+    new->taps[i] /= sum;
+
+  /*
+   * Outputs are computed after the samples with index (q * bins / 2 - 1),
+   * whose position modulo bins alternates between bins / 2 - 1 and
+   * bins - 1. The FFT is referred to the window start, so each bin must
+   * be rotated accordingly.
+   */
+  for (k = 0; k < bins; ++k) {
+    new->twiddle[0][k] =
+        SU_C_EXP(-2 * I * PI * k * (SUFLOAT) (new->decimation - 1) / bins);
+    new->twiddle[1][k] =
+        SU_C_EXP(-2 * I * PI * k * (SUFLOAT) (bins - 1) / bins);
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_channelizer_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_channelizer_compute(suscan_channelizer_t *self)
+{
+  const SUCOMPLEX *w = self->history + self->ptr;
+  const SUCOMPLEX *tw = self->twiddle[self->odd];
+  SUCOMPLEX *u = (SUCOMPLEX *) self->fft;
+  SUSCOUNT L = self->length;
+  SUSCOUNT m, l;
+  unsigned int k;
+  SUCOMPLEX acc;
+
+  /*
+   * Polyphase fold: u[m] = sum_t h[m + t * bins] x[n - m - t * bins].
+   * w[L - 1] is the most recent sample.
+   */
+  for (m = 0; m < self->bins; ++m) {
+    acc = 0;
+    for (l = m; l < L; l += self->bins)
+      acc += self->taps[l] * w[L - 1 - l];
+    u[m] = acc;
+  }
+
+  SU_FFTW(_execute) (self->plan);
+
+  for (k = 0; k < self->bins; ++k)
+    u[k] *= tw[k];
+
+  self->odd = !self->odd;
+}
+
+SUSCOUNT
+suscan_channelizer_feed(
+    suscan_channelizer_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUBOOL *ready)
+{
+  SUSCOUNT i;
+  SUSCOUNT L = self->length;
+
+  *ready = SU_FALSE;
+
+  for (i = 0; i < len; ++i) {
+    self->history[self->ptr] = self->history[self->ptr + L] = x[i];
+    if (++self->ptr == L)
+      self->ptr = 0;
+
+    if (++self->count == self->decimation) {
+      self->count = 0;
+      suscan_channelizer_compute(self);
+      *ready = SU_TRUE;
+      return i + 1;
+    }
+  }
+
+  return len;
+}
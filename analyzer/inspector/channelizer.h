@@ -0,0 +1,87 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_CHANNELIZER_H
+#define _INSPECTOR_CHANNELIZER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_CHANNELIZER_TAPS_PER_BRANCH 8
+
+/*
+ * 2x oversampled polyphase analysis filter bank. The input band is split
+ * in `bins' channels of width fs / bins, and every bins / 2 input samples
+ * a new vector with one sample per channel is produced (so each channel
+ * runs at 2 * fs / bins). Channel k is centered at k * fs / bins, with
+ * k >= bins / 2 standing for negative frequencies, as in an FFT.
+ */
+struct suscan_channelizer {
+  unsigned int bins;
+  unsigned int decimation;
+  SUSCOUNT     length;      /* Prototype filter length */
+  SUFLOAT     *taps;        /* Time-reversed prototype filter */
+  SUCOMPLEX   *history;     /* Doubled history buffer */
+  SUSCOUNT     ptr;
+  SUSCOUNT     count;       /* Samples since last output */
+  SUBOOL       odd;         /* Output parity, for phase correction */
+  SUCOMPLEX   *twiddle[2];  /* Per-bin phase correction */
+
+  SU_FFTW(_complex) *fft;
+  SU_FFTW(_plan)     plan;
+};
+
+typedef struct suscan_channelizer suscan_channelizer_t;
+
+SUINLINE unsigned int
+suscan_channelizer_get_bins(const suscan_channelizer_t *self)
+{
+  return self->bins;
+}
+
+SUINLINE const SUCOMPLEX *
+suscan_channelizer_get_output(const suscan_channelizer_t *self)
+{
+  return (const SUCOMPLEX *) self->fft;
+}
+
+suscan_channelizer_t *suscan_channelizer_new(unsigned int bins);
+
+/*
+ * Consumes samples until a new output vector is available (in which case
+ * *ready is set to SU_TRUE) or the input is exhausted. Returns the number
+ * of consumed samples.
+ */
+SUSCOUNT suscan_channelizer_feed(
+    suscan_channelizer_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUBOOL *ready);
+
+void suscan_channelizer_destroy(suscan_channelizer_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_CHANNELIZER_H */
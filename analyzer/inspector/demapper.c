@@ -0,0 +1,128 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#define SU_LOG_DOMAIN "demapper"
+
+#include "demapper.h"
+
+SUBOOL
+suscan_soft_demapper_init(
+    suscan_soft_demapper_t *self,
+    enum suscan_soft_demapper_kind kind,
+    unsigned int bits,
+    SUFLOAT scale)
+{
+  unsigned int k;
+  SUFLOAT offset = 0;
+
+  SU_TRYCATCH(bits >= 1 && bits <= SUSCAN_SOFT_DEMAPPER_MAX_BITS, return SU_FALSE);
+  SU_TRYCATCH(scale > 0, return SU_FALSE);
+
+  self->kind  = kind;
+  self->bits  = bits;
+  self->order = 1 << bits;
+  self->scale = scale;
+
+  if (kind == SUSCAN_SOFT_DEMAPPER_PSK && self->order == 4)
+    offset = .25 * PI;
+
+  for (k = 0; k < self->order; ++k) {
+    /* Gray code */
+    self->labels[k] = k ^ (k >> 1);
+
+    if (kind == SUSCAN_SOFT_DEMAPPER_PSK)
+      self->points[k] = SU_C_EXP(I * (2 * PI * k / self->order + offset));
+    else
+      self->points[k] = 2. * k - (self->order - 1);
+  }
+
+  self->amplitude = 0;
+  self->noise     = 1;
+
+  return SU_TRUE;
+}
+
+/*
+ * FSK symbols are demapped from their argument (the instantaneous
+ * frequency), whose levels are assumed to be symmetric around zero.
+ * Levels are spaced so that their mean absolute value is M / 2.
+ */
+void
+suscan_soft_demapper_feed(
+    suscan_soft_demapper_t *self,
+    SUCOMPLEX x,
+    int8_t *llr)
+{
+  SUFLOAT dist[SUSCAN_SOFT_DEMAPPER_MAX_POINTS];
+  SUFLOAT min0, min1, dmin, mag, value;
+  SUCOMPLEX diff;
+  unsigned int k, b, mask;
+
+  if (self->kind == SUSCAN_SOFT_DEMAPPER_FSK)
+    x = SU_C_ARG(x);
+
+  mag = SU_C_ABS(x);
+
+  if (self->amplitude <= 0)
+    self->amplitude = mag;
+  else
+    self->amplitude += SUSCAN_SOFT_DEMAPPER_ALPHA * (mag - self->amplitude);
+
+  if (self->amplitude > 0) {
+    x /= self->amplitude;
+    if (self->kind == SUSCAN_SOFT_DEMAPPER_FSK)
+      x *= .5 * self->order;
+  }
+
+  dmin = INFINITY;
+  for (k = 0; k < self->order; ++k) {
+    diff = x - self->points[k];
+    dist[k] = SU_C_REAL(diff * SU_C_CONJ(diff));
+    if (dist[k] < dmin)
+      dmin = dist[k];
+  }
+
+  self->noise += SUSCAN_SOFT_DEMAPPER_ALPHA * (dmin - self->noise);
+  if (self->noise < SUSCAN_SOFT_DEMAPPER_MIN_NOISE)
+    self->noise = SUSCAN_SOFT_DEMAPPER_MIN_NOISE;
+
+  for (b = 0; b < self->bits; ++b) {
+    mask = 1 << (self->bits - b - 1);
+    min0 = min1 = INFINITY;
+
+    for (k = 0; k < self->order; ++k) {
+      if (self->labels[k] & mask) {
+        if (dist[k] < min1)
+          min1 = dist[k];
+      } else if (dist[k] < min0) {
+        min0 = dist[k];
+      }
+    }
+
+    value = SU_FLOOR(self->scale * (min0 - min1) / self->noise + .5);
+
+    if (value > 127)
+      value = 127;
+    else if (value < -127)
+      value = -127;
+
+    llr[b] = (int8_t) value;
+  }
+}
@@ -0,0 +1,86 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_DEMAPPER_H
+#define _INSPECTOR_DEMAPPER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_SOFT_DEMAPPER_MAX_BITS   3
+#define SUSCAN_SOFT_DEMAPPER_MAX_POINTS (1 << SUSCAN_SOFT_DEMAPPER_MAX_BITS)
+#define SUSCAN_SOFT_DEMAPPER_ALPHA      1e-2 /* Level tracking, per symbol */
+#define SUSCAN_SOFT_DEMAPPER_MIN_NOISE  1e-3
+
+enum suscan_soft_demapper_kind {
+  SUSCAN_SOFT_DEMAPPER_PSK, /* Points in the unit circle */
+  SUSCAN_SOFT_DEMAPPER_FSK  /* Equally spaced levels in the symbol argument */
+};
+
+/*
+ * Max-log soft demapper for Gray-coded constellations. Symbol amplitude
+ * and noise variance are tracked with decision-directed averages, so the
+ * input need not be normalized. Bit values are log(P(1) / P(0)) (positive
+ * values favor ones), scaled by `scale' and saturated to int8, most
+ * significant bit first.
+ *
+ * PSK point k lies at exp(j(2 pi k / M + pi / 4)) for QPSK (as the Costas
+ * loop locks it) and at exp(j 2 pi k / M) otherwise.
+ */
+struct suscan_soft_demapper {
+  enum suscan_soft_demapper_kind kind;
+  unsigned int bits;
+  unsigned int order;
+  SUCOMPLEX    points[SUSCAN_SOFT_DEMAPPER_MAX_POINTS];
+  unsigned int labels[SUSCAN_SOFT_DEMAPPER_MAX_POINTS];
+  SUFLOAT      scale;
+  SUFLOAT      amplitude;
+  SUFLOAT      noise;
+};
+
+typedef struct suscan_soft_demapper suscan_soft_demapper_t;
+
+SUINLINE unsigned int
+suscan_soft_demapper_get_bits(const suscan_soft_demapper_t *self)
+{
+  return self->bits;
+}
+
+SUBOOL suscan_soft_demapper_init(
+    suscan_soft_demapper_t *self,
+    enum suscan_soft_demapper_kind kind,
+    unsigned int bits,
+    SUFLOAT scale);
+
+/* Writes suscan_soft_demapper_get_bits() values to llr */
+void suscan_soft_demapper_feed(
+    suscan_soft_demapper_t *self,
+    SUCOMPLEX x,
+    int8_t *llr);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_DEMAPPER_H */
@@ -0,0 +1,281 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "fastcorr"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/fastcorr.h"
+#include "inspector/pipeline.h"
+
+void
+suscan_fastcorr_destroy(suscan_fastcorr_t *self)
+{
+  unsigned int i;
+
+  suscan_inspector_fftw_lock();
+  if (self->fwd_plan != NULL)
+    SU_FFTW(_destroy_plan) (self->fwd_plan);
+  if (self->bwd_plan != NULL)
+    SU_FFTW(_destroy_plan) (self->bwd_plan);
+  suscan_inspector_fftw_unlock();
+
+  if (self->fft != NULL)
+    SU_FFTW(_free) (self->fft);
+
+  if (self->ifft != NULL)
+    SU_FFTW(_free) (self->ifft);
+
+  if (self->spectrum != NULL) {
+    for (i = 0; i < self->count; ++i)
+      if (self->spectrum[i] != NULL)
+        free(self->spectrum[i]);
+    free(self->spectrum);
+  }
+
+  if (self->length != NULL)
+    free(self->length);
+
+  if (self->energy != NULL)
+    free(self->energy);
+
+  if (self->window != NULL)
+    free(self->window);
+
+  if (self->cumenergy != NULL)
+    free(self->cumenergy);
+
+  if (self->metric != NULL)
+    free(self->metric);
+
+  if (self->shift != NULL)
+    free(self->shift);
+
+  free(self);
+}
+
+SUSCOUNT
+suscan_fastcorr_size_for_length(SUSCOUNT max_length)
+{
+  SUSCOUNT size = SUSCAN_FASTCORR_MIN_SIZE;
+
+  while (size < 2 * max_length)
+    size <<= 1;
+
+  return size;
+}
+
+suscan_fastcorr_t *
+suscan_fastcorr_new(
+    const SUCOMPLEX * const *templates,
+    const SUSCOUNT *lengths,
+    unsigned int count,
+    int max_shift)
+{
+  suscan_fastcorr_t *new = NULL;
+  unsigned int i;
+  SUSCOUNT j;
+
+  SU_TRYCATCH(count > 0, goto fail);
+  SU_TRYCATCH(max_shift >= 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_fastcorr_t)), goto fail);
+
+  new->count = count;
+  new->max_shift = max_shift;
+
+  for (i = 0; i < count; ++i) {
+    SU_TRYCATCH(lengths[i] > 0, goto fail);
+    if (lengths[i] > new->max_length)
+      new->max_length = lengths[i];
+  }
+
+  new->size = suscan_fastcorr_size_for_length(new->max_length);
+
+  new->step = new->size - new->max_length + 1;
+
+  SU_TRYCATCH(2 * max_shift < new->size, goto fail);
+
+  SU_TRYCATCH(new->length = malloc(count * sizeof(SUSCOUNT)), goto fail);
+  SU_TRYCATCH(new->energy = calloc(count, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->spectrum = calloc(count, sizeof(SUCOMPLEX *)), goto fail);
+  SU_TRYCATCH(
+      new->window = calloc(new->size, sizeof(SUCOMPLEX)),
+      goto fail);
+  SU_TRYCATCH(
+      new->cumenergy = malloc((new->size + 1) * sizeof(SUFLOAT)),
+      goto fail);
+  SU_TRYCATCH(
+      new->metric = calloc(count * new->step, sizeof(SUFLOAT)),
+      goto fail);
+  SU_TRYCATCH(new->shift = calloc(count * new->step, sizeof(int)), goto fail);
+
+  SU_TRYCATCH(
+      new->fft = SU_FFTW(_malloc)(new->size * sizeof(SU_FFTW(_complex))),
+      goto fail);
+  SU_TRYCATCH(
+      new->ifft = SU_FFTW(_malloc)(new->size * sizeof(SU_FFTW(_complex))),
+      goto fail);
+
+  suscan_inspector_fftw_lock();
+  new->fwd_plan = SU_FFTW(_plan_dft_1d)(
+      new->size,
+      new->fft,
+      new->fft,
+      FFTW_FORWARD,
+      FFTW_ESTIMATE);
+  new->bwd_plan = SU_FFTW(_plan_dft_1d)(
+      new->size,
+      new->ifft,
+      new->ifft,
+      FFTW_BACKWARD,
+      FFTW_ESTIMATE);
+  suscan_inspector_fftw_unlock();
+
+  SU_TRYCATCH(new->fwd_plan != NULL, goto fail);
+  SU_TRYCATCH(new->bwd_plan != NULL, goto fail);
+
+  /* Template spectra, zero padded to the FFT size */
+  for (i = 0; i < count; ++i) {
+    new->length[i] = lengths[i];
+
+    SU_TRYCATCH(
+        new->spectrum[i] = malloc(new->size * sizeof(SUCOMPLEX)),
+        goto fail);
+
+    for (j = 0; j < new->size; ++j)
+      new->fft[j] = j < lengths[i] ? templates[i][j] : 0;
+
+    for (j = 0; j < lengths[i]; ++j)
+      new->energy[i] += SU_C_REAL(templates[i][j] * SU_C_CONJ(templates[i][j]));
+
+    SU_TRYCATCH(new->energy[i] > 0, goto fail);
+
+    SU_FFTW(_execute) (new->fwd_plan);
+
+    for (j = 0; j < new->size; ++j)
+      new->spectrum[i][j] = SU_C_CONJ(new->fft[j]) / new->size;
+  }
+
+  /* The first window is preceded by zeroes */
+  new->fill  = new->max_length - 1;
+  new->window_start = -(SUSDIFF) new->fill;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_fastcorr_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE void
+suscan_fastcorr_compute(suscan_fastcorr_t *self)
+{
+  SUSCOUNT size = self->size;
+  SUSCOUNT step = self->step;
+  SUSCOUNT j, len;
+  SUFLOAT *metric, e, r;
+  const SUCOMPLEX *spectrum;
+  SUCOMPLEX c;
+  int *shift;
+  unsigned int t;
+  int s;
+
+  memcpy(self->fft, self->window, size * sizeof(SUCOMPLEX));
+  SU_FFTW(_execute) (self->fwd_plan);
+
+  self->cumenergy[0] = 0;
+  for (j = 0; j < size; ++j)
+    self->cumenergy[j + 1] = self->cumenergy[j]
+        + SU_C_REAL(self->window[j] * SU_C_CONJ(self->window[j]));
+
+  for (t = 0; t < self->count; ++t) {
+    spectrum = self->spectrum[t];
+    metric   = self->metric + t * step;
+    shift    = self->shift + t * step;
+    len      = self->length[t];
+
+    memset(metric, 0, step * sizeof(SUFLOAT));
+
+    for (s = -self->max_shift; s <= self->max_shift; ++s) {
+      /* X[k + s] conj(T[k]) is the correlation of the derotated window */
+      for (j = 0; j < size; ++j)
+        self->ifft[j] = self->fft[(j + size + s) % size] * spectrum[j];
+
+      SU_FFTW(_execute) (self->bwd_plan);
+
+      for (j = 0; j < step; ++j) {
+        e = self->cumenergy[j + len] - self->cumenergy[j];
+        if (e <= 0)
+          continue;
+
+        c = self->ifft[j];
+        r = SU_C_REAL(c * SU_C_CONJ(c)) / (self->energy[t] * e);
+        if (r > metric[j]) {
+          metric[j] = r;
+          shift[j]  = s;
+        }
+      }
+    }
+
+    for (j = 0; j < step; ++j)
+      metric[j] = SU_SQRT(metric[j]);
+  }
+}
+
+SUSCOUNT
+suscan_fastcorr_feed(
+    suscan_fastcorr_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUBOOL *ready)
+{
+  SUSCOUNT avail = self->size - self->fill;
+  SUSCOUNT keep = self->max_length - 1;
+
+  *ready = SU_FALSE;
+
+  if (len > avail)
+    len = avail;
+
+  memcpy(self->window + self->fill, x, len * sizeof(SUCOMPLEX));
+  self->fill += len;
+
+  if (self->fill == self->size) {
+    suscan_fastcorr_compute(self);
+    self->start = self->window_start;
+    *ready = SU_TRUE;
+
+    /* Overlap: keep the samples of lags that start in the next window */
+    memmove(
+        self->window,
+        self->window + self->step,
+        keep * sizeof(SUCOMPLEX));
+    self->fill = keep;
+    self->window_start += self->step;
+  }
+
+  return len;
+}
@@ -0,0 +1,138 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_FASTCORR_H
+#define _INSPECTOR_FASTCORR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_FASTCORR_MIN_SIZE 64
+
+/*
+ * Overlap-save correlator against a set of complex templates. Incoming
+ * samples are gathered in windows of `size' samples (a power of two of at
+ * least twice the longest template), overlapping by the longest template
+ * length minus one. For every window, the input spectrum is computed once
+ * and multiplied by the conjugated spectrum of each template, so each
+ * correlation lag costs O(log size) instead of O(template length).
+ *
+ * Frequency offsets are searched by circularly shifting the input
+ * spectrum up to max_shift bins in each direction, which is equivalent to
+ * derotating the window by a multiple of fs / size.
+ *
+ * Results are normalized correlations (between 0 and 1) for each template
+ * and each of the `step' lags that start in the last window, along with
+ * the frequency shift (in bins) that maximized them.
+ */
+struct suscan_fastcorr {
+  unsigned int count;       /* Number of templates */
+  SUSCOUNT    *length;      /* Template lengths */
+  SUFLOAT     *energy;      /* Template energies */
+  SUSCOUNT     max_length;
+  SUSCOUNT     size;        /* FFT size */
+  SUSCOUNT     step;        /* New samples per window */
+  int          max_shift;   /* Frequency search range, in bins */
+
+  SUCOMPLEX  **spectrum;    /* Conjugated template spectra */
+  SUCOMPLEX   *window;      /* Input window */
+  SUSCOUNT     fill;
+  SUSDIFF      window_start; /* Input index of the first window sample */
+  SUSDIFF      start;        /* Same, for the last computed window */
+  SUFLOAT     *cumenergy;   /* Prefix sums of window energy */
+
+  SUFLOAT     *metric;      /* count rows of step values */
+  int         *shift;       /* count rows of step values */
+
+  SU_FFTW(_complex) *fft;
+  SU_FFTW(_complex) *ifft;
+  SU_FFTW(_plan)     fwd_plan;
+  SU_FFTW(_plan)     bwd_plan;
+};
+
+typedef struct suscan_fastcorr suscan_fastcorr_t;
+
+SUINLINE SUSCOUNT
+suscan_fastcorr_get_size(const suscan_fastcorr_t *self)
+{
+  return self->size;
+}
+
+SUINLINE SUSCOUNT
+suscan_fastcorr_get_step(const suscan_fastcorr_t *self)
+{
+  return self->step;
+}
+
+SUINLINE SUSCOUNT
+suscan_fastcorr_get_template_length(const suscan_fastcorr_t *self, unsigned int t)
+{
+  return self->length[t];
+}
+
+/* Input index (counting from the first fed sample) of lag 0 */
+SUINLINE SUSDIFF
+suscan_fastcorr_get_start(const suscan_fastcorr_t *self)
+{
+  return self->start;
+}
+
+SUINLINE const SUFLOAT *
+suscan_fastcorr_get_metric(const suscan_fastcorr_t *self, unsigned int t)
+{
+  return self->metric + t * self->step;
+}
+
+SUINLINE const int *
+suscan_fastcorr_get_shift(const suscan_fastcorr_t *self, unsigned int t)
+{
+  return self->shift + t * self->step;
+}
+
+/* FFT size used for templates of up to max_length samples */
+SUSCOUNT suscan_fastcorr_size_for_length(SUSCOUNT max_length);
+
+suscan_fastcorr_t *suscan_fastcorr_new(
+    const SUCOMPLEX * const *templates,
+    const SUSCOUNT *lengths,
+    unsigned int count,
+    int max_shift);
+
+/*
+ * Consumes samples until a window is complete (in which case *ready is
+ * set to SU_TRUE and results are updated) or the input is exhausted.
+ * Returns the number of consumed samples.
+ */
+SUSCOUNT suscan_fastcorr_feed(
+    suscan_fastcorr_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUBOOL *ready);
+
+void suscan_fastcorr_destroy(suscan_fastcorr_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_FASTCORR_H */
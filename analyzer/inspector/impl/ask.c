@@ -30,6 +30,8 @@
 
 #include "inspector/interface.h"
 #include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/mfsampler.h"
 
 #include "inspector/inspector.h"
 
@@ -59,6 +61,19 @@ struct suscan_ask_inspector_params {
   struct suscan_inspector_ask_params ask;
 };
 
+enum suscan_ask_inspector_stage {
+  SUSCAN_ASK_INSPECTOR_STAGE_MIXER,
+  SUSCAN_ASK_INSPECTOR_STAGE_GAIN,
+  SUSCAN_ASK_INSPECTOR_STAGE_CARRIER,
+  SUSCAN_ASK_INSPECTOR_STAGE_MF,
+  SUSCAN_ASK_INSPECTOR_STAGE_TIMING,
+  SUSCAN_ASK_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_ask_inspector_stage_names[] = {
+    "mixer", "gain", "carrier", "mf", "timing"
+};
+
 struct suscan_ask_inspector {
   struct suscan_inspector_sampling_info samp_info;
   struct suscan_ask_inspector_params req_params;
@@ -69,10 +84,15 @@ struct suscan_ask_inspector {
   su_iir_filt_t       mf;         /* Matched filter (Root Raised Cosine) */
   su_clock_detector_t cd;         /* Clock detector */
   su_sampler_t        sampler;    /* Fixed baudrate sampler */
+  suscan_mf_sampler_t mfs;        /* Polyphase matched filter + sampler */
   su_pll_t            pll;        /* PLL to center frequency */
-  su_ncqo_t           lo;         /* Oscillator for manual carrier offset */
+  struct suscan_inspector_rotator lo; /* Manual carrier offset */
   SUCOMPLEX           phase;      /* Local oscillator phase */
   SUCOMPLEX           last;       /* Last sample processed */
+
+  /* Block processing */
+  SUCOMPLEX block[SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE];
+  struct suscan_inspector_stage_stats stats[SUSCAN_ASK_INSPECTOR_STAGE_COUNT];
 };
 
 SUSCOUNT
@@ -122,6 +142,8 @@ suscan_ask_inspector_destroy(struct suscan_ask_inspector *insp)
 
   su_sampler_finalize(&insp->sampler);
 
+  suscan_mf_sampler_finalize(&insp->mfs);
+
   free(insp);
 }
 
@@ -164,9 +186,14 @@ suscan_ask_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
       goto fail);
 
   /* Initialize local oscillator */
-  su_ncqo_init(&new->lo, 0);
+  suscan_inspector_rotator_init(&new->lo);
   new->phase = 1.;
 
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_ask_inspector_stage_names,
+      SUSCAN_ASK_INSPECTOR_STAGE_COUNT);
+
   /* Initialize AGC */
   tau = 1. / bw; /* Samples per symbol */
 
@@ -237,34 +264,55 @@ suscan_ask_inspector_get_config(void *private, suscan_config_t *config)
   return SU_TRUE;
 }
 
-SUBOOL
-suscan_ask_inspector_parse_config(void *private, const suscan_config_t *config)
+SUPRIVATE SUBOOL
+suscan_ask_inspector_parse_params(
+    const struct suscan_ask_inspector *insp,
+    struct suscan_ask_inspector_params *params,
+    const suscan_config_t *config)
 {
-  struct suscan_ask_inspector *insp = (struct suscan_ask_inspector *) private;
-
-  suscan_ask_inspector_params_initialize(&insp->req_params, &insp->samp_info);
+  suscan_ask_inspector_params_initialize(params, &insp->samp_info);
 
   SU_TRYCATCH(
-      suscan_inspector_gc_params_parse(&insp->req_params.gc, config),
+      suscan_inspector_gc_params_parse(&params->gc, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_mf_params_parse(&insp->req_params.mf, config),
+      suscan_inspector_mf_params_parse(&params->mf, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_br_params_parse(&insp->req_params.br, config),
+      suscan_inspector_br_params_parse(&params->br, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_ask_params_parse(&insp->req_params.ask, config),
+      suscan_inspector_ask_params_parse(&params->ask, config),
       return SU_FALSE);
 
   return SU_TRUE;
+}
 
+SUBOOL
+suscan_ask_inspector_parse_config(void *private, const suscan_config_t *config)
+{
+  struct suscan_ask_inspector *insp = (struct suscan_ask_inspector *) private;
+
+  return suscan_ask_inspector_parse_params(insp, &insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_ask_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  const struct suscan_ask_inspector *insp =
+      (const struct suscan_ask_inspector *) private;
+  struct suscan_ask_inspector_params params;
+
+  return suscan_ask_inspector_parse_params(insp, &params, config);
 }
 
-/* This method is called inside the inspector mutex */
+/* This method is called from the worker thread */
 void
 suscan_ask_inspector_commit_config(void *private)
 {
@@ -275,6 +323,7 @@ suscan_ask_inspector_commit_config(void *private)
   SUFLOAT sym_period;
   su_pll_t new_pll;
   su_iir_filt_t mf = su_iir_filt_INITIALIZER;
+  suscan_mf_sampler_t mfs = suscan_mf_sampler_INITIALIZER;
   struct suscan_ask_inspector *insp = (struct suscan_ask_inspector *) private;
 
   actual_baud = insp->req_params.br.br_running
@@ -301,7 +350,7 @@ suscan_ask_inspector_commit_config(void *private)
   }
 
   /* Update local oscillator */
-  su_ncqo_set_freq(
+  suscan_inspector_rotator_set_freq(
       &insp->lo,
       SU_ABS2NORM_FREQ(fs, insp->cur_params.ask.offset));
 
@@ -327,6 +376,27 @@ suscan_ask_inspector_commit_config(void *private)
       insp->mf = mf;
     }
   }
+
+  /* Update polyphase matched filter, used with manual baudrate control */
+  if (sym_period < 1) {
+    suscan_mf_sampler_finalize(&insp->mfs);
+  } else if (mf_changed || !suscan_mf_sampler_is_ready(&insp->mfs)) {
+    if (!suscan_mf_sampler_init(
+        &mfs,
+        sym_period,
+        insp->cur_params.mf.mf_rolloff,
+        suscan_ask_inspector_mf_span(6 * sym_period))) {
+      SU_ERROR("No memory left to update polyphase matched filter!\n");
+    } else {
+      suscan_mf_sampler_finalize(&insp->mfs);
+      insp->mfs = mfs;
+    }
+  }
+
+  if (suscan_mf_sampler_is_ready(&insp->mfs))
+    suscan_mf_sampler_set_phase_addend(
+        &insp->mfs,
+        insp->cur_params.br.sym_phase);
 }
 
 SUSDIFF
@@ -336,66 +406,136 @@ suscan_ask_inspector_feed(
     const SUCOMPLEX *x,
     SUSCOUNT count)
 {
-  SUSCOUNT i;
-  SUSCOUNT osize = 0;
-  SUFLOAT alpha;
-  SUCOMPLEX const_gain;
-  SUCOMPLEX det_x;
+  SUSCOUNT i, n, len;
+  SUSCOUNT consumed = 0;
+  SUBOOL use_mfs;
   SUCOMPLEX output;
-  SUBOOL new_sample = SU_FALSE;
-  SUCOMPLEX last = 0;
-  unsigned int counts = 0;
-  struct timeval tv, otv, sub;
-
+  SUCOMPLEX *y;
+  struct timespec t;
   struct suscan_ask_inspector *ask_insp =
       (struct suscan_ask_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = ask_insp->stats;
 
-  last = ask_insp->last;
+  y = ask_insp->block;
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
-    /* Re-center carrier */
-    det_x = x[i] * SU_C_CONJ(su_ncqo_read(&ask_insp->lo)) * ask_insp->phase;
+  /* With manual timing, the matched filter is merged into the sampler */
+  use_mfs = ask_insp->cur_params.mf.mf_conf
+      == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL
+      && ask_insp->cur_params.br.br_ctrl
+      == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL
+      && suscan_mf_sampler_is_ready(&ask_insp->mfs);
+
+  while (consumed < count) {
+    /* At most one symbol per sample: bound block by free output space */
+    len = MIN(count - consumed, SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE);
+    len = MIN(len, suscan_inspector_sampler_buf_avail(insp));
 
-    /* Perform gain control */
+    if (len == 0)
+      break;
+
+    /* Re-center carrier */
+    suscan_inspector_stage_enter(&t);
+    suscan_inspector_rotator_apply(&ask_insp->lo, x + consumed, y, len);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_ASK_INSPECTOR_STAGE_MIXER,
+        &t,
+        len);
+
+    /* Perform gain control (the AGC is insensitive to the carrier phase) */
+    suscan_inspector_stage_enter(&t);
     switch (ask_insp->cur_params.gc.gc_ctrl) {
       case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        const_gain = 2 * ask_insp->cur_params.gc.gc_gain * det_x;
+        suscan_inspector_block_scale(
+            y,
+            2 * ask_insp->cur_params.gc.gc_gain * ask_insp->phase,
+            len);
         break;
 
       case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        const_gain  = 2 * su_agc_feed(&ask_insp->agc, det_x);
+        for (i = 0; i < len; ++i)
+          y[i] = su_agc_feed(&ask_insp->agc, y[i]);
+        suscan_inspector_block_scale(y, 2 * ask_insp->phase, len);
         break;
     }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_ASK_INSPECTOR_STAGE_GAIN,
+        &t,
+        len);
 
     /* Apply PLL, if enabled */
-    if (ask_insp->cur_params.ask.uses_pll)
-      const_gain = su_pll_track(&ask_insp->pll, const_gain);
-
-    /* Put real component around the unit circle */
-    det_x = const_gain;
-
-    /* Add matched filter, if enabled */
-    if (ask_insp->cur_params.mf.mf_conf
-        == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
-      det_x = su_iir_filt_feed(&ask_insp->mf, det_x);
+    if (ask_insp->cur_params.ask.uses_pll) {
+      suscan_inspector_stage_enter(&t);
+      for (i = 0; i < len; ++i)
+        y[i] = su_pll_track(&ask_insp->pll, y[i]);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_ASK_INSPECTOR_STAGE_CARRIER,
+          &t,
+          len);
+    }
 
-    /* Check if channel sampler is enabled */
-    if (ask_insp->cur_params.br.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
-      output = det_x;
-      new_sample = su_sampler_feed(&ask_insp->sampler, &output);
+    if (use_mfs) {
+      /* Matched filter is only evaluated at symbol instants */
+      suscan_inspector_stage_enter(&t);
+      n = suscan_mf_sampler_feed(&ask_insp->mfs, y, len, y);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_ASK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     } else {
-      /* Automatic baudrate control enabled */
-      su_clock_detector_feed(&ask_insp->cd, det_x);
-      new_sample = su_clock_detector_read(&ask_insp->cd, &output, 1) == 1;
+      /* Add matched filter, if enabled */
+      if (ask_insp->cur_params.mf.mf_conf
+          == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL) {
+        suscan_inspector_stage_enter(&t);
+        suscan_inspector_block_iir_filt(&ask_insp->mf, y, len);
+        suscan_inspector_stage_leave(
+            stats + SUSCAN_ASK_INSPECTOR_STAGE_MF,
+            &t,
+            len);
+      }
+
+      /* Symbol timing. Symbols are compacted at the beginning of the block */
+      suscan_inspector_stage_enter(&t);
+      n = 0;
+      if (ask_insp->cur_params.br.br_ctrl
+          == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
+        for (i = 0; i < len; ++i) {
+          output = y[i];
+          if (su_sampler_feed(&ask_insp->sampler, &output))
+            y[n++] = output;
+        }
+      } else {
+        /* Automatic baudrate control enabled */
+        for (i = 0; i < len; ++i) {
+          su_clock_detector_feed(&ask_insp->cd, y[i]);
+          if (su_clock_detector_read(&ask_insp->cd, &output, 1) == 1)
+            y[n++] = output;
+        }
+      }
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_ASK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     }
 
-    if (new_sample)
-      suscan_inspector_push_sample(insp, output * .75 * ask_insp->phase);
+    for (i = 0; i < n; ++i)
+      suscan_inspector_push_sample(insp, y[i] * .75 * ask_insp->phase);
+
+    consumed += len;
   }
 
-  ask_insp->last = last;
+  return consumed;
+}
+
+void
+suscan_ask_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_ask_inspector *insp = (struct suscan_ask_inspector *) private;
 
-  return i;
+  *stats = insp->stats;
+  *count = SUSCAN_ASK_INSPECTOR_STAGE_COUNT;
 }
 
 void
@@ -410,8 +550,10 @@ SUPRIVATE struct suscan_inspector_interface iface = {
     .open = suscan_ask_inspector_open,
     .get_config = suscan_ask_inspector_get_config,
     .parse_config = suscan_ask_inspector_parse_config,
+    .check_config = suscan_ask_inspector_check_config,
     .commit_config = suscan_ask_inspector_commit_config,
     .feed = suscan_ask_inspector_feed,
+    .get_stage_stats = suscan_ask_inspector_get_stage_stats,
     .close = suscan_ask_inspector_close
 };
 
@@ -433,6 +575,14 @@ suscan_ask_inspector_register(void)
       suscan_inspector_interface_add_estimator(&iface, "baud-nonlinear"),
       return SU_FALSE);
 
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "carrier-sdft"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "snr-m2m4"),
+      return SU_FALSE);
+
   /* Add applicable spectrum sources */
   SU_TRYCATCH(
       suscan_inspector_interface_add_spectsrc(&iface, "psd"),
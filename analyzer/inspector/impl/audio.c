@@ -23,12 +23,13 @@
 #include <sigutils/sigutils.h>
 #include <sigutils/agc.h>
 #include <sigutils/pll.h>
-#include <sigutils/sampling.h>
 #include <sigutils/iir.h>
 #include <sigutils/clock.h>
 
 #include "inspector/interface.h"
 #include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/resampler.h"
 #include "inspector/inspector.h"
 
 #include <string.h>
@@ -58,6 +59,19 @@ struct suscan_audio_inspector_params {
 #define SUSCAN_AUDIO_AM_ATTENUATION               .25
 #define SUSCAN_AUDIO_AM_CARRIER_AVERAGING_SECONDS .2
 
+enum suscan_audio_inspector_stage {
+  SUSCAN_AUDIO_INSPECTOR_STAGE_GAIN,
+  SUSCAN_AUDIO_INSPECTOR_STAGE_DEMOD,
+  SUSCAN_AUDIO_INSPECTOR_STAGE_DECIMATOR,
+  SUSCAN_AUDIO_INSPECTOR_STAGE_FILTER,
+  SUSCAN_AUDIO_INSPECTOR_STAGE_RESAMPLER,
+  SUSCAN_AUDIO_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_audio_inspector_stage_names[] = {
+    "gain", "demod", "decimator", "filter", "resampler"
+};
+
 struct suscan_audio_inspector {
   struct suscan_inspector_sampling_info samp_info;
   struct suscan_audio_inspector_params req_params;
@@ -65,14 +79,34 @@ struct suscan_audio_inspector {
 
   /* Blocks */
   su_agc_t  agc;          /* AGC, for AM-like modulations */
-  su_iir_filt_t filt;     /* Input filter */
+  su_iir_filt_t filt;     /* Audio filter, at the intermediate rate */
   su_pll_t pll;           /* Carrier tracking PLL */
-  su_ncqo_t lo;           /* Oscillator */
-  su_sampler_t sampler;   /* Fixed rate sampler */
+  struct suscan_inspector_rotator lo; /* Sideband oscillator */
+  SUFLOAT lo_fnor;        /* Sideband oscillator frequency (normalized) */
+  suscan_resampler_t resampler; /* Channel rate to audio rate */
   SUFLOAT beta;          /* Coefficient for single pole IIR filter */
   SUCOMPLEX last;         /* Last processed sample (for quad demod) */
+
+  /* Block processing */
+  SUCOMPLEX block[SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE];
+  SUCOMPLEX output[SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE];
+  struct suscan_inspector_stage_stats stats[SUSCAN_AUDIO_INSPECTOR_STAGE_COUNT];
 };
 
+/*
+ * The rotator multiplies by the conjugate of the oscillator, which is
+ * what LSB needs. USB is obtained by running it backwards.
+ */
+SUPRIVATE void
+suscan_audio_inspector_update_lo(struct suscan_audio_inspector *insp)
+{
+  suscan_inspector_rotator_set_freq(
+      &insp->lo,
+      insp->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_USB
+      ? -insp->lo_fnor
+      : insp->lo_fnor);
+}
+
 SUPRIVATE void
 suscan_audio_inspector_params_initialize(
     struct suscan_audio_inspector_params *params,
@@ -97,7 +131,7 @@ suscan_audio_inspector_destroy(struct suscan_audio_inspector *insp)
 
   su_agc_finalize(&insp->agc);
 
-  su_sampler_finalize(&insp->sampler);
+  suscan_resampler_finalize(&insp->resampler);
 
   free(insp);
 }
@@ -117,6 +151,8 @@ suscan_audio_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
 
   suscan_audio_inspector_params_initialize(&new->cur_params, sinfo);
 
+  new->resampler = (suscan_resampler_t) suscan_resampler_INITIALIZER;
+
   bw = sinfo->bw;
   tau = 1. / bw;
 
@@ -141,8 +177,15 @@ suscan_audio_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
       5,
       SU_ABS2NORM_FREQ(sinfo->equiv_fs, new->cur_params.audio.cutoff));
 
-  /* NCQO init, used to sideband adjustment */
-  su_ncqo_init(&new->lo, .5 * bw);
+  /* Oscillator init, used to sideband adjustment */
+  suscan_inspector_rotator_init(&new->lo);
+  new->lo_fnor = SU_ABS2NORM_FREQ(sinfo->equiv_fs, .5 * bw);
+  suscan_audio_inspector_update_lo(new);
+
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_audio_inspector_stage_names,
+      SUSCAN_AUDIO_INSPECTOR_STAGE_COUNT);
 
   /* One second time constant, used to remove AM carrier */
   new->beta = 1 - SU_EXP(
@@ -181,24 +224,43 @@ suscan_audio_inspector_get_config(void *private, suscan_config_t *config)
   return SU_TRUE;
 }
 
-SUBOOL
-suscan_audio_inspector_parse_config(void *private, const suscan_config_t *config)
+SUPRIVATE SUBOOL
+suscan_audio_inspector_parse_params(
+    struct suscan_audio_inspector_params *params,
+    const suscan_config_t *config)
 {
-  struct suscan_audio_inspector *insp = (struct suscan_audio_inspector *) private;
-
-
   SU_TRYCATCH(
-      suscan_inspector_gc_params_parse(&insp->req_params.gc, config),
+      suscan_inspector_gc_params_parse(&params->gc, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_audio_params_parse(&insp->req_params.audio, config),
+      suscan_inspector_audio_params_parse(&params->audio, config),
       return SU_FALSE);
 
   return SU_TRUE;
 }
 
-/* Called inside inspector mutex */
+SUBOOL
+suscan_audio_inspector_parse_config(void *private, const suscan_config_t *config)
+{
+  struct suscan_audio_inspector *insp =
+      (struct suscan_audio_inspector *) private;
+
+  return suscan_audio_inspector_parse_params(&insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_audio_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_audio_inspector_params params;
+
+  return suscan_audio_inspector_parse_params(&params, config);
+}
+
+/* Called from the worker thread */
 void
 suscan_audio_inspector_new_bandwidth(void *private, SUFREQ bw)
 {
@@ -207,12 +269,11 @@ suscan_audio_inspector_new_bandwidth(void *private, SUFREQ bw)
   SUFLOAT fs = insp->samp_info.equiv_fs;
 
   /* Initialize oscillator */
-  su_ncqo_set_freq(
-      &insp->lo,
-      SU_ABS2NORM_FREQ(fs, .5 * bw));
+  insp->lo_fnor = SU_ABS2NORM_FREQ(fs, .5 * bw);
+  suscan_audio_inspector_update_lo(insp);
 }
 
-/* Called inside inspector mutex */
+/* Called from the worker thread */
 void
 suscan_audio_inspector_commit_config(void *private)
 {
@@ -221,9 +282,36 @@ suscan_audio_inspector_commit_config(void *private)
   su_iir_filt_t filt;
   SUBOOL filt_initialized;
   SUFLOAT fs = insp->samp_info.equiv_fs;
+  SUFLOAT cutoff;
 
   insp->last  = 0;
 
+  /*
+   * Resampler state is kept across unrelated configuration changes,
+   * so that audio is not interrupted by them.
+   */
+  if (insp->req_params.audio.sample_rate > 0) {
+    if (!suscan_resampler_is_ready(&insp->resampler)
+        || insp->resampler.fs_out != insp->req_params.audio.sample_rate) {
+      suscan_resampler_finalize(&insp->resampler);
+      if (!suscan_resampler_init(
+          &insp->resampler,
+          fs,
+          insp->req_params.audio.sample_rate))
+        SU_ERROR("Failed to initialize audio resampler\n");
+    }
+  } else {
+    suscan_resampler_finalize(&insp->resampler);
+  }
+
+  /* The audio filter runs after decimation */
+  if (suscan_resampler_is_ready(&insp->resampler))
+    fs = suscan_resampler_get_mid_rate(&insp->resampler);
+
+  cutoff = insp->req_params.audio.cutoff;
+  if (cutoff > .5 * fs)
+    cutoff = .5 * fs;
+
   if (insp->req_params.audio.demod != SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED) {
     switch (insp->req_params.audio.demod)
     {
@@ -236,7 +324,7 @@ suscan_audio_inspector_commit_config(void *private)
         filt_initialized = su_iir_bwlpf_init(
             &filt,
             5,
-            SU_ABS2NORM_FREQ(fs, insp->req_params.audio.cutoff));
+            SU_ABS2NORM_FREQ(fs, cutoff));
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_AM:
@@ -248,7 +336,7 @@ suscan_audio_inspector_commit_config(void *private)
         filt_initialized = su_iir_bwlpf_init(
             &filt,
             3,
-            SU_ABS2NORM_FREQ(fs, insp->req_params.audio.cutoff));
+            SU_ABS2NORM_FREQ(fs, cutoff));
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_LSB:
@@ -261,7 +349,7 @@ suscan_audio_inspector_commit_config(void *private)
         filt_initialized = su_iir_brickwall_lp_init(
             &filt,
             SUSCAN_AUDIO_INSPECTOR_BRICKWALL_LEN,
-            SU_ABS2NORM_FREQ(fs, insp->req_params.audio.cutoff));
+            SU_ABS2NORM_FREQ(fs, cutoff));
         break;
     }
 
@@ -273,13 +361,9 @@ suscan_audio_inspector_commit_config(void *private)
     }
   }
 
-  /* Set sampling info */
-  if (insp->req_params.audio.sample_rate > 0)
-    su_sampler_set_rate(
-        &insp->sampler,
-        SU_ABS2NORM_BAUD(fs, insp->req_params.audio.sample_rate));
-
   insp->cur_params = insp->req_params;
+
+  suscan_audio_inspector_update_lo(insp);
 }
 
 SUSDIFF
@@ -289,72 +373,145 @@ suscan_audio_inspector_feed(
     const SUCOMPLEX *x,
     SUSCOUNT count)
 {
-  SUCOMPLEX last, det_x, output;
-  SUSCOUNT i;
-  SUFLOAT alpha;
-  SUCOMPLEX lo;
+  SUCOMPLEX last, curr, output;
+  SUSCOUNT i, n, len, max_out;
+  SUSCOUNT consumed = 0;
+  SUFLOAT volume;
+  SUCOMPLEX *y, *out;
+  struct timespec t;
   struct suscan_audio_inspector *self =
       (struct suscan_audio_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = self->stats;
 
   if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED)
     return count;
 
+  y = self->block;
   last = self->last;
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
-    det_x = x[i];
+  volume = self->cur_params.audio.volume;
+  if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_AM)
+    volume *= SUSCAN_AUDIO_AM_ATTENUATION;
+
+  while (consumed < count) {
+    /* Bound block so that its output fits in the free output space */
+    max_out = MIN(
+        SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE,
+        suscan_inspector_sampler_buf_avail(insp));
+    len = MIN(count - consumed, SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE);
+
+    if (suscan_resampler_is_ready(&self->resampler))
+      len = MIN(len, suscan_resampler_get_max_input(&self->resampler, max_out));
+    else
+      len = MIN(len, max_out);
+
+    if (len == 0)
+      break;
 
     /* Perform gain control */
+    suscan_inspector_stage_enter(&t);
     switch (self->cur_params.gc.gc_ctrl) {
       case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        det_x = 2 * self->cur_params.gc.gc_gain * det_x;
+        memcpy(y, x + consumed, len * sizeof(SUCOMPLEX));
+        suscan_inspector_block_scale(y, 2 * self->cur_params.gc.gc_gain, len);
         break;
 
       case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        det_x  = 2 * su_agc_feed(&self->agc, det_x);
+        for (i = 0; i < len; ++i)
+          y[i] = su_agc_feed(&self->agc, x[consumed + i]);
+        suscan_inspector_block_scale(y, 2, len);
         break;
     }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_AUDIO_INSPECTOR_STAGE_GAIN,
+        &t,
+        len);
 
+    suscan_inspector_stage_enter(&t);
     switch (self->cur_params.audio.demod) {
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_FM:
-        output = SU_C_ARG(det_x * SU_C_CONJ(last)) / M_PI;
-        last   = det_x;
+        for (i = 0; i < len; ++i) {
+          curr = y[i];
+          y[i] = SU_C_ARG(curr * SU_C_CONJ(last)) / M_PI;
+          last = curr;
+        }
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_AM:
-        /* Synchronous detection */
-        output  = su_pll_track(&self->pll, det_x);
-
-        /* Carrier removal */
-        last   += self->beta * (output - last);
-        output -= last;
-
-        /* Volume attenuation */
-        output *= SUSCAN_AUDIO_AM_ATTENUATION;
+        for (i = 0; i < len; ++i) {
+          /* Synchronous detection */
+          output  = su_pll_track(&self->pll, y[i]);
+
+          /* Carrier removal */
+          last   += self->beta * (output - last);
+          y[i]    = output - last;
+        }
         break;
 
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_USB:
-        lo = su_ncqo_read(&self->lo);
-        output  = det_x * lo;
-        break;
-
       case SUSCAN_INSPECTOR_AUDIO_DEMOD_LSB:
-        lo = su_ncqo_read(&self->lo);
-        output = det_x * SU_C_CONJ(lo);
+        suscan_inspector_rotator_apply(&self->lo, y, y, len);
         break;
     }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_AUDIO_INSPECTOR_STAGE_DEMOD,
+        &t,
+        len);
+
+    /* Volume (and AM attenuation), then reduce rate as early as possible */
+    suscan_inspector_stage_enter(&t);
+    suscan_inspector_block_scale(y, volume, len);
+    if (suscan_resampler_is_ready(&self->resampler))
+      n = suscan_resampler_decimate(&self->resampler, y, len, y);
+    else
+      n = len;
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_AUDIO_INSPECTOR_STAGE_DECIMATOR,
+        &t,
+        len);
+
+    /* Audio filter, at the intermediate rate */
+    suscan_inspector_stage_enter(&t);
+    suscan_inspector_block_iir_filt(&self->filt, y, n);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_AUDIO_INSPECTOR_STAGE_FILTER,
+        &t,
+        n);
+
+    /* Fractional resampling to the audio rate */
+    suscan_inspector_stage_enter(&t);
+    out = y;
+    if (suscan_resampler_is_ready(&self->resampler)) {
+      out = self->output;
+      n = suscan_resampler_interpolate(&self->resampler, y, n, out);
+    }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_AUDIO_INSPECTOR_STAGE_RESAMPLER,
+        &t,
+        n);
 
-    output *= self->cur_params.audio.volume;
-
-    output = su_iir_filt_feed(&self->filt, output);
+    for (i = 0; i < n; ++i)
+      suscan_inspector_push_sample(insp, out[i] * .75);
 
-    if (su_sampler_feed(&self->sampler, &output))
-      suscan_inspector_push_sample(insp, output * .75);
+    consumed += len;
   }
 
   self->last = last;
 
-  return i;
+  return consumed;
+}
+
+void
+suscan_audio_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_audio_inspector *insp =
+      (struct suscan_audio_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_AUDIO_INSPECTOR_STAGE_COUNT;
 }
 
 void
@@ -369,9 +526,11 @@ SUPRIVATE struct suscan_inspector_interface iface = {
     .open = suscan_audio_inspector_open,
     .get_config = suscan_audio_inspector_get_config,
     .parse_config = suscan_audio_inspector_parse_config,
+    .check_config = suscan_audio_inspector_check_config,
     .commit_config = suscan_audio_inspector_commit_config,
     .new_bandwidth = suscan_audio_inspector_new_bandwidth,
     .feed = suscan_audio_inspector_feed,
+    .get_stage_stats = suscan_audio_inspector_get_stage_stats,
     .close = suscan_audio_inspector_close
 };
 
@@ -386,6 +545,15 @@ suscan_audio_inspector_register(void)
   SU_TRYCATCH(suscan_config_desc_add_gc_params(iface.cfgdesc), return SU_FALSE);
   SU_TRYCATCH(suscan_config_desc_add_audio_params(iface.cfgdesc), return SU_FALSE);
 
+  /* Add estimators */
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "carrier-sdft"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "snr-m2m4"),
+      return SU_FALSE);
+
   /* Register inspector interface */
   SU_TRYCATCH(suscan_inspector_interface_register(&iface), return SU_FALSE);
 
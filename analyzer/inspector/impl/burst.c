@@ -0,0 +1,672 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+/*
+ * Burst inspector. Instead of streaming channel samples, it keeps a short
+ * history of the channel and waits for a trigger: either the smoothed
+ * channel power exceeding the noise floor by burst.threshold dB, or the
+ * normalized correlation against a BPSK preamble exceeding
+ * burst.corr_threshold. Captured samples (including burst.pretrigger
+ * seconds before the trigger) are delivered as a single burst once the
+ * power stays below the threshold for burst.hang seconds.
+ *
+ * Preamble correlation is coherent: frequency offsets must be small
+ * compared to the inverse of the preamble duration.
+ */
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "burst-inspector"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/interface.h"
+#include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/inspector.h"
+
+#define SUSCAN_BURST_INSPECTOR_DEFAULT_THRESHOLD  10    /* dB */
+#define SUSCAN_BURST_INSPECTOR_DEFAULT_PRETRIGGER 1e-3  /* s */
+#define SUSCAN_BURST_INSPECTOR_DEFAULT_HANG       1e-3  /* s */
+#define SUSCAN_BURST_INSPECTOR_DEFAULT_MAX_LENGTH .1    /* s */
+#define SUSCAN_BURST_INSPECTOR_DEFAULT_CORR       .7
+#define SUSCAN_BURST_INSPECTOR_LEVEL_SAMPLES      8
+#define SUSCAN_BURST_INSPECTOR_NOISE_SECONDS      .5
+#define SUSCAN_BURST_INSPECTOR_NOISE_ADAPT_SECONDS 10  /* For 10 dB rises */
+#define SUSCAN_BURST_INSPECTOR_WARMUP_SECONDS     .01
+#define SUSCAN_BURST_INSPECTOR_MIN_WARMUP         64
+#define SUSCAN_BURST_INSPECTOR_MAX_SAMPLES        (1 << 22)
+#define SUSCAN_BURST_INSPECTOR_MAX_PREAMBLE_LEN   (1 << 16)
+
+struct suscan_burst_inspector_params {
+  struct suscan_inspector_burst_params burst;
+};
+
+enum suscan_burst_inspector_stage {
+  SUSCAN_BURST_INSPECTOR_STAGE_TRIGGER,
+  SUSCAN_BURST_INSPECTOR_STAGE_CAPTURE,
+  SUSCAN_BURST_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_burst_inspector_stage_names[] = {
+    "trigger", "capture"
+};
+
+struct suscan_burst_inspector {
+  struct suscan_inspector_sampling_info samp_info;
+  struct suscan_burst_inspector_params req_params;
+  struct suscan_burst_inspector_params cur_params;
+
+  /* Channel history, doubled to read it as a contiguous window */
+  SUCOMPLEX *history;
+  SUSCOUNT   history_size;
+  SUSCOUNT   ptr;
+  SUSCOUNT   fill;
+  SUSCOUNT   pretrigger;     /* In samples */
+
+  /* Power tracking */
+  SUFLOAT    level;          /* Smoothed channel power */
+  SUFLOAT    level_alpha;
+  SUFLOAT    noise;          /* Noise floor, tracked while idle */
+  SUFLOAT    noise_alpha;
+  SUFLOAT    noise_growth;   /* Growth factor while above threshold */
+  SUSCOUNT   warmup;         /* Samples used for the initial estimate */
+  SUSCOUNT   warmup_left;
+  SUFLOAT    ratio;          /* Energy threshold (linear) */
+
+  /* Preamble correlator */
+  SUFLOAT   *preamble;       /* Bipolar template, one value per sample */
+  SUSCOUNT   preamble_len;
+  SUFLOAT    preamble_energy;
+  SUFLOAT    window_energy;  /* Energy of the last preamble_len samples */
+
+  /* Capture in progress */
+  SUBOOL     capturing;
+  SUCOMPLEX *capture;
+  SUSCOUNT   capture_len;
+  SUSCOUNT   capture_max;    /* Samples after the trigger */
+  SUSCOUNT   capture_size;   /* Allocation of the current capture */
+  SUSCOUNT   capture_pre;
+  SUSCOUNT   since_start;
+  SUSCOUNT   hang_max;
+  SUSCOUNT   hang_left;
+  SUFLOAT    power_acc;
+  SUFLOAT    trigger_noise;
+
+  /* Completed burst, waiting to be retrieved */
+  SUBOOL     ready;
+  struct suscan_inspector_burst burst;
+
+  struct suscan_inspector_stage_stats
+    stats[SUSCAN_BURST_INSPECTOR_STAGE_COUNT];
+};
+
+SUPRIVATE void
+suscan_burst_inspector_params_initialize(
+    struct suscan_burst_inspector_params *params)
+{
+  memset(params, 0, sizeof(struct suscan_burst_inspector_params));
+
+  params->burst.trigger        = SUSCAN_INSPECTOR_BURST_TRIGGER_ENERGY;
+  params->burst.threshold      = SUSCAN_BURST_INSPECTOR_DEFAULT_THRESHOLD;
+  params->burst.pretrigger     = SUSCAN_BURST_INSPECTOR_DEFAULT_PRETRIGGER;
+  params->burst.hang           = SUSCAN_BURST_INSPECTOR_DEFAULT_HANG;
+  params->burst.max_length     = SUSCAN_BURST_INSPECTOR_DEFAULT_MAX_LENGTH;
+  params->burst.corr_threshold = SUSCAN_BURST_INSPECTOR_DEFAULT_CORR;
+}
+
+SUPRIVATE void
+suscan_burst_inspector_abort_capture(struct suscan_burst_inspector *insp)
+{
+  if (insp->capture != NULL) {
+    free(insp->capture);
+    insp->capture = NULL;
+  }
+
+  insp->capturing = SU_FALSE;
+}
+
+SUPRIVATE void
+suscan_burst_inspector_destroy(struct suscan_burst_inspector *insp)
+{
+  suscan_burst_inspector_abort_capture(insp);
+
+  if (insp->burst.samples != NULL)
+    free(insp->burst.samples);
+
+  if (insp->history != NULL)
+    free(insp->history);
+
+  if (insp->preamble != NULL)
+    free(insp->preamble);
+
+  free(insp);
+}
+
+/*
+ * Bits are mapped to +1 (1) and -1 (0) and held during one symbol
+ * period. Characters other than 0 and 1 are ignored.
+ */
+SUPRIVATE SUBOOL
+suscan_burst_inspector_init_preamble(struct suscan_burst_inspector *insp)
+{
+  const char *bits = insp->cur_params.burst.preamble;
+  SUFLOAT symbols[SUSCAN_INSPECTOR_BURST_MAX_PREAMBLE];
+  SUFLOAT *preamble = NULL;
+  SUFLOAT sps;
+  SUSCOUNT i, nbits = 0, len;
+
+  for (i = 0; bits[i] != '\0'; ++i)
+    if (bits[i] == '0' || bits[i] == '1')
+      symbols[nbits++] = bits[i] == '1' ? 1 : -1;
+
+  SU_TRYCATCH(nbits > 0, goto fail);
+  SU_TRYCATCH(insp->cur_params.burst.baud > 0, goto fail);
+
+  sps = insp->samp_info.equiv_fs / insp->cur_params.burst.baud;
+  len = SU_FLOOR(nbits * sps);
+
+  SU_TRYCATCH(len > 0, goto fail);
+  SU_TRYCATCH(len <= SUSCAN_BURST_INSPECTOR_MAX_PREAMBLE_LEN, goto fail);
+
+  SU_TRYCATCH(preamble = malloc(len * sizeof(SUFLOAT)), goto fail);
+
+  for (i = 0; i < len; ++i)
+    preamble[i] = symbols[MIN((SUSCOUNT) (i / sps), nbits - 1)];
+
+  if (insp->preamble != NULL)
+    free(insp->preamble);
+
+  insp->preamble = preamble;
+  insp->preamble_len = len;
+  insp->preamble_energy = len;
+
+  return SU_TRUE;
+
+fail:
+  if (preamble != NULL)
+    free(preamble);
+
+  return SU_FALSE;
+}
+
+/*
+ * The history must hold both the pre-trigger samples and the preamble
+ * window, plus the sample being processed.
+ */
+SUPRIVATE SUBOOL
+suscan_burst_inspector_init_history(struct suscan_burst_inspector *insp)
+{
+  SUCOMPLEX *history = NULL;
+  SUSCOUNT size;
+
+  size = insp->pretrigger;
+  if (insp->preamble != NULL && insp->preamble_len > size)
+    size = insp->preamble_len;
+  ++size;
+
+  if (size == insp->history_size)
+    return SU_TRUE;
+
+  SU_TRYCATCH(history = calloc(2 * size, sizeof(SUCOMPLEX)), return SU_FALSE);
+
+  if (insp->history != NULL)
+    free(insp->history);
+
+  insp->history       = history;
+  insp->history_size  = size;
+  insp->ptr           = 0;
+  insp->fill          = 0;
+  insp->window_energy = 0;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_burst_inspector_update_coefs(struct suscan_burst_inspector *insp)
+{
+  SUFLOAT fs = insp->samp_info.equiv_fs;
+  SUFLOAT max_len;
+
+  insp->ratio      = SU_POWER_MAG(insp->cur_params.burst.threshold);
+  insp->pretrigger = SU_FLOOR(insp->cur_params.burst.pretrigger * fs);
+  insp->hang_max   = SU_CEIL(insp->cur_params.burst.hang * fs);
+
+  max_len = SU_CEIL(insp->cur_params.burst.max_length * fs);
+  if (max_len > SUSCAN_BURST_INSPECTOR_MAX_SAMPLES)
+    max_len = SUSCAN_BURST_INSPECTOR_MAX_SAMPLES;
+  if (max_len < 1)
+    max_len = 1;
+
+  if (insp->pretrigger > SUSCAN_BURST_INSPECTOR_MAX_SAMPLES)
+    insp->pretrigger = SUSCAN_BURST_INSPECTOR_MAX_SAMPLES;
+
+  insp->capture_max = max_len;
+}
+
+SUPRIVATE struct suscan_burst_inspector *
+suscan_burst_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
+{
+  struct suscan_burst_inspector *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_burst_inspector)),
+      goto fail);
+
+  new->samp_info = *sinfo;
+
+  suscan_burst_inspector_params_initialize(&new->cur_params);
+  new->req_params = new->cur_params;
+
+  new->level_alpha = 1. / SUSCAN_BURST_INSPECTOR_LEVEL_SAMPLES;
+  new->noise_alpha = 1 - SU_EXP(
+      -1. / (SUSCAN_BURST_INSPECTOR_NOISE_SECONDS * sinfo->equiv_fs));
+  new->noise_growth = SU_POW(
+      10.,
+      1. / (SUSCAN_BURST_INSPECTOR_NOISE_ADAPT_SECONDS * sinfo->equiv_fs));
+
+  new->warmup = SUSCAN_BURST_INSPECTOR_WARMUP_SECONDS * sinfo->equiv_fs;
+  if (new->warmup < SUSCAN_BURST_INSPECTOR_MIN_WARMUP)
+    new->warmup = SUSCAN_BURST_INSPECTOR_MIN_WARMUP;
+  new->warmup_left = new->warmup;
+
+  suscan_burst_inspector_update_coefs(new);
+
+  SU_TRYCATCH(suscan_burst_inspector_init_history(new), goto fail);
+
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_burst_inspector_stage_names,
+      SUSCAN_BURST_INSPECTOR_STAGE_COUNT);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_burst_inspector_destroy(new);
+
+  return NULL;
+}
+
+/************************** API implementation *******************************/
+void *
+suscan_burst_inspector_open(const struct suscan_inspector_sampling_info *s)
+{
+  return suscan_burst_inspector_new(s);
+}
+
+SUBOOL
+suscan_burst_inspector_get_config(void *private, suscan_config_t *config)
+{
+  struct suscan_burst_inspector *insp =
+      (struct suscan_burst_inspector *) private;
+
+  SU_TRYCATCH(
+      suscan_inspector_burst_params_save(&insp->cur_params.burst, config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_burst_inspector_parse_params(
+    struct suscan_burst_inspector_params *params,
+    const suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_inspector_burst_params_parse(&params->burst, config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_burst_inspector_parse_config(void *private, const suscan_config_t *config)
+{
+  struct suscan_burst_inspector *insp =
+      (struct suscan_burst_inspector *) private;
+
+  return suscan_burst_inspector_parse_params(&insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_burst_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_burst_inspector_params params;
+
+  return suscan_burst_inspector_parse_params(&params, config);
+}
+
+/* Called from the worker thread */
+void
+suscan_burst_inspector_commit_config(void *private)
+{
+  struct suscan_burst_inspector *insp =
+      (struct suscan_burst_inspector *) private;
+
+  insp->cur_params = insp->req_params;
+
+  /* Captures in progress were sized for the previous configuration */
+  suscan_burst_inspector_abort_capture(insp);
+
+  if (insp->cur_params.burst.trigger
+      == SUSCAN_INSPECTOR_BURST_TRIGGER_PREAMBLE) {
+    if (!suscan_burst_inspector_init_preamble(insp)) {
+      SU_ERROR("Invalid preamble, falling back to energy trigger\n");
+      insp->cur_params.burst.trigger = SUSCAN_INSPECTOR_BURST_TRIGGER_ENERGY;
+    }
+  }
+
+  if (insp->cur_params.burst.trigger
+      != SUSCAN_INSPECTOR_BURST_TRIGGER_PREAMBLE
+      && insp->preamble != NULL) {
+    free(insp->preamble);
+    insp->preamble = NULL;
+    insp->preamble_len = 0;
+  }
+
+  suscan_burst_inspector_update_coefs(insp);
+
+  /* The previous history is still valid if no preamble is needed */
+  if (!suscan_burst_inspector_init_history(insp)) {
+    SU_ERROR("Failed to resize burst history, using energy trigger\n");
+    insp->cur_params.burst.trigger = SUSCAN_INSPECTOR_BURST_TRIGGER_ENERGY;
+    if (insp->preamble != NULL) {
+      free(insp->preamble);
+      insp->preamble = NULL;
+      insp->preamble_len = 0;
+    }
+    insp->pretrigger = insp->history_size - 1;
+  }
+}
+
+/*
+ * Push a sample into the history and the preamble energy window. The
+ * energy window is recomputed every time the history wraps, so that
+ * rounding errors do not accumulate.
+ */
+SUINLINE void
+suscan_burst_inspector_push_history(
+    struct suscan_burst_inspector *self,
+    SUCOMPLEX x)
+{
+  SUSCOUNT size = self->history_size;
+  SUSCOUNT len = self->preamble_len;
+  SUSCOUNT i;
+  SUCOMPLEX old;
+
+  if (self->preamble != NULL) {
+    old = self->history[self->ptr + size - len];
+    self->window_energy += SU_C_REAL(x * SU_C_CONJ(x));
+    self->window_energy -= SU_C_REAL(old * SU_C_CONJ(old));
+  }
+
+  self->history[self->ptr] = self->history[self->ptr + size] = x;
+  if (++self->ptr == size) {
+    self->ptr = 0;
+
+    if (self->preamble != NULL) {
+      self->window_energy = 0;
+      for (i = size - len; i < size; ++i)
+        self->window_energy +=
+            SU_C_REAL(self->history[i] * SU_C_CONJ(self->history[i]));
+    }
+  }
+
+  if (self->fill < size)
+    ++self->fill;
+}
+
+SUINLINE SUBOOL
+suscan_burst_inspector_triggered(struct suscan_burst_inspector *self)
+{
+  SUSCOUNT len = self->preamble_len;
+  SUCOMPLEX corr;
+
+  if (self->preamble == NULL)
+    return self->level > self->ratio * self->noise;
+
+  if (self->fill < len || self->window_energy <= 0)
+    return SU_FALSE;
+
+  corr = suscan_inspector_dot_real(
+      self->history + self->ptr + self->history_size - len,
+      self->preamble,
+      len);
+
+  return SU_C_REAL(corr * SU_C_CONJ(corr))
+      >= self->cur_params.burst.corr_threshold
+       * self->cur_params.burst.corr_threshold
+       * self->preamble_energy
+       * self->window_energy;
+}
+
+/* Copies the pre-trigger samples and the current one */
+SUPRIVATE SUBOOL
+suscan_burst_inspector_start_capture(
+    struct suscan_burst_inspector *self,
+    SUFLOAT power)
+{
+  SUSCOUNT pre = self->pretrigger;
+
+  if (self->preamble != NULL && self->preamble_len - 1 > pre)
+    pre = self->preamble_len - 1;
+
+  if (pre > self->fill - 1)
+    pre = self->fill - 1;
+
+  self->capture_size = pre + self->capture_max;
+
+  SU_TRYCATCH(
+      self->capture = malloc(self->capture_size * sizeof(SUCOMPLEX)),
+      return SU_FALSE);
+
+  memcpy(
+      self->capture,
+      self->history + self->ptr + self->history_size - (pre + 1),
+      (pre + 1) * sizeof(SUCOMPLEX));
+
+  self->capture_len   = pre + 1;
+  self->capture_pre   = pre;
+  self->since_start   = pre + 1;
+  self->hang_left     = self->hang_max;
+  self->power_acc     = power;
+  self->trigger_noise = self->noise;
+  self->capturing     = SU_TRUE;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+suscan_burst_inspector_finish_capture(struct suscan_burst_inspector *self)
+{
+  SUSCOUNT post = self->capture_len - self->capture_pre;
+
+  self->burst.samples    = self->capture;
+  self->burst.count      = self->capture_len;
+  self->burst.pretrigger = self->capture_pre;
+  self->burst.delay      = self->since_start;
+  self->burst.power      = SU_POWER_DB(self->power_acc / post);
+  self->burst.noise      = SU_POWER_DB(self->trigger_noise);
+
+  self->capture   = NULL;
+  self->capturing = SU_FALSE;
+  self->ready     = SU_TRUE;
+}
+
+SUSDIFF
+suscan_burst_inspector_feed(
+    void *private,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  struct suscan_burst_inspector *self =
+      (struct suscan_burst_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = self->stats;
+  struct timespec t;
+  SUSCOUNT i, idle = 0;
+  SUFLOAT power;
+
+  /* Wait until the pending burst is retrieved */
+  if (self->ready)
+    return 0;
+
+  suscan_inspector_stage_enter(&t);
+
+  for (i = 0; i < count; ++i) {
+    power = SU_C_REAL(x[i] * SU_C_CONJ(x[i]));
+
+    if (self->warmup_left == self->warmup)
+      self->level = power;
+    else
+      self->level += self->level_alpha * (power - self->level);
+
+    suscan_burst_inspector_push_history(self, x[i]);
+
+    if (self->capturing) {
+      self->capture[self->capture_len++] = x[i];
+      self->power_acc += power;
+      ++self->since_start;
+
+      if (self->level > self->ratio * self->trigger_noise)
+        self->hang_left = self->hang_max;
+      else if (self->hang_left > 0)
+        --self->hang_left;
+
+      if (self->hang_left == 0 || self->capture_len >= self->capture_size) {
+        suscan_burst_inspector_finish_capture(self);
+        ++i;
+        break;
+      }
+    } else {
+      ++idle;
+
+      /*
+       * The initial noise estimate is the mean level over the warmup
+       * period. After that, levels above the threshold are not averaged:
+       * the floor is only allowed to grow slowly, in case it changed.
+       */
+      if (self->warmup_left > 0) {
+        self->noise += (self->level - self->noise)
+            / (self->warmup - self->warmup_left + 1);
+        --self->warmup_left;
+        continue;
+      } else if (self->level < self->ratio * self->noise) {
+        self->noise += self->noise_alpha * (self->level - self->noise);
+      } else {
+        self->noise *= self->noise_growth;
+      }
+
+      if (suscan_burst_inspector_triggered(self)
+          && !suscan_burst_inspector_start_capture(self, power))
+        SU_ERROR("Cannot allocate burst, trigger ignored\n");
+    }
+  }
+
+  suscan_inspector_stage_leave(
+      stats + SUSCAN_BURST_INSPECTOR_STAGE_TRIGGER,
+      &t,
+      idle);
+
+  /* Capture time is not measured separately */
+  stats[SUSCAN_BURST_INSPECTOR_STAGE_CAPTURE].samples += i - idle;
+  ++stats[SUSCAN_BURST_INSPECTOR_STAGE_CAPTURE].blocks;
+
+  return i;
+}
+
+SUBOOL
+suscan_burst_inspector_pop_burst(
+    void *private,
+    struct suscan_inspector_burst *burst)
+{
+  struct suscan_burst_inspector *self =
+      (struct suscan_burst_inspector *) private;
+
+  if (!self->ready)
+    return SU_FALSE;
+
+  *burst = self->burst;
+
+  self->burst.samples = NULL;
+  self->ready = SU_FALSE;
+
+  return SU_TRUE;
+}
+
+void
+suscan_burst_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_burst_inspector *insp =
+      (struct suscan_burst_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_BURST_INSPECTOR_STAGE_COUNT;
+}
+
+void
+suscan_burst_inspector_close(void *private)
+{
+  suscan_burst_inspector_destroy((struct suscan_burst_inspector *) private);
+}
+
+SUPRIVATE struct suscan_inspector_interface iface = {
+    .name = "burst",
+    .desc = "Burst capture inspector",
+    .open = suscan_burst_inspector_open,
+    .get_config = suscan_burst_inspector_get_config,
+    .parse_config = suscan_burst_inspector_parse_config,
+    .check_config = suscan_burst_inspector_check_config,
+    .commit_config = suscan_burst_inspector_commit_config,
+    .feed = suscan_burst_inspector_feed,
+    .pop_burst = suscan_burst_inspector_pop_burst,
+    .get_stage_stats = suscan_burst_inspector_get_stage_stats,
+    .close = suscan_burst_inspector_close
+};
+
+SUBOOL
+suscan_burst_inspector_register(void)
+{
+  SU_TRYCATCH(
+      iface.cfgdesc = suscan_config_desc_new(),
+      return SU_FALSE);
+
+  /* Add all configuration parameters */
+  SU_TRYCATCH(
+      suscan_config_desc_add_burst_params(iface.cfgdesc),
+      return SU_FALSE);
+
+  /* Add applicable spectrum sources */
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_spectsrc(&iface, "psd"),
+      return SU_FALSE);
+
+  /* Register inspector interface */
+  SU_TRYCATCH(suscan_inspector_interface_register(&iface), return SU_FALSE);
+
+  return SU_TRUE;
+}
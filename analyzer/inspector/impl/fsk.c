@@ -30,6 +30,9 @@
 
 #include "inspector/interface.h"
 #include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/mfsampler.h"
+#include "inspector/demapper.h"
 
 #include "inspector/inspector.h"
 
@@ -38,6 +41,7 @@
 #define SUSCAN_FSK_INSPECTOR_DEFAULT_EQ_MU     1e-3
 #define SUSCAN_FSK_INSPECTOR_DEFAULT_EQ_LENGTH 20
 #define SUSCAN_FSK_INSPECTOR_MAX_MF_SPAN       1024
+#define SUSCAN_FSK_INSPECTOR_DEFAULT_SOFT_SCALE 8
 
 /*
  * Spike durations measured in symbol times
@@ -57,6 +61,20 @@ struct suscan_fsk_inspector_params {
   struct suscan_inspector_mf_params mf;
   struct suscan_inspector_br_params br;
   struct suscan_inspector_fsk_params fsk;
+  struct suscan_inspector_soft_params soft;
+};
+
+enum suscan_fsk_inspector_stage {
+  SUSCAN_FSK_INSPECTOR_STAGE_MIXER,
+  SUSCAN_FSK_INSPECTOR_STAGE_GAIN,
+  SUSCAN_FSK_INSPECTOR_STAGE_DISCRIMINATOR,
+  SUSCAN_FSK_INSPECTOR_STAGE_MF,
+  SUSCAN_FSK_INSPECTOR_STAGE_TIMING,
+  SUSCAN_FSK_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_fsk_inspector_stage_names[] = {
+    "mixer", "gain", "discriminator", "mf", "timing"
 };
 
 struct suscan_fsk_inspector {
@@ -69,9 +87,16 @@ struct suscan_fsk_inspector {
   su_iir_filt_t       mf;         /* Matched filter (Root Raised Cosine) */
   su_clock_detector_t cd;         /* Clock detector */
   su_sampler_t        sampler;    /* Sampler */
-  su_ncqo_t           lo;         /* Oscillator for manual carrier offset */
+  suscan_mf_sampler_t mfs;        /* Polyphase matched filter + sampler */
+  struct suscan_inspector_rotator lo; /* Manual carrier offset */
   SUCOMPLEX           phase;      /* Local oscillator phase */
   SUCOMPLEX           last;       /* Last processed sample */
+  suscan_soft_demapper_t demapper; /* Soft symbol output */
+  SUBOOL              soft;       /* Soft symbols enabled */
+
+  /* Block processing */
+  SUCOMPLEX block[SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE];
+  struct suscan_inspector_stage_stats stats[SUSCAN_FSK_INSPECTOR_STAGE_COUNT];
 };
 
 SUSCOUNT
@@ -106,6 +131,9 @@ suscan_fsk_inspector_params_initialize(
   params->fsk.bits_per_tone = 1;
   params->fsk.quad_demod    = SU_FALSE;
   params->fsk.phase         = PI;
+
+  params->soft.soft_bits  = 1;
+  params->soft.soft_scale = SUSCAN_FSK_INSPECTOR_DEFAULT_SOFT_SCALE;
 }
 
 SUPRIVATE void
@@ -119,6 +147,8 @@ suscan_fsk_inspector_destroy(struct suscan_fsk_inspector *insp)
 
   su_sampler_finalize(&insp->sampler);
 
+  suscan_mf_sampler_finalize(&insp->mfs);
+
   free(insp);
 }
 
@@ -153,9 +183,14 @@ suscan_fsk_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
   SU_TRYCATCH(su_sampler_init(&new->sampler, tau), goto fail);
 
   /* Initialize local oscillator */
-  su_ncqo_init(&new->lo, 0);
+  suscan_inspector_rotator_init(&new->lo);
   new->phase = SU_C_EXP(I * new->cur_params.fsk.phase);
 
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_fsk_inspector_stage_names,
+      SUSCAN_FSK_INSPECTOR_STAGE_COUNT);
+
   /* Initialize AGC */
   tau = 1. / bw; /* Samples per symbol */
 
@@ -223,37 +258,63 @@ suscan_fsk_inspector_get_config(void *private, suscan_config_t *config)
       suscan_inspector_fsk_params_save(&insp->cur_params.fsk, config),
       return SU_FALSE);
 
+  SU_TRYCATCH(
+      suscan_inspector_soft_params_save(&insp->cur_params.soft, config),
+      return SU_FALSE);
+
   return SU_TRUE;
 }
 
-SUBOOL
-suscan_fsk_inspector_parse_config(void *private, const suscan_config_t *config)
+SUPRIVATE SUBOOL
+suscan_fsk_inspector_parse_params(
+    struct suscan_fsk_inspector_params *params,
+    const suscan_config_t *config)
 {
-  struct suscan_fsk_inspector *insp = (struct suscan_fsk_inspector *) private;
+  suscan_fsk_inspector_params_initialize(params);
 
-  suscan_fsk_inspector_params_initialize(&insp->req_params);
+  SU_TRYCATCH(
+      suscan_inspector_gc_params_parse(&params->gc, config),
+      return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_gc_params_parse(&insp->req_params.gc, config),
+      suscan_inspector_mf_params_parse(&params->mf, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_mf_params_parse(&insp->req_params.mf, config),
+      suscan_inspector_br_params_parse(&params->br, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_br_params_parse(&insp->req_params.br, config),
+      suscan_inspector_fsk_params_parse(&params->fsk, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_fsk_params_parse(&insp->req_params.fsk, config),
+      suscan_inspector_soft_params_parse(&params->soft, config),
       return SU_FALSE);
 
   return SU_TRUE;
+}
+
+SUBOOL
+suscan_fsk_inspector_parse_config(void *private, const suscan_config_t *config)
+{
+  struct suscan_fsk_inspector *insp = (struct suscan_fsk_inspector *) private;
 
+  return suscan_fsk_inspector_parse_params(&insp->req_params, config);
 }
 
-/* This method is called inside the inspector mutex */
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_fsk_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_fsk_inspector_params params;
+
+  return suscan_fsk_inspector_parse_params(&params, config);
+}
+
+/* This method is called from the worker thread */
 void
 suscan_fsk_inspector_commit_config(void *private)
 {
@@ -262,6 +323,7 @@ suscan_fsk_inspector_commit_config(void *private)
   SUFLOAT actual_baud;
   SUFLOAT sym_period;
   su_iir_filt_t mf = su_iir_filt_INITIALIZER;
+  suscan_mf_sampler_t mfs = suscan_mf_sampler_INITIALIZER;
   struct suscan_fsk_inspector *insp = (struct suscan_fsk_inspector *) private;
 
   actual_baud = insp->req_params.br.br_running
@@ -301,6 +363,38 @@ suscan_fsk_inspector_commit_config(void *private)
       insp->mf = mf;
     }
   }
+
+  /* Update polyphase matched filter, used with manual baudrate control */
+  if (sym_period < 1) {
+    suscan_mf_sampler_finalize(&insp->mfs);
+  } else if (mf_changed || !suscan_mf_sampler_is_ready(&insp->mfs)) {
+    if (!suscan_mf_sampler_init(
+        &mfs,
+        sym_period,
+        insp->cur_params.mf.mf_rolloff,
+        suscan_fsk_inspector_mf_span(6 * sym_period))) {
+      SU_ERROR("No memory left to update polyphase matched filter!\n");
+    } else {
+      suscan_mf_sampler_finalize(&insp->mfs);
+      insp->mfs = mfs;
+    }
+  }
+
+  if (suscan_mf_sampler_is_ready(&insp->mfs))
+    suscan_mf_sampler_set_phase_addend(
+        &insp->mfs,
+        insp->cur_params.br.sym_phase);
+
+  /* Tones are demapped from the discriminator output, before rotation */
+  insp->soft = insp->cur_params.soft.soft_enabled;
+  if (insp->soft && !suscan_soft_demapper_init(
+      &insp->demapper,
+      SUSCAN_SOFT_DEMAPPER_FSK,
+      insp->cur_params.fsk.bits_per_tone,
+      insp->cur_params.soft.soft_scale)) {
+    SU_ERROR("Invalid soft symbol configuration, sending samples\n");
+    insp->soft = SU_FALSE;
+  }
 }
 
 SUSDIFF
@@ -310,68 +404,166 @@ suscan_fsk_inspector_feed(
     const SUCOMPLEX *x,
     SUSCOUNT count)
 {
-  SUSCOUNT i;
-  SUSCOUNT osize = 0;
-  SUFLOAT alpha;
-  SUCOMPLEX const_gain;
-  SUCOMPLEX det_x;
+  SUSCOUNT i, n, len;
+  SUSCOUNT consumed = 0;
+  SUBOOL use_mfs;
+  SUCOMPLEX curr;
   SUCOMPLEX output;
-  SUBOOL new_sample = SU_FALSE;
-  SUCOMPLEX last = 0;
-
+  SUCOMPLEX last;
+  SUCOMPLEX *y;
+  int8_t llr[SUSCAN_SOFT_DEMAPPER_MAX_BITS];
+  struct timespec t;
   struct suscan_fsk_inspector *fsk_insp =
       (struct suscan_fsk_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = fsk_insp->stats;
+
+  y = fsk_insp->block;
+
+  /* With manual timing, the matched filter is merged into the sampler */
+  use_mfs = fsk_insp->cur_params.mf.mf_conf
+      == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL
+      && fsk_insp->cur_params.br.br_ctrl
+      == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL
+      && suscan_mf_sampler_is_ready(&fsk_insp->mfs);
 
   last = fsk_insp->last;
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
+  while (consumed < count) {
+    /* At most one symbol per sample: bound block by free output space */
+    len = MIN(count - consumed, SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE);
+    len = MIN(len, suscan_inspector_sampler_buf_avail(insp));
+
+    if (len == 0)
+      break;
+
     /* Re-center carrier */
-    det_x = x[i] * SU_C_CONJ(su_ncqo_read(&fsk_insp->lo));
+    suscan_inspector_stage_enter(&t);
+    suscan_inspector_rotator_apply(&fsk_insp->lo, x + consumed, y, len);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_FSK_INSPECTOR_STAGE_MIXER,
+        &t,
+        len);
 
     /* Perform gain control */
+    suscan_inspector_stage_enter(&t);
     switch (fsk_insp->cur_params.gc.gc_ctrl) {
       case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        const_gain = 2 * fsk_insp->cur_params.gc.gc_gain * det_x;
+        suscan_inspector_block_scale(
+            y,
+            2 * fsk_insp->cur_params.gc.gc_gain,
+            len);
         break;
 
       case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        const_gain = 2 * su_agc_feed(&fsk_insp->agc, det_x);
+        for (i = 0; i < len; ++i)
+          y[i] = su_agc_feed(&fsk_insp->agc, y[i]);
+        suscan_inspector_block_scale(y, 2, len);
         break;
     }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_FSK_INSPECTOR_STAGE_GAIN,
+        &t,
+        len);
 
     /*
      * We are actually encoding frequency information in the phase. This
      * is intentional, as the UI quantizes the argument of each sample.
      */
-    if (fsk_insp->cur_params.fsk.quad_demod)
-      det_x = const_gain * SU_C_CONJ(last);
-    else
-      det_x = (const_gain * SU_C_CONJ(last)) /
-      (.5 * (const_gain * SU_C_CONJ(const_gain) + last * SU_C_CONJ(last)) + 1e-8);
-
-    last = const_gain;
-
-    /* Add matched filter, if enabled */
-    if (fsk_insp->cur_params.mf.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
-      det_x = su_iir_filt_feed(&fsk_insp->mf, det_x);
-
-    /* Check if channel sampler is enabled */
-    if (fsk_insp->cur_params.br.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
-      output = det_x;
-      new_sample = su_sampler_feed(&fsk_insp->sampler, &output);
+    suscan_inspector_stage_enter(&t);
+    if (fsk_insp->cur_params.fsk.quad_demod) {
+      for (i = 0; i < len; ++i) {
+        curr = y[i];
+        y[i] = curr * SU_C_CONJ(last);
+        last = curr;
+      }
+    } else {
+      for (i = 0; i < len; ++i) {
+        curr = y[i];
+        y[i] = (curr * SU_C_CONJ(last)) /
+          (.5 * (curr * SU_C_CONJ(curr) + last * SU_C_CONJ(last)) + 1e-8);
+        last = curr;
+      }
+    }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_FSK_INSPECTOR_STAGE_DISCRIMINATOR,
+        &t,
+        len);
+
+    if (use_mfs) {
+      /* Matched filter is only evaluated at symbol instants */
+      suscan_inspector_stage_enter(&t);
+      n = suscan_mf_sampler_feed(&fsk_insp->mfs, y, len, y);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_FSK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     } else {
-      /* Automatic baudrate control enabled */
-      su_clock_detector_feed(&fsk_insp->cd, det_x);
-      new_sample = su_clock_detector_read(&fsk_insp->cd, &output, 1) == 1;
+      /* Add matched filter, if enabled */
+      if (fsk_insp->cur_params.mf.mf_conf
+          == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL) {
+        suscan_inspector_stage_enter(&t);
+        suscan_inspector_block_iir_filt(&fsk_insp->mf, y, len);
+        suscan_inspector_stage_leave(
+            stats + SUSCAN_FSK_INSPECTOR_STAGE_MF,
+            &t,
+            len);
+      }
+
+      /* Symbol timing. Symbols are compacted at the beginning of the block */
+      suscan_inspector_stage_enter(&t);
+      n = 0;
+      if (fsk_insp->cur_params.br.br_ctrl
+          == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
+        for (i = 0; i < len; ++i) {
+          output = y[i];
+          if (su_sampler_feed(&fsk_insp->sampler, &output))
+            y[n++] = output;
+        }
+      } else {
+        /* Automatic baudrate control enabled */
+        for (i = 0; i < len; ++i) {
+          su_clock_detector_feed(&fsk_insp->cd, y[i]);
+          if (su_clock_detector_read(&fsk_insp->cd, &output, 1) == 1)
+            y[n++] = output;
+        }
+      }
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_FSK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     }
 
-    if (new_sample)
-      suscan_inspector_push_sample(insp, output * .75 * fsk_insp->phase);
+    if (fsk_insp->soft) {
+      for (i = 0; i < n; ++i) {
+        suscan_soft_demapper_feed(&fsk_insp->demapper, y[i], llr);
+        suscan_inspector_push_soft(
+            insp,
+            llr,
+            suscan_soft_demapper_get_bits(&fsk_insp->demapper));
+      }
+    } else {
+      for (i = 0; i < n; ++i)
+        suscan_inspector_push_sample(insp, y[i] * .75 * fsk_insp->phase);
+    }
+
+    consumed += len;
   }
 
   fsk_insp->last = last;
 
-  return i;
+  return consumed;
+}
+
+void
+suscan_fsk_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_fsk_inspector *insp = (struct suscan_fsk_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_FSK_INSPECTOR_STAGE_COUNT;
 }
 
 void
@@ -386,8 +578,10 @@ SUPRIVATE struct suscan_inspector_interface iface = {
     .open = suscan_fsk_inspector_open,
     .get_config = suscan_fsk_inspector_get_config,
     .parse_config = suscan_fsk_inspector_parse_config,
+    .check_config = suscan_fsk_inspector_check_config,
     .commit_config = suscan_fsk_inspector_commit_config,
     .feed = suscan_fsk_inspector_feed,
+    .get_stage_stats = suscan_fsk_inspector_get_stage_stats,
     .close = suscan_fsk_inspector_close
 };
 
@@ -403,12 +597,23 @@ suscan_fsk_inspector_register(void)
   SU_TRYCATCH(suscan_config_desc_add_fsk_params(iface.cfgdesc), return SU_FALSE);
   SU_TRYCATCH(suscan_config_desc_add_mf_params(iface.cfgdesc), return SU_FALSE);
   SU_TRYCATCH(suscan_config_desc_add_br_params(iface.cfgdesc), return SU_FALSE);
+  SU_TRYCATCH(
+      suscan_config_desc_add_soft_params(iface.cfgdesc),
+      return SU_FALSE);
 
   /* Add estimator */
   SU_TRYCATCH(
       suscan_inspector_interface_add_estimator(&iface, "baud-nonlinear"),
       return SU_FALSE);
 
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "carrier-sdft"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "snr-m2m4"),
+      return SU_FALSE);
+
   /* Add applicable spectrum sources */
   SU_TRYCATCH(
       suscan_inspector_interface_add_spectsrc(&iface, "psd"),
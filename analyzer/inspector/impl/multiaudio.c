@@ -0,0 +1,541 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+/*
+ * Multichannel audio inspector. A single specttuner channel covering a
+ * contiguous band is split by a polyphase channelizer into equally spaced
+ * narrowband channels, which are demodulated together. Channels below the
+ * squelch level are not demodulated at all.
+ *
+ * Output samples are sent as frames of multiaudio.channels consecutive
+ * samples (one per channel, lowest frequency first) at the audio sample
+ * rate. Squelched channels produce zeroes.
+ */
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "multiaudio-inspector"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/interface.h"
+#include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/channelizer.h"
+#include "inspector/inspector.h"
+
+#define SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS     256
+#define SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_CHANNELS 8
+#define SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_SPACING  12500
+#define SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_SQUELCH  -60
+#define SUSCAN_MULTIAUDIO_INSPECTOR_SAMPLE_RATE      8000
+#define SUSCAN_MULTIAUDIO_INSPECTOR_POWER_SECONDS    .01
+#define SUSCAN_MULTIAUDIO_INSPECTOR_HANG_SECONDS     .5
+#define SUSCAN_MULTIAUDIO_AM_CARRIER_SECONDS         .2
+
+struct suscan_multiaudio_inspector_params {
+  struct suscan_inspector_audio_params audio;
+  struct suscan_inspector_multiaudio_params multiaudio;
+};
+
+enum suscan_multiaudio_inspector_stage {
+  SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_CHANNELIZER,
+  SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_SQUELCH,
+  SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_DEMOD,
+  SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_OUTPUT,
+  SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_multiaudio_inspector_stage_names[] = {
+    "channelizer", "squelch", "demod", "output"
+};
+
+struct suscan_multiaudio_inspector {
+  struct suscan_inspector_sampling_info samp_info;
+  struct suscan_multiaudio_inspector_params req_params;
+  struct suscan_multiaudio_inspector_params cur_params;
+
+  suscan_channelizer_t *channelizer;
+  unsigned int channels;  /* Channels being demodulated */
+  SUFLOAT   chan_fs;      /* Sample rate of each channel */
+  SUFLOAT   out_phase;    /* Audio sampler phase */
+  SUFLOAT   out_step;     /* Audio samples per channel sample */
+  SUFLOAT   pwr_alpha;    /* Power averaging coefficient */
+  SUFLOAT   lpf_alpha;    /* Audio low pass coefficient */
+  SUFLOAT   am_beta;      /* AM carrier averaging coefficient */
+  SUFLOAT   squelch;      /* Squelch level (linear power) */
+  SUSCOUNT  hang_max;     /* Hang time, in channel samples */
+
+  /* Per-channel state */
+  unsigned int bin[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUCOMPLEX    x[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUCOMPLEX    last[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUFLOAT      power[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUFLOAT      carrier[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUFLOAT      audio[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUSCOUNT     hang[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+
+  /* Active channels, packed */
+  unsigned int active_count;
+  unsigned int active[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUCOMPLEX    active_x[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUCOMPLEX    active_last[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+  SUFLOAT      active_out[SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS];
+
+  struct suscan_inspector_stage_stats
+    stats[SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_COUNT];
+};
+
+SUPRIVATE void
+suscan_multiaudio_inspector_params_initialize(
+    struct suscan_multiaudio_inspector_params *params)
+{
+  memset(params, 0, sizeof(struct suscan_multiaudio_inspector_params));
+
+  params->audio.sample_rate = SUSCAN_MULTIAUDIO_INSPECTOR_SAMPLE_RATE;
+  params->audio.demod       = SUSCAN_INSPECTOR_AUDIO_DEMOD_FM;
+  params->audio.cutoff      = SUSCAN_MULTIAUDIO_INSPECTOR_SAMPLE_RATE / 2;
+  params->audio.volume      = 1;
+
+  params->multiaudio.channels = SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_CHANNELS;
+  params->multiaudio.spacing  = SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_SPACING;
+  params->multiaudio.squelch  = SUSCAN_MULTIAUDIO_INSPECTOR_DEFAULT_SQUELCH;
+}
+
+SUPRIVATE void
+suscan_multiaudio_inspector_destroy(struct suscan_multiaudio_inspector *insp)
+{
+  if (insp->channelizer != NULL)
+    suscan_channelizer_destroy(insp->channelizer);
+
+  free(insp);
+}
+
+/* Recreates the channelizer according to cur_params */
+SUPRIVATE SUBOOL
+suscan_multiaudio_inspector_init_channelizer(
+    struct suscan_multiaudio_inspector *insp)
+{
+  suscan_channelizer_t *channelizer = NULL;
+  SUFLOAT fs = insp->samp_info.equiv_fs;
+  unsigned int bins, channels, i;
+
+  SU_TRYCATCH(insp->cur_params.multiaudio.spacing > 0, return SU_FALSE);
+
+  /* Round to the nearest even number of bins */
+  bins = 2 * (unsigned int) SU_FLOOR(
+      .5 * fs / insp->cur_params.multiaudio.spacing + .5);
+  if (bins < 2)
+    bins = 2;
+
+  SU_TRYCATCH(channelizer = suscan_channelizer_new(bins), return SU_FALSE);
+
+  channels = insp->cur_params.multiaudio.channels;
+  if (channels > bins)
+    channels = bins;
+  if (channels > SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS)
+    channels = SUSCAN_MULTIAUDIO_INSPECTOR_MAX_CHANNELS;
+
+  if (channels != insp->cur_params.multiaudio.channels)
+    SU_WARNING(
+        "Cannot demodulate %d channels, limiting to %d\n",
+        insp->cur_params.multiaudio.channels,
+        channels);
+
+  if (insp->channelizer != NULL)
+    suscan_channelizer_destroy(insp->channelizer);
+
+  insp->channelizer = channelizer;
+  insp->channels = channels;
+  insp->chan_fs = 2 * fs / bins;
+
+  /* Channels around the center of the inspected band */
+  for (i = 0; i < channels; ++i)
+    insp->bin[i] = (i + bins - channels / 2) % bins;
+
+  memset(insp->last,    0, sizeof(insp->last));
+  memset(insp->power,   0, sizeof(insp->power));
+  memset(insp->carrier, 0, sizeof(insp->carrier));
+  memset(insp->audio,   0, sizeof(insp->audio));
+  memset(insp->hang,    0, sizeof(insp->hang));
+
+  return SU_TRUE;
+}
+
+/* Derive per-sample coefficients from cur_params and the channel rate */
+SUPRIVATE void
+suscan_multiaudio_inspector_update_coefs(
+    struct suscan_multiaudio_inspector *insp)
+{
+  SUFLOAT cutoff = insp->cur_params.audio.cutoff;
+
+  insp->out_step = insp->cur_params.audio.sample_rate / insp->chan_fs;
+  if (insp->out_step > 1)
+    insp->out_step = 1;
+
+  if (cutoff <= 0 || cutoff > .5 * insp->chan_fs)
+    cutoff = .5 * insp->chan_fs;
+
+  insp->lpf_alpha = 1 - SU_EXP(-2 * PI * cutoff / insp->chan_fs);
+  insp->pwr_alpha = 1 - SU_EXP(
+      -1. / (SUSCAN_MULTIAUDIO_INSPECTOR_POWER_SECONDS * insp->chan_fs));
+  insp->am_beta = 1 - SU_EXP(
+      -1. / (SUSCAN_MULTIAUDIO_AM_CARRIER_SECONDS * insp->chan_fs));
+  insp->hang_max =
+      SUSCAN_MULTIAUDIO_INSPECTOR_HANG_SECONDS * insp->chan_fs;
+  insp->squelch = SU_POWER_MAG(insp->cur_params.multiaudio.squelch);
+
+  if (insp->cur_params.audio.demod != SUSCAN_INSPECTOR_AUDIO_DEMOD_FM
+      && insp->cur_params.audio.demod != SUSCAN_INSPECTOR_AUDIO_DEMOD_AM
+      && insp->cur_params.audio.demod != SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED)
+    SU_WARNING("Only AM and FM are supported in multichannel mode\n");
+}
+
+SUPRIVATE struct suscan_multiaudio_inspector *
+suscan_multiaudio_inspector_new(
+    const struct suscan_inspector_sampling_info *sinfo)
+{
+  struct suscan_multiaudio_inspector *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_multiaudio_inspector)),
+      goto fail);
+
+  new->samp_info = *sinfo;
+
+  suscan_multiaudio_inspector_params_initialize(&new->cur_params);
+  new->req_params = new->cur_params;
+
+  SU_TRYCATCH(suscan_multiaudio_inspector_init_channelizer(new), goto fail);
+  suscan_multiaudio_inspector_update_coefs(new);
+
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_multiaudio_inspector_stage_names,
+      SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_COUNT);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_multiaudio_inspector_destroy(new);
+
+  return NULL;
+}
+
+/************************** API implementation *******************************/
+void *
+suscan_multiaudio_inspector_open(const struct suscan_inspector_sampling_info *s)
+{
+  return suscan_multiaudio_inspector_new(s);
+}
+
+SUBOOL
+suscan_multiaudio_inspector_get_config(void *private, suscan_config_t *config)
+{
+  struct suscan_multiaudio_inspector *insp =
+      (struct suscan_multiaudio_inspector *) private;
+
+  SU_TRYCATCH(
+      suscan_inspector_audio_params_save(&insp->cur_params.audio, config),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_multiaudio_params_save(
+          &insp->cur_params.multiaudio,
+          config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_multiaudio_inspector_parse_params(
+    struct suscan_multiaudio_inspector_params *params,
+    const suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_inspector_audio_params_parse(&params->audio, config),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_multiaudio_params_parse(
+          &params->multiaudio,
+          config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_multiaudio_inspector_parse_config(
+    void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_multiaudio_inspector *insp =
+      (struct suscan_multiaudio_inspector *) private;
+
+  return suscan_multiaudio_inspector_parse_params(&insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_multiaudio_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_multiaudio_inspector_params params;
+
+  return suscan_multiaudio_inspector_parse_params(&params, config);
+}
+
+/* Called from the worker thread */
+void
+suscan_multiaudio_inspector_commit_config(void *private)
+{
+  struct suscan_multiaudio_inspector *insp =
+      (struct suscan_multiaudio_inspector *) private;
+  struct suscan_multiaudio_inspector_params old = insp->cur_params;
+
+  insp->cur_params = insp->req_params;
+
+  if (old.multiaudio.channels != insp->cur_params.multiaudio.channels
+      || old.multiaudio.spacing != insp->cur_params.multiaudio.spacing) {
+    if (!suscan_multiaudio_inspector_init_channelizer(insp)) {
+      SU_ERROR("Failed to update channelizer, keeping previous layout\n");
+      insp->cur_params.multiaudio = old.multiaudio;
+    }
+  }
+
+  suscan_multiaudio_inspector_update_coefs(insp);
+}
+
+/*
+ * Update channel powers and build the list of channels above the
+ * squelch level (or still within their hang time).
+ */
+SUPRIVATE void
+suscan_multiaudio_inspector_squelch(struct suscan_multiaudio_inspector *self)
+{
+  const SUCOMPLEX *bins = suscan_channelizer_get_output(self->channelizer);
+  unsigned int i;
+
+  for (i = 0; i < self->channels; ++i)
+    self->x[i] = bins[self->bin[i]];
+
+  for (i = 0; i < self->channels; ++i)
+    self->power[i] += self->pwr_alpha
+        * (SU_C_REAL(self->x[i] * SU_C_CONJ(self->x[i])) - self->power[i]);
+
+  self->active_count = 0;
+
+  for (i = 0; i < self->channels; ++i) {
+    if (self->power[i] > self->squelch)
+      self->hang[i] = self->hang_max;
+    else if (self->hang[i] > 0)
+      --self->hang[i];
+
+    if (self->hang[i] > 0)
+      self->active[self->active_count++] = i;
+    else
+      self->audio[i] = 0;
+  }
+}
+
+SUPRIVATE void
+suscan_multiaudio_inspector_demod(struct suscan_multiaudio_inspector *self)
+{
+  unsigned int i, c;
+  SUFLOAT env;
+  SUFLOAT volume = self->cur_params.audio.volume;
+
+  switch (self->cur_params.audio.demod) {
+    case SUSCAN_INSPECTOR_AUDIO_DEMOD_FM:
+      for (i = 0; i < self->active_count; ++i) {
+        c = self->active[i];
+        self->active_x[i]    = self->x[c];
+        self->active_last[i] = self->last[c];
+      }
+
+      suscan_inspector_block_fm_demod(
+          self->active_x,
+          self->active_last,
+          self->active_out,
+          self->active_count);
+
+      /* Keep the phase reference of idle channels up to date too */
+      memcpy(self->last, self->x, self->channels * sizeof(SUCOMPLEX));
+      break;
+
+    case SUSCAN_INSPECTOR_AUDIO_DEMOD_AM:
+      /* Envelope detection, normalized by the carrier level */
+      for (i = 0; i < self->active_count; ++i) {
+        c = self->active[i];
+        env = SU_C_ABS(self->x[c]);
+        self->carrier[c] += self->am_beta * (env - self->carrier[c]);
+        self->active_out[i] =
+            (env - self->carrier[c]) / (self->carrier[c] + 1e-12);
+      }
+      break;
+
+    default:
+      for (i = 0; i < self->active_count; ++i)
+        self->active_out[i] = 0;
+  }
+
+  /* Audio low pass filter */
+  for (i = 0; i < self->active_count; ++i) {
+    c = self->active[i];
+    self->audio[c] +=
+        self->lpf_alpha * (volume * self->active_out[i] - self->audio[c]);
+  }
+}
+
+SUSDIFF
+suscan_multiaudio_inspector_feed(
+    void *private,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  SUSCOUNT consumed = 0;
+  SUSCOUNT got;
+  SUBOOL ready;
+  unsigned int i;
+  struct timespec t;
+  struct suscan_multiaudio_inspector *self =
+      (struct suscan_multiaudio_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = self->stats;
+
+  if (self->cur_params.audio.demod == SUSCAN_INSPECTOR_AUDIO_DEMOD_DISABLED)
+    return count;
+
+  while (consumed < count) {
+    /* Make sure a whole output frame fits */
+    if (suscan_inspector_sampler_buf_avail(insp) < self->channels)
+      break;
+
+    suscan_inspector_stage_enter(&t);
+    got = suscan_channelizer_feed(
+        self->channelizer,
+        x + consumed,
+        count - consumed,
+        &ready);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_CHANNELIZER,
+        &t,
+        got);
+
+    consumed += got;
+
+    if (!ready)
+      continue;
+
+    suscan_inspector_stage_enter(&t);
+    suscan_multiaudio_inspector_squelch(self);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_SQUELCH,
+        &t,
+        self->channels);
+
+    if (self->active_count > 0) {
+      suscan_inspector_stage_enter(&t);
+      suscan_multiaudio_inspector_demod(self);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_DEMOD,
+          &t,
+          self->active_count);
+    }
+
+    self->out_phase += self->out_step;
+    if (self->out_phase >= 1) {
+      self->out_phase -= 1;
+
+      suscan_inspector_stage_enter(&t);
+      for (i = 0; i < self->channels; ++i)
+        suscan_inspector_push_sample(insp, self->audio[i] * .75);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_OUTPUT,
+          &t,
+          self->channels);
+    }
+  }
+
+  return consumed;
+}
+
+void
+suscan_multiaudio_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_multiaudio_inspector *insp =
+      (struct suscan_multiaudio_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_MULTIAUDIO_INSPECTOR_STAGE_COUNT;
+}
+
+void
+suscan_multiaudio_inspector_close(void *private)
+{
+  suscan_multiaudio_inspector_destroy(
+      (struct suscan_multiaudio_inspector *) private);
+}
+
+SUPRIVATE struct suscan_inspector_interface iface = {
+    .name = "multiaudio",
+    .desc = "Multichannel audio inspector",
+    .open = suscan_multiaudio_inspector_open,
+    .get_config = suscan_multiaudio_inspector_get_config,
+    .parse_config = suscan_multiaudio_inspector_parse_config,
+    .check_config = suscan_multiaudio_inspector_check_config,
+    .commit_config = suscan_multiaudio_inspector_commit_config,
+    .feed = suscan_multiaudio_inspector_feed,
+    .get_stage_stats = suscan_multiaudio_inspector_get_stage_stats,
+    .close = suscan_multiaudio_inspector_close
+};
+
+SUBOOL
+suscan_multiaudio_inspector_register(void)
+{
+  SU_TRYCATCH(
+      iface.cfgdesc = suscan_config_desc_new(),
+      return SU_FALSE);
+
+  /* Add all configuration parameters */
+  SU_TRYCATCH(
+      suscan_config_desc_add_audio_params(iface.cfgdesc),
+      return SU_FALSE);
+  SU_TRYCATCH(
+      suscan_config_desc_add_multiaudio_params(iface.cfgdesc),
+      return SU_FALSE);
+
+  /* Add applicable spectrum sources */
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_spectsrc(&iface, "psd"),
+      return SU_FALSE);
+
+  /* Register inspector interface */
+  SU_TRYCATCH(suscan_inspector_interface_register(&iface), return SU_FALSE);
+
+  return SU_TRUE;
+}
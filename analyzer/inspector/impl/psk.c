@@ -30,6 +30,9 @@
 
 #include "inspector/interface.h"
 #include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/mfsampler.h"
+#include "inspector/demapper.h"
 
 #include "inspector/inspector.h"
 
@@ -38,6 +41,7 @@
 #define SUSCAN_PSK_INSPECTOR_DEFAULT_EQ_MU     1e-3
 #define SUSCAN_PSK_INSPECTOR_DEFAULT_EQ_LENGTH 20
 #define SUSCAN_PSK_INSPECTOR_MAX_MF_SPAN       1024
+#define SUSCAN_PSK_INSPECTOR_DEFAULT_SOFT_SCALE 8
 
 /*
  * Spike durations measured in symbol times
@@ -58,6 +62,21 @@ struct suscan_psk_inspector_params {
   struct suscan_inspector_mf_params mf;
   struct suscan_inspector_eq_params eq;
   struct suscan_inspector_br_params br;
+  struct suscan_inspector_soft_params soft;
+};
+
+enum suscan_psk_inspector_stage {
+  SUSCAN_PSK_INSPECTOR_STAGE_MIXER,
+  SUSCAN_PSK_INSPECTOR_STAGE_GAIN,
+  SUSCAN_PSK_INSPECTOR_STAGE_CARRIER,
+  SUSCAN_PSK_INSPECTOR_STAGE_MF,
+  SUSCAN_PSK_INSPECTOR_STAGE_TIMING,
+  SUSCAN_PSK_INSPECTOR_STAGE_EQ,
+  SUSCAN_PSK_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_psk_inspector_stage_names[] = {
+    "mixer", "gain", "carrier", "mf", "timing", "eq"
 };
 
 struct suscan_psk_inspector {
@@ -71,10 +90,17 @@ struct suscan_psk_inspector {
   su_iir_filt_t       mf;         /* Matched filter (Root Raised Cosine) */
   su_clock_detector_t cd;         /* Clock detector */
   su_sampler_t        sampler;    /* Sampler */
+  suscan_mf_sampler_t mfs;        /* Polyphase matched filter + sampler */
   su_equalizer_t      eq;         /* Equalizer */
-  su_ncqo_t           lo;         /* Oscillator for manual carrier offset */
+  suscan_soft_demapper_t demapper; /* Soft symbol output */
+  SUBOOL              soft;       /* Soft symbols enabled */
+  struct suscan_inspector_rotator lo; /* Manual carrier offset */
 
   SUCOMPLEX           phase;      /* Local oscillator phase */
+
+  /* Block processing */
+  SUCOMPLEX block[SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE];
+  struct suscan_inspector_stage_stats stats[SUSCAN_PSK_INSPECTOR_STAGE_COUNT];
 };
 
 SUSCOUNT
@@ -111,6 +137,9 @@ suscan_psk_inspector_params_initialize(
 
   params->eq.eq_conf    = SUSCAN_INSPECTOR_EQUALIZER_BYPASS;
   params->eq.eq_mu      = SUSCAN_PSK_INSPECTOR_DEFAULT_EQ_MU;
+
+  params->soft.soft_bits  = 1;
+  params->soft.soft_scale = SUSCAN_PSK_INSPECTOR_DEFAULT_SOFT_SCALE;
 }
 
 SUPRIVATE void
@@ -128,6 +157,8 @@ suscan_psk_inspector_destroy(struct suscan_psk_inspector *insp)
 
   su_sampler_finalize(&insp->sampler);
 
+  suscan_mf_sampler_finalize(&insp->mfs);
+
   free(insp);
 }
 
@@ -159,9 +190,14 @@ suscan_psk_inspector_new(const struct suscan_inspector_sampling_info *sinfo)
       goto fail);
 
   /* Initialize local oscillator */
-  su_ncqo_init(&new->lo, 0);
+  suscan_inspector_rotator_init(&new->lo);
   new->phase = 1.;
 
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_psk_inspector_stage_names,
+      SUSCAN_PSK_INSPECTOR_STAGE_COUNT);
+
   /* Initialize AGC */
   tau = 1. / bw; /* Samples per symbol */
 
@@ -248,41 +284,70 @@ suscan_psk_inspector_get_config(void *private, suscan_config_t *config)
       suscan_inspector_br_params_save(&insp->cur_params.br, config),
       return SU_FALSE);
 
+  SU_TRYCATCH(
+      suscan_inspector_soft_params_save(&insp->cur_params.soft, config),
+      return SU_FALSE);
+
   return SU_TRUE;
 }
 
-SUBOOL
-suscan_psk_inspector_parse_config(void *private, const suscan_config_t *config)
+SUPRIVATE SUBOOL
+suscan_psk_inspector_parse_params(
+    const struct suscan_psk_inspector *insp,
+    struct suscan_psk_inspector_params *params,
+    const suscan_config_t *config)
 {
-  struct suscan_psk_inspector *insp = (struct suscan_psk_inspector *) private;
+  suscan_psk_inspector_params_initialize(params, &insp->samp_info);
 
-  suscan_psk_inspector_params_initialize(&insp->req_params, &insp->samp_info);
+  SU_TRYCATCH(
+      suscan_inspector_gc_params_parse(&params->gc, config),
+      return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_gc_params_parse(&insp->req_params.gc, config),
+      suscan_inspector_fc_params_parse(&params->fc, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_fc_params_parse(&insp->req_params.fc, config),
+      suscan_inspector_mf_params_parse(&params->mf, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_mf_params_parse(&insp->req_params.mf, config),
+      suscan_inspector_eq_params_parse(&params->eq, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_eq_params_parse(&insp->req_params.eq, config),
+      suscan_inspector_br_params_parse(&params->br, config),
       return SU_FALSE);
 
   SU_TRYCATCH(
-      suscan_inspector_br_params_parse(&insp->req_params.br, config),
+      suscan_inspector_soft_params_parse(&params->soft, config),
       return SU_FALSE);
 
   return SU_TRUE;
+}
 
+SUBOOL
+suscan_psk_inspector_parse_config(void *private, const suscan_config_t *config)
+{
+  struct suscan_psk_inspector *insp = (struct suscan_psk_inspector *) private;
+
+  return suscan_psk_inspector_parse_params(insp, &insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_psk_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  const struct suscan_psk_inspector *insp =
+      (const struct suscan_psk_inspector *) private;
+  struct suscan_psk_inspector_params params;
+
+  return suscan_psk_inspector_parse_params(insp, &params, config);
 }
 
-/* This method is called inside the inspector mutex */
+/* This method is called from the worker thread */
 void
 suscan_psk_inspector_commit_config(void *private)
 {
@@ -293,8 +358,10 @@ suscan_psk_inspector_commit_config(void *private)
   SUFLOAT sym_period;
   su_costas_t costas;
   enum sigutils_costas_kind kind;
+  unsigned int bits;
 
   su_iir_filt_t mf = su_iir_filt_INITIALIZER;
+  suscan_mf_sampler_t mfs = suscan_mf_sampler_INITIALIZER;
   struct suscan_psk_inspector *insp = (struct suscan_psk_inspector *) private;
 
   actual_baud = insp->req_params.br.br_running
@@ -313,7 +380,7 @@ suscan_psk_inspector_commit_config(void *private)
   fs = insp->samp_info.equiv_fs;
 
   /* Update local oscillator frequency and phase */
-  su_ncqo_set_freq(
+  suscan_inspector_rotator_set_freq(
       &insp->lo,
       SU_ABS2NORM_FREQ(fs, insp->cur_params.fc.fc_off));
   insp->phase = SU_C_EXP(I * insp->cur_params.fc.fc_phi);
@@ -347,6 +414,27 @@ suscan_psk_inspector_commit_config(void *private)
     }
   }
 
+  /* Update polyphase matched filter, used with manual baudrate control */
+  if (sym_period < 1) {
+    suscan_mf_sampler_finalize(&insp->mfs);
+  } else if (mf_changed || !suscan_mf_sampler_is_ready(&insp->mfs)) {
+    if (!suscan_mf_sampler_init(
+        &mfs,
+        sym_period,
+        insp->cur_params.mf.mf_rolloff,
+        suscan_psk_inspector_mf_span(6 * sym_period))) {
+      SU_ERROR("No memory left to update polyphase matched filter!\n");
+    } else {
+      suscan_mf_sampler_finalize(&insp->mfs);
+      insp->mfs = mfs;
+    }
+  }
+
+  if (suscan_mf_sampler_is_ready(&insp->mfs))
+    suscan_mf_sampler_set_phase_addend(
+        &insp->mfs,
+        insp->cur_params.br.sym_phase);
+
   /* Costas bandwidth changed */
   if (costas_changed) {
     SU_TRYCATCH(
@@ -382,6 +470,34 @@ suscan_psk_inspector_commit_config(void *private)
       su_costas_set_kind(&insp->costas, SU_COSTAS_KIND_8PSK);
       break;
   }
+
+  /* The constellation order is implied by the Costas loop, if any */
+  switch (insp->cur_params.fc.fc_ctrl) {
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_2:
+      bits = 1;
+      break;
+
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_4:
+      bits = 2;
+      break;
+
+    case SUSCAN_INSPECTOR_CARRIER_CONTROL_COSTAS_8:
+      bits = 3;
+      break;
+
+    default:
+      bits = insp->cur_params.soft.soft_bits;
+  }
+
+  insp->soft = insp->cur_params.soft.soft_enabled;
+  if (insp->soft && !suscan_soft_demapper_init(
+      &insp->demapper,
+      SUSCAN_SOFT_DEMAPPER_PSK,
+      bits,
+      insp->cur_params.soft.soft_scale)) {
+    SU_ERROR("Invalid soft symbol configuration, sending samples\n");
+    insp->soft = SU_FALSE;
+  }
 }
 
 SUSDIFF
@@ -391,65 +507,174 @@ suscan_psk_inspector_feed(
     const SUCOMPLEX *x,
     SUSCOUNT count)
 {
-  SUSCOUNT i;
-  SUSCOUNT osize = 0;
-  SUFLOAT alpha;
-  SUCOMPLEX det_x;
+  SUSCOUNT i, n, len;
+  SUSCOUNT consumed = 0;
+  SUBOOL use_mfs;
   SUCOMPLEX output;
-  SUBOOL new_sample = SU_FALSE;
+  int8_t llr[SUSCAN_SOFT_DEMAPPER_MAX_BITS];
+  SUCOMPLEX *y;
+  struct timespec t;
   struct suscan_psk_inspector *psk_insp =
       (struct suscan_psk_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = psk_insp->stats;
 
-  for (i = 0; i < count && suscan_inspector_sampler_buf_avail(insp) > 0; ++i) {
-    /* Re-center carrier */
-    det_x = x[i] * SU_C_CONJ(su_ncqo_read(&psk_insp->lo)) * psk_insp->phase;
+  y = psk_insp->block;
 
-    /* Perform gain control */
+  /* With manual timing, the matched filter is merged into the sampler */
+  use_mfs = psk_insp->cur_params.mf.mf_conf
+      == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL
+      && psk_insp->cur_params.br.br_ctrl
+      == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL
+      && suscan_mf_sampler_is_ready(&psk_insp->mfs);
+
+  while (consumed < count) {
+    /* At most one symbol per sample: bound block by free output space */
+    len = MIN(count - consumed, SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE);
+    len = MIN(len, suscan_inspector_sampler_buf_avail(insp));
+
+    if (len == 0)
+      break;
+
+    /* Re-center carrier */
+    suscan_inspector_stage_enter(&t);
+    suscan_inspector_rotator_apply(&psk_insp->lo, x + consumed, y, len);
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_PSK_INSPECTOR_STAGE_MIXER,
+        &t,
+        len);
+
+    /*
+     * Perform gain control. The AGC only looks at the magnitude, so the
+     * manual carrier phase can be applied after it.
+     */
+    suscan_inspector_stage_enter(&t);
     switch (psk_insp->cur_params.gc.gc_ctrl) {
       case SUSCAN_INSPECTOR_GAIN_CONTROL_MANUAL:
-        det_x *= 2 * psk_insp->cur_params.gc.gc_gain;
+        suscan_inspector_block_scale(
+            y,
+            2 * psk_insp->cur_params.gc.gc_gain * psk_insp->phase,
+            len);
         break;
 
       case SUSCAN_INSPECTOR_GAIN_CONTROL_AUTOMATIC:
-        det_x  = 2 * su_agc_feed(&psk_insp->agc, det_x);
+        for (i = 0; i < len; ++i)
+          y[i] = su_agc_feed(&psk_insp->agc, y[i]);
+        suscan_inspector_block_scale(y, 2 * psk_insp->phase, len);
         break;
     }
+    suscan_inspector_stage_leave(
+        stats + SUSCAN_PSK_INSPECTOR_STAGE_GAIN,
+        &t,
+        len);
 
     /* Perform frequency correction */
     if (psk_insp->cur_params.fc.fc_ctrl
         != SUSCAN_INSPECTOR_CARRIER_CONTROL_MANUAL) {
-      su_costas_feed(&psk_insp->costas, det_x);
-      det_x = psk_insp->costas.y;
+      suscan_inspector_stage_enter(&t);
+      for (i = 0; i < len; ++i) {
+        su_costas_feed(&psk_insp->costas, y[i]);
+        y[i] = psk_insp->costas.y;
+      }
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_PSK_INSPECTOR_STAGE_CARRIER,
+          &t,
+          len);
     }
 
-    /* Add matched filter, if enabled */
-    if (psk_insp->cur_params.mf.mf_conf == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL)
-      det_x = su_iir_filt_feed(&psk_insp->mf, det_x);
-
-    /* Check if channel sampler is enabled */
-    if (psk_insp->cur_params.br.br_ctrl == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
-      output = det_x;
-      new_sample = su_sampler_feed(&psk_insp->sampler, &output);
+    if (use_mfs) {
+      /* Matched filter is only evaluated at symbol instants */
+      suscan_inspector_stage_enter(&t);
+      n = suscan_mf_sampler_feed(&psk_insp->mfs, y, len, y);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_PSK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     } else {
-      /* Automatic baudrate control enabled */
-      su_clock_detector_feed(&psk_insp->cd, det_x);
-      new_sample = su_clock_detector_read(&psk_insp->cd, &output, 1) == 1;
+      /* Add matched filter, if enabled */
+      if (psk_insp->cur_params.mf.mf_conf
+          == SUSCAN_INSPECTOR_MATCHED_FILTER_MANUAL) {
+        suscan_inspector_stage_enter(&t);
+        suscan_inspector_block_iir_filt(&psk_insp->mf, y, len);
+        suscan_inspector_stage_leave(
+            stats + SUSCAN_PSK_INSPECTOR_STAGE_MF,
+            &t,
+            len);
+      }
+
+      /* Symbol timing. Symbols are compacted at the beginning of the block */
+      suscan_inspector_stage_enter(&t);
+      n = 0;
+      if (psk_insp->cur_params.br.br_ctrl
+          == SUSCAN_INSPECTOR_BAUDRATE_CONTROL_MANUAL) {
+        for (i = 0; i < len; ++i) {
+          output = y[i];
+          if (su_sampler_feed(&psk_insp->sampler, &output))
+            y[n++] = output;
+        }
+      } else {
+        /* Automatic baudrate control enabled */
+        for (i = 0; i < len; ++i) {
+          su_clock_detector_feed(&psk_insp->cd, y[i]);
+          if (su_clock_detector_read(&psk_insp->cd, &output, 1) == 1)
+            y[n++] = output;
+        }
+      }
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_PSK_INSPECTOR_STAGE_TIMING,
+          &t,
+          len);
     }
 
     /* Apply channel equalizer, if enabled */
-    if (new_sample) {
-      if (psk_insp->cur_params.eq.eq_conf == SUSCAN_INSPECTOR_EQUALIZER_CMA) {
-        suscan_inspector_lock(insp);
-        output = su_equalizer_feed(&psk_insp->eq, output);
-        suscan_inspector_unlock(insp);
-      }
+    if (n > 0
+        && psk_insp->cur_params.eq.eq_conf == SUSCAN_INSPECTOR_EQUALIZER_CMA) {
+      suscan_inspector_stage_enter(&t);
+      for (i = 0; i < n; ++i)
+        y[i] = su_equalizer_feed(&psk_insp->eq, y[i]);
+      suscan_inspector_stage_leave(
+          stats + SUSCAN_PSK_INSPECTOR_STAGE_EQ,
+          &t,
+          n);
+    }
 
+    if (psk_insp->soft) {
+      for (i = 0; i < n; ++i) {
+        suscan_soft_demapper_feed(&psk_insp->demapper, y[i], llr);
+        suscan_inspector_push_soft(
+            insp,
+            llr,
+            suscan_soft_demapper_get_bits(&psk_insp->demapper));
+      }
+    } else {
       /* Reduce amplitude so it fits in the constellation window */
-      suscan_inspector_push_sample(insp, output * .75);
+      for (i = 0; i < n; ++i)
+        suscan_inspector_push_sample(insp, y[i] * .75);
     }
+
+    consumed += len;
   }
 
-  return i;
+  return consumed;
+}
+
+void
+suscan_psk_inspector_reset_equalizer(void *private)
+{
+  struct suscan_psk_inspector *insp = (struct suscan_psk_inspector *) private;
+
+  su_equalizer_reset(&insp->eq);
+}
+
+void
+suscan_psk_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_psk_inspector *insp = (struct suscan_psk_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_PSK_INSPECTOR_STAGE_COUNT;
 }
 
 void
@@ -464,8 +689,11 @@ SUPRIVATE struct suscan_inspector_interface iface = {
     .open = suscan_psk_inspector_open,
     .get_config = suscan_psk_inspector_get_config,
     .parse_config = suscan_psk_inspector_parse_config,
+    .check_config = suscan_psk_inspector_check_config,
     .commit_config = suscan_psk_inspector_commit_config,
+    .reset_equalizer = suscan_psk_inspector_reset_equalizer,
     .feed = suscan_psk_inspector_feed,
+    .get_stage_stats = suscan_psk_inspector_get_stage_stats,
     .close = suscan_psk_inspector_close
 };
 
@@ -482,6 +710,9 @@ suscan_psk_inspector_register(void)
   SU_TRYCATCH(suscan_config_desc_add_mf_params(iface.cfgdesc), return SU_FALSE);
   SU_TRYCATCH(suscan_config_desc_add_eq_params(iface.cfgdesc), return SU_FALSE);
   SU_TRYCATCH(suscan_config_desc_add_br_params(iface.cfgdesc), return SU_FALSE);
+  SU_TRYCATCH(
+      suscan_config_desc_add_soft_params(iface.cfgdesc),
+      return SU_FALSE);
 
   /* Add some estimators */
   SU_TRYCATCH(
@@ -492,6 +723,14 @@ suscan_psk_inspector_register(void)
       suscan_inspector_interface_add_estimator(&iface, "baud-nonlinear"),
       return SU_FALSE);
 
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "carrier-sdft"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_estimator(&iface, "snr-m2m4"),
+      return SU_FALSE);
+
   /* Add applicable spectrum sources */
   SU_TRYCATCH(
       suscan_inspector_interface_add_spectsrc(&iface, "psd"),
@@ -0,0 +1,512 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+/*
+ * Sync word inspector. The channel is correlated against a set of known
+ * PSK symbol sequences (syncword.templates, comma-separated, one digit per
+ * symbol, with symbol k mapped to exp(2 pi j k / 2^bits_per_symbol) and
+ * held during one symbol period) using an overlap-save FFT correlator.
+ * Frequency offsets up to syncword.freq_span Hz in each direction are
+ * searched in steps of the correlator bin width.
+ *
+ * For every template, correlation peaks above syncword.threshold are kept
+ * as candidates until no higher peak is found within one template length,
+ * and then reported as detections. The channel samples themselves are not
+ * delivered.
+ */
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "syncword-inspector"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/interface.h"
+#include "inspector/params.h"
+#include "inspector/pipeline.h"
+#include "inspector/inspector.h"
+#include "inspector/fastcorr.h"
+
+#define SUSCAN_SYNCWORD_INSPECTOR_DEFAULT_THRESHOLD .7
+#define SUSCAN_SYNCWORD_INSPECTOR_MAX_TEMPLATES     16
+#define SUSCAN_SYNCWORD_INSPECTOR_MAX_LENGTH        (1 << 16)
+#define SUSCAN_SYNCWORD_INSPECTOR_QUEUE_SIZE        64
+
+struct suscan_syncword_inspector_params {
+  struct suscan_inspector_syncword_params syncword;
+};
+
+enum suscan_syncword_inspector_stage {
+  SUSCAN_SYNCWORD_INSPECTOR_STAGE_CORRELATOR,
+  SUSCAN_SYNCWORD_INSPECTOR_STAGE_PEAKS,
+  SUSCAN_SYNCWORD_INSPECTOR_STAGE_COUNT
+};
+
+SUPRIVATE const char *suscan_syncword_inspector_stage_names[] = {
+    "correlator", "peaks"
+};
+
+/* Best peak found so far for a given template */
+struct suscan_syncword_candidate {
+  SUBOOL   active;
+  SUSCOUNT position;
+  SUFLOAT  peak;
+  int      shift;
+};
+
+struct suscan_syncword_inspector {
+  struct suscan_inspector_sampling_info samp_info;
+  struct suscan_syncword_inspector_params req_params;
+  struct suscan_syncword_inspector_params cur_params;
+
+  suscan_fastcorr_t *corr;
+  SUSCOUNT fed;              /* Samples consumed by the correlator */
+
+  struct suscan_syncword_candidate
+    candidate[SUSCAN_SYNCWORD_INSPECTOR_MAX_TEMPLATES];
+
+  /* Detections waiting to be retrieved */
+  struct suscan_inspector_detection
+    queue[SUSCAN_SYNCWORD_INSPECTOR_QUEUE_SIZE];
+  unsigned int q_head;
+  unsigned int q_count;
+  SUSCOUNT     dropped;
+
+  struct suscan_inspector_stage_stats
+    stats[SUSCAN_SYNCWORD_INSPECTOR_STAGE_COUNT];
+};
+
+SUPRIVATE void
+suscan_syncword_inspector_params_initialize(
+    struct suscan_syncword_inspector_params *params)
+{
+  memset(params, 0, sizeof(struct suscan_syncword_inspector_params));
+
+  params->syncword.bits_per_symbol = 1;
+  params->syncword.threshold = SUSCAN_SYNCWORD_INSPECTOR_DEFAULT_THRESHOLD;
+}
+
+SUPRIVATE void
+suscan_syncword_inspector_destroy(struct suscan_syncword_inspector *insp)
+{
+  if (insp->corr != NULL)
+    suscan_fastcorr_destroy(insp->corr);
+
+  free(insp);
+}
+
+SUPRIVATE struct suscan_syncword_inspector *
+suscan_syncword_inspector_new(
+    const struct suscan_inspector_sampling_info *sinfo)
+{
+  struct suscan_syncword_inspector *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_syncword_inspector)),
+      goto fail);
+
+  new->samp_info = *sinfo;
+
+  suscan_syncword_inspector_params_initialize(&new->cur_params);
+  new->req_params = new->cur_params;
+
+  suscan_inspector_stage_stats_init(
+      new->stats,
+      suscan_syncword_inspector_stage_names,
+      SUSCAN_SYNCWORD_INSPECTOR_STAGE_COUNT);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_syncword_inspector_destroy(new);
+
+  return NULL;
+}
+
+/*
+ * Builds the sampled templates and the correlator for the current
+ * configuration. Returns NULL if no valid template was given.
+ */
+SUPRIVATE suscan_fastcorr_t *
+suscan_syncword_inspector_make_corr(struct suscan_syncword_inspector *insp)
+{
+  const struct suscan_inspector_syncword_params *params =
+      &insp->cur_params.syncword;
+  SUCOMPLEX *templates[SUSCAN_SYNCWORD_INSPECTOR_MAX_TEMPLATES];
+  SUSCOUNT lengths[SUSCAN_SYNCWORD_INSPECTOR_MAX_TEMPLATES];
+  SUCOMPLEX symbols[SUSCAN_INSPECTOR_SYNCWORD_MAX_TEMPLATE_CHARS];
+  SUCOMPLEX *curr;
+  suscan_fastcorr_t *corr = NULL;
+  const char *p = params->templates;
+  unsigned int count = 0, order, nsym, i, max_shift;
+  SUSCOUNT j, len, max_len = 0;
+  SUFLOAT sps, bin;
+
+  memset(templates, 0, sizeof(templates));
+
+  SU_TRYCATCH(
+      params->bits_per_symbol >= 1 && params->bits_per_symbol <= 3,
+      goto done);
+  SU_TRYCATCH(params->baud > 0, goto done);
+
+  order = 1 << params->bits_per_symbol;
+  sps = insp->samp_info.equiv_fs / params->baud;
+
+  while (*p != '\0') {
+    nsym = 0;
+
+    for (; *p != '\0' && *p != ','; ++p)
+      if (*p >= '0' && *p < '0' + order)
+        symbols[nsym++] = SU_C_EXP(I * 2 * PI * (*p - '0') / order);
+
+    if (*p == ',')
+      ++p;
+
+    if (nsym == 0)
+      continue;
+
+    SU_TRYCATCH(
+        count < SUSCAN_SYNCWORD_INSPECTOR_MAX_TEMPLATES,
+        goto done);
+
+    len = SU_FLOOR(nsym * sps);
+    SU_TRYCATCH(len > 0, goto done);
+    SU_TRYCATCH(len <= SUSCAN_SYNCWORD_INSPECTOR_MAX_LENGTH, goto done);
+
+    SU_TRYCATCH(curr = malloc(len * sizeof(SUCOMPLEX)), goto done);
+    templates[count] = curr;
+    lengths[count++] = len;
+
+    for (j = 0; j < len; ++j)
+      curr[j] = symbols[MIN((SUSCOUNT) (j / sps), nsym - 1)];
+
+    if (len > max_len)
+      max_len = len;
+  }
+
+  SU_TRYCATCH(count > 0, goto done);
+
+  /* Frequency search range, in correlator bins */
+  bin = insp->samp_info.equiv_fs / suscan_fastcorr_size_for_length(max_len);
+  max_shift = SU_FLOOR(SU_ABS(params->freq_span) / bin);
+  if (2 * max_shift >= suscan_fastcorr_size_for_length(max_len))
+    max_shift = suscan_fastcorr_size_for_length(max_len) / 2 - 1;
+
+  SU_TRYCATCH(
+      corr = suscan_fastcorr_new(
+          (const SUCOMPLEX * const *) templates,
+          lengths,
+          count,
+          max_shift),
+      goto done);
+
+done:
+  for (i = 0; i < count; ++i)
+    free(templates[i]);
+
+  return corr;
+}
+
+/************************** API implementation *******************************/
+void *
+suscan_syncword_inspector_open(const struct suscan_inspector_sampling_info *s)
+{
+  return suscan_syncword_inspector_new(s);
+}
+
+SUBOOL
+suscan_syncword_inspector_get_config(void *private, suscan_config_t *config)
+{
+  struct suscan_syncword_inspector *insp =
+      (struct suscan_syncword_inspector *) private;
+
+  SU_TRYCATCH(
+      suscan_inspector_syncword_params_save(
+          &insp->cur_params.syncword,
+          config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_syncword_inspector_parse_params(
+    struct suscan_syncword_inspector_params *params,
+    const suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_inspector_syncword_params_parse(
+          &params->syncword,
+          config),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_syncword_inspector_parse_config(
+    void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_syncword_inspector *insp =
+      (struct suscan_syncword_inspector *) private;
+
+  return suscan_syncword_inspector_parse_params(&insp->req_params, config);
+}
+
+/* Called from the analyzer thread: parses into a scratch area */
+SUBOOL
+suscan_syncword_inspector_check_config(
+    const void *private,
+    const suscan_config_t *config)
+{
+  struct suscan_syncword_inspector_params params;
+
+  return suscan_syncword_inspector_parse_params(&params, config);
+}
+
+/* Called from the worker thread */
+void
+suscan_syncword_inspector_commit_config(void *private)
+{
+  struct suscan_syncword_inspector *insp =
+      (struct suscan_syncword_inspector *) private;
+  suscan_fastcorr_t *corr;
+
+  insp->cur_params = insp->req_params;
+
+  /* Pending candidates refer to the previous templates */
+  memset(insp->candidate, 0, sizeof(insp->candidate));
+
+  if (insp->corr != NULL) {
+    suscan_fastcorr_destroy(insp->corr);
+    insp->corr = NULL;
+  }
+
+  if (insp->cur_params.syncword.templates[0] == '\0')
+    return;
+
+  if ((corr = suscan_syncword_inspector_make_corr(insp)) == NULL) {
+    SU_ERROR("Invalid sync word configuration, detection disabled\n");
+    return;
+  }
+
+  insp->corr = corr;
+}
+
+SUPRIVATE void
+suscan_syncword_inspector_push_detection(
+    struct suscan_syncword_inspector *self,
+    unsigned int t)
+{
+  struct suscan_syncword_candidate *cand = self->candidate + t;
+  struct suscan_inspector_detection *det;
+
+  if (self->q_count == SUSCAN_SYNCWORD_INSPECTOR_QUEUE_SIZE) {
+    ++self->dropped;
+    return;
+  }
+
+  det = self->queue
+      + (self->q_head + self->q_count++) % SUSCAN_SYNCWORD_INSPECTOR_QUEUE_SIZE;
+
+  det->template_id = t;
+  det->position    = cand->position;
+  det->peak        = cand->peak;
+  det->freq_offset = cand->shift * self->samp_info.equiv_fs
+      / suscan_fastcorr_get_size(self->corr);
+}
+
+/*
+ * Peaks of the same template closer than one template length are
+ * considered the same detection (e.g. symbol-spaced sidelobes).
+ */
+SUPRIVATE void
+suscan_syncword_inspector_find_peaks(struct suscan_syncword_inspector *self)
+{
+  const SUFLOAT *metric;
+  const int *shift;
+  struct suscan_syncword_candidate *cand;
+  SUFLOAT threshold = self->cur_params.syncword.threshold;
+  SUSDIFF start = suscan_fastcorr_get_start(self->corr);
+  SUSCOUNT step = suscan_fastcorr_get_step(self->corr);
+  SUSCOUNT i, len;
+  SUSDIFF pos;
+  unsigned int t;
+
+  for (t = 0; t < self->corr->count; ++t) {
+    metric = suscan_fastcorr_get_metric(self->corr, t);
+    shift  = suscan_fastcorr_get_shift(self->corr, t);
+    len    = suscan_fastcorr_get_template_length(self->corr, t);
+    cand   = self->candidate + t;
+
+    for (i = 0; i < step; ++i) {
+      /* Lags before the first sample are only partial matches */
+      if ((pos = start + (SUSDIFF) i) < 0)
+        continue;
+
+      if (cand->active && (SUSCOUNT) pos >= cand->position + len) {
+        suscan_syncword_inspector_push_detection(self, t);
+        cand->active = SU_FALSE;
+      }
+
+      if (metric[i] >= threshold
+          && (!cand->active || metric[i] > cand->peak)) {
+        cand->active   = SU_TRUE;
+        cand->position = pos;
+        cand->peak     = metric[i];
+        cand->shift    = shift[i];
+      }
+    }
+  }
+}
+
+SUSDIFF
+suscan_syncword_inspector_feed(
+    void *private,
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  struct suscan_syncword_inspector *self =
+      (struct suscan_syncword_inspector *) private;
+  struct suscan_inspector_stage_stats *stats = self->stats;
+  struct timespec t;
+  SUSCOUNT got, consumed = 0, windows = 0;
+  SUBOOL ready;
+
+  if (self->corr == NULL)
+    return count;
+
+  /* Wait until pending detections are retrieved */
+  if (self->q_count > 0)
+    return 0;
+
+  suscan_inspector_stage_enter(&t);
+
+  while (consumed < count) {
+    got = suscan_fastcorr_feed(self->corr, x + consumed, count - consumed, &ready);
+    consumed  += got;
+    self->fed += got;
+
+    if (ready) {
+      suscan_syncword_inspector_find_peaks(self);
+      ++windows;
+
+      if (self->q_count > 0)
+        break;
+    }
+  }
+
+  suscan_inspector_stage_leave(
+      stats + SUSCAN_SYNCWORD_INSPECTOR_STAGE_CORRELATOR,
+      &t,
+      consumed);
+
+  /* Peak search time is included in the correlator stage */
+  stats[SUSCAN_SYNCWORD_INSPECTOR_STAGE_PEAKS].samples +=
+      windows * suscan_fastcorr_get_step(self->corr);
+  ++stats[SUSCAN_SYNCWORD_INSPECTOR_STAGE_PEAKS].blocks;
+
+  return consumed;
+}
+
+SUBOOL
+suscan_syncword_inspector_pop_detection(
+    void *private,
+    struct suscan_inspector_detection *detection)
+{
+  struct suscan_syncword_inspector *self =
+      (struct suscan_syncword_inspector *) private;
+
+  if (self->q_count == 0)
+    return SU_FALSE;
+
+  *detection = self->queue[self->q_head];
+  detection->delay = self->fed - detection->position;
+
+  self->q_head = (self->q_head + 1) % SUSCAN_SYNCWORD_INSPECTOR_QUEUE_SIZE;
+  --self->q_count;
+
+  if (self->q_count == 0 && self->dropped > 0) {
+    SU_WARNING("%lu sync word detections dropped\n", self->dropped);
+    self->dropped = 0;
+  }
+
+  return SU_TRUE;
+}
+
+void
+suscan_syncword_inspector_get_stage_stats(
+    void *private,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  struct suscan_syncword_inspector *insp =
+      (struct suscan_syncword_inspector *) private;
+
+  *stats = insp->stats;
+  *count = SUSCAN_SYNCWORD_INSPECTOR_STAGE_COUNT;
+}
+
+void
+suscan_syncword_inspector_close(void *private)
+{
+  suscan_syncword_inspector_destroy(
+      (struct suscan_syncword_inspector *) private);
+}
+
+SUPRIVATE struct suscan_inspector_interface iface = {
+    .name = "syncword",
+    .desc = "Sync word correlator",
+    .open = suscan_syncword_inspector_open,
+    .get_config = suscan_syncword_inspector_get_config,
+    .parse_config = suscan_syncword_inspector_parse_config,
+    .check_config = suscan_syncword_inspector_check_config,
+    .commit_config = suscan_syncword_inspector_commit_config,
+    .feed = suscan_syncword_inspector_feed,
+    .pop_detection = suscan_syncword_inspector_pop_detection,
+    .get_stage_stats = suscan_syncword_inspector_get_stage_stats,
+    .close = suscan_syncword_inspector_close
+};
+
+SUBOOL
+suscan_syncword_inspector_register(void)
+{
+  SU_TRYCATCH(
+      iface.cfgdesc = suscan_config_desc_new(),
+      return SU_FALSE);
+
+  /* Add all configuration parameters */
+  SU_TRYCATCH(
+      suscan_config_desc_add_syncword_params(iface.cfgdesc),
+      return SU_FALSE);
+
+  /* Add applicable spectrum sources */
+  SU_TRYCATCH(
+      suscan_inspector_interface_add_spectsrc(&iface, "psd"),
+      return SU_FALSE);
+
+  /* Register inspector interface */
+  SU_TRYCATCH(suscan_inspector_interface_register(&iface), return SU_FALSE);
+
+  return SU_TRUE;
+}
@@ -46,34 +46,199 @@ suscan_inspector_unlock(suscan_inspector_t *insp)
 void
 suscan_inspector_reset_equalizer(suscan_inspector_t *insp)
 {
-  suscan_inspector_lock(insp);
-
-  SU_WARNING("Reset equalizer not implemented yet!\n");
-
-  suscan_inspector_unlock(insp);
+  __atomic_store_n(&insp->eq_reset_requested, SU_TRUE, __ATOMIC_RELEASE);
 }
 
+/*
+ * Called by the worker before every block. Requests are consumed with
+ * atomic exchanges, so the analyzer thread never waits for the worker
+ * and vice versa.
+ */
 void
 suscan_inspector_assert_params(suscan_inspector_t *insp)
 {
-  if (insp->params_requested) {
-    suscan_inspector_lock(insp);
-
-    (insp->iface->commit_config) (insp->privdata);
-    insp->params_requested = SU_FALSE;
+  suscan_config_t *config;
+  SUFREQ bw;
+  SUBOOL wall_clock;
+  unsigned int i;
 
-    suscan_inspector_unlock(insp);
+  if (__atomic_load_n(&insp->pending_config, __ATOMIC_RELAXED) != NULL) {
+    config = __atomic_exchange_n(
+        &insp->pending_config,
+        NULL,
+        __ATOMIC_ACQ_REL);
+
+    if (config != NULL) {
+      if ((insp->iface->parse_config) (insp->privdata, config)) {
+        suscan_inspector_lock(insp);
+        (insp->iface->commit_config) (insp->privdata);
+        suscan_inspector_unlock(insp);
+      } else {
+        SU_WARNING("Failed to parse inspector configuration\n");
+      }
+
+      suscan_config_destroy(config);
+    }
   }
 
-  if (insp->bandwidth_notified) {
-    suscan_inspector_lock(insp);
+  if (__atomic_load_n(&insp->bandwidth_notified, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(
+          &insp->bandwidth_notified,
+          SU_FALSE,
+          __ATOMIC_ACQ_REL)) {
+    __atomic_load(&insp->new_bandwidth, &bw, __ATOMIC_RELAXED);
 
     if (insp->iface->new_bandwidth != NULL)
-      (insp->iface->new_bandwidth) (insp->privdata, insp->new_bandwidth);
-    insp->bandwidth_notified = SU_FALSE;
+      (insp->iface->new_bandwidth) (insp->privdata, bw);
+  }
+
+  if (__atomic_load_n(&insp->eq_reset_requested, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(
+          &insp->eq_reset_requested,
+          SU_FALSE,
+          __ATOMIC_ACQ_REL)) {
+    if (insp->iface->reset_equalizer != NULL)
+      (insp->iface->reset_equalizer) (insp->privdata);
+    else
+      SU_WARNING("Inspector has no equalizer to reset\n");
+  }
+
+  if (__atomic_load_n(&insp->wall_clock_requested, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(
+          &insp->wall_clock_requested,
+          SU_FALSE,
+          __ATOMIC_ACQ_REL)) {
+    wall_clock = __atomic_load_n(&insp->new_wall_clock, __ATOMIC_RELAXED);
+
+    if (wall_clock && !insp->wall_clock) {
+      clock_gettime(CLOCK_MONOTONIC_RAW, &insp->last_estimator);
+      clock_gettime(CLOCK_MONOTONIC_RAW, &insp->last_spectrum);
+    }
 
-    suscan_inspector_unlock(insp);
+    insp->samples_estimator = 0;
+    insp->samples_spectrum  = 0;
+
+    insp->wall_clock = wall_clock;
   }
+
+  if (__atomic_load_n(&insp->spectsrc_requested, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(
+          &insp->spectsrc_requested,
+          SU_FALSE,
+          __ATOMIC_ACQ_REL))
+    insp->spectsrc_index =
+        __atomic_load_n(&insp->new_spectsrc_index, __ATOMIC_RELAXED);
+
+  if (__atomic_load_n(&insp->estimators_requested, __ATOMIC_RELAXED)
+      && __atomic_exchange_n(
+          &insp->estimators_requested,
+          SU_FALSE,
+          __ATOMIC_ACQ_REL))
+    for (i = 0; i < insp->estimator_count; ++i)
+      suscan_estimator_apply_enabled(insp->estimator_list[i]);
+}
+
+/* Called from the worker thread. Buffered samples are preserved. */
+SUBOOL
+suscan_inspector_resize_sampler_buf(suscan_inspector_t *insp, SUSCOUNT size)
+{
+  SUCOMPLEX *buf;
+  int8_t *soft;
+
+  SU_TRYCATCH(size >= insp->sampler_ptr + insp->soft_count, return SU_FALSE);
+  SU_TRYCATCH(size <= SUSCAN_INSPECTOR_SAMPLER_MAX_BUF_SIZE, return SU_FALSE);
+
+  if (size == insp->sampler_size)
+    return SU_TRUE;
+
+  SU_TRYCATCH(
+      buf = realloc(insp->sampler_buf, size * sizeof(SUCOMPLEX)),
+      return SU_FALSE);
+
+  insp->sampler_buf = buf;
+
+  /*
+   * If the soft buffer cannot follow, the sampler buffer already has its
+   * new size. Keep the smaller of both so neither of them overflows.
+   */
+  SU_TRYCATCH(
+      soft = realloc(insp->soft_buf, size * SUSCAN_INSPECTOR_SOFT_MAX_BITS),
+      insp->sampler_size = SU_MIN(size, insp->sampler_size);
+      return SU_FALSE);
+
+  insp->soft_buf     = soft;
+  insp->sampler_size = size;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_set_squelch(
+    suscan_inspector_t *insp,
+    SUBOOL enabled,
+    SUFLOAT level_db,
+    SUFLOAT hang)
+{
+  SUFLOAT ratio;
+
+  if (hang < 0)
+    return SU_FALSE;
+
+  ratio = SU_POWER_MAG(level_db);
+
+  __atomic_store(&insp->squelch_ratio, &ratio, __ATOMIC_RELAXED);
+  __atomic_store(&insp->squelch_hang, &hang, __ATOMIC_RELAXED);
+  __atomic_store_n(&insp->squelch, enabled, __ATOMIC_RELEASE);
+
+  return SU_TRUE;
+}
+
+/*
+ * Decides whether the incoming block is worth demodulating. The mean
+ * block power is compared against the channel noise reported by the
+ * detector: once it goes below the threshold, the inspector stays
+ * active for the configured hang time before becoming dormant.
+ */
+SUBOOL
+suscan_inspector_update_activity(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count)
+{
+  SUFLOAT N0, ratio, hang;
+  SUFLOAT power = 0;
+  SUSCOUNT i;
+
+  if (!__atomic_load_n(&insp->squelch, __ATOMIC_ACQUIRE)) {
+    insp->dormant = SU_FALSE;
+    return SU_TRUE;
+  }
+
+  __atomic_load(&insp->noise_floor, &N0, __ATOMIC_RELAXED);
+
+  /* No noise estimation yet (e.g. no detector running) */
+  if (N0 <= 0 || count == 0) {
+    insp->dormant = SU_FALSE;
+    return SU_TRUE;
+  }
+
+  __atomic_load(&insp->squelch_ratio, &ratio, __ATOMIC_RELAXED);
+  __atomic_load(&insp->squelch_hang, &hang, __ATOMIC_RELAXED);
+
+  for (i = 0; i < count; ++i)
+    power += SU_C_REAL(x[i] * SU_C_CONJ(x[i]));
+
+  if (power >= ratio * N0 * count) {
+    insp->hang_left = hang * insp->samp_info.equiv_fs;
+    insp->dormant = SU_FALSE;
+  } else if (insp->hang_left > count) {
+    insp->hang_left -= count;
+  } else {
+    insp->hang_left = 0;
+    insp->dormant = SU_TRUE;
+  }
+
+  return !insp->dormant;
 }
 
 void
@@ -83,6 +248,15 @@ suscan_inspector_destroy(suscan_inspector_t *insp)
 
   pthread_mutex_destroy(&insp->mutex);
 
+  if (insp->pending_config != NULL)
+    suscan_config_destroy(insp->pending_config);
+
+  if (insp->sampler_buf != NULL)
+    free(insp->sampler_buf);
+
+  if (insp->soft_buf != NULL)
+    free(insp->soft_buf);
+
   if (insp->privdata != NULL)
     (insp->iface->close) (insp->privdata);
 
@@ -92,6 +266,9 @@ suscan_inspector_destroy(suscan_inspector_t *insp)
   if (insp->estimator_list != NULL)
     free(insp->estimator_list);
 
+  if (insp->estimator_fe != NULL)
+    suscan_estimator_frontend_destroy(insp->estimator_fe);
+
   for (i = 0; i < insp->spectsrc_count; ++i)
     suscan_spectsrc_destroy(insp->spectsrc_list[i]);
 
@@ -101,23 +278,47 @@ suscan_inspector_destroy(suscan_inspector_t *insp)
   free(insp);
 }
 
+/*
+ * Validates the configuration and publishes a private copy of it. If the
+ * worker did not consume the previous request yet, it is simply replaced.
+ */
 SUBOOL
 suscan_inspector_set_config(
     suscan_inspector_t *insp,
     const suscan_config_t *config)
 {
-  /* TODO: Protect? */
-  insp->params_requested = SU_TRUE;
+  suscan_config_t *copy = NULL;
+
+  if (insp->iface->check_config != NULL
+      && !(insp->iface->check_config) (insp->privdata, config))
+    return SU_FALSE;
+
+  SU_TRYCATCH(copy = suscan_config_dup(config), return SU_FALSE);
 
-  return (insp->iface->parse_config) (insp->privdata, config);
+  copy = __atomic_exchange_n(&insp->pending_config, copy, __ATOMIC_ACQ_REL);
+
+  if (copy != NULL)
+    suscan_config_destroy(copy);
+
+  return SU_TRUE;
 }
 
+/*
+ * Called from the analyzer thread. The worker commits new parameters with
+ * the inspector mutex held, so the copy is never torn.
+ */
 SUBOOL
 suscan_inspector_get_config(
-    const suscan_inspector_t *insp,
+    suscan_inspector_t *insp,
     suscan_config_t *config)
 {
-  return (insp->iface->get_config) (insp->privdata, config);
+  SUBOOL ok;
+
+  suscan_inspector_lock(insp);
+  ok = (insp->iface->get_config) (insp->privdata, config);
+  suscan_inspector_unlock(insp);
+
+  return ok;
 }
 
 SUBOOL
@@ -125,8 +326,8 @@ suscan_inspector_notify_bandwidth(
     suscan_inspector_t *insp,
     SUFREQ new_bandwidth)
 {
-  insp->new_bandwidth = new_bandwidth;
-  insp->bandwidth_notified = SU_TRUE;
+  __atomic_store(&insp->new_bandwidth, &new_bandwidth, __ATOMIC_RELAXED);
+  __atomic_store_n(&insp->bandwidth_notified, SU_TRUE, __ATOMIC_RELEASE);
 
   return SU_TRUE;
 }
@@ -213,11 +414,22 @@ suscan_inspector_new(
   new->samp_info.bw = SU_ANG2NORM_FREQ(
       .5 * channel->decimation * su_specttuner_channel_get_bw(channel));
 
+  /* Sampler output, resized later according to the watermark */
+  SU_TRYCATCH(
+      suscan_inspector_resize_sampler_buf(
+          new,
+          SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE),
+      goto fail);
+
   /* Spectrum and estimator updates */
-  new->interval_estimator = .1;
+  new->interval_estimator = SUSCAN_DEFAULT_ESTIMATOR_INTERVAL;
   new->interval_spectrum  = .1;
 
-  /* Initialize clocks */
+  /* Squelch is disabled by default */
+  new->squelch_ratio = SU_POWER_MAG(SUSCAN_INSPECTOR_DEFAULT_SQUELCH_LEVEL);
+  new->squelch_hang  = SUSCAN_INSPECTOR_DEFAULT_SQUELCH_HANG;
+
+  /* Initialize clocks, only used in wall clock mode */
   clock_gettime(CLOCK_MONOTONIC_RAW, &new->last_estimator);
   clock_gettime(CLOCK_MONOTONIC_RAW, &new->last_spectrum);
 
@@ -236,6 +448,13 @@ suscan_inspector_new(
         suscan_inspector_add_estimator(new, iface->estimator_list[i]),
         goto fail);
 
+  if (iface->estimator_count > 0)
+    SU_TRYCATCH(
+        new->estimator_fe = suscan_estimator_frontend_new(
+            new->samp_info.equiv_fs,
+            SUSCAN_DEFAULT_ESTIMATOR_BUFSIZ),
+        goto fail);
+
   return new;
 
 fail:
@@ -245,6 +464,42 @@ fail:
   return NULL;
 }
 
+SUBOOL
+suscan_inspector_get_stage_stats(
+    const suscan_inspector_t *insp,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count)
+{
+  if (insp->iface->get_stage_stats == NULL)
+    return SU_FALSE;
+
+  (insp->iface->get_stage_stats) (insp->privdata, stats, count);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_pop_burst(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_burst *burst)
+{
+  if (insp->iface->pop_burst == NULL)
+    return SU_FALSE;
+
+  return (insp->iface->pop_burst) (insp->privdata, burst);
+}
+
+SUBOOL
+suscan_inspector_pop_detection(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_detection *detection)
+{
+  if (insp->iface->pop_detection == NULL)
+    return SU_FALSE;
+
+  return (insp->iface->pop_detection) (insp->privdata, detection);
+}
+
 SUSDIFF
 suscan_inspector_feed_bulk(
     suscan_inspector_t *insp,
@@ -261,6 +516,9 @@ suscan_init_inspectors(void)
   SU_TRYCATCH(suscan_psk_inspector_register(), return SU_FALSE);
   SU_TRYCATCH(suscan_fsk_inspector_register(), return SU_FALSE);
   SU_TRYCATCH(suscan_audio_inspector_register(), return SU_FALSE);
+  SU_TRYCATCH(suscan_multiaudio_inspector_register(), return SU_FALSE);
+  SU_TRYCATCH(suscan_burst_inspector_register(), return SU_FALSE);
+  SU_TRYCATCH(suscan_syncword_inspector_register(), return SU_FALSE);
 
   return SU_TRUE;
 }
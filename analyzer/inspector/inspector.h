@@ -34,8 +34,13 @@ extern "C" {
 
 #define SUSCAN_INSPECTOR_TUNER_BUF_SIZE    SU_BLOCK_STREAM_BUFFER_SIZE
 #define SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE  SU_BLOCK_STREAM_BUFFER_SIZE
+#define SUSCAN_INSPECTOR_SAMPLER_MAX_BUF_SIZE (1 << 20)
+#define SUSCAN_INSPECTOR_SOFT_MAX_BITS     8 /* Soft values per symbol */
 #define SUSCAN_INSPECTOR_SPECTRUM_BUF_SIZE 2048
 
+#define SUSCAN_INSPECTOR_DEFAULT_SQUELCH_LEVEL 6.  /* dB over noise floor */
+#define SUSCAN_INSPECTOR_DEFAULT_SQUELCH_HANG  .5  /* seconds */
+
 enum suscan_aync_state {
   SUSCAN_ASYNC_STATE_CREATED,
   SUSCAN_ASYNC_STATE_RUNNING,
@@ -43,7 +48,6 @@ enum suscan_aync_state {
   SUSCAN_ASYNC_STATE_HALTED
 };
 
-/* TODO: protect baudrate access with mutexes */
 struct suscan_inspector {
   pthread_mutex_t mutex;
   uint32_t inspector_id;        /* Set by client */
@@ -56,49 +60,192 @@ struct suscan_inspector {
   struct suscan_inspector_sampling_info samp_info; /* Sampling information */
 
   /* Spectrum and estimator state */
-  SUFLOAT  interval_estimator;
+  SUFLOAT  interval_estimator;  /* Only accessed through atomic builtins */
   SUFLOAT  interval_spectrum;
+  SUBOOL   wall_clock;          /* Schedule updates using the wall clock */
+  SUSCOUNT samples_estimator;   /* Samples since last estimator update */
+  SUSCOUNT samples_spectrum;    /* Samples since last spectrum update */
   struct timespec last_estimator;
   struct timespec last_spectrum;
 
   uint32_t spectsrc_index;
 
-  SUBOOL    params_requested;    /* New parameters requested */
-  SUBOOL    bandwidth_notified;  /* New bandwidth set */
+  /*
+   * Requests from the analyzer thread. The worker picks them up once per
+   * block in suscan_inspector_assert_params, so no lock is needed in the
+   * sample path. These fields are only accessed through atomic builtins.
+   */
+  suscan_config_t *pending_config;  /* Private copy of the last request */
+  SUBOOL    bandwidth_notified;     /* New bandwidth set */
   SUFREQ    new_bandwidth;
-
-  /* Sampler output */
-  SUCOMPLEX sampler_buf[SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE];
+  SUBOOL    eq_reset_requested;     /* Equalizer reset requested */
+  SUBOOL    wall_clock_requested;   /* New scheduling mode set */
+  SUBOOL    new_wall_clock;
+  SUBOOL    spectsrc_requested;     /* New spectrum source selected */
+  uint32_t  new_spectsrc_index;
+  SUBOOL    estimators_requested;   /* Some estimator was toggled */
+
+  /*
+   * Activity gating. While dormant, the worker skips demodulation and
+   * estimation. squelch, squelch_ratio, squelch_hang and noise_floor are
+   * written from other threads and only accessed through atomic builtins.
+   */
+  SUBOOL    squelch;              /* Gate processing on channel activity */
+  SUFLOAT   squelch_ratio;        /* Linear threshold over channel noise */
+  SUFLOAT   squelch_hang;         /* Seconds to stay active after signal */
+  SUFLOAT   noise_floor;          /* Channel noise power, from the detector */
+  SUSCOUNT  hang_left;            /* Samples left before going dormant */
+  SUBOOL    dormant;
+
+  /*
+   * Sampler output. The buffer grows (up to the maximum size) to hold the
+   * watermark, and when a block produces more samples than it can hold.
+   * sample_msg_watermark and sample_msg_latency are written from other
+   * threads and only accessed through atomic builtins.
+   */
+  SUCOMPLEX *sampler_buf;
+  SUSCOUNT  sampler_size;
   SUSCOUNT  sampler_ptr;
+
+  /*
+   * Soft symbol output. It shares the sampler buffer size (in symbols),
+   * and all buffered symbols have the same number of soft values.
+   */
+  int8_t   *soft_buf;
+  SUSCOUNT  soft_count;           /* Symbols */
+  SUSCOUNT  soft_ptr;             /* Soft values */
+  unsigned int soft_bits;         /* Soft values per symbol */
+
+  SUSCOUNT  sampler_age;          /* Input samples since first output */
   SUSCOUNT  sample_msg_watermark; /* Watermark. When reached, message is sent */
+  SUFLOAT   sample_msg_latency;   /* Max. seconds of buffered output (0: off) */
 
   PTR_LIST(suscan_estimator_t, estimator); /* Parameter estimators */
+  suscan_estimator_frontend_t *estimator_fe; /* Shared by all estimators */
   PTR_LIST(suscan_spectsrc_t, spectsrc); /* Spectrum source */
 };
 
 typedef struct suscan_inspector suscan_inspector_t;
 
+/* The sampler buffer is resized by the worker, before the next block */
 SUINLINE SUBOOL
 suscan_inspector_set_msg_watermark(suscan_inspector_t *insp, SUSCOUNT wm)
 {
-  if (wm > SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE)
+  if (wm > SUSCAN_INSPECTOR_SAMPLER_MAX_BUF_SIZE)
     return SU_FALSE;
 
-  insp->sample_msg_watermark = wm;
+  __atomic_store_n(&insp->sample_msg_watermark, wm, __ATOMIC_RELAXED);
 
   return SU_TRUE;
 }
 
+/*
+ * Sample messages are also sent when the oldest buffered sample is older
+ * than the given latency, in seconds. The age of the buffer is counted in
+ * channel samples, so this follows the stream rate, not the wall clock.
+ */
+SUINLINE SUBOOL
+suscan_inspector_set_msg_latency(suscan_inspector_t *insp, SUFLOAT latency)
+{
+  if (latency < 0)
+    return SU_FALSE;
+
+  __atomic_store(&insp->sample_msg_latency, &latency, __ATOMIC_RELAXED);
+
+  return SU_TRUE;
+}
+
+SUINLINE SUBOOL
+suscan_inspector_set_estimator_interval(
+    suscan_inspector_t *insp,
+    SUFLOAT interval)
+{
+  if (interval < 0)
+    return SU_FALSE;
+
+  __atomic_store(&insp->interval_estimator, &interval, __ATOMIC_RELAXED);
+
+  return SU_TRUE;
+}
+
+/*
+ * By default, spectrum and estimator updates are scheduled according to
+ * the number of processed samples, which is deterministic and does not
+ * require querying the system clock on every block. Wall clock scheduling
+ * may be preferred for sources whose rate does not match real time. The
+ * worker switches modes before its next block.
+ */
+/* Index 0 disables the spectrum, the rest select spectsrc_list[index - 1] */
+SUINLINE SUBOOL
+suscan_inspector_set_spectsrc(suscan_inspector_t *insp, uint32_t index)
+{
+  if (index > insp->spectsrc_count)
+    return SU_FALSE;
+
+  __atomic_store_n(&insp->new_spectsrc_index, index, __ATOMIC_RELAXED);
+  __atomic_store_n(&insp->spectsrc_requested, SU_TRUE, __ATOMIC_RELEASE);
+
+  return SU_TRUE;
+}
+
+SUINLINE SUBOOL
+suscan_inspector_set_estimator_enabled(
+    suscan_inspector_t *insp,
+    uint32_t index,
+    SUBOOL enabled)
+{
+  if (index >= insp->estimator_count)
+    return SU_FALSE;
+
+  suscan_estimator_set_enabled(insp->estimator_list[index], enabled);
+  __atomic_store_n(&insp->estimators_requested, SU_TRUE, __ATOMIC_RELEASE);
+
+  return SU_TRUE;
+}
+
+SUINLINE void
+suscan_inspector_set_wall_clock(suscan_inspector_t *insp, SUBOOL wall_clock)
+{
+  __atomic_store_n(&insp->new_wall_clock, wall_clock, __ATOMIC_RELAXED);
+  __atomic_store_n(&insp->wall_clock_requested, SU_TRUE, __ATOMIC_RELEASE);
+}
+
+/*
+ * Called from the source worker. N0 is the noise level the channel
+ * detector estimated per FFT bin, which for white noise equals the noise
+ * power of the full-band stream. The fraction that falls inside the
+ * channel is what the inspector is expected to see while idle.
+ */
+SUINLINE void
+suscan_inspector_set_noise_floor(suscan_inspector_t *insp, SUFLOAT N0)
+{
+  SUFLOAT fraction;
+
+  fraction = su_specttuner_channel_get_bw(insp->samp_info.schan) / (2 * PI);
+  if (fraction > 1)
+    fraction = 1;
+
+  N0 *= fraction;
+
+  __atomic_store(&insp->noise_floor, &N0, __ATOMIC_RELAXED);
+}
+
+SUINLINE SUBOOL
+suscan_inspector_is_dormant(const suscan_inspector_t *insp)
+{
+  return insp->dormant;
+}
+
 SUINLINE SUSCOUNT
 suscan_inspector_sampler_buf_avail(const suscan_inspector_t *insp)
 {
-  return SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE - insp->sampler_ptr;
+  return insp->sampler_size - insp->sampler_ptr - insp->soft_count;
 }
 
 SUINLINE SUBOOL
 suscan_inspector_push_sample(suscan_inspector_t *insp, SUCOMPLEX samp)
 {
-  if (insp->sampler_ptr >= SUSCAN_INSPECTOR_SAMPLER_BUF_SIZE)
+  if (insp->sampler_ptr + insp->soft_count >= insp->sampler_size)
     return SU_FALSE;
 
   insp->sampler_buf[insp->sampler_ptr++] = samp;
@@ -106,6 +253,42 @@ suscan_inspector_push_sample(suscan_inspector_t *insp, SUCOMPLEX samp)
   return SU_TRUE;
 }
 
+SUINLINE SUBOOL
+suscan_inspector_push_soft(
+    suscan_inspector_t *insp,
+    const int8_t *values,
+    unsigned int bits)
+{
+  unsigned int i;
+
+  if (insp->sampler_ptr + insp->soft_count >= insp->sampler_size)
+    return SU_FALSE;
+
+  if (bits > SUSCAN_INSPECTOR_SOFT_MAX_BITS
+      || (insp->soft_count > 0 && bits != insp->soft_bits))
+    return SU_FALSE;
+
+  for (i = 0; i < bits; ++i)
+    insp->soft_buf[insp->soft_ptr++] = values[i];
+
+  insp->soft_bits = bits;
+  ++insp->soft_count;
+
+  return SU_TRUE;
+}
+
+SUINLINE SUSCOUNT
+suscan_inspector_get_soft_count(const suscan_inspector_t *insp)
+{
+  return insp->soft_count;
+}
+
+SUINLINE const int8_t *
+suscan_inspector_get_soft_buffer(const suscan_inspector_t *insp)
+{
+  return insp->soft_buf;
+}
+
 SUINLINE SUSCOUNT
 suscan_inspector_get_output_length(const suscan_inspector_t *insp)
 {
@@ -139,6 +322,21 @@ void suscan_inspector_reset_equalizer(suscan_inspector_t *insp);
 
 void suscan_inspector_assert_params(suscan_inspector_t *insp);
 
+SUBOOL suscan_inspector_resize_sampler_buf(
+    suscan_inspector_t *insp,
+    SUSCOUNT size);
+
+SUBOOL suscan_inspector_set_squelch(
+    suscan_inspector_t *insp,
+    SUBOOL enabled,
+    SUFLOAT level_db,
+    SUFLOAT hang);
+
+SUBOOL suscan_inspector_update_activity(
+    suscan_inspector_t *insp,
+    const SUCOMPLEX *x,
+    SUSCOUNT count);
+
 void suscan_inspector_destroy(suscan_inspector_t *insp);
 
 SUBOOL suscan_inspector_set_config(
@@ -150,7 +348,7 @@ SUBOOL suscan_inspector_notify_bandwidth(
     SUFREQ new_bandwidth);
 
 SUBOOL suscan_inspector_get_config(
-    const suscan_inspector_t *insp,
+    suscan_inspector_t *insp,
     suscan_config_t *config);
 
 suscan_inspector_t *suscan_inspector_new(
@@ -158,6 +356,24 @@ suscan_inspector_t *suscan_inspector_new(
     SUFLOAT fs,
     su_specttuner_channel_t *channel);
 
+/*
+ * Stage counters are updated by the worker without locking: they are meant
+ * for diagnostics only.
+ */
+SUBOOL suscan_inspector_get_stage_stats(
+    const suscan_inspector_t *insp,
+    const struct suscan_inspector_stage_stats **stats,
+    unsigned int *count);
+
+/* Ownership of burst->samples is transferred to the caller */
+SUBOOL suscan_inspector_pop_burst(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_burst *burst);
+
+SUBOOL suscan_inspector_pop_detection(
+    suscan_inspector_t *insp,
+    struct suscan_inspector_detection *detection);
+
 SUSDIFF suscan_inspector_feed_bulk(
     suscan_inspector_t *insp,
     const SUCOMPLEX *x,
@@ -170,6 +386,9 @@ SUBOOL suscan_ask_inspector_register(void);
 SUBOOL suscan_fsk_inspector_register(void);
 SUBOOL suscan_psk_inspector_register(void);
 SUBOOL suscan_audio_inspector_register(void);
+SUBOOL suscan_multiaudio_inspector_register(void);
+SUBOOL suscan_burst_inspector_register(void);
+SUBOOL suscan_syncword_inspector_register(void);
 
 #ifdef __cplusplus
 }
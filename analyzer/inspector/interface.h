@@ -28,6 +28,7 @@
 
 #include "../estimator.h"
 #include "../spectsrc.h"
+#include "pipeline.h"
 
 struct suscan_inspector;
 
@@ -38,6 +39,25 @@ struct suscan_inspector_sampling_info {
   SUFLOAT f0;
 };
 
+/* Template match, produced by correlator inspectors */
+struct suscan_inspector_detection {
+  unsigned int template_id;
+  SUSCOUNT     position;    /* Input sample where the match starts */
+  SUSCOUNT     delay;       /* Samples fed since the match start */
+  SUFLOAT      freq_offset; /* Relative to the channel center (Hz) */
+  SUFLOAT      peak;        /* Normalized correlation (0-1) */
+};
+
+/* Triggered capture, produced by burst-mode inspectors */
+struct suscan_inspector_burst {
+  SUCOMPLEX *samples;    /* Owned by whoever holds the burst */
+  SUSCOUNT   count;
+  SUSCOUNT   pretrigger; /* Samples preceding the trigger */
+  SUSCOUNT   delay;      /* Samples fed since the first burst sample */
+  SUFLOAT    power;      /* Mean power after the trigger (dB) */
+  SUFLOAT    noise;      /* Noise floor before the trigger (dB) */
+};
+
 
 struct suscan_inspector_interface {
   const char *name;
@@ -52,6 +72,17 @@ struct suscan_inspector_interface {
   /* Get current configuration */
   SUBOOL (*get_config) (void *priv, suscan_config_t *config);
 
+  /*
+   * Validate a config without applying it (optional). Called from the
+   * analyzer thread, so it must not touch anything the worker uses.
+   */
+  SUBOOL (*check_config) (const void *priv, const suscan_config_t *config);
+
+  /*
+   * The following methods are called from the worker thread, between
+   * calls to feed.
+   */
+
   /* Parse config and store it in a temporary area */
   SUBOOL (*parse_config) (void *priv, const suscan_config_t *config);
 
@@ -61,6 +92,9 @@ struct suscan_inspector_interface {
   /* Commit parsed config */
   void (*commit_config) (void *priv);
 
+  /* Reset channel equalizer (optional) */
+  void (*reset_equalizer) (void *priv);
+
   /* Feed inspector with samples */
   SUSDIFF (*feed) (
       void *priv,
@@ -68,6 +102,23 @@ struct suscan_inspector_interface {
       const SUCOMPLEX *x,
       SUSCOUNT count);
 
+  /*
+   * Retrieve a completed burst (optional). Burst-mode inspectors stop
+   * consuming samples in feed until their pending burst is retrieved.
+   */
+  SUBOOL (*pop_burst) (void *priv, struct suscan_inspector_burst *burst);
+
+  /* Retrieve a pending template match (optional) */
+  SUBOOL (*pop_detection) (
+      void *priv,
+      struct suscan_inspector_detection *detection);
+
+  /* Get per-stage processing counters (optional) */
+  void (*get_stage_stats) (
+      void *priv,
+      const struct suscan_inspector_stage_stats **stats,
+      unsigned int *count);
+
   /* Close inspector */
   void (*close) (void *priv);
 };
@@ -0,0 +1,177 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "mf-sampler"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/mfsampler.h"
+#include "inspector/pipeline.h"
+
+/* Root raised cosine impulse response, t and T in samples */
+SUPRIVATE SUFLOAT
+suscan_mf_sampler_rrc(SUFLOAT t, SUFLOAT T, SUFLOAT beta)
+{
+  SUFLOAT x = t / T;
+  SUFLOAT den;
+
+  if (SU_ABS(x) < 1e-6)
+    return 1 + beta * (4 / PI - 1);
+
+  if (beta > 0 && SU_ABS(SU_ABS(x) - 1 / (4 * beta)) < 1e-6)
+    return beta / SU_SQRT(2)
+        * ((1 + 2 / PI) * SU_SIN(PI / (4 * beta))
+         + (1 - 2 / PI) * SU_COS(PI / (4 * beta)));
+
+  den = PI * x * (1 - 16 * beta * beta * x * x);
+
+  return (SU_SIN(PI * x * (1 - beta))
+      + 4 * beta * x * SU_COS(PI * x * (1 + beta))) / den;
+}
+
+SUBOOL
+suscan_mf_sampler_init(
+    suscan_mf_sampler_t *self,
+    SUFLOAT period,
+    SUFLOAT rolloff,
+    SUSCOUNT span)
+{
+  unsigned int p;
+  SUSCOUNT j;
+  SUFLOAT *branch;
+  SUFLOAT delay, center, sum;
+
+  memset(self, 0, sizeof(suscan_mf_sampler_t));
+
+  SU_TRYCATCH(period >= 1, goto fail);
+  SU_TRYCATCH(span > 0, goto fail);
+
+  self->period = period;
+  self->span   = span;
+
+  SU_TRYCATCH(
+      self->taps = malloc(
+          SUSCAN_MF_SAMPLER_PHASES * span * sizeof(SUFLOAT)),
+      goto fail);
+
+  SU_TRYCATCH(
+      self->history = calloc(2 * span, sizeof(SUCOMPLEX)),
+      goto fail);
+
+  center = .5 * (span - 1);
+
+  /*
+   * Branch p evaluates the filter at p / PHASES samples before the most
+   * recent sample. Taps are stored time-reversed so that the output is a
+   * plain dot product with the history window. Every branch is normalized
+   * to unity DC gain.
+   */
+  for (p = 0; p < SUSCAN_MF_SAMPLER_PHASES; ++p) {
+    branch = self->taps + p * span;
+    delay = (SUFLOAT) p / SUSCAN_MF_SAMPLER_PHASES;
+    sum = 0;
+
+    for (j = 0; j < span; ++j) {
+      branch[j] = suscan_mf_sampler_rrc(
+          span - 1 - j - delay - center,
+          period,
+          rolloff);
+      sum += branch[j];
+    }
+
+    if (SU_ABS(sum) > 0)
+      for (j = 0; j < span; ++j)
+        branch[j] /= sum;
+  }
+
+  return SU_TRUE;
+
+fail:
+  suscan_mf_sampler_finalize(self);
+
+  return SU_FALSE;
+}
+
+void
+suscan_mf_sampler_set_phase_addend(suscan_mf_sampler_t *self, SUFLOAT addend)
+{
+  self->phase += (addend - self->phase_addend) * self->period;
+  self->phase_addend = addend;
+
+  self->phase -= SU_FLOOR(self->phase / self->period) * self->period;
+}
+
+SUSCOUNT
+suscan_mf_sampler_feed(
+    suscan_mf_sampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y)
+{
+  SUSCOUNT i;
+  SUSCOUNT n = 0;
+  SUSCOUNT span = self->span;
+  SUSCOUNT ptr = self->ptr;
+  SUFLOAT phase = self->phase;
+  SUFLOAT period = self->period;
+  unsigned int p;
+
+  for (i = 0; i < len; ++i) {
+    /* After this, history[ptr .. ptr + span - 1] holds the last span samples */
+    self->history[ptr] = self->history[ptr + span] = x[i];
+    if (++ptr == span)
+      ptr = 0;
+
+    phase += 1;
+    if (phase >= period) {
+      phase -= period;
+
+      /* The symbol instant happened phase samples ago */
+      p = (unsigned int) (phase * SUSCAN_MF_SAMPLER_PHASES + .5);
+      if (p >= SUSCAN_MF_SAMPLER_PHASES)
+        p = SUSCAN_MF_SAMPLER_PHASES - 1;
+
+      y[n++] = suscan_inspector_dot_real(
+          self->history + ptr,
+          self->taps + p * span,
+          span);
+    }
+  }
+
+  self->ptr   = ptr;
+  self->phase = phase;
+
+  return n;
+}
+
+void
+suscan_mf_sampler_finalize(suscan_mf_sampler_t *self)
+{
+  if (self->taps != NULL)
+    free(self->taps);
+
+  if (self->history != NULL)
+    free(self->history);
+
+  memset(self, 0, sizeof(suscan_mf_sampler_t));
+}
@@ -0,0 +1,81 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_MFSAMPLER_H
+#define _INSPECTOR_MFSAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_MF_SAMPLER_PHASES 32
+
+/*
+ * Polyphase RRC matched filter merged with a fixed rate symbol sampler.
+ * Incoming samples are only stored in a history buffer: the filter is
+ * evaluated once per symbol, at the instant dictated by the sampler,
+ * using the branch whose fractional delay is closest to that instant.
+ */
+struct suscan_mf_sampler {
+  SUFLOAT      period;        /* Symbol period, in samples */
+  SUFLOAT      phase;         /* Samples since last symbol instant */
+  SUFLOAT      phase_addend;  /* Symbol phase, as a fraction of period */
+  SUSCOUNT     span;          /* Taps per branch */
+  SUFLOAT     *taps;          /* Time-reversed branches, one after another */
+  SUCOMPLEX   *history;       /* Doubled history buffer */
+  SUSCOUNT     ptr;
+};
+
+typedef struct suscan_mf_sampler suscan_mf_sampler_t;
+
+#define suscan_mf_sampler_INITIALIZER {0, 0, 0, 0, NULL, NULL, 0}
+
+SUINLINE SUBOOL
+suscan_mf_sampler_is_ready(const suscan_mf_sampler_t *self)
+{
+  return self->taps != NULL;
+}
+
+SUBOOL suscan_mf_sampler_init(
+    suscan_mf_sampler_t *self,
+    SUFLOAT period,
+    SUFLOAT rolloff,
+    SUSCOUNT span);
+
+void suscan_mf_sampler_set_phase_addend(
+    suscan_mf_sampler_t *self,
+    SUFLOAT addend);
+
+/* Returns the number of symbols written to y. y may alias x. */
+SUSCOUNT suscan_mf_sampler_feed(
+    suscan_mf_sampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y);
+
+void suscan_mf_sampler_finalize(suscan_mf_sampler_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_MFSAMPLER_H */
@@ -20,6 +20,8 @@
 
 #define SU_LOG_DOMAIN "insp-params"
 
+#include <string.h>
+
 #include <sigutils/log.h>
 #include "params.h"
 
@@ -557,6 +559,109 @@ suscan_inspector_br_params_save(
   return SU_TRUE;
 }
 
+/**************************** Soft symbols ***********************************/
+SUBOOL
+suscan_config_desc_add_soft_params(suscan_config_desc_t *desc)
+{
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_BOOLEAN,
+          SU_TRUE,
+          "soft.enabled",
+          "Output soft symbols"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_INTEGER,
+          SU_TRUE,
+          "soft.bits_per_symbol",
+          "Soft bits per symbol"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "soft.scale",
+          "LLR quantization scale"),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_soft_params_parse(
+    struct suscan_inspector_soft_params *params,
+    const suscan_config_t *config)
+{
+  struct suscan_field_value *value;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "soft.enabled"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_BOOLEAN, return SU_FALSE);
+
+  params->soft_enabled = value->as_bool;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "soft.bits_per_symbol"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_INTEGER, return SU_FALSE);
+
+  params->soft_bits = value->as_int;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "soft.scale"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->soft_scale = value->as_float;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_soft_params_save(
+    const struct suscan_inspector_soft_params *params,
+    suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_config_set_bool(
+          config,
+          "soft.enabled",
+          params->soft_enabled),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_integer(
+          config,
+          "soft.bits_per_symbol",
+          params->soft_bits),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "soft.scale",
+          params->soft_scale),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
 /****************************** FSK config ***********************************/
 SUBOOL
 suscan_config_desc_add_fsk_params(suscan_config_desc_t *desc)
@@ -927,3 +1032,502 @@ suscan_inspector_audio_params_save(
   return SU_TRUE;
 
 }
+
+/************************** Multichannel config ******************************/
+SUBOOL
+suscan_config_desc_add_multiaudio_params(suscan_config_desc_t *desc)
+{
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_INTEGER,
+          SU_TRUE,
+          "multiaudio.channels",
+          "Number of channels"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "multiaudio.spacing",
+          "Channel spacing"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "multiaudio.squelch",
+          "Squelch level (dB)"),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_multiaudio_params_parse(
+    struct suscan_inspector_multiaudio_params *params,
+    const suscan_config_t *config)
+{
+  struct suscan_field_value *value;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "multiaudio.channels"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_INTEGER, return SU_FALSE);
+
+  params->channels = value->as_int;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "multiaudio.spacing"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->spacing = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "multiaudio.squelch"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->squelch = value->as_float;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_multiaudio_params_save(
+    const struct suscan_inspector_multiaudio_params *params,
+    suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_config_set_integer(
+          config,
+          "multiaudio.channels",
+          params->channels),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "multiaudio.spacing",
+          params->spacing),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "multiaudio.squelch",
+          params->squelch),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/****************************** Burst config *********************************/
+SUBOOL
+suscan_config_desc_add_burst_params(suscan_config_desc_t *desc)
+{
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_INTEGER,
+          SU_TRUE,
+          "burst.trigger",
+          "Trigger (energy or preamble)"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.threshold",
+          "Energy trigger level (dB)"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.pretrigger",
+          "Pre-trigger time"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.hang",
+          "Hang time"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.max_length",
+          "Maximum burst length"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.baud",
+          "Preamble baud rate"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "burst.corr_threshold",
+          "Preamble correlation threshold"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_STRING,
+          SU_TRUE,
+          "burst.preamble",
+          "Preamble bits"),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_burst_params_parse(
+    struct suscan_inspector_burst_params *params,
+    const suscan_config_t *config)
+{
+  struct suscan_field_value *value;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.trigger"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_INTEGER, return SU_FALSE);
+
+  params->trigger = (enum suscan_inspector_burst_trigger) value->as_int;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.threshold"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->threshold = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.pretrigger"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->pretrigger = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.hang"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->hang = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.max_length"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->max_length = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.baud"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->baud = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.corr_threshold"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->corr_threshold = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "burst.preamble"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_STRING, return SU_FALSE);
+
+  SU_TRYCATCH(
+      strlen(value->as_string) <= SUSCAN_INSPECTOR_BURST_MAX_PREAMBLE,
+      return SU_FALSE);
+
+  strcpy(params->preamble, value->as_string);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_burst_params_save(
+    const struct suscan_inspector_burst_params *params,
+    suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_config_set_integer(
+          config,
+          "burst.trigger",
+          params->trigger),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.threshold",
+          params->threshold),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.pretrigger",
+          params->pretrigger),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.hang",
+          params->hang),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.max_length",
+          params->max_length),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.baud",
+          params->baud),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "burst.corr_threshold",
+          params->corr_threshold),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_string(
+          config,
+          "burst.preamble",
+          params->preamble),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/**************************** Sync word config ******************************/
+SUBOOL
+suscan_config_desc_add_syncword_params(suscan_config_desc_t *desc)
+{
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_STRING,
+          SU_TRUE,
+          "syncword.templates",
+          "Templates (comma-separated symbols)"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_INTEGER,
+          SU_TRUE,
+          "syncword.bits_per_symbol",
+          "Bits per symbol"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "syncword.baud",
+          "Baud rate"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "syncword.threshold",
+          "Detection threshold"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_desc_add_field(
+          desc,
+          SUSCAN_FIELD_TYPE_FLOAT,
+          SU_TRUE,
+          "syncword.freq_span",
+          "Frequency search span"),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_syncword_params_parse(
+    struct suscan_inspector_syncword_params *params,
+    const suscan_config_t *config)
+{
+  struct suscan_field_value *value;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "syncword.templates"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_STRING, return SU_FALSE);
+
+  SU_TRYCATCH(
+      strlen(value->as_string) <= SUSCAN_INSPECTOR_SYNCWORD_MAX_TEMPLATE_CHARS,
+      return SU_FALSE);
+
+  strcpy(params->templates, value->as_string);
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "syncword.bits_per_symbol"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_INTEGER, return SU_FALSE);
+
+  params->bits_per_symbol = value->as_int;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "syncword.baud"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->baud = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "syncword.threshold"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->threshold = value->as_float;
+
+  SU_TRYCATCH(
+      value = suscan_config_get_value(
+          config,
+          "syncword.freq_span"),
+      return SU_FALSE);
+
+  SU_TRYCATCH(value->field->type == SUSCAN_FIELD_TYPE_FLOAT, return SU_FALSE);
+
+  params->freq_span = value->as_float;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_inspector_syncword_params_save(
+    const struct suscan_inspector_syncword_params *params,
+    suscan_config_t *config)
+{
+  SU_TRYCATCH(
+      suscan_config_set_string(
+          config,
+          "syncword.templates",
+          params->templates),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_integer(
+          config,
+          "syncword.bits_per_symbol",
+          params->bits_per_symbol),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "syncword.baud",
+          params->baud),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "syncword.threshold",
+          params->threshold),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      suscan_config_set_float(
+          config,
+          "syncword.freq_span",
+          params->freq_span),
+      return SU_FALSE);
+
+  return SU_TRUE;
+}
@@ -129,6 +129,21 @@ SUBOOL suscan_inspector_br_params_save(
     const struct suscan_inspector_br_params *params,
     suscan_config_t *config);
 
+/**************************** Soft symbols ***********************************/
+struct suscan_inspector_soft_params {
+  SUBOOL       soft_enabled; /* Send soft symbols instead of samples */
+  unsigned int soft_bits;    /* Bits per symbol, if not set by the carrier */
+  SUFLOAT      soft_scale;   /* Quantization steps per LLR unit */
+};
+
+SUBOOL suscan_config_desc_add_soft_params(suscan_config_desc_t *desc);
+SUBOOL suscan_inspector_soft_params_parse(
+    struct suscan_inspector_soft_params *params,
+    const suscan_config_t *config);
+SUBOOL suscan_inspector_soft_params_save(
+    const struct suscan_inspector_soft_params *params,
+    suscan_config_t *config);
+
 /****************************** FSK config ***********************************/
 struct suscan_inspector_fsk_params {
   unsigned int bits_per_tone; /* Bits per symbol (dummy) */
@@ -184,4 +199,65 @@ SUBOOL suscan_inspector_audio_params_save(
     const struct suscan_inspector_audio_params *params,
     suscan_config_t *config);
 
+/*************************** Multichannel config *****************************/
+struct suscan_inspector_multiaudio_params {
+  unsigned int channels; /* Number of channels */
+  SUFLOAT spacing;       /* Requested channel spacing (Hz) */
+  SUFLOAT squelch;       /* Squelch level (dB) */
+};
+
+SUBOOL suscan_config_desc_add_multiaudio_params(suscan_config_desc_t *desc);
+SUBOOL suscan_inspector_multiaudio_params_parse(
+    struct suscan_inspector_multiaudio_params *params,
+    const suscan_config_t *config);
+SUBOOL suscan_inspector_multiaudio_params_save(
+    const struct suscan_inspector_multiaudio_params *params,
+    suscan_config_t *config);
+
+/****************************** Burst config *********************************/
+#define SUSCAN_INSPECTOR_BURST_MAX_PREAMBLE 256
+
+enum suscan_inspector_burst_trigger {
+  SUSCAN_INSPECTOR_BURST_TRIGGER_ENERGY,
+  SUSCAN_INSPECTOR_BURST_TRIGGER_PREAMBLE
+};
+
+struct suscan_inspector_burst_params {
+  enum suscan_inspector_burst_trigger trigger;
+  SUFLOAT threshold;      /* Energy over noise floor (dB) */
+  SUFLOAT pretrigger;     /* Samples kept before the trigger (s) */
+  SUFLOAT hang;           /* Time below threshold ending a burst (s) */
+  SUFLOAT max_length;     /* Longest burst (s) */
+  SUFLOAT baud;           /* Preamble symbol rate */
+  SUFLOAT corr_threshold; /* Normalized preamble correlation (0-1) */
+  char    preamble[SUSCAN_INSPECTOR_BURST_MAX_PREAMBLE + 1]; /* BPSK, 0/1 */
+};
+
+SUBOOL suscan_config_desc_add_burst_params(suscan_config_desc_t *desc);
+SUBOOL suscan_inspector_burst_params_parse(
+    struct suscan_inspector_burst_params *params,
+    const suscan_config_t *config);
+SUBOOL suscan_inspector_burst_params_save(
+    const struct suscan_inspector_burst_params *params,
+    suscan_config_t *config);
+
+/***************************** Sync word config ******************************/
+#define SUSCAN_INSPECTOR_SYNCWORD_MAX_TEMPLATE_CHARS 1024
+
+struct suscan_inspector_syncword_params {
+  char         templates[SUSCAN_INSPECTOR_SYNCWORD_MAX_TEMPLATE_CHARS + 1];
+  unsigned int bits_per_symbol; /* 1 to 3 (BPSK, QPSK, 8PSK) */
+  SUFLOAT      baud;
+  SUFLOAT      threshold;       /* Normalized correlation (0-1) */
+  SUFLOAT      freq_span;       /* Frequency search range, +/- (Hz) */
+};
+
+SUBOOL suscan_config_desc_add_syncword_params(suscan_config_desc_t *desc);
+SUBOOL suscan_inspector_syncword_params_parse(
+    struct suscan_inspector_syncword_params *params,
+    const suscan_config_t *config);
+SUBOOL suscan_inspector_syncword_params_save(
+    const struct suscan_inspector_syncword_params *params,
+    suscan_config_t *config);
+
 #endif /* _INSPECTOR_PARAMS_H */
@@ -0,0 +1,166 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+#include <pthread.h>
+
+#define SU_LOG_DOMAIN "inspector-pipeline"
+
+#include <sigutils/sigutils.h>
+
+#ifdef HAVE_VOLK
+#  include <volk/volk.h>
+#endif /* HAVE_VOLK */
+
+#include "inspector/pipeline.h"
+
+/*
+ * VOLK kernels are only available for single precision samples. Double
+ * precision builds fall back to plain loops, which the compiler is still
+ * able to vectorize.
+ */
+#if defined(HAVE_VOLK) && defined(_SU_SINGLE_PRECISION)
+#  define SUSCAN_PIPELINE_USE_VOLK
+#endif
+
+SUPRIVATE pthread_mutex_t fftw_plan_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+suscan_inspector_fftw_lock(void)
+{
+  (void) pthread_mutex_lock(&fftw_plan_mutex);
+}
+
+void
+suscan_inspector_fftw_unlock(void)
+{
+  (void) pthread_mutex_unlock(&fftw_plan_mutex);
+}
+
+void
+suscan_inspector_stage_stats_init(
+    struct suscan_inspector_stage_stats *stats,
+    const char * const *names,
+    unsigned int count)
+{
+  unsigned int i;
+
+  memset(stats, 0, count * sizeof(struct suscan_inspector_stage_stats));
+
+  for (i = 0; i < count; ++i)
+    stats[i].name = names[i];
+}
+
+void
+suscan_inspector_rotator_init(struct suscan_inspector_rotator *rot)
+{
+  rot->phasor = 1;
+  rot->step   = 1;
+  rot->since_renorm = 0;
+}
+
+void
+suscan_inspector_rotator_set_freq(
+    struct suscan_inspector_rotator *rot,
+    SUFLOAT fnor)
+{
+  /* Same convention as SU_C_CONJ(su_ncqo_read()) */
+  rot->step = SU_C_EXP(-I * PI * fnor);
+}
+
+void
+suscan_inspector_rotator_apply(
+    struct suscan_inspector_rotator *rot,
+    const SUCOMPLEX *x,
+    SUCOMPLEX *y,
+    SUSCOUNT len)
+{
+#ifdef SUSCAN_PIPELINE_USE_VOLK
+  volk_32fc_s32fc_x2_rotator_32fc(y, x, rot->step, &rot->phasor, len);
+#else
+  SUSCOUNT i;
+  SUCOMPLEX phasor = rot->phasor;
+  SUCOMPLEX step = rot->step;
+
+  for (i = 0; i < len; ++i) {
+    y[i] = x[i] * phasor;
+    phasor *= step;
+  }
+
+  rot->phasor = phasor;
+#endif /* SUSCAN_PIPELINE_USE_VOLK */
+
+  /* Keep the phasor in the unit circle */
+  rot->since_renorm += len;
+  if (rot->since_renorm >= SUSCAN_INSPECTOR_ROTATOR_RENORM_INTERVAL) {
+    rot->phasor /= SU_C_ABS(rot->phasor);
+    rot->since_renorm = 0;
+  }
+}
+
+void
+suscan_inspector_block_scale(SUCOMPLEX *y, SUCOMPLEX k, SUSCOUNT len)
+{
+#ifdef SUSCAN_PIPELINE_USE_VOLK
+  volk_32fc_s32fc_multiply_32fc(y, y, k, len);
+#else
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    y[i] *= k;
+#endif /* SUSCAN_PIPELINE_USE_VOLK */
+}
+
+SUCOMPLEX
+suscan_inspector_dot_real(const SUCOMPLEX *x, const SUFLOAT *h, SUSCOUNT len)
+{
+  SUCOMPLEX result = 0;
+#ifdef SUSCAN_PIPELINE_USE_VOLK
+  volk_32fc_32f_dot_prod_32fc(&result, x, h, len);
+#else
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    result += x[i] * h[i];
+#endif /* SUSCAN_PIPELINE_USE_VOLK */
+
+  return result;
+}
+
+void
+suscan_inspector_block_fm_demod(
+    const SUCOMPLEX *x,
+    SUCOMPLEX *last,
+    SUFLOAT *out,
+    SUSCOUNT len)
+{
+#ifdef SUSCAN_PIPELINE_USE_VOLK
+  volk_32fc_x2_multiply_conjugate_32fc(last, x, last, len);
+  volk_32fc_s32f_atan2_32f(out, last, PI, len);
+  memcpy(last, x, len * sizeof(SUCOMPLEX));
+#else
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i) {
+    out[i] = SU_C_ARG(x[i] * SU_C_CONJ(last[i])) / PI;
+    last[i] = x[i];
+  }
+#endif /* SUSCAN_PIPELINE_USE_VOLK */
+}
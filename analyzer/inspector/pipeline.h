@@ -0,0 +1,151 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_PIPELINE_H
+#define _INSPECTOR_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+#include <time.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/iir.h>
+
+/*
+ * Inspector demodulators process their input in blocks of at most
+ * SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE samples. Each stage runs over the
+ * whole block before the next one starts, so configuration-dependent
+ * decisions are taken once per block and stateless stages reduce to tight
+ * loops over contiguous buffers.
+ */
+#define SUSCAN_INSPECTOR_PIPELINE_BLOCK_SIZE 512
+
+/* Renormalize rotators after this many samples */
+#define SUSCAN_INSPECTOR_ROTATOR_RENORM_INTERVAL 512
+
+struct suscan_inspector_stage_stats {
+  const char *name;
+  SUSCOUNT    samples;  /* Samples that went through this stage */
+  SUSCOUNT    blocks;   /* Number of blocks processed */
+  uint64_t    nsec;     /* Only if built with SUSCAN_INSPECTOR_STAGE_PROFILING */
+};
+
+struct suscan_inspector_rotator {
+  SUCOMPLEX phasor;
+  SUCOMPLEX step;
+  SUSCOUNT  since_renorm;
+};
+
+/****************************** Stage stats **********************************/
+void suscan_inspector_stage_stats_init(
+    struct suscan_inspector_stage_stats *stats,
+    const char * const *names,
+    unsigned int count);
+
+SUINLINE void
+suscan_inspector_stage_enter(struct timespec *start)
+{
+#ifdef SUSCAN_INSPECTOR_STAGE_PROFILING
+  clock_gettime(CLOCK_MONOTONIC_RAW, start);
+#else
+  (void) start;
+#endif /* SUSCAN_INSPECTOR_STAGE_PROFILING */
+}
+
+SUINLINE void
+suscan_inspector_stage_leave(
+    struct suscan_inspector_stage_stats *stats,
+    const struct timespec *start,
+    SUSCOUNT samples)
+{
+#ifdef SUSCAN_INSPECTOR_STAGE_PROFILING
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+
+  stats->nsec +=
+      (end.tv_sec - start->tv_sec) * 1000000000ull
+      + end.tv_nsec - start->tv_nsec;
+#else
+  (void) start;
+#endif /* SUSCAN_INSPECTOR_STAGE_PROFILING */
+
+  stats->samples += samples;
+  ++stats->blocks;
+}
+
+/******************************** Rotator ************************************/
+/*
+ * Block replacement for su_ncqo_read: multiplies a buffer by the
+ * conjugate of a complex exponential of normalized frequency fnor.
+ */
+void suscan_inspector_rotator_init(struct suscan_inspector_rotator *rot);
+
+void suscan_inspector_rotator_set_freq(
+    struct suscan_inspector_rotator *rot,
+    SUFLOAT fnor);
+
+void suscan_inspector_rotator_apply(
+    struct suscan_inspector_rotator *rot,
+    const SUCOMPLEX *x,
+    SUCOMPLEX *y,
+    SUSCOUNT len);
+
+/***************************** Block helpers *********************************/
+void suscan_inspector_block_scale(SUCOMPLEX *y, SUCOMPLEX k, SUSCOUNT len);
+
+/*
+ * Quadrature discriminator over independent streams (e.g. one sample per
+ * channel): out[i] = arg(x[i] * conj(last[i])) / PI. Updates last.
+ */
+void suscan_inspector_block_fm_demod(
+    const SUCOMPLEX *x,
+    SUCOMPLEX *last,
+    SUFLOAT *out,
+    SUSCOUNT len);
+
+/*
+ * Inspector DSP objects may be created from worker threads, and the FFTW
+ * planner is not reentrant. Every plan creation and destruction in the
+ * analyzer, not only in inspectors, must be serialized through these.
+ */
+void suscan_inspector_fftw_lock(void);
+
+void suscan_inspector_fftw_unlock(void);
+
+/* Dot product of a complex buffer and real taps */
+SUCOMPLEX suscan_inspector_dot_real(
+    const SUCOMPLEX *x,
+    const SUFLOAT *h,
+    SUSCOUNT len);
+
+SUINLINE void
+suscan_inspector_block_iir_filt(su_iir_filt_t *filt, SUCOMPLEX *y, SUSCOUNT len)
+{
+  su_iir_filt_feed_bulk(filt, y, y, len);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_PIPELINE_H */
@@ -0,0 +1,247 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "resampler"
+
+#include <sigutils/sigutils.h>
+
+#include "inspector/resampler.h"
+#include "inspector/pipeline.h"
+
+/* Hamming-windowed sinc of cutoff fc (cycles per sample), t in samples */
+SUPRIVATE SUFLOAT
+suscan_resampler_lpf(SUFLOAT t, SUFLOAT fc, SUFLOAT width)
+{
+  SUFLOAT x = 2 * fc * t;
+  SUFLOAT w;
+
+  if (SU_ABS(t) >= .5 * width)
+    return 0;
+
+  w = .54 + .46 * SU_COS(2 * PI * t / width);
+
+  if (SU_ABS(x) < 1e-6)
+    return w;
+
+  return w * SU_SIN(PI * x) / (PI * x);
+}
+
+SUBOOL
+suscan_resampler_init(suscan_resampler_t *self, SUFLOAT fs, SUFLOAT fs_out)
+{
+  unsigned int p;
+  SUSCOUNT j;
+  SUFLOAT *branch;
+  SUFLOAT fc, delay, center, sum;
+
+  memset(self, 0, sizeof(suscan_resampler_t));
+
+  SU_TRYCATCH(fs > 0, goto fail);
+  SU_TRYCATCH(fs_out > 0, goto fail);
+
+  self->fs     = fs;
+  self->fs_out = fs_out;
+
+  /* Leave between 2 and 4 intermediate samples per output sample */
+  self->decimation = SU_FLOOR(fs / (2 * fs_out));
+  if (self->decimation < 1)
+    self->decimation = 1;
+
+  if (self->decimation > 1) {
+    self->dec_span = SUSCAN_RESAMPLER_DECIMATOR_SPAN * self->decimation + 1;
+
+    SU_TRYCATCH(
+        self->dec_taps = malloc(self->dec_span * sizeof(SUFLOAT)),
+        goto fail);
+
+    SU_TRYCATCH(
+        self->dec_history = calloc(2 * self->dec_span, sizeof(SUCOMPLEX)),
+        goto fail);
+
+    /*
+     * Cutoff at a quarter of the intermediate rate: this is above the
+     * output Nyquist frequency, and whatever folds back stays above it.
+     */
+    fc = .25 / self->decimation;
+    center = .5 * (self->dec_span - 1);
+    sum = 0;
+
+    for (j = 0; j < self->dec_span; ++j) {
+      self->dec_taps[j] = suscan_resampler_lpf(
+          j - center,
+          fc,
+          self->dec_span);
+      sum += self->dec_taps[j];
+    }
+
+    for (j = 0; j < self->dec_span; ++j)
+      self->dec_taps[j] /= sum;
+  }
+
+  self->step = suscan_resampler_get_mid_rate(self) / fs_out;
+
+  /* Band limit to the lowest Nyquist frequency, with some margin */
+  fc = .45 * (self->step > 1 ? 1 / self->step : 1);
+  self->span = SU_CEIL(SUSCAN_RESAMPLER_ZERO_CROSSINGS / fc);
+
+  SU_TRYCATCH(
+      self->taps = malloc(SUSCAN_RESAMPLER_PHASES * self->span * sizeof(SUFLOAT)),
+      goto fail);
+
+  SU_TRYCATCH(
+      self->history = calloc(2 * self->span, sizeof(SUCOMPLEX)),
+      goto fail);
+
+  center = .5 * (self->span - 1);
+
+  /*
+   * Branch p evaluates the filter at p / PHASES samples before the most
+   * recent sample. As in the matched filter sampler, taps are stored
+   * time-reversed and every branch has unity DC gain.
+   */
+  for (p = 0; p < SUSCAN_RESAMPLER_PHASES; ++p) {
+    branch = self->taps + p * self->span;
+    delay = (SUFLOAT) p / SUSCAN_RESAMPLER_PHASES;
+    sum = 0;
+
+    for (j = 0; j < self->span; ++j) {
+      branch[j] = suscan_resampler_lpf(
+          self->span - 1 - j - delay - center,
+          fc,
+          self->span);
+      sum += branch[j];
+    }
+
+    if (SU_ABS(sum) > 0)
+      for (j = 0; j < self->span; ++j)
+        branch[j] /= sum;
+  }
+
+  return SU_TRUE;
+
+fail:
+  suscan_resampler_finalize(self);
+
+  return SU_FALSE;
+}
+
+SUSCOUNT
+suscan_resampler_decimate(
+    suscan_resampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y)
+{
+  SUSCOUNT i;
+  SUSCOUNT n = 0;
+  SUSCOUNT span = self->dec_span;
+  SUSCOUNT ptr = self->dec_ptr;
+  SUSCOUNT count = self->dec_count;
+
+  if (self->decimation == 1) {
+    if (y != x)
+      memcpy(y, x, len * sizeof(SUCOMPLEX));
+    return len;
+  }
+
+  for (i = 0; i < len; ++i) {
+    self->dec_history[ptr] = self->dec_history[ptr + span] = x[i];
+    if (++ptr == span)
+      ptr = 0;
+
+    /* Taps are symmetric: no need to reverse them */
+    if (++count == self->decimation) {
+      count = 0;
+      y[n++] = suscan_inspector_dot_real(
+          self->dec_history + ptr,
+          self->dec_taps,
+          span);
+    }
+  }
+
+  self->dec_ptr   = ptr;
+  self->dec_count = count;
+
+  return n;
+}
+
+SUSCOUNT
+suscan_resampler_interpolate(
+    suscan_resampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y)
+{
+  SUSCOUNT i;
+  SUSCOUNT n = 0;
+  SUSCOUNT span = self->span;
+  SUSCOUNT ptr = self->ptr;
+  SUFLOAT phase = self->phase;
+  SUFLOAT step = self->step;
+  unsigned int p;
+
+  for (i = 0; i < len; ++i) {
+    self->history[ptr] = self->history[ptr + span] = x[i];
+    if (++ptr == span)
+      ptr = 0;
+
+    /* Emit every output instant that falls before this sample */
+    phase += 1;
+    while (phase >= step) {
+      phase -= step;
+
+      p = (unsigned int) (phase * SUSCAN_RESAMPLER_PHASES + .5);
+      if (p >= SUSCAN_RESAMPLER_PHASES)
+        p = SUSCAN_RESAMPLER_PHASES - 1;
+
+      y[n++] = suscan_inspector_dot_real(
+          self->history + ptr,
+          self->taps + p * span,
+          span);
+    }
+  }
+
+  self->ptr   = ptr;
+  self->phase = phase;
+
+  return n;
+}
+
+void
+suscan_resampler_finalize(suscan_resampler_t *self)
+{
+  if (self->dec_taps != NULL)
+    free(self->dec_taps);
+
+  if (self->dec_history != NULL)
+    free(self->dec_history);
+
+  if (self->taps != NULL)
+    free(self->taps);
+
+  if (self->history != NULL)
+    free(self->history);
+
+  memset(self, 0, sizeof(suscan_resampler_t));
+  self->decimation = 1;
+}
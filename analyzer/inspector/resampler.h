@@ -0,0 +1,128 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _INSPECTOR_RESAMPLER_H
+#define _INSPECTOR_RESAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <sigutils/sigutils.h>
+
+#define SUSCAN_RESAMPLER_PHASES         32
+#define SUSCAN_RESAMPLER_DECIMATOR_SPAN 8  /* Taps per decimation step */
+#define SUSCAN_RESAMPLER_ZERO_CROSSINGS 8  /* Sinc lobes per side */
+
+/*
+ * Rational resampler in two stages. The input is first reduced by an
+ * integer factor with a FIR anti-alias filter, evaluated only once per
+ * output sample, so that the intermediate rate lies between two and four
+ * times the output rate. The remaining fractional ratio is covered by a
+ * polyphase interpolator, using the branch whose delay is closest to each
+ * output instant. Both stages may be fed separately, so that additional
+ * processing can take place at the intermediate rate.
+ */
+struct suscan_resampler {
+  SUFLOAT      fs;            /* Input rate */
+  SUFLOAT      fs_out;        /* Output rate */
+
+  /* Decimator */
+  SUSCOUNT     decimation;
+  SUSCOUNT     dec_span;
+  SUFLOAT     *dec_taps;
+  SUCOMPLEX   *dec_history;   /* Doubled history buffer */
+  SUSCOUNT     dec_ptr;
+  SUSCOUNT     dec_count;     /* Samples since last output */
+
+  /* Fractional interpolator */
+  SUFLOAT      step;          /* Intermediate samples per output sample */
+  SUFLOAT      phase;         /* Intermediate samples since last output */
+  SUSCOUNT     span;          /* Taps per branch */
+  SUFLOAT     *taps;          /* Time-reversed branches, one after another */
+  SUCOMPLEX   *history;       /* Doubled history buffer */
+  SUSCOUNT     ptr;
+};
+
+typedef struct suscan_resampler suscan_resampler_t;
+
+#define suscan_resampler_INITIALIZER                    \
+{                                                       \
+  0, 0,                                                 \
+  1, 0, NULL, NULL, 0, 0,                               \
+  0, 0, 0, NULL, NULL, 0                                \
+}
+
+SUINLINE SUBOOL
+suscan_resampler_is_ready(const suscan_resampler_t *self)
+{
+  return self->taps != NULL;
+}
+
+/* Sample rate seen between the decimator and the interpolator */
+SUINLINE SUFLOAT
+suscan_resampler_get_mid_rate(const suscan_resampler_t *self)
+{
+  return self->fs / self->decimation;
+}
+
+/* Input samples that produce at most max_out output samples */
+SUINLINE SUSCOUNT
+suscan_resampler_get_max_input(const suscan_resampler_t *self, SUSCOUNT max_out)
+{
+  SUFLOAT mid;
+
+  if (max_out < 2)
+    return 0;
+
+  /* len inputs give at most len / D + 1 intermediate samples */
+  mid = (max_out - 1) * self->step - 1;
+  if (mid < 1)
+    return 0;
+
+  return (SUSCOUNT) mid * self->decimation;
+}
+
+SUBOOL suscan_resampler_init(
+    suscan_resampler_t *self,
+    SUFLOAT fs,
+    SUFLOAT fs_out);
+
+/* Returns the number of samples written to y. y may alias x. */
+SUSCOUNT suscan_resampler_decimate(
+    suscan_resampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y);
+
+/* Returns the number of samples written to y. y must not alias x. */
+SUSCOUNT suscan_resampler_interpolate(
+    suscan_resampler_t *self,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y);
+
+void suscan_resampler_finalize(suscan_resampler_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _INSPECTOR_RESAMPLER_H */
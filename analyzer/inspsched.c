@@ -40,25 +40,41 @@ suscan_inpsched_task_cb(
   unsigned int i;
 
   /*
-   * We just process the incoming data. If we broke something,
-   * mark the inspector as halted.
+   * Idle channels skip demodulation and estimation altogether. The
+   * spectrum is still computed, so the channel can be monitored.
    */
-  SU_TRYCATCH(
-      suscan_inspector_sampler_loop(
-          task_info->inspector,
-          task_info->data,
-          task_info->size,
-          sched->analyzer->mq_out),
-      goto fail);
-
-  /* Feed all enabled estimators */
-  SU_TRYCATCH(
-      suscan_inspector_estimator_loop(
-          task_info->inspector,
-          task_info->data,
-          task_info->size,
-          sched->analyzer->mq_out),
-      goto fail);
+  if (suscan_inspector_update_activity(
+      task_info->inspector,
+      task_info->data,
+      task_info->size)) {
+    /*
+     * We just process the incoming data. If we broke something,
+     * mark the inspector as halted.
+     */
+    SU_TRYCATCH(
+        suscan_inspector_sampler_loop(
+            task_info->inspector,
+            task_info->data,
+            task_info->size,
+            sched->analyzer->mq_out),
+        goto fail);
+
+    /* Feed all enabled estimators */
+    SU_TRYCATCH(
+        suscan_inspector_estimator_loop(
+            task_info->inspector,
+            task_info->data,
+            task_info->size,
+            sched->analyzer->mq_out),
+        goto fail);
+  } else {
+    /* Do not hold buffered output or configuration changes back */
+    SU_TRYCATCH(
+        suscan_inspector_dormant_loop(
+            task_info->inspector,
+            sched->analyzer->mq_out),
+        goto fail);
+  }
 
   /* Feed spectrum */
   SU_TRYCATCH(
@@ -184,6 +200,28 @@ suscan_inspsched_queue_task(
   return SU_TRUE;
 }
 
+SUBOOL
+suscan_inspsched_queue_job(
+    suscan_inspsched_t *sched,
+    SUBOOL (*func) (
+        struct suscan_mq *mq_out,
+        void *wk_private,
+        void *cb_private),
+    void *privdata)
+{
+  SU_TRYCATCH(
+      suscan_worker_push(
+          sched->worker_list[sched->last_worker],
+          func,
+          privdata),
+      return SU_FALSE);
+
+  if (++sched->last_worker == sched->worker_count)
+    sched->last_worker = 0;
+
+  return SU_TRUE;
+}
+
 SUBOOL
 suscan_inspsched_sync(suscan_inspsched_t *sched)
 {
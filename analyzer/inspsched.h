@@ -83,6 +83,15 @@ SUBOOL suscan_inspsched_queue_task(
     suscan_inspsched_t *sched,
     struct suscan_inspector_task_info *task_info);
 
+/* Queues an arbitrary job, to be waited for with suscan_inspsched_sync */
+SUBOOL suscan_inspsched_queue_job(
+    suscan_inspsched_t *sched,
+    SUBOOL (*func) (
+        struct suscan_mq *mq_out,
+        void *wk_private,
+        void *cb_private),
+    void *privdata);
+
 SUBOOL suscan_inspsched_sync(suscan_inspsched_t *sched);
 
 suscan_inspsched_t *suscan_inspsched_new(struct suscan_analyzer *analyzer);
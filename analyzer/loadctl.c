@@ -0,0 +1,74 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "load-controller"
+
+#include "loadctl.h"
+
+void
+suscan_load_controller_init(suscan_load_controller_t *self, SUFLOAT budget)
+{
+  memset(self, 0, sizeof(suscan_load_controller_t));
+
+  self->budget = budget;
+}
+
+void
+suscan_load_controller_set_budget(
+    suscan_load_controller_t *self,
+    SUFLOAT budget)
+{
+  self->budget = budget;
+  self->relax  = 0;
+}
+
+SUBOOL
+suscan_load_controller_update(
+    suscan_load_controller_t *self,
+    SUFLOAT cpu,
+    SUSCOUNT overflows)
+{
+  unsigned int level = self->level;
+  SUBOOL lost = overflows != self->overflows;
+
+  self->overflows = overflows;
+
+  if (self->budget <= 0) {
+    /* Disabled: back to full quality */
+    self->level = 0;
+    self->relax = 0;
+  } else if (lost || cpu > self->budget) {
+    if (self->level < SUSCAN_LOAD_CONTROLLER_MAX_LEVEL)
+      ++self->level;
+    self->relax = 0;
+  } else if (cpu < SUSCAN_LOAD_CONTROLLER_RELAX_RATIO * self->budget) {
+    if (self->level > 0
+        && ++self->relax >= SUSCAN_LOAD_CONTROLLER_RELAX_COUNT) {
+      --self->level;
+      self->relax = 0;
+    }
+  } else {
+    self->relax = 0;
+  }
+
+  return level != self->level;
+}
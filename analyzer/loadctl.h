@@ -0,0 +1,93 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _LOADCTL_H
+#define _LOADCTL_H
+
+#include <sigutils/sigutils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_LOAD_CONTROLLER_INTERVAL    1.  /* Seconds between decisions */
+#define SUSCAN_LOAD_CONTROLLER_MAX_LEVEL   8
+#define SUSCAN_LOAD_CONTROLLER_RELAX_RATIO .6  /* Relative to the budget */
+#define SUSCAN_LOAD_CONTROLLER_RELAX_COUNT 5   /* Intervals before relaxing */
+
+/*
+ * Load controller. Degrades the main spectrum when the source worker
+ * exceeds its CPU budget or the device starts losing samples, and restores
+ * it gradually once the load stays low. Every level alternately doubles
+ * the PSD update interval or the detector stride (the detector keeps one
+ * whole FFT window out of every `stride').
+ */
+struct suscan_load_controller {
+  SUFLOAT      budget;    /* Fraction of real time, 0 disables it */
+  unsigned int level;
+  unsigned int relax;     /* Consecutive intervals below the threshold */
+  SUSCOUNT     overflows; /* Last known overflow count */
+};
+
+typedef struct suscan_load_controller suscan_load_controller_t;
+
+SUINLINE unsigned int
+suscan_load_controller_get_level(const suscan_load_controller_t *self)
+{
+  return self->level;
+}
+
+SUINLINE SUFLOAT
+suscan_load_controller_get_psd_factor(const suscan_load_controller_t *self)
+{
+  return 1 << ((self->level + 1) / 2);
+}
+
+SUINLINE SUSCOUNT
+suscan_load_controller_get_stride(const suscan_load_controller_t *self)
+{
+  return 1 << (self->level / 2);
+}
+
+SUINLINE SUBOOL
+suscan_load_controller_is_active(const suscan_load_controller_t *self)
+{
+  return self->budget > 0 || self->level > 0;
+}
+
+void suscan_load_controller_init(
+    suscan_load_controller_t *self,
+    SUFLOAT budget);
+
+void suscan_load_controller_set_budget(
+    suscan_load_controller_t *self,
+    SUFLOAT budget);
+
+/* Returns SU_TRUE if the level has changed */
+SUBOOL suscan_load_controller_update(
+    suscan_load_controller_t *self,
+    SUFLOAT cpu,
+    SUSCOUNT overflows);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _LOADCTL_H */
@@ -118,7 +118,7 @@ suscan_analyzer_channel_msg_new(
   new->source = analyzer->source;
   new->sender = analyzer;
 
-  fc = (suscan_source_get_config(analyzer->source))->freq;
+  fc = suscan_analyzer_get_center_freq(analyzer);
 
   for (i = 0; i < len; ++i)
     if (list[i] != NULL)
@@ -144,6 +144,50 @@ fail:
   return NULL;
 }
 
+void
+suscan_analyzer_channel_delta_msg_destroy(
+    struct suscan_analyzer_channel_delta_msg *msg)
+{
+  if (msg->delta_list != NULL)
+    free(msg->delta_list);
+
+  free(msg);
+}
+
+struct suscan_analyzer_channel_delta_msg *
+suscan_analyzer_channel_delta_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const struct suscan_channel_delta *list,
+    unsigned int count,
+    SUBOOL snapshot)
+{
+  struct suscan_analyzer_channel_delta_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_channel_delta_msg)),
+      goto fail);
+
+  if (count > 0) {
+    SU_TRYCATCH(
+        new->delta_list = malloc(count * sizeof(struct suscan_channel_delta)),
+        goto fail);
+    memcpy(new->delta_list, list, count * sizeof(struct suscan_channel_delta));
+  }
+
+  new->delta_count = count;
+  new->snapshot    = snapshot;
+  new->source      = analyzer->source;
+  new->sender      = analyzer;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_channel_delta_msg_destroy(new);
+
+  return NULL;
+}
+
 struct suscan_analyzer_inspector_msg *
 suscan_analyzer_inspector_msg_new(
     enum suscan_analyzer_inspector_msgkind kind,
@@ -202,14 +246,49 @@ suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg)
   if (msg->psd_data != NULL)
     free(msg->psd_data);
 
+  if (msg->psd_min != NULL)
+    free(msg->psd_min);
+
+  if (msg->psd_max != NULL)
+    free(msg->psd_max);
+
   free(msg);
 }
 
+/* Computes the detector PSD, rotated `shift' bins to the right */
+SUPRIVATE void
+suscan_analyzer_psd_compute(
+    const su_channel_detector_t *cd,
+    SUFLOAT *psd,
+    SUSCOUNT shift)
+{
+  unsigned int i;
+  SUSCOUNT j = shift % cd->params.window_size;
+
+  switch (cd->params.mode) {
+    case SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION:
+      for (i = 0; i < cd->params.window_size; ++i) {
+        psd[j] = SU_C_REAL(cd->fft[i]);
+        if (++j == cd->params.window_size)
+          j = 0;
+      }
+      break;
+
+    default:
+      for (i = 0; i < cd->params.window_size; ++i) {
+        psd[j] = SU_C_REAL(cd->fft[i] * SU_C_CONJ(cd->fft[i]));
+        psd[j] /= cd->params.window_size;
+        if (++j == cd->params.window_size)
+          j = 0;
+      }
+  }
+}
+
 struct suscan_analyzer_psd_msg *
 suscan_analyzer_psd_msg_new(const su_channel_detector_t *cd)
 {
   struct suscan_analyzer_psd_msg *new = NULL;
-  unsigned int i;
+
   SU_TRYCATCH(
       new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
       goto fail);
@@ -226,19 +305,164 @@ suscan_analyzer_psd_msg_new(const su_channel_detector_t *cd)
       new->psd_data = malloc(sizeof(SUFLOAT) * new->psd_size),
       goto fail);
 
-  switch (cd->params.mode) {
-    case SU_CHANNEL_DETECTOR_MODE_AUTOCORRELATION:
-      for (i = 0; i < new->psd_size; ++i)
-        new->psd_data[i] = SU_C_REAL(cd->fft[i]);
-      break;
+  suscan_analyzer_psd_compute(cd, new->psd_data, 0);
 
-    default:
-      for (i = 0; i < new->psd_size; ++i) {
-        new->psd_data[i] = SU_C_REAL(cd->fft[i] * SU_C_CONJ(cd->fft[i]));
-        new->psd_data[i] /= cd->params.window_size;;
-      }
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_psd_msg_destroy(new);
+
+  return NULL;
+}
+
+/* Same as above, for the parallel PSD */
+SUPRIVATE void
+suscan_analyzer_parallel_psd_compute(
+    const suscan_parallel_psd_t *parpsd,
+    SUFLOAT *psd,
+    SUSCOUNT shift)
+{
+  const SUFLOAT *data = suscan_parallel_psd_get_psd(parpsd);
+  SUSCOUNT size = suscan_parallel_psd_get_size(parpsd);
+
+  shift %= size;
+
+  memcpy(psd + shift, data, (size - shift) * sizeof(SUFLOAT));
+  memcpy(psd, data + size - shift, shift * sizeof(SUFLOAT));
+}
+
+SUPRIVATE struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new_parallel(
+    const suscan_parallel_psd_t *parpsd,
+    const su_channel_detector_t *cd)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
+      goto fail);
+
+  new->psd_size = suscan_parallel_psd_get_size(parpsd);
+  new->samp_rate = cd->params.samp_rate;
+
+  if (cd->params.decimation > 1)
+    new->samp_rate /= cd->params.decimation;
+
+  SU_TRYCATCH(
+      new->psd_data = malloc(sizeof(SUFLOAT) * new->psd_size),
+      goto fail);
+
+  suscan_analyzer_parallel_psd_compute(parpsd, new->psd_data, 0);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_psd_msg_destroy(new);
+
+  return NULL;
+}
+
+/* Loads the current PSD in ascending frequency order into the pyramid */
+SUPRIVATE SUBOOL
+suscan_analyzer_load_psd_pyramid(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector)
+{
+  SUSCOUNT size = self->parpsd != NULL
+      ? suscan_parallel_psd_get_size(self->parpsd)
+      : detector->params.window_size;
+
+  if (self->psd_pyramid != NULL
+      && suscan_psd_pyramid_get_size(self->psd_pyramid) != size) {
+    suscan_psd_pyramid_destroy(self->psd_pyramid);
+    self->psd_pyramid = NULL;
+  }
+
+  if (self->psd_pyramid == NULL)
+    SU_TRYCATCH(
+        self->psd_pyramid = suscan_psd_pyramid_new(size),
+        return SU_FALSE);
+
+  if (self->parpsd != NULL)
+    suscan_analyzer_parallel_psd_compute(
+        self->parpsd,
+        suscan_psd_pyramid_get_base(self->psd_pyramid),
+        size / 2);
+  else
+    suscan_analyzer_psd_compute(
+        detector,
+        suscan_psd_pyramid_get_base(self->psd_pyramid),
+        size / 2);
+
+  suscan_psd_pyramid_build(self->psd_pyramid);
+
+  return SU_TRUE;
+}
+
+/*
+ * Decimated PSD message from a pyramid spanning `fs' Hz around the center
+ * frequency. The subscription span is relative to the center frequency.
+ */
+SUPRIVATE struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new_from_pyramid(
+    suscan_psd_pyramid_t *pyr,
+    SUFLOAT fs,
+    SUSCOUNT bins,
+    const struct suscan_analyzer_psd_subscription *sub)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+  SUSCOUNT size = suscan_psd_pyramid_get_size(pyr);
+  SUSCOUNT half = size / 2;
+  SUSDIFF first, last;
+
+  SU_TRYCATCH(bins > 0, goto fail);
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_psd_msg)),
+      goto fail);
+
+  new->samp_rate = fs;
+  new->decimated = SU_TRUE;
+
+  if (sub->f_lo < sub->f_hi) {
+    first = (SUSDIFF) SU_FLOOR(sub->f_lo * size / fs) + half;
+    last  = (SUSDIFF) SU_CEIL(sub->f_hi * size / fs) + half;
+
+    if (first < 0)
+      first = 0;
+    if (last > (SUSDIFF) size)
+      last = size;
+
+    SU_TRYCATCH(first < last, goto fail);
+  } else {
+    first = 0;
+    last  = size;
   }
 
+  new->f_lo = (first - (SUSDIFF) half) * fs / size;
+  new->f_hi = (last  - (SUSDIFF) half) * fs / size;
+
+  SU_TRYCATCH(
+      new->psd_data = malloc(sizeof(SUFLOAT) * bins),
+      goto fail);
+  SU_TRYCATCH(
+      new->psd_min = malloc(sizeof(SUFLOAT) * bins),
+      goto fail);
+  SU_TRYCATCH(
+      new->psd_max = malloc(sizeof(SUFLOAT) * bins),
+      goto fail);
+
+  new->psd_size = suscan_psd_pyramid_query(
+      pyr,
+      first,
+      last,
+      bins,
+      new->psd_min,
+      new->psd_data,
+      new->psd_max);
+
   return new;
 
 fail:
@@ -248,6 +472,45 @@ fail:
   return NULL;
 }
 
+struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new_decimated(
+    suscan_psd_pyramid_t *pyr,
+    const su_channel_detector_t *cd,
+    const struct suscan_analyzer_psd_subscription *sub)
+{
+  SUFLOAT fs;
+
+  SU_TRYCATCH(
+      suscan_psd_pyramid_get_size(pyr) == cd->params.window_size,
+      return NULL);
+
+  fs = cd->params.samp_rate;
+  if (cd->params.decimation > 1)
+    fs /= cd->params.decimation;
+
+  return suscan_analyzer_psd_msg_new_from_pyramid(pyr, fs, sub->bins, sub);
+}
+
+struct suscan_analyzer_psd_msg *
+suscan_analyzer_psd_msg_new_panorama(
+    suscan_panorama_t *panorama,
+    const struct suscan_analyzer_psd_subscription *sub)
+{
+  struct suscan_analyzer_psd_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = suscan_analyzer_psd_msg_new_from_pyramid(
+          suscan_panorama_get_pyramid(panorama),
+          suscan_panorama_get_span(panorama),
+          sub->bins > 0 ? sub->bins : suscan_panorama_get_size(panorama),
+          sub),
+      return NULL);
+
+  new->fc = suscan_panorama_get_center(panorama);
+
+  return new;
+}
+
 SUFLOAT *
 suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg)
 {
@@ -298,12 +561,114 @@ suscan_analyzer_sample_batch_msg_destroy(
   free(msg);
 }
 
+struct suscan_analyzer_soft_symbol_msg *
+suscan_analyzer_soft_symbol_msg_new(
+    uint32_t inspector_id,
+    const int8_t *values,
+    unsigned int bits_per_symbol,
+    SUSCOUNT count)
+{
+  struct suscan_analyzer_soft_symbol_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_soft_symbol_msg)),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->values = malloc(count * bits_per_symbol),
+      goto fail);
+
+  memcpy(new->values, values, count * bits_per_symbol);
+
+  new->symbol_count    = count;
+  new->bits_per_symbol = bits_per_symbol;
+  new->inspector_id    = inspector_id;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_soft_symbol_msg_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_analyzer_soft_symbol_msg_destroy(
+    struct suscan_analyzer_soft_symbol_msg *msg)
+{
+  if (msg->values != NULL)
+    free(msg->values);
+
+  free(msg);
+}
+
+struct suscan_analyzer_burst_msg *
+suscan_analyzer_burst_msg_new(
+    uint32_t inspector_id,
+    struct suscan_inspector_burst *burst)
+{
+  struct suscan_analyzer_burst_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_burst_msg)),
+      return NULL);
+
+  new->inspector_id = inspector_id;
+  new->power        = burst->power;
+  new->noise        = burst->noise;
+  new->pretrigger   = burst->pretrigger;
+  new->samples      = burst->samples;
+  new->sample_count = burst->count;
+
+  burst->samples = NULL;
+
+  return new;
+}
+
+void
+suscan_analyzer_burst_msg_destroy(struct suscan_analyzer_burst_msg *msg)
+{
+  if (msg->samples != NULL)
+    free(msg->samples);
+
+  free(msg);
+}
+
+struct suscan_analyzer_detection_msg *
+suscan_analyzer_detection_msg_new(
+    uint32_t inspector_id,
+    const struct suscan_inspector_detection *detection)
+{
+  struct suscan_analyzer_detection_msg *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_detection_msg)),
+      return NULL);
+
+  new->inspector_id = inspector_id;
+  new->template_id  = detection->template_id;
+  new->position     = detection->position;
+  new->freq_offset  = detection->freq_offset;
+  new->peak         = detection->peak;
+
+  return new;
+}
+
+void
+suscan_analyzer_detection_msg_destroy(
+    struct suscan_analyzer_detection_msg *msg)
+{
+  free(msg);
+}
+
 void
 suscan_analyzer_dispose_message(uint32_t type, void *ptr)
 {
   switch (type) {
     case SUSCAN_ANALYZER_MESSAGE_TYPE_SOURCE_INIT:
     case SUSCAN_ANALYZER_MESSAGE_TYPE_EOS:
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_LOAD_CONTROL:
       suscan_analyzer_status_msg_destroy(ptr);
       break;
 
@@ -311,6 +676,10 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
       suscan_analyzer_channel_msg_destroy(ptr);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA:
+      suscan_analyzer_channel_delta_msg_destroy(ptr);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_INSPECTOR:
       suscan_analyzer_inspector_msg_destroy(ptr);
       break;
@@ -323,6 +692,18 @@ suscan_analyzer_dispose_message(uint32_t type, void *ptr)
       suscan_analyzer_sample_batch_msg_destroy(ptr);
       break;
 
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_BURST:
+      suscan_analyzer_burst_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_DETECTION:
+      suscan_analyzer_detection_msg_destroy(ptr);
+      break;
+
+    case SUSCAN_ANALYZER_MESSAGE_TYPE_SOFT_SYMBOLS:
+      suscan_analyzer_soft_symbol_msg_destroy(ptr);
+      break;
+
     case SUSCAN_ANALYZER_MESSAGE_TYPE_THROTTLE:
       free(ptr);
       break;
@@ -369,6 +750,74 @@ done:
   return ok;
 }
 
+SUPRIVATE SUBOOL
+suscan_analyzer_send_detector_channel_delta(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector)
+{
+  struct suscan_analyzer_channel_delta_msg *msg = NULL;
+  const struct suscan_channel_delta *delta_list;
+  struct sigutils_channel **ch_list;
+  unsigned int ch_count, delta_count;
+  SUBOOL snapshot;
+  SUBOOL ok = SU_FALSE;
+
+  if (self->channel_tracker == NULL)
+    SU_TRYCATCH(
+        self->channel_tracker = suscan_channel_tracker_new(),
+        goto done);
+
+  snapshot = self->channel_updates++ % self->channel_snapshot_int == 0;
+
+  su_channel_detector_get_channel_list(detector, &ch_list, &ch_count);
+
+  SU_TRYCATCH(
+      suscan_channel_tracker_update(
+          self->channel_tracker,
+          ch_list,
+          ch_count,
+          suscan_analyzer_get_center_freq(self),
+          snapshot),
+      goto done);
+
+  delta_list = suscan_channel_tracker_get_deltas(
+      self->channel_tracker,
+      &delta_count);
+
+  /* Nothing changed, nothing to say */
+  if (!snapshot && delta_count == 0) {
+    ok = SU_TRUE;
+    goto done;
+  }
+
+  SU_TRYCATCH(
+      msg = suscan_analyzer_channel_delta_msg_new(
+          self,
+          delta_list,
+          delta_count,
+          snapshot),
+      goto done);
+
+  msg->seq = self->channel_delta_seq++;
+
+  SU_TRYCATCH(
+      suscan_mq_write(
+          self->mq_out,
+          SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA,
+          msg),
+      goto done);
+
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_channel_delta_msg_destroy(msg);
+
+  return ok;
+}
+
 SUBOOL
 suscan_analyzer_send_detector_channels(
     suscan_analyzer_t *analyzer,
@@ -379,6 +828,12 @@ suscan_analyzer_send_detector_channels(
   unsigned int ch_count;
   SUBOOL ok = SU_FALSE;
 
+  if (analyzer->channel_snapshot_int > 0)
+    return suscan_analyzer_send_detector_channel_delta(analyzer, detector);
+
+  /* Start over with a snapshot if deltas are enabled again */
+  analyzer->channel_updates = 0;
+
   su_channel_detector_get_channel_list(detector, &ch_list, &ch_count);
 
   if ((msg = suscan_analyzer_channel_msg_new(analyzer, ch_list, ch_count))
@@ -422,9 +877,55 @@ suscan_analyzer_send_psd(
     const su_channel_detector_t *detector)
 {
   struct suscan_analyzer_psd_msg *msg = NULL;
+  struct timespec now;
+  SUFREQ fc;
+  SUFLOAT fs;
   SUBOOL ok = SU_FALSE;
 
-  if ((msg = suscan_analyzer_psd_msg_new(detector)) == NULL) {
+  /* Nothing to show until the first batch is done */
+  if (self->parpsd != NULL && !suscan_parallel_psd_is_valid(self->parpsd))
+    return SU_TRUE;
+
+  /* In wide spectrum mode, frequency is given by curr_freq */
+  fc = self->params.mode == SUSCAN_ANALYZER_MODE_CHANNEL
+      ? suscan_analyzer_get_center_freq(self)
+      : self->curr_freq;
+
+  if (self->psd_sub.bins > 0 || self->psd_history != NULL)
+    SU_TRYCATCH(suscan_analyzer_load_psd_pyramid(self, detector), goto done);
+
+  if (self->psd_history != NULL) {
+    fs = detector->params.samp_rate;
+    if (detector->params.decimation > 1)
+      fs /= detector->params.decimation;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    if (!suscan_spectrum_history_append(
+        self->psd_history,
+        &now,
+        fc,
+        fs,
+        suscan_psd_pyramid_get_base(self->psd_pyramid),
+        suscan_psd_pyramid_get_size(self->psd_pyramid))) {
+      SU_WARNING("Cannot append PSD to spectrum history, disabling it\n");
+      suscan_spectrum_history_destroy(self->psd_history);
+      self->psd_history = NULL;
+    }
+  }
+
+  if (self->psd_sub.bins > 0) {
+    msg = suscan_analyzer_psd_msg_new_decimated(
+        self->psd_pyramid,
+        detector,
+        &self->psd_sub);
+  } else if (self->parpsd != NULL) {
+    msg = suscan_analyzer_psd_msg_new_parallel(self->parpsd, detector);
+  } else {
+    msg = suscan_analyzer_psd_msg_new(detector);
+  }
+
+  if (msg == NULL) {
     suscan_analyzer_send_status(
         self,
         SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
@@ -434,12 +935,118 @@ suscan_analyzer_send_psd(
     goto done;
   }
 
-  /* In wide spectrum mode, frequency is given by curr_freq */
-  msg->fc = self->params.mode == SUSCAN_ANALYZER_MODE_CHANNEL
-      ? (suscan_source_get_config(self->source))->freq
-      : self->curr_freq;
+  msg->fc = fc;
+
+  msg->N0 = self->parpsd != NULL
+      ? suscan_parallel_psd_get_noise(self->parpsd)
+      : detector->N0;
+
+  if (!suscan_mq_write(
+      self->mq_out,
+      SUSCAN_ANALYZER_MESSAGE_TYPE_PSD,
+      msg)) {
+    suscan_analyzer_send_status(
+        self,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot write message: %s",
+        strerror(errno));
+    goto done;
+  }
+
+  /* Message queued, forget about it */
+  msg = NULL;
+
+  ok = SU_TRUE;
+
+done:
+  if (msg != NULL)
+    suscan_analyzer_dispose_message(SUSCAN_ANALYZER_MESSAGE_TYPE_PSD, msg);
+
+  return ok;
+}
+
+/* Merges the current PSD of the detector into the wide-mode panorama */
+SUBOOL
+suscan_analyzer_feed_panorama(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector)
+{
+  SUFLOAT fs;
+
+  SU_TRYCATCH(self->panorama != NULL, return SU_FALSE);
+  SU_TRYCATCH(
+      suscan_analyzer_load_psd_pyramid(self, detector),
+      return SU_FALSE);
+
+  fs = detector->params.samp_rate;
+  if (detector->params.decimation > 1)
+    fs /= detector->params.decimation;
+
+  suscan_panorama_feed(
+      self->panorama,
+      self->curr_freq,
+      fs,
+      suscan_psd_pyramid_get_base(self->psd_pyramid),
+      suscan_psd_pyramid_get_size(self->psd_pyramid));
+
+  return SU_TRUE;
+}
+
+/* Searches the current PSD of the detector for signals */
+SUBOOL
+suscan_analyzer_update_signal_catalog(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector)
+{
+  struct timeval now;
+  SUFLOAT fs;
+
+  SU_TRYCATCH(self->signal_catalog != NULL, return SU_FALSE);
+  SU_TRYCATCH(
+      suscan_analyzer_load_psd_pyramid(self, detector),
+      return SU_FALSE);
+
+  fs = detector->params.samp_rate;
+  if (detector->params.decimation > 1)
+    fs /= detector->params.decimation;
+
+  gettimeofday(&now, NULL);
+
+  return suscan_signal_catalog_feed(
+      self->signal_catalog,
+      self->curr_freq,
+      fs,
+      suscan_psd_pyramid_get_base(self->psd_pyramid),
+      suscan_psd_pyramid_get_size(self->psd_pyramid),
+      &now);
+}
+
+SUBOOL
+suscan_analyzer_send_panorama(
+    suscan_analyzer_t *self,
+    const su_channel_detector_t *detector)
+{
+  struct suscan_analyzer_psd_msg *msg = NULL;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(self->panorama != NULL, goto done);
+
+  if ((msg = suscan_analyzer_psd_msg_new_panorama(
+      self->panorama,
+      &self->psd_sub)) == NULL) {
+    suscan_analyzer_send_status(
+        self,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_INTERNAL,
+        -1,
+        "Cannot create message: %s",
+        strerror(errno));
+    goto done;
+  }
 
-  msg->N0 = detector->N0;
+  msg->N0 = self->parpsd != NULL
+      ? suscan_parallel_psd_get_noise(self->parpsd)
+      : detector->N0;
 
   if (!suscan_mq_write(
       self->mq_out,
@@ -23,6 +23,7 @@
 
 #include <util.h>
 #include <stdint.h>
+#include <sys/time.h>
 
 #include "analyzer.h"
 
@@ -42,6 +43,11 @@ extern "C" {
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_SAMPLES       0x9 /* Sample batch */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_THROTTLE      0xa /* Set throttle */
 #define SUSCAN_ANALYZER_MESSAGE_TYPE_PARAMS        0xb /* Analyzer params */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_BURST         0xc /* Triggered capture */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_DETECTION     0xd /* Template match */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_SOFT_SYMBOLS  0xe /* Soft symbol batch */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_CHANNEL_DELTA 0xf /* Channel list delta */
+#define SUSCAN_ANALYZER_MESSAGE_TYPE_LOAD_CONTROL  0x10 /* Quality change */
 
 #define SUSCAN_ANALYZER_INIT_SUCCESS               0
 #define SUSCAN_ANALYZER_INIT_FAILURE              -1
@@ -60,6 +66,20 @@ struct suscan_analyzer_channel_msg {
   const suscan_analyzer_t *sender;
 };
 
+/*
+ * Channel list changes since the previous delta message. Channels are
+ * identified by persistent IDs. Snapshots list every current channel as
+ * added, and consumers must discard any channel not present in them.
+ */
+struct suscan_analyzer_channel_delta_msg {
+  const suscan_source_t *source;
+  const suscan_analyzer_t *sender;
+  uint64_t seq;
+  SUBOOL   snapshot;
+  struct suscan_channel_delta *delta_list;
+  unsigned int delta_count;
+};
+
 /* Throttle parameters */
 struct suscan_analyzer_throttle_msg {
   SUSCOUNT samp_rate; /* Samp rate == 0: reset */
@@ -73,6 +93,13 @@ struct suscan_analyzer_psd_msg {
   SUSCOUNT psd_size;
   SUFLOAT *psd_data;
   SUFLOAT  N0;
+
+  /* Decimated PSDs are in ascending frequency order, spanning f_lo..f_hi */
+  SUBOOL   decimated;
+  SUFREQ   f_lo;
+  SUFREQ   f_hi;
+  SUFLOAT *psd_min;
+  SUFLOAT *psd_max;
 };
 
 /* Channel sample batch */
@@ -82,6 +109,42 @@ struct suscan_analyzer_sample_batch_msg {
   unsigned int sample_count;
 };
 
+/*
+ * Soft symbols, as int8 log-likelihood ratios (positive values favor
+ * ones). There are bits_per_symbol values per symbol, MSB first.
+ */
+struct suscan_analyzer_soft_symbol_msg {
+  uint32_t     inspector_id;
+  unsigned int bits_per_symbol;
+  int8_t      *values;
+  unsigned int symbol_count;
+};
+
+/* Burst captured by an inspector in burst mode */
+struct suscan_analyzer_burst_msg {
+  uint32_t       inspector_id;
+  struct timeval timestamp;    /* First sample, including pre-trigger */
+  SUFREQ         lo;           /* Channel offset from source center (Hz) */
+  SUFLOAT        samp_rate;
+  SUFLOAT        power;        /* Mean power after the trigger (dB) */
+  SUFLOAT        noise;        /* Noise floor before the trigger (dB) */
+  SUSCOUNT       pretrigger;   /* Samples preceding the trigger */
+  SUCOMPLEX     *samples;
+  SUSCOUNT       sample_count;
+};
+
+/* Template match reported by a correlator inspector */
+struct suscan_analyzer_detection_msg {
+  uint32_t       inspector_id;
+  struct timeval timestamp;    /* Start of the match */
+  SUFREQ         lo;           /* Channel offset from source center (Hz) */
+  SUFLOAT        samp_rate;
+  uint32_t       template_id;
+  SUSCOUNT       position;     /* Channel sample where the match starts */
+  SUFLOAT        freq_offset;  /* Relative to the channel center (Hz) */
+  SUFLOAT        peak;         /* Normalized correlation (0-1) */
+};
+
 /*
  * Channel inspector command. This is request-response: sample
  * updates are treated separately
@@ -102,7 +165,11 @@ enum suscan_analyzer_inspector_msgkind {
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_HANDLE,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_OBJECT,
   SUSCAN_ANALYZER_INSPECTOR_MSGKIND_INVALID_ARGUMENT,
-  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_WRONG_KIND,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_ESTIMATOR_INTERVAL,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_WALL_CLOCK,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_SQUELCH,
+  SUSCAN_ANALYZER_INSPECTOR_MSGKIND_SET_LATENCY
 };
 
 struct suscan_analyzer_inspector_msg {
@@ -142,7 +209,16 @@ struct suscan_analyzer_inspector_msg {
     };
 
     SUSCOUNT watermark;
+    SUFLOAT  latency;  /* seconds */
+    SUFLOAT  interval;
+    SUBOOL   wall_clock;
     struct suscan_analyzer_params params;
+
+    struct {
+      SUBOOL  squelch_enabled;
+      SUFLOAT squelch_level; /* dB over channel noise */
+      SUFLOAT squelch_hang;  /* seconds */
+    };
   };
 };
 
@@ -153,6 +229,11 @@ SUBOOL suscan_inspector_sampler_loop(
     SUSCOUNT samp_count,
     struct suscan_mq *mq_out);
 
+/* Keeps a dormant inspector responsive, without demodulating */
+SUBOOL suscan_inspector_dormant_loop(
+    suscan_inspector_t *insp,
+    struct suscan_mq *mq_out);
+
 SUBOOL suscan_inspector_spectrum_loop(
     suscan_inspector_t *insp,
     const SUCOMPLEX *samp_buf,
@@ -185,6 +266,18 @@ SUBOOL suscan_analyzer_send_psd(
     suscan_analyzer_t *analyzer,
     const su_channel_detector_t *detector);
 
+SUBOOL suscan_analyzer_feed_panorama(
+    suscan_analyzer_t *analyzer,
+    const su_channel_detector_t *detector);
+
+SUBOOL suscan_analyzer_update_signal_catalog(
+    suscan_analyzer_t *analyzer,
+    const su_channel_detector_t *detector);
+
+SUBOOL suscan_analyzer_send_panorama(
+    suscan_analyzer_t *analyzer,
+    const su_channel_detector_t *detector);
+
 /************************* Message parsing methods ***************************/
 SUBOOL suscan_analyzer_parse_inspector_msg(
     suscan_analyzer_t *analyzer,
@@ -208,6 +301,16 @@ void suscan_analyzer_channel_msg_take_channels(
     unsigned int *pchannel_count);
 void suscan_analyzer_channel_msg_destroy(struct suscan_analyzer_channel_msg *msg);
 
+/* Channel list delta */
+struct suscan_analyzer_channel_delta_msg *
+suscan_analyzer_channel_delta_msg_new(
+    const suscan_analyzer_t *analyzer,
+    const struct suscan_channel_delta *list,
+    unsigned int count,
+    SUBOOL snapshot);
+void suscan_analyzer_channel_delta_msg_destroy(
+    struct suscan_analyzer_channel_delta_msg *msg);
+
 /* Channel inspector commands */
 struct suscan_analyzer_inspector_msg *suscan_analyzer_inspector_msg_new(
     enum suscan_analyzer_inspector_msgkind kind,
@@ -223,6 +326,16 @@ void suscan_analyzer_inspector_msg_destroy(
 struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new(
     const su_channel_detector_t *cd);
 
+/* The pyramid must hold the current PSD */
+struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new_decimated(
+    suscan_psd_pyramid_t *pyr,
+    const su_channel_detector_t *cd,
+    const struct suscan_analyzer_psd_subscription *sub);
+
+/* Stitched wide-mode PSD, centered in the sweep range */
+struct suscan_analyzer_psd_msg *suscan_analyzer_psd_msg_new_panorama(
+    suscan_panorama_t *panorama,
+    const struct suscan_analyzer_psd_subscription *sub);
 SUFLOAT *suscan_analyzer_psd_msg_take_psd(struct suscan_analyzer_psd_msg *msg);
 
 void suscan_analyzer_psd_msg_destroy(struct suscan_analyzer_psd_msg *msg);
@@ -236,6 +349,30 @@ struct suscan_analyzer_sample_batch_msg *suscan_analyzer_sample_batch_msg_new(
 void suscan_analyzer_sample_batch_msg_destroy(
     struct suscan_analyzer_sample_batch_msg *msg);
 
+/* Soft symbol batch */
+struct suscan_analyzer_soft_symbol_msg *suscan_analyzer_soft_symbol_msg_new(
+    uint32_t inspector_id,
+    const int8_t *values,
+    unsigned int bits_per_symbol,
+    SUSCOUNT count);
+
+void suscan_analyzer_soft_symbol_msg_destroy(
+    struct suscan_analyzer_soft_symbol_msg *msg);
+
+/* Takes ownership of burst->samples */
+struct suscan_analyzer_burst_msg *suscan_analyzer_burst_msg_new(
+    uint32_t inspector_id,
+    struct suscan_inspector_burst *burst);
+
+void suscan_analyzer_burst_msg_destroy(struct suscan_analyzer_burst_msg *msg);
+
+struct suscan_analyzer_detection_msg *suscan_analyzer_detection_msg_new(
+    uint32_t inspector_id,
+    const struct suscan_inspector_detection *detection);
+
+void suscan_analyzer_detection_msg_destroy(
+    struct suscan_analyzer_detection_msg *msg);
+
 /* Generic message disposer */
 void suscan_analyzer_dispose_message(uint32_t type, void *ptr);
 
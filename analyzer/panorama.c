@@ -0,0 +1,157 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "panorama"
+
+#include "panorama.h"
+
+void
+suscan_panorama_destroy(suscan_panorama_t *self)
+{
+  if (self->weight != NULL)
+    free(self->weight);
+
+  if (self->pyramid != NULL)
+    suscan_psd_pyramid_destroy(self->pyramid);
+
+  free(self);
+}
+
+suscan_panorama_t *
+suscan_panorama_new(
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUSCOUNT size,
+    SUFLOAT edge)
+{
+  suscan_panorama_t *new = NULL;
+
+  SU_TRYCATCH(max_freq > min_freq, goto fail);
+  SU_TRYCATCH(size > 0 && size <= SUSCAN_PANORAMA_MAX_SIZE, goto fail);
+  SU_TRYCATCH(edge >= 0 && edge < .5, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_panorama_t)), goto fail);
+
+  new->min_freq = min_freq;
+  new->max_freq = max_freq;
+  new->size     = size;
+  new->res      = (max_freq - min_freq) / size;
+  new->edge     = edge;
+
+  SU_TRYCATCH(new->weight = calloc(size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->pyramid = suscan_psd_pyramid_new(size), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_panorama_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_panorama_feed(
+    suscan_panorama_t *self,
+    SUFREQ fc,
+    SUFLOAT fs,
+    const SUFLOAT *psd,
+    SUSCOUNT size)
+{
+  SUFLOAT *base = suscan_psd_pyramid_get_base(self->pyramid);
+  SUFREQ f_start = fc - .5 * fs; /* Frequency of psd[0] */
+  SUFREQ guard = self->edge * fs;
+  SUFREQ keep_lo = f_start + guard;
+  SUFREQ keep_hi = fc + .5 * fs - guard;
+  SUFREQ f0, f_c;
+  SUFLOAT rbw = fs / size;
+  SUFLOAT u, w, acc, sum;
+  SUSDIFF first, last, j;
+  SUSDIFF p, q, i;
+
+  /*
+   * Nobody else covers the limits of the range: keep them. Hops that
+   * start (or end) less than a guard band away from them count as well.
+   */
+  if (f_start - self->min_freq < guard)
+    keep_lo = f_start;
+  if (self->max_freq - (fc + .5 * fs) < guard)
+    keep_hi = fc + .5 * fs;
+
+  first = (SUSDIFF) SU_FLOOR((keep_lo - self->min_freq) / self->res);
+  last  = (SUSDIFF) SU_CEIL((keep_hi - self->min_freq) / self->res);
+
+  if (first < 0)
+    first = 0;
+  if (last > (SUSDIFF) self->size)
+    last = self->size;
+
+  for (j = first; j < last; ++j) {
+    f0  = self->min_freq + j * self->res;
+    f_c = f0 + .5 * self->res;
+
+    if (f_c < keep_lo || f_c >= keep_hi)
+      continue;
+
+    /* Average all the hop bins that fall into this panorama bin */
+    p = (SUSDIFF) SU_FLOOR((f0 - f_start) / rbw);
+    q = (SUSDIFF) SU_CEIL((f0 + self->res - f_start) / rbw);
+
+    if (p < 0)
+      p = 0;
+    if (q > (SUSDIFF) size)
+      q = size;
+    if (q <= p) {
+      if (p >= (SUSDIFF) size)
+        continue;
+      q = p + 1;
+    }
+
+    sum = 0;
+    for (i = p; i < q; ++i)
+      sum += psd[i];
+    sum /= q - p;
+
+    /* Raised-cosine weight across the kept part of the hop */
+    u = (f_c - keep_lo) / (keep_hi - keep_lo);
+    w = SU_SIN(PI * u);
+    w = w * w + SUSCAN_PANORAMA_MIN_WEIGHT;
+
+    acc = SUSCAN_PANORAMA_MEMORY * self->weight[j];
+    base[j] = (acc * base[j] + w * sum) / (acc + w);
+    self->weight[j] = acc + w;
+  }
+
+  self->dirty = SU_TRUE;
+  ++self->updates;
+}
+
+suscan_psd_pyramid_t *
+suscan_panorama_get_pyramid(suscan_panorama_t *self)
+{
+  if (self->dirty) {
+    suscan_psd_pyramid_build(self->pyramid);
+    self->dirty = SU_FALSE;
+  }
+
+  return self->pyramid;
+}
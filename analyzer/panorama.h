@@ -0,0 +1,110 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PANORAMA_H
+#define _PANORAMA_H
+
+#include <sigutils/sigutils.h>
+
+#include "psdpyr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_PANORAMA_MAX_SIZE       (1 << 20)
+#define SUSCAN_PANORAMA_EDGE_FRACTION  .05
+#define SUSCAN_PANORAMA_MEMORY         .5
+#define SUSCAN_PANORAMA_MIN_WEIGHT     .05
+
+/*
+ * Stitched PSD over a frequency range wider than the sample rate. Every
+ * hop PSD is resampled to the panorama resolution, discarding the `edge'
+ * fraction of the sample rate at both sides (where the anti-alias filter
+ * of the device bends the spectrum) except at the limits of the range.
+ * Bins are blended with a weight that decays towards the edges of the
+ * hop, so overlapping hops fade into each other. Older estimates of a bin
+ * are retained with weight SUSCAN_PANORAMA_MEMORY on every update.
+ *
+ * The stitched PSD lives in the base of a decimation pyramid, so it can
+ * be served to clients at any resolution.
+ */
+struct suscan_panorama {
+  SUFREQ   min_freq;
+  SUFREQ   max_freq;
+  SUFREQ   res;       /* Bin width */
+  SUFLOAT  edge;
+  SUSCOUNT size;
+  SUFLOAT *weight;    /* Accumulated weight of every bin */
+  suscan_psd_pyramid_t *pyramid;
+  SUBOOL   dirty;     /* Pyramid levels need rebuild */
+  SUSCOUNT updates;
+};
+
+typedef struct suscan_panorama suscan_panorama_t;
+
+SUINLINE SUFREQ
+suscan_panorama_get_center(const suscan_panorama_t *self)
+{
+  return .5 * (self->min_freq + self->max_freq);
+}
+
+SUINLINE SUFREQ
+suscan_panorama_get_span(const suscan_panorama_t *self)
+{
+  return self->max_freq - self->min_freq;
+}
+
+SUINLINE SUSCOUNT
+suscan_panorama_get_size(const suscan_panorama_t *self)
+{
+  return self->size;
+}
+
+SUINLINE SUSCOUNT
+suscan_panorama_get_updates(const suscan_panorama_t *self)
+{
+  return self->updates;
+}
+
+suscan_panorama_t *suscan_panorama_new(
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUSCOUNT size,
+    SUFLOAT edge);
+
+/* Merges a PSD in ascending frequency order, centered at fc */
+void suscan_panorama_feed(
+    suscan_panorama_t *self,
+    SUFREQ fc,
+    SUFLOAT fs,
+    const SUFLOAT *psd,
+    SUSCOUNT size);
+
+/* Returns the decimation pyramid of the current panorama */
+suscan_psd_pyramid_t *suscan_panorama_get_pyramid(suscan_panorama_t *self);
+
+void suscan_panorama_destroy(suscan_panorama_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PANORAMA_H */
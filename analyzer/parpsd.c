@@ -0,0 +1,308 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "parallel-psd"
+
+#include "parpsd.h"
+#include "inspector/pipeline.h"
+#include <sigutils/taps.h>
+
+SUPRIVATE void
+suscan_parallel_psd_slice_destroy(struct suscan_parallel_psd_slice *slice)
+{
+  if (slice->plan != NULL) {
+    suscan_inspector_fftw_lock();
+    SU_FFTW(_destroy_plan)(slice->plan);
+    suscan_inspector_fftw_unlock();
+  }
+
+  if (slice->buffer != NULL)
+    SU_FFTW(_free)(slice->buffer);
+
+  if (slice->acc != NULL)
+    free(slice->acc);
+
+  free(slice);
+}
+
+SUPRIVATE struct suscan_parallel_psd_slice *
+suscan_parallel_psd_slice_new(suscan_parallel_psd_t *owner)
+{
+  struct suscan_parallel_psd_slice *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_parallel_psd_slice)),
+      goto fail);
+
+  new->owner = owner;
+
+  SU_TRYCATCH(
+      new->buffer = SU_FFTW(_malloc)(owner->size * sizeof(SU_FFTW(_complex))),
+      goto fail);
+
+  SU_TRYCATCH(new->acc = calloc(owner->size, sizeof(SUFLOAT)), goto fail);
+
+  suscan_inspector_fftw_lock();
+  new->plan = SU_FFTW(_plan_dft_1d)(
+      owner->size,
+      new->buffer,
+      new->buffer,
+      FFTW_FORWARD,
+      FFTW_ESTIMATE);
+  suscan_inspector_fftw_unlock();
+
+  SU_TRYCATCH(new->plan != NULL, goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_parallel_psd_slice_destroy(new);
+
+  return NULL;
+}
+
+SUPRIVATE SUBOOL
+suscan_parallel_psd_init_window_func(
+    suscan_parallel_psd_t *self,
+    enum sigutils_channel_detector_window window)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < self->size; ++i)
+    self->window_func[i] = 1;
+
+  switch (window) {
+    case SU_CHANNEL_DETECTOR_WINDOW_NONE:
+      break;
+
+    case SU_CHANNEL_DETECTOR_WINDOW_HAMMING:
+      su_taps_apply_hamming_complex(self->window_func, self->size);
+      break;
+
+    case SU_CHANNEL_DETECTOR_WINDOW_HANN:
+      su_taps_apply_hann_complex(self->window_func, self->size);
+      break;
+
+    case SU_CHANNEL_DETECTOR_WINDOW_FLAT_TOP:
+      su_taps_apply_flat_top_complex(self->window_func, self->size);
+      break;
+
+    case SU_CHANNEL_DETECTOR_WINDOW_BLACKMANN_HARRIS:
+      su_taps_apply_blackmann_harris_complex(self->window_func, self->size);
+      break;
+
+    default:
+      SU_WARNING("Unsupported window function %d\n", window);
+      return SU_FALSE;
+  }
+
+  self->window_power = 0;
+  for (i = 0; i < self->size; ++i)
+    self->window_power += SU_C_REAL(
+        self->window_func[i] * SU_C_CONJ(self->window_func[i]));
+  self->window_power /= self->size;
+
+  return SU_TRUE;
+}
+
+void
+suscan_parallel_psd_destroy(suscan_parallel_psd_t *self)
+{
+  unsigned int i;
+
+  for (i = 0; i < self->slice_count; ++i)
+    if (self->slice_list[i] != NULL)
+      suscan_parallel_psd_slice_destroy(self->slice_list[i]);
+
+  if (self->slice_list != NULL)
+    free(self->slice_list);
+
+  if (self->window_func != NULL)
+    free(self->window_func);
+
+  if (self->batch != NULL)
+    free(self->batch);
+
+  if (self->psd != NULL)
+    free(self->psd);
+
+  if (self->scratch != NULL)
+    free(self->scratch);
+
+  free(self);
+}
+
+void
+suscan_parallel_psd_set_alpha(suscan_parallel_psd_t *self, SUFLOAT alpha)
+{
+  self->alpha       = alpha;
+  self->batch_alpha = 1 - SU_POW(1 - alpha, self->batch_size);
+}
+
+suscan_parallel_psd_t *
+suscan_parallel_psd_new(
+    SUSCOUNT size,
+    enum sigutils_channel_detector_window window,
+    SUFLOAT alpha,
+    unsigned int slices,
+    SUSCOUNT batch)
+{
+  suscan_parallel_psd_t *new = NULL;
+  struct suscan_parallel_psd_slice *slice = NULL;
+  SUSCOUNT per_slice;
+  unsigned int i;
+
+  SU_TRYCATCH(size > 0, goto fail);
+  SU_TRYCATCH(slices > 0, goto fail);
+  SU_TRYCATCH(alpha > 0 && alpha <= 1, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_parallel_psd_t)), goto fail);
+
+  per_slice = (batch + slices - 1) / slices;
+  if (per_slice == 0)
+    per_slice = 1;
+
+  new->size       = size;
+  new->batch_size = per_slice * slices;
+  suscan_parallel_psd_set_alpha(new, alpha);
+
+  SU_TRYCATCH(
+      new->window_func = malloc(size * sizeof(SUCOMPLEX)),
+      goto fail);
+  SU_TRYCATCH(
+      suscan_parallel_psd_init_window_func(new, window),
+      goto fail);
+
+  SU_TRYCATCH(
+      new->batch = malloc(new->batch_size * size * sizeof(SUCOMPLEX)),
+      goto fail);
+
+  SU_TRYCATCH(new->psd = calloc(size, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->scratch = malloc(size * sizeof(SUFLOAT)), goto fail);
+
+  for (i = 0; i < slices; ++i) {
+    SU_TRYCATCH(slice = suscan_parallel_psd_slice_new(new), goto fail);
+
+    slice->first   = i * per_slice;
+    slice->windows = per_slice;
+
+    SU_TRYCATCH(PTR_LIST_APPEND_CHECK(new->slice, slice) != -1, goto fail);
+    slice = NULL;
+  }
+
+  return new;
+
+fail:
+  if (slice != NULL)
+    suscan_parallel_psd_slice_destroy(slice);
+
+  if (new != NULL)
+    suscan_parallel_psd_destroy(new);
+
+  return NULL;
+}
+
+SUSCOUNT
+suscan_parallel_psd_feed(
+    suscan_parallel_psd_t *self,
+    const SUCOMPLEX *data,
+    SUSCOUNT len)
+{
+  SUSCOUNT avail = self->batch_size * self->size - self->batch_ptr;
+
+  if (len > avail)
+    len = avail;
+
+  memcpy(self->batch + self->batch_ptr, data, len * sizeof(SUCOMPLEX));
+  self->batch_ptr += len;
+
+  return len;
+}
+
+void
+suscan_parallel_psd_slice_run(struct suscan_parallel_psd_slice *slice)
+{
+  const suscan_parallel_psd_t *owner = slice->owner;
+  const SUCOMPLEX *window;
+  SUSCOUNT size = owner->size;
+  SUSCOUNT i, w;
+
+  memset(slice->acc, 0, size * sizeof(SUFLOAT));
+
+  for (w = 0; w < slice->windows; ++w) {
+    window = owner->batch + (slice->first + w) * size;
+
+    for (i = 0; i < size; ++i)
+      slice->buffer[i] = window[i] * owner->window_func[i];
+
+    SU_FFTW(_execute)(slice->plan);
+
+    for (i = 0; i < size; ++i)
+      slice->acc[i] +=
+          SU_C_REAL(slice->buffer[i] * SU_C_CONJ(slice->buffer[i]));
+  }
+}
+
+SUPRIVATE int
+suscan_parallel_psd_cmp(const void *a, const void *b)
+{
+  SUFLOAT x = *(const SUFLOAT *) a;
+  SUFLOAT y = *(const SUFLOAT *) b;
+
+  return (x > y) - (x < y);
+}
+
+void
+suscan_parallel_psd_reduce(suscan_parallel_psd_t *self)
+{
+  SUSCOUNT i;
+  unsigned int s;
+  SUFLOAT k = 1. / (self->batch_size * self->size * self->window_power);
+
+  for (i = 0; i < self->size; ++i)
+    self->scratch[i] = 0;
+
+  for (s = 0; s < self->slice_count; ++s)
+    for (i = 0; i < self->size; ++i)
+      self->scratch[i] += self->slice_list[s]->acc[i];
+
+  /* The first batch initializes the average */
+  if (!self->valid) {
+    for (i = 0; i < self->size; ++i)
+      self->psd[i] = k * self->scratch[i];
+    self->valid = SU_TRUE;
+  } else {
+    for (i = 0; i < self->size; ++i)
+      self->psd[i] +=
+          self->batch_alpha * (k * self->scratch[i] - self->psd[i]);
+  }
+
+  /* Median, robust to the channels present in the band */
+  memcpy(self->scratch, self->psd, self->size * sizeof(SUFLOAT));
+  qsort(self->scratch, self->size, sizeof(SUFLOAT), suscan_parallel_psd_cmp);
+  self->N0 = self->scratch[self->size / 2];
+
+  self->batch_ptr = 0;
+}
+
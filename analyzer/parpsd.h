@@ -0,0 +1,153 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PARPSD_H
+#define _PARPSD_H
+
+#include <util.h>
+#include <sigutils/sigutils.h>
+#include <sigutils/detect.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+struct suscan_parallel_psd;
+
+/* Part of a batch, transformed by one worker */
+struct suscan_parallel_psd_slice {
+  struct suscan_parallel_psd *owner;
+  SU_FFTW(_complex) *buffer;
+  SU_FFTW(_plan)     plan;
+  SUFLOAT           *acc;     /* Sum of the periodograms of this slice */
+  SUSCOUNT           first;   /* First window of the batch */
+  SUSCOUNT           windows;
+};
+
+/*
+ * Parallel PSD estimator. Samples are gathered in batches of several
+ * FFT windows, which are split in slices so that different threads can
+ * compute their periodograms simultaneously (every slice has its own
+ * plan and buffers). Once all slices are done, their periodograms are
+ * averaged and merged into the running average, with an update factor
+ * equivalent to that of feeding the windows one by one.
+ */
+struct suscan_parallel_psd {
+  SUSCOUNT   size;
+  SUFLOAT    alpha;        /* Per-window averaging factor */
+  SUFLOAT    batch_alpha;  /* Per-batch averaging factor */
+  SUCOMPLEX *window_func;
+  SUFLOAT    window_power; /* Mean of |window_func|^2 */
+  SUCOMPLEX *batch;
+  SUSCOUNT   batch_size;   /* In windows */
+  SUSCOUNT   batch_ptr;    /* In samples */
+  PTR_LIST(struct suscan_parallel_psd_slice, slice);
+
+  SUFLOAT   *psd;          /* Averaged PSD, FFT order */
+  SUFLOAT   *scratch;
+  SUFLOAT    N0;           /* Noise floor of the averaged PSD */
+  SUBOOL     valid;
+};
+
+typedef struct suscan_parallel_psd suscan_parallel_psd_t;
+
+SUINLINE SUSCOUNT
+suscan_parallel_psd_get_size(const suscan_parallel_psd_t *self)
+{
+  return self->size;
+}
+
+SUINLINE const SUFLOAT *
+suscan_parallel_psd_get_psd(const suscan_parallel_psd_t *self)
+{
+  return self->psd;
+}
+
+/* Median of the averaged PSD, as an estimate of the noise floor */
+SUINLINE SUFLOAT
+suscan_parallel_psd_get_noise(const suscan_parallel_psd_t *self)
+{
+  return self->N0;
+}
+
+SUINLINE SUBOOL
+suscan_parallel_psd_is_valid(const suscan_parallel_psd_t *self)
+{
+  return self->valid;
+}
+
+/* Samples already gathered for the window being filled */
+SUINLINE SUSCOUNT
+suscan_parallel_psd_get_window_ptr(const suscan_parallel_psd_t *self)
+{
+  return self->batch_ptr % self->size;
+}
+
+SUINLINE SUBOOL
+suscan_parallel_psd_is_full(const suscan_parallel_psd_t *self)
+{
+  return self->batch_ptr == self->batch_size * self->size;
+}
+
+SUINLINE unsigned int
+suscan_parallel_psd_get_slice_count(const suscan_parallel_psd_t *self)
+{
+  return self->slice_count;
+}
+
+SUINLINE struct suscan_parallel_psd_slice *
+suscan_parallel_psd_get_slice(const suscan_parallel_psd_t *self, unsigned int i)
+{
+  return self->slice_list[i];
+}
+
+void suscan_parallel_psd_set_alpha(suscan_parallel_psd_t *self, SUFLOAT alpha);
+
+/* The batch size is rounded up to a multiple of the slice count */
+suscan_parallel_psd_t *suscan_parallel_psd_new(
+    SUSCOUNT size,
+    enum sigutils_channel_detector_window window,
+    SUFLOAT alpha,
+    unsigned int slices,
+    SUSCOUNT batch);
+
+/* Returns the number of samples consumed, until the batch is full */
+SUSCOUNT suscan_parallel_psd_feed(
+    suscan_parallel_psd_t *self,
+    const SUCOMPLEX *data,
+    SUSCOUNT len);
+
+/* May run concurrently for different slices of the same batch */
+void suscan_parallel_psd_slice_run(struct suscan_parallel_psd_slice *slice);
+
+/*
+ * Once all slices are done: updates the average and its noise floor, and
+ * clears the batch. The average is corrected for the power lost to the
+ * window, so white noise of power N0 yields N0 in every bin.
+ */
+void suscan_parallel_psd_reduce(suscan_parallel_psd_t *self);
+
+void suscan_parallel_psd_destroy(suscan_parallel_psd_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PARPSD_H */
@@ -0,0 +1,200 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "psd-pyramid"
+
+#include "psdpyr.h"
+
+void
+suscan_psd_pyramid_destroy(suscan_psd_pyramid_t *pyr)
+{
+  if (pyr->offset != NULL)
+    free(pyr->offset);
+
+  if (pyr->length != NULL)
+    free(pyr->length);
+
+  if (pyr->min != NULL)
+    free(pyr->min);
+
+  if (pyr->max != NULL)
+    free(pyr->max);
+
+  if (pyr->mean != NULL)
+    free(pyr->mean);
+
+  free(pyr);
+}
+
+suscan_psd_pyramid_t *
+suscan_psd_pyramid_new(SUSCOUNT size)
+{
+  suscan_psd_pyramid_t *new = NULL;
+  SUSCOUNT total = 0;
+  SUSCOUNT len;
+  unsigned int i;
+
+  SU_TRYCATCH(size > 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_psd_pyramid_t)), goto fail);
+
+  new->size = size;
+
+  for (len = size; len > 0; len >>= 1)
+    ++new->levels;
+
+  SU_TRYCATCH(new->offset = calloc(new->levels, sizeof(SUSCOUNT)), goto fail);
+  SU_TRYCATCH(new->length = calloc(new->levels, sizeof(SUSCOUNT)), goto fail);
+
+  for (i = 0, len = size; i < new->levels; ++i, len >>= 1) {
+    new->offset[i] = total;
+    new->length[i] = len;
+    total += len;
+  }
+
+  SU_TRYCATCH(new->min  = calloc(total, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->max  = calloc(total, sizeof(SUFLOAT)), goto fail);
+  SU_TRYCATCH(new->mean = calloc(total, sizeof(SUFLOAT)), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_psd_pyramid_destroy(new);
+
+  return NULL;
+}
+
+void
+suscan_psd_pyramid_build(suscan_psd_pyramid_t *pyr)
+{
+  unsigned int l;
+  SUSCOUNT i;
+  const SUFLOAT *pmin, *pmax, *pmean;
+  SUFLOAT *qmin, *qmax, *qmean;
+
+  /* Level 0: min, max and mean are the same */
+  memcpy(pyr->min, pyr->mean, pyr->size * sizeof(SUFLOAT));
+  memcpy(pyr->max, pyr->mean, pyr->size * sizeof(SUFLOAT));
+
+  for (l = 1; l < pyr->levels; ++l) {
+    pmin  = pyr->min  + pyr->offset[l - 1];
+    pmax  = pyr->max  + pyr->offset[l - 1];
+    pmean = pyr->mean + pyr->offset[l - 1];
+    qmin  = pyr->min  + pyr->offset[l];
+    qmax  = pyr->max  + pyr->offset[l];
+    qmean = pyr->mean + pyr->offset[l];
+
+    for (i = 0; i < pyr->length[l]; ++i) {
+      qmin[i]  = SU_MIN(pmin[2 * i], pmin[2 * i + 1]);
+      qmax[i]  = SU_MAX(pmax[2 * i], pmax[2 * i + 1]);
+      qmean[i] = .5 * (pmean[2 * i] + pmean[2 * i + 1]);
+    }
+  }
+}
+
+void
+suscan_psd_pyramid_update(suscan_psd_pyramid_t *pyr, const SUFLOAT *psd)
+{
+  SUSCOUNT half = pyr->size / 2;
+  SUSCOUNT rest = pyr->size - half;
+
+  /* FFT order to ascending frequency order */
+  memcpy(pyr->mean, psd + rest, half * sizeof(SUFLOAT));
+  memcpy(pyr->mean + half, psd, rest * sizeof(SUFLOAT));
+
+  suscan_psd_pyramid_build(pyr);
+}
+
+SUSCOUNT
+suscan_psd_pyramid_query(
+    const suscan_psd_pyramid_t *pyr,
+    SUSCOUNT first,
+    SUSCOUNT last,
+    SUSCOUNT bins,
+    SUFLOAT *min,
+    SUFLOAT *mean,
+    SUFLOAT *max)
+{
+  unsigned int l = 0;
+  SUSCOUNT i, j, p, q, count;
+  const SUFLOAT *lmin, *lmax, *lmean;
+  SUFLOAT vmin, vmax, vsum;
+  SUFLOAT ratio;
+
+  if (last > pyr->size)
+    last = pyr->size;
+
+  if (first >= last || bins == 0)
+    return 0;
+
+  /* Coarsest level that still provides at least `bins' bins */
+  while (l + 1 < pyr->levels && ((last - first) >> (l + 1)) >= bins)
+    ++l;
+
+  first >>= l;
+  last  >>= l;
+  if (last > pyr->length[l])
+    last = pyr->length[l];
+  if (last <= first)
+    last = first + 1;
+
+  count = last - first;
+  if (bins > count)
+    bins = count;
+
+  lmin  = pyr->min  + pyr->offset[l] + first;
+  lmax  = pyr->max  + pyr->offset[l] + first;
+  lmean = pyr->mean + pyr->offset[l] + first;
+
+  ratio = (SUFLOAT) count / (SUFLOAT) bins;
+
+  for (j = 0; j < bins; ++j) {
+    p = (SUSCOUNT) (j * ratio);
+    q = (SUSCOUNT) ((j + 1) * ratio);
+    if (q > count)
+      q = count;
+    if (q <= p)
+      q = p + 1;
+
+    vmin = lmin[p];
+    vmax = lmax[p];
+    vsum = 0;
+
+    for (i = p; i < q; ++i) {
+      if (lmin[i] < vmin)
+        vmin = lmin[i];
+      if (lmax[i] > vmax)
+        vmax = lmax[i];
+      vsum += lmean[i];
+    }
+
+    if (min != NULL)
+      min[j] = vmin;
+    if (max != NULL)
+      max[j] = vmax;
+    if (mean != NULL)
+      mean[j] = vsum / (q - p);
+  }
+
+  return bins;
+}
@@ -0,0 +1,90 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _PSDPYR_H
+#define _PSDPYR_H
+
+#include <sigutils/sigutils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * PSD decimation pyramid. Level 0 holds the PSD in ascending frequency
+ * order (i.e. FFT-shifted). Every subsequent level halves the number of
+ * bins, keeping the minimum, maximum and mean of each pair. Arbitrary
+ * (span, bin count) requests are served from the coarsest level that still
+ * has enough resolution.
+ */
+struct suscan_psd_pyramid {
+  SUSCOUNT size;        /* Bins in level 0 */
+  unsigned int levels;
+  SUSCOUNT *offset;     /* Offset of each level in the arrays below */
+  SUSCOUNT *length;     /* Number of bins in each level */
+  SUFLOAT  *min;
+  SUFLOAT  *max;
+  SUFLOAT  *mean;
+};
+
+typedef struct suscan_psd_pyramid suscan_psd_pyramid_t;
+
+SUINLINE SUSCOUNT
+suscan_psd_pyramid_get_size(const suscan_psd_pyramid_t *pyr)
+{
+  return pyr->size;
+}
+
+/* Level 0 buffer, to be filled in ascending frequency order */
+SUINLINE SUFLOAT *
+suscan_psd_pyramid_get_base(suscan_psd_pyramid_t *pyr)
+{
+  return pyr->mean;
+}
+
+suscan_psd_pyramid_t *suscan_psd_pyramid_new(SUSCOUNT size);
+
+/* Fills level 0 from a PSD in FFT order and rebuilds all levels */
+void suscan_psd_pyramid_update(suscan_psd_pyramid_t *pyr, const SUFLOAT *psd);
+
+/* Rebuilds all levels from the contents of the base buffer */
+void suscan_psd_pyramid_build(suscan_psd_pyramid_t *pyr);
+
+/*
+ * Decimates the level-0 bin range [first, last) to at most `bins' bins.
+ * Any of the output arrays may be NULL. Returns the number of bins
+ * written, which may be less than requested if the range is narrower.
+ */
+SUSCOUNT suscan_psd_pyramid_query(
+    const suscan_psd_pyramid_t *pyr,
+    SUSCOUNT first,
+    SUSCOUNT last,
+    SUSCOUNT bins,
+    SUFLOAT *min,
+    SUFLOAT *mean,
+    SUFLOAT *max);
+
+void suscan_psd_pyramid_destroy(suscan_psd_pyramid_t *pyr);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PSDPYR_H */
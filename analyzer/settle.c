@@ -0,0 +1,151 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SU_LOG_DOMAIN "settle"
+
+#include "settle.h"
+
+void
+suscan_settle_estimator_destroy(suscan_settle_estimator_t *self)
+{
+  if (self->trace != NULL)
+    free(self->trace);
+
+  free(self);
+}
+
+suscan_settle_estimator_t *
+suscan_settle_estimator_new(void)
+{
+  suscan_settle_estimator_t *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(suscan_settle_estimator_t)),
+      return NULL);
+
+  return new;
+}
+
+void
+suscan_settle_estimator_reset(suscan_settle_estimator_t *self)
+{
+  self->hops      = 0;
+  self->trace_len = 0;
+  self->acc       = 0;
+  self->acc_count = 0;
+}
+
+SUBOOL
+suscan_settle_estimator_begin_hop(
+    suscan_settle_estimator_t *self,
+    SUSCOUNT samples)
+{
+  SUSCOUNT blocks = samples / SUSCAN_SETTLE_BLOCK_SIZE + 1;
+  SUFLOAT *tmp;
+
+  if (blocks > self->trace_alloc) {
+    SU_TRYCATCH(
+        tmp = realloc(self->trace, blocks * sizeof(SUFLOAT)),
+        return SU_FALSE);
+    self->trace = tmp;
+    self->trace_alloc = blocks;
+  }
+
+  self->trace_len = 0;
+  self->acc       = 0;
+  self->acc_count = 0;
+
+  return SU_TRUE;
+}
+
+void
+suscan_settle_estimator_feed(
+    suscan_settle_estimator_t *self,
+    const SUCOMPLEX *data,
+    SUSCOUNT len)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i) {
+    self->acc += SU_C_REAL(data[i] * SU_C_CONJ(data[i]));
+
+    if (++self->acc_count == SUSCAN_SETTLE_BLOCK_SIZE) {
+      if (self->trace_len < self->trace_alloc)
+        self->trace[self->trace_len++] =
+            SU_POWER_DB(self->acc / SUSCAN_SETTLE_BLOCK_SIZE + 1e-20);
+      self->acc = 0;
+      self->acc_count = 0;
+    }
+  }
+}
+
+void
+suscan_settle_estimator_end_hop(suscan_settle_estimator_t *self)
+{
+  SUSCOUNT i, half = self->trace_len / 2;
+  SUSCOUNT end = 0;
+  SUFLOAT ref = 0;
+
+  /* Too short to tell the transient from the steady state */
+  if (half < 2)
+    return;
+
+  for (i = half; i < self->trace_len; ++i)
+    ref += self->trace[i];
+  ref /= self->trace_len - half;
+
+  for (i = 0; i < self->trace_len; ++i)
+    if (SU_ABS(self->trace[i] - ref) > SUSCAN_SETTLE_TOLERANCE_DB)
+      end = i + 1;
+
+  /* Transient never faded: this hop tells us nothing */
+  if (end > half)
+    return;
+
+  if (self->hops < SUSCAN_SETTLE_CALIBRATION_HOPS)
+    self->transients[self->hops++] = end * SUSCAN_SETTLE_BLOCK_SIZE;
+}
+
+SUPRIVATE int
+suscan_settle_compare(const void *a, const void *b)
+{
+  SUSCOUNT x = *(const SUSCOUNT *) a;
+  SUSCOUNT y = *(const SUSCOUNT *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+SUSCOUNT
+suscan_settle_estimator_get_settle(const suscan_settle_estimator_t *self)
+{
+  SUSCOUNT sorted[SUSCAN_SETTLE_CALIBRATION_HOPS];
+
+  if (self->hops == 0)
+    return 0;
+
+  memcpy(sorted, self->transients, self->hops * sizeof(SUSCOUNT));
+  qsort(sorted, self->hops, sizeof(SUSCOUNT), suscan_settle_compare);
+
+  return (SUSCOUNT) SU_CEIL(SUSCAN_SETTLE_MARGIN * sorted[self->hops / 2])
+      + SUSCAN_SETTLE_BLOCK_SIZE;
+}
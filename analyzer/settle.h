@@ -0,0 +1,90 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SETTLE_H
+#define _SETTLE_H
+
+#include <sigutils/sigutils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SUSCAN_SETTLE_BLOCK_SIZE        256
+#define SUSCAN_SETTLE_CALIBRATION_HOPS  8
+#define SUSCAN_SETTLE_TOLERANCE_DB      1.
+#define SUSCAN_SETTLE_MARGIN            1.5
+
+/*
+ * Settling time estimator. During calibration, the power of the samples
+ * read right after every retune is traced in blocks of
+ * SUSCAN_SETTLE_BLOCK_SIZE samples. The end of the transient of a hop is
+ * the last block whose power departs more than SUSCAN_SETTLE_TOLERANCE_DB
+ * from the power of the second half of the trace. The settling time is
+ * the median of the transients of SUSCAN_SETTLE_CALIBRATION_HOPS hops,
+ * times SUSCAN_SETTLE_MARGIN, so a few hops landing on bursty signals do
+ * not inflate it.
+ */
+struct suscan_settle_estimator {
+  SUFLOAT *trace;      /* Block powers of the current hop */
+  SUSCOUNT trace_alloc;
+  SUSCOUNT trace_len;
+  SUFLOAT  acc;        /* Power accumulator of the current block */
+  SUSCOUNT acc_count;
+
+  SUSCOUNT transients[SUSCAN_SETTLE_CALIBRATION_HOPS];
+  unsigned int hops;
+};
+
+typedef struct suscan_settle_estimator suscan_settle_estimator_t;
+
+SUINLINE SUBOOL
+suscan_settle_estimator_is_ready(const suscan_settle_estimator_t *self)
+{
+  return self->hops >= SUSCAN_SETTLE_CALIBRATION_HOPS;
+}
+
+suscan_settle_estimator_t *suscan_settle_estimator_new(void);
+
+/* Prepares the trace to observe up to `samples' samples after a retune */
+SUBOOL suscan_settle_estimator_begin_hop(
+    suscan_settle_estimator_t *self,
+    SUSCOUNT samples);
+
+void suscan_settle_estimator_feed(
+    suscan_settle_estimator_t *self,
+    const SUCOMPLEX *data,
+    SUSCOUNT len);
+
+void suscan_settle_estimator_end_hop(suscan_settle_estimator_t *self);
+
+/* Settling time, in samples. Only meaningful once ready. */
+SUSCOUNT suscan_settle_estimator_get_settle(
+    const suscan_settle_estimator_t *self);
+
+void suscan_settle_estimator_reset(suscan_settle_estimator_t *self);
+
+void suscan_settle_estimator_destroy(suscan_settle_estimator_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _SETTLE_H */
@@ -1671,6 +1671,8 @@ suscan_source_open_sdr(suscan_source_t *source)
       SOAPY_SDR_RX,
       0);
 
+  source->has_hw_time = SoapySDRDevice_hasHardwareTime(source->sdr, "");
+
   return SU_TRUE;
 }
 
@@ -1719,8 +1721,8 @@ SUPRIVATE SUSDIFF
 suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
 {
   int result;
-  int flags;
-  long long timeNs;
+  int flags = 0;
+  long long timeNs = 0;
   SUBOOL retry;
 
   do {
@@ -1741,6 +1743,8 @@ suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
         || result == SOAPY_SDR_OVERFLOW
         || result == SOAPY_SDR_UNDERFLOW) {
       /* We should use this statuses as quality indicators */
+      if (result == SOAPY_SDR_OVERFLOW)
+        ++source->overflows;
       retry = SU_TRUE;
     }
   } while (retry);
@@ -1753,6 +1757,9 @@ suscan_source_read_sdr(suscan_source_t *source, SUCOMPLEX *buf, SUSCOUNT max)
     return SU_BLOCK_PORT_READ_ERROR_ACQUIRE;
   }
 
+  source->read_timed   = (flags & SOAPY_SDR_HAS_TIME) != 0;
+  source->read_time_ns = timeNs;
+
   return result;
 }
 
@@ -1949,6 +1956,16 @@ suscan_source_set_bandwidth(suscan_source_t *source, SUFLOAT bw)
   return SU_TRUE;
 }
 
+/* Remember when the device was retuned, to discard unsettled samples */
+SUPRIVATE void
+suscan_source_mark_retune(suscan_source_t *source)
+{
+  source->retune_timed = source->has_hw_time;
+
+  if (source->has_hw_time)
+    source->retune_time_ns = SoapySDRDevice_getHardwareTime(source->sdr, "");
+}
+
 SUBOOL
 suscan_source_set_freq(suscan_source_t *source, SUFREQ freq)
 {
@@ -1974,6 +1991,8 @@ suscan_source_set_freq(suscan_source_t *source, SUFREQ freq)
     return SU_FALSE;
   }
 
+  suscan_source_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2002,6 +2021,8 @@ suscan_source_set_lnb_freq(suscan_source_t *source, SUFREQ freq)
     return SU_FALSE;
   }
 
+  suscan_source_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2031,6 +2052,8 @@ suscan_source_set_freq2(suscan_source_t *source, SUFREQ freq, SUFREQ lnb)
     return SU_FALSE;
   }
 
+  suscan_source_mark_retune(source);
+
   return SU_TRUE;
 }
 
@@ -2071,6 +2094,8 @@ suscan_source_new(suscan_source_config_t *config)
   SU_TRYCATCH(new = calloc(1, sizeof(suscan_source_t)), goto fail);
   SU_TRYCATCH(new->config = suscan_source_config_clone(config), goto fail);
 
+  new->settle_time = -1;
+
   switch (new->config->type) {
     case SUSCAN_SOURCE_TYPE_FILE:
       SU_TRYCATCH(suscan_source_open_file(new), goto fail);
@@ -336,6 +336,19 @@ struct suscan_source {
   size_t chan_array[1];
   SUFLOAT samp_rate; /* Actual sample rate */
 
+  /* Stream timing, if the device provides it (in device time, ns) */
+  SUBOOL    has_hw_time;
+  SUBOOL    read_timed;     /* Last read carried a timestamp */
+  long long read_time_ns;   /* Time of the first sample of the last read */
+  SUBOOL    retune_timed;
+  long long retune_time_ns; /* Time of the last retune */
+
+  /* Measured settling time after retuning, in seconds (< 0: unknown) */
+  SUFLOAT settle_time;
+
+  /* Number of stream overflows (i.e. samples lost by the device) */
+  SUSCOUNT overflows;
+
   /* To prevent source from looping forever */
   SUBOOL force_eos;
 };
@@ -401,6 +414,48 @@ suscan_source_is_capturing(const suscan_source_t *src)
   return src->capturing;
 }
 
+SUINLINE SUSCOUNT
+suscan_source_get_overflow_count(const suscan_source_t *src)
+{
+  return src->overflows;
+}
+
+/* Device time of the first sample returned by the last read */
+SUINLINE SUBOOL
+suscan_source_get_read_time(const suscan_source_t *src, long long *ns)
+{
+  if (!src->read_timed)
+    return SU_FALSE;
+
+  *ns = src->read_time_ns;
+
+  return SU_TRUE;
+}
+
+/* Device time of the last frequency change */
+SUINLINE SUBOOL
+suscan_source_get_retune_time(const suscan_source_t *src, long long *ns)
+{
+  if (!src->retune_timed)
+    return SU_FALSE;
+
+  *ns = src->retune_time_ns;
+
+  return SU_TRUE;
+}
+
+SUINLINE SUFLOAT
+suscan_source_get_settle_time(const suscan_source_t *src)
+{
+  return src->settle_time;
+}
+
+SUINLINE void
+suscan_source_set_settle_time(suscan_source_t *src, SUFLOAT seconds)
+{
+  src->settle_time = seconds;
+}
+
 void suscan_source_destroy(suscan_source_t *config);
 
 SUBOOL suscan_source_config_register(suscan_source_config_t *config);
@@ -0,0 +1,587 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SU_LOG_DOMAIN "spectrum-history"
+
+#include "spechist.h"
+
+#define SUSCAN_SPECTRUM_HISTORY_MAX_VARINT 3 /* Enough for 17 bit values */
+
+SUINLINE uint64_t
+suscan_spectrum_history_timespec_to_ns(const struct timespec *ts)
+{
+  return (uint64_t) ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+SUINLINE void
+suscan_spectrum_history_ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+  ts->tv_sec  = ns / 1000000000ull;
+  ts->tv_nsec = ns % 1000000000ull;
+}
+
+SUINLINE uint64_t
+suscan_spectrum_history_align(uint64_t offset)
+{
+  return (offset + SUSCAN_SPECTRUM_HISTORY_ALIGN - 1)
+      & ~(uint64_t) (SUSCAN_SPECTRUM_HISTORY_ALIGN - 1);
+}
+
+SUINLINE uint16_t
+suscan_spectrum_history_quantize(
+    const suscan_spectrum_history_t *hist,
+    SUFLOAT power)
+{
+  SUFLOAT q;
+
+  if (power <= 0)
+    return 0;
+
+  q = (SU_POWER_DB(power) - hist->header.db_min) * hist->q_scale;
+
+  if (q <= 0)
+    return 0;
+  else if (q >= hist->q_max)
+    return hist->q_max;
+
+  return (uint16_t) (q + .5);
+}
+
+SUINLINE SUFLOAT
+suscan_spectrum_history_dequantize(
+    const suscan_spectrum_history_t *hist,
+    uint16_t q)
+{
+  return SU_POWER_MAG(hist->header.db_min + q / hist->q_scale);
+}
+
+SUPRIVATE void
+suscan_spectrum_history_init_quantizer(suscan_spectrum_history_t *hist)
+{
+  hist->q_max   = (1u << hist->header.bits) - 1;
+  hist->q_scale = hist->q_max / (hist->header.db_max - hist->header.db_min);
+}
+
+/****************************** Frame coding *********************************/
+SUPRIVATE SUSCOUNT
+suscan_spectrum_history_encode(
+    suscan_spectrum_history_t *hist,
+    const SUFLOAT *psd,
+    uint8_t *out)
+{
+  SUSCOUNT i, p = 0;
+  int32_t delta;
+  uint32_t z;
+  uint16_t q;
+
+  for (i = 0; i < hist->header.psd_size; ++i) {
+    q = suscan_spectrum_history_quantize(hist, psd[i]);
+    delta = (int32_t) q - (int32_t) hist->prev[i];
+    hist->prev[i] = q;
+
+    /* Zigzag, so small negative deltas are small too */
+    z = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+
+    while (z >= 0x80) {
+      out[p++] = (z & 0x7f) | 0x80;
+      z >>= 7;
+    }
+
+    out[p++] = z;
+  }
+
+  return p;
+}
+
+SUPRIVATE SUBOOL
+suscan_spectrum_history_decode(
+    const suscan_spectrum_history_t *hist,
+    const uint8_t *data,
+    SUSCOUNT size,
+    uint16_t *prev)
+{
+  SUSCOUNT i, p = 0;
+  unsigned int shift;
+  uint32_t z;
+  int32_t delta;
+
+  for (i = 0; i < hist->header.psd_size; ++i) {
+    z = 0;
+    shift = 0;
+
+    do {
+      if (p >= size || shift > 7 * SUSCAN_SPECTRUM_HISTORY_MAX_VARINT)
+        return SU_FALSE;
+      z |= (uint32_t) (data[p] & 0x7f) << shift;
+      shift += 7;
+    } while (data[p++] & 0x80);
+
+    delta = (int32_t) (z >> 1) ^ -(int32_t) (z & 1);
+    prev[i] += delta;
+  }
+
+  return p == size;
+}
+
+/******************************** Writer *************************************/
+suscan_spectrum_history_t *
+suscan_spectrum_history_create(
+    const char *path,
+    SUSCOUNT psd_size,
+    const struct suscan_spectrum_history_params *params)
+{
+  suscan_spectrum_history_t *new = NULL;
+  uint8_t header[SUSCAN_SPECTRUM_HISTORY_ALIGN];
+
+  SU_TRYCATCH(psd_size > 0, goto fail);
+  SU_TRYCATCH(params->bits == 8 || params->bits == 16, goto fail);
+  SU_TRYCATCH(params->db_min < params->db_max, goto fail);
+  SU_TRYCATCH(params->chunk_frames > 0, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_spectrum_history_t)), goto fail);
+
+  new->fd = -1;
+  new->writable = SU_TRUE;
+
+  memcpy(
+      new->header.magic,
+      SUSCAN_SPECTRUM_HISTORY_MAGIC,
+      sizeof(new->header.magic));
+  new->header.version      = SUSCAN_SPECTRUM_HISTORY_VERSION;
+  new->header.psd_size     = psd_size;
+  new->header.bits         = params->bits;
+  new->header.chunk_frames = params->chunk_frames;
+  new->header.db_min       = params->db_min;
+  new->header.db_max       = params->db_max;
+
+  suscan_spectrum_history_init_quantizer(new);
+
+  SU_TRYCATCH(new->prev = calloc(psd_size, sizeof(uint16_t)), goto fail);
+  SU_TRYCATCH(
+      new->encbuf = malloc(psd_size * SUSCAN_SPECTRUM_HISTORY_MAX_VARINT),
+      goto fail);
+
+  if ((new->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+    SU_ERROR("Cannot create %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  /* The file header takes a whole page */
+  memset(header, 0, sizeof(header));
+  memcpy(header, &new->header, sizeof(new->header));
+
+  SU_TRYCATCH(
+      pwrite(new->fd, header, sizeof(header), 0) == sizeof(header),
+      goto fail);
+
+  new->offset = SUSCAN_SPECTRUM_HISTORY_ALIGN;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_spectrum_history_destroy(new);
+
+  return NULL;
+}
+
+SUBOOL
+suscan_spectrum_history_flush(suscan_spectrum_history_t *hist)
+{
+  struct suscan_spectrum_history_chunk_header chunk;
+  static const uint8_t padding[SUSCAN_SPECTRUM_HISTORY_ALIGN];
+  uint64_t end, pad;
+  size_t size;
+
+  SU_TRYCATCH(hist->writable, return SU_FALSE);
+
+  if (hist->frame_count == 0)
+    return SU_TRUE;
+
+  size = grow_buf_get_size(&hist->payload);
+
+  chunk.magic        = SUSCAN_SPECTRUM_HISTORY_CHUNK_MAGIC;
+  chunk.frame_count  = hist->frame_count;
+  chunk.payload_size = size;
+  chunk.first_ts     = hist->first_ts;
+  chunk.last_ts      = hist->last_ts;
+
+  SU_TRYCATCH(
+      pwrite(hist->fd, &chunk, sizeof(chunk), hist->offset) == sizeof(chunk),
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      pwrite(
+          hist->fd,
+          grow_buf_get_buffer(&hist->payload),
+          size,
+          hist->offset + sizeof(chunk)) == size,
+      return SU_FALSE);
+
+  end = hist->offset + sizeof(chunk) + size;
+  pad = suscan_spectrum_history_align(end) - end;
+
+  if (pad > 0)
+    SU_TRYCATCH(pwrite(hist->fd, padding, pad, end) == pad, return SU_FALSE);
+
+  hist->offset = end + pad;
+
+  /* Next chunk starts with a key frame */
+  grow_buf_shrink(&hist->payload);
+  memset(hist->prev, 0, hist->header.psd_size * sizeof(uint16_t));
+  hist->frame_count = 0;
+
+  return SU_TRUE;
+}
+
+SUBOOL
+suscan_spectrum_history_append(
+    suscan_spectrum_history_t *hist,
+    const struct timespec *ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    const SUFLOAT *psd,
+    SUSCOUNT size)
+{
+  struct suscan_spectrum_history_frame_header frame;
+
+  SU_TRYCATCH(hist->writable, return SU_FALSE);
+  SU_TRYCATCH(size == hist->header.psd_size, return SU_FALSE);
+
+  frame.ts        = suscan_spectrum_history_timespec_to_ns(ts);
+  frame.fc        = fc;
+  frame.samp_rate = samp_rate;
+  frame.size      = suscan_spectrum_history_encode(hist, psd, hist->encbuf);
+
+  SU_TRYCATCH(
+      grow_buf_append(&hist->payload, &frame, sizeof(frame)) != -1,
+      return SU_FALSE);
+
+  SU_TRYCATCH(
+      grow_buf_append(&hist->payload, hist->encbuf, frame.size) != -1,
+      return SU_FALSE);
+
+  if (hist->frame_count++ == 0)
+    hist->first_ts = frame.ts;
+  hist->last_ts = frame.ts;
+
+  if (hist->frame_count >= hist->header.chunk_frames)
+    SU_TRYCATCH(suscan_spectrum_history_flush(hist), return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+/******************************** Reader *************************************/
+SUPRIVATE SUBOOL
+suscan_spectrum_history_build_index(suscan_spectrum_history_t *hist)
+{
+  struct suscan_spectrum_history_chunk_header chunk;
+  struct suscan_spectrum_history_index_entry entry;
+  uint64_t offset = SUSCAN_SPECTRUM_HISTORY_ALIGN;
+
+  while (offset + sizeof(chunk) <= hist->mmap_size) {
+    memcpy(&chunk, (const uint8_t *) hist->mmap_base + offset, sizeof(chunk));
+
+    if (chunk.magic != SUSCAN_SPECTRUM_HISTORY_CHUNK_MAGIC)
+      break;
+
+    if (offset + sizeof(chunk) + chunk.payload_size > hist->mmap_size) {
+      SU_WARNING("Truncated chunk at offset %lu\n", (unsigned long) offset);
+      break;
+    }
+
+    entry.first_ts    = chunk.first_ts;
+    entry.last_ts     = chunk.last_ts;
+    entry.offset      = offset;
+    entry.frame_count = chunk.frame_count;
+
+    SU_TRYCATCH(
+        grow_buf_append(&hist->index, &entry, sizeof(entry)) != -1,
+        return SU_FALSE);
+
+    offset = suscan_spectrum_history_align(
+        offset + sizeof(chunk) + chunk.payload_size);
+  }
+
+  return SU_TRUE;
+}
+
+suscan_spectrum_history_t *
+suscan_spectrum_history_open(const char *path)
+{
+  suscan_spectrum_history_t *new = NULL;
+  struct stat sbuf;
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_spectrum_history_t)), goto fail);
+
+  new->fd = -1;
+  new->mmap_base = (void *) -1;
+
+  if ((new->fd = open(path, O_RDONLY)) == -1) {
+    SU_ERROR("Cannot open %s: %s\n", path, strerror(errno));
+    goto fail;
+  }
+
+  SU_TRYCATCH(fstat(new->fd, &sbuf) != -1, goto fail);
+  SU_TRYCATCH(sbuf.st_size >= SUSCAN_SPECTRUM_HISTORY_ALIGN, goto fail);
+
+  new->mmap_size = sbuf.st_size;
+
+  SU_TRYCATCH(
+      (new->mmap_base = mmap(
+          NULL,
+          new->mmap_size,
+          PROT_READ,
+          MAP_PRIVATE,
+          new->fd,
+          0)) != (void *) -1,
+      goto fail);
+
+  memcpy(&new->header, new->mmap_base, sizeof(new->header));
+
+  if (memcmp(
+      new->header.magic,
+      SUSCAN_SPECTRUM_HISTORY_MAGIC,
+      sizeof(new->header.magic)) != 0) {
+    SU_ERROR("%s: not a spectrum history file\n", path);
+    goto fail;
+  }
+
+  SU_TRYCATCH(
+      new->header.version == SUSCAN_SPECTRUM_HISTORY_VERSION,
+      goto fail);
+  SU_TRYCATCH(new->header.psd_size > 0, goto fail);
+  SU_TRYCATCH(new->header.bits == 8 || new->header.bits == 16, goto fail);
+  SU_TRYCATCH(new->header.db_min < new->header.db_max, goto fail);
+
+  suscan_spectrum_history_init_quantizer(new);
+
+  SU_TRYCATCH(
+      new->prev = calloc(new->header.psd_size, sizeof(uint16_t)),
+      goto fail);
+  SU_TRYCATCH(
+      new->acc = calloc(new->header.psd_size, sizeof(uint16_t)),
+      goto fail);
+  SU_TRYCATCH(
+      new->psd = calloc(new->header.psd_size, sizeof(SUFLOAT)),
+      goto fail);
+
+  SU_TRYCATCH(suscan_spectrum_history_build_index(new), goto fail);
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_spectrum_history_destroy(new);
+
+  return NULL;
+}
+
+SUBOOL
+suscan_spectrum_history_get_time_range(
+    const suscan_spectrum_history_t *hist,
+    struct timespec *start,
+    struct timespec *end)
+{
+  const struct suscan_spectrum_history_index_entry *index =
+      grow_buf_get_buffer(&hist->index);
+  SUSCOUNT count = suscan_spectrum_history_get_chunk_count(hist);
+
+  if (count == 0)
+    return SU_FALSE;
+
+  suscan_spectrum_history_ns_to_timespec(index[0].first_ts, start);
+  suscan_spectrum_history_ns_to_timespec(index[count - 1].last_ts, end);
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+suscan_spectrum_history_emit(
+    suscan_spectrum_history_t *hist,
+    uint64_t ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    suscan_spectrum_history_frame_cb_t cb,
+    void *privdata)
+{
+  struct timespec tv;
+  SUSCOUNT i;
+
+  for (i = 0; i < hist->header.psd_size; ++i)
+    hist->psd[i] = suscan_spectrum_history_dequantize(hist, hist->acc[i]);
+
+  suscan_spectrum_history_ns_to_timespec(ts, &tv);
+
+  return (cb) (privdata, &tv, fc, samp_rate, hist->psd, hist->header.psd_size);
+}
+
+SUBOOL
+suscan_spectrum_history_query(
+    suscan_spectrum_history_t *hist,
+    const struct timespec *start,
+    const struct timespec *end,
+    SUSCOUNT max_frames,
+    suscan_spectrum_history_frame_cb_t cb,
+    void *privdata)
+{
+  const struct suscan_spectrum_history_index_entry *index =
+      grow_buf_get_buffer(&hist->index);
+  SUSCOUNT count = suscan_spectrum_history_get_chunk_count(hist);
+  struct suscan_spectrum_history_chunk_header chunk;
+  struct suscan_spectrum_history_frame_header frame;
+  const uint8_t *data;
+  uint64_t t0 = suscan_spectrum_history_timespec_to_ns(start);
+  uint64_t t1 = suscan_spectrum_history_timespec_to_ns(end);
+  uint64_t width = 1;
+  uint64_t bucket, curr_bucket = 0;
+  uint64_t bucket_ts = 0;
+  uint64_t p;
+  SUFREQ   bucket_fc = 0;
+  SUFLOAT  bucket_fs = 0;
+  SUBOOL   pending = SU_FALSE;
+  SUSCOUNT lo = 0, hi = count, mid;
+  SUSCOUNT c, i, j;
+
+  if (t1 < t0 || count == 0)
+    return SU_TRUE;
+
+  if (max_frames > 0)
+    width = SU_MAX((t1 - t0) / max_frames, 1);
+
+  /* Binary search: first chunk ending after t0 */
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (index[mid].last_ts < t0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  for (c = lo; c < count && index[c].first_ts <= t1; ++c) {
+    data = (const uint8_t *) hist->mmap_base + index[c].offset;
+    memcpy(&chunk, data, sizeof(chunk));
+    data += sizeof(chunk);
+
+    /* Every chunk starts with a key frame */
+    memset(hist->prev, 0, hist->header.psd_size * sizeof(uint16_t));
+
+    for (i = 0, p = 0; i < index[c].frame_count; ++i) {
+      SU_TRYCATCH(p + sizeof(frame) <= chunk.payload_size, return SU_FALSE);
+      memcpy(&frame, data + p, sizeof(frame));
+      p += sizeof(frame);
+
+      SU_TRYCATCH(p + frame.size <= chunk.payload_size, return SU_FALSE);
+      SU_TRYCATCH(
+          suscan_spectrum_history_decode(hist, data + p, frame.size, hist->prev),
+          return SU_FALSE);
+      p += frame.size;
+
+      if (frame.ts < t0)
+        continue;
+
+      if (frame.ts > t1)
+        break;
+
+      bucket = (frame.ts - t0) / width;
+      if (max_frames > 0 && bucket >= max_frames)
+        bucket = max_frames - 1;
+
+      if (pending
+          && (max_frames == 0 || bucket != curr_bucket || frame.fc != bucket_fc)) {
+        SU_TRYCATCH(
+            suscan_spectrum_history_emit(
+                hist,
+                bucket_ts,
+                bucket_fc,
+                bucket_fs,
+                cb,
+                privdata),
+            return SU_FALSE);
+        pending = SU_FALSE;
+      }
+
+      if (!pending) {
+        memcpy(hist->acc, hist->prev, hist->header.psd_size * sizeof(uint16_t));
+        curr_bucket = bucket;
+        bucket_ts   = frame.ts;
+        bucket_fc   = frame.fc;
+        bucket_fs   = frame.samp_rate;
+        pending     = SU_TRUE;
+      } else {
+        /* Max-hold: keeps short bursts visible in decimated reads */
+        for (j = 0; j < hist->header.psd_size; ++j)
+          if (hist->prev[j] > hist->acc[j])
+            hist->acc[j] = hist->prev[j];
+      }
+    }
+  }
+
+  if (pending)
+    SU_TRYCATCH(
+        suscan_spectrum_history_emit(
+            hist,
+            bucket_ts,
+            bucket_fc,
+            bucket_fs,
+            cb,
+            privdata),
+        return SU_FALSE);
+
+  return SU_TRUE;
+}
+
+void
+suscan_spectrum_history_destroy(suscan_spectrum_history_t *hist)
+{
+  if (hist->writable && hist->fd != -1)
+    if (!suscan_spectrum_history_flush(hist))
+      SU_ERROR("Failed to flush last chunk, spectrum history truncated\n");
+
+  if (hist->mmap_base != NULL && hist->mmap_base != (void *) -1)
+    munmap(hist->mmap_base, hist->mmap_size);
+
+  if (hist->fd != -1)
+    close(hist->fd);
+
+  grow_buf_finalize(&hist->payload);
+  grow_buf_finalize(&hist->index);
+
+  if (hist->prev != NULL)
+    free(hist->prev);
+
+  if (hist->encbuf != NULL)
+    free(hist->encbuf);
+
+  if (hist->acc != NULL)
+    free(hist->acc);
+
+  if (hist->psd != NULL)
+    free(hist->psd);
+
+  free(hist);
+}
@@ -0,0 +1,194 @@
+/*
+
+  Copyright (C) 2019 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SPECHIST_H
+#define _SPECHIST_H
+
+#include <sigutils/sigutils.h>
+#include <stdint.h>
+#include <time.h>
+#include <util.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Spectrum history store. PSD frames are quantized to 8 or 16 bit dB
+ * levels, delta-coded against the previous frame of the same chunk and
+ * packed as zigzag varints. Chunks are page-aligned so that readers can
+ * mmap the whole file and locate chunks by scanning their headers, which
+ * hold the time range they cover.
+ *
+ * Frames are stored in ascending frequency order.
+ */
+
+#define SUSCAN_SPECTRUM_HISTORY_MAGIC         "SUSPHIST"
+#define SUSCAN_SPECTRUM_HISTORY_CHUNK_MAGIC   0x4b435053 /* SPCK */
+#define SUSCAN_SPECTRUM_HISTORY_VERSION       1
+#define SUSCAN_SPECTRUM_HISTORY_ALIGN         4096
+
+struct suscan_spectrum_history_params {
+  unsigned int bits;         /* 8 or 16 */
+  SUFLOAT      db_min;       /* Quantization range */
+  SUFLOAT      db_max;
+  unsigned int chunk_frames; /* Frames per chunk */
+};
+
+#define suscan_spectrum_history_params_INITIALIZER {                   \
+  8,             /* bits */                                             \
+  -150,          /* db_min */                                           \
+  50,            /* db_max */                                           \
+  256            /* chunk_frames */                                     \
+}
+
+/* On-disk structures */
+struct suscan_spectrum_history_header {
+  char     magic[8];
+  uint32_t version;
+  uint32_t psd_size;
+  uint32_t bits;
+  uint32_t chunk_frames;
+  float    db_min;
+  float    db_max;
+  uint8_t  reserved[32];
+};
+
+struct suscan_spectrum_history_chunk_header {
+  uint32_t magic;
+  uint32_t frame_count;
+  uint64_t payload_size;
+  uint64_t first_ts;      /* Nanoseconds since the epoch */
+  uint64_t last_ts;
+};
+
+struct suscan_spectrum_history_frame_header {
+  uint64_t ts;
+  double   fc;
+  float    samp_rate;
+  uint32_t size;          /* Encoded size, in bytes */
+};
+
+/* In-memory time index, one entry per chunk */
+struct suscan_spectrum_history_index_entry {
+  uint64_t first_ts;
+  uint64_t last_ts;
+  uint64_t offset;
+  uint32_t frame_count;
+};
+
+struct suscan_spectrum_history {
+  struct suscan_spectrum_history_header header;
+  SUBOOL   writable;
+  int      fd;
+  SUFLOAT  q_scale;       /* Levels per dB */
+  uint32_t q_max;
+
+  /* Writer state */
+  uint64_t   offset;      /* Offset of the next chunk */
+  grow_buf_t payload;     /* Current chunk */
+  uint32_t   frame_count;
+  uint64_t   first_ts;
+  uint64_t   last_ts;
+  uint16_t  *prev;        /* Last frame of the chunk, quantized */
+  uint8_t   *encbuf;
+
+  /* Reader state */
+  void      *mmap_base;
+  size_t     mmap_size;
+  grow_buf_t index;       /* Of struct suscan_spectrum_history_index_entry */
+  uint16_t  *acc;         /* Time decimation accumulator */
+  SUFLOAT   *psd;
+};
+
+typedef struct suscan_spectrum_history suscan_spectrum_history_t;
+
+/*
+ * Callback for time range queries. Frames are given in linear power
+ * units, as in PSD messages.
+ */
+typedef SUBOOL (*suscan_spectrum_history_frame_cb_t) (
+    void *privdata,
+    const struct timespec *ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    const SUFLOAT *psd,
+    SUSCOUNT size);
+
+SUINLINE SUSCOUNT
+suscan_spectrum_history_get_psd_size(const suscan_spectrum_history_t *hist)
+{
+  return hist->header.psd_size;
+}
+
+SUINLINE SUSCOUNT
+suscan_spectrum_history_get_chunk_count(const suscan_spectrum_history_t *hist)
+{
+  return grow_buf_get_size(&hist->index)
+      / sizeof(struct suscan_spectrum_history_index_entry);
+}
+
+/* Creates a new history file, truncating it if it already exists */
+suscan_spectrum_history_t *suscan_spectrum_history_create(
+    const char *path,
+    SUSCOUNT psd_size,
+    const struct suscan_spectrum_history_params *params);
+
+/* Opens an existing history file for reading */
+suscan_spectrum_history_t *suscan_spectrum_history_open(const char *path);
+
+/* Appends a frame in ascending frequency order */
+SUBOOL suscan_spectrum_history_append(
+    suscan_spectrum_history_t *hist,
+    const struct timespec *ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    const SUFLOAT *psd,
+    SUSCOUNT size);
+
+/* Writes the current chunk to disk */
+SUBOOL suscan_spectrum_history_flush(suscan_spectrum_history_t *hist);
+
+SUBOOL suscan_spectrum_history_get_time_range(
+    const suscan_spectrum_history_t *hist,
+    struct timespec *start,
+    struct timespec *end);
+
+/*
+ * Reads all frames between start and end. If max_frames is not zero,
+ * the time range is split in max_frames intervals and frames falling in
+ * the same interval (and center frequency) are merged by keeping the
+ * maximum of each bin.
+ */
+SUBOOL suscan_spectrum_history_query(
+    suscan_spectrum_history_t *hist,
+    const struct timespec *start,
+    const struct timespec *end,
+    SUSCOUNT max_frames,
+    suscan_spectrum_history_frame_cb_t cb,
+    void *privdata);
+
+void suscan_spectrum_history_destroy(suscan_spectrum_history_t *hist);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _SPECHIST_H */
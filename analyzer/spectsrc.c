@@ -23,6 +23,7 @@
 #define SU_LOG_DOMAIN "spectsrc"
 
 #include "spectsrc.h"
+#include "inspector/pipeline.h"
 #include <sigutils/taps.h>
 
 PTR_LIST_CONST(struct suscan_spectsrc_class, spectsrc_class);
@@ -136,14 +137,16 @@ suscan_spectsrc_new(
       new->privdata = (class->ctor) (new),
       goto fail);
 
-  SU_TRYCATCH(
-      (new->fft_plan = SU_FFTW(_plan_dft_1d)(
-          new->window_size,
-          new->window_buffer,
-          new->window_buffer,
-          FFTW_FORWARD,
-          FFTW_MEASURE)),
-      goto fail);
+  suscan_inspector_fftw_lock();
+  new->fft_plan = SU_FFTW(_plan_dft_1d)(
+      new->window_size,
+      new->window_buffer,
+      new->window_buffer,
+      FFTW_FORWARD,
+      FFTW_MEASURE);
+  suscan_inspector_fftw_unlock();
+
+  SU_TRYCATCH(new->fft_plan != NULL, goto fail);
 
   return new;
 
@@ -233,8 +236,11 @@ suscan_spectsrc_destroy(suscan_spectsrc_t *spectsrc)
   if (spectsrc != NULL)
     (spectsrc->classptr->dtor) (spectsrc->privdata);
 
-  if (spectsrc->fft_plan != NULL)
+  if (spectsrc->fft_plan != NULL) {
+    suscan_inspector_fftw_lock();
     SU_FFTW(_destroy_plan)(spectsrc->fft_plan);
+    suscan_inspector_fftw_unlock();
+  }
 
   if (spectsrc->window_func != NULL)
     free(spectsrc->window_func);
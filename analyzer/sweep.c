@@ -0,0 +1,215 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#define SU_LOG_DOMAIN "sweep-planner"
+
+#include "sweep.h"
+
+void
+suscan_sweep_planner_destroy(suscan_sweep_planner_t *self)
+{
+  if (self->hops != NULL)
+    free(self->hops);
+
+  free(self);
+}
+
+SUPRIVATE void
+suscan_sweep_planner_apply_bands(
+    suscan_sweep_planner_t *self,
+    const struct suscan_sweep_band *bands,
+    unsigned int band_count)
+{
+  struct suscan_sweep_hop *hop;
+  SUFREQ lo, hi;
+  SUFLOAT weight;
+  SUSCOUNT i;
+  unsigned int j;
+
+  for (i = 0; i < self->hop_count; ++i) {
+    hop = self->hops + i;
+
+    /* Portion of the spectrum this hop is responsible for */
+    lo = hop->fc - .5 * self->spacing;
+    hi = hop->fc + .5 * self->spacing;
+    weight = 0;
+
+    for (j = 0; j < band_count; ++j) {
+      if (bands[j].f_hi < lo || bands[j].f_lo > hi)
+        continue;
+
+      /* Overlapping bands: the heaviest one wins, even if below 1 */
+      if (bands[j].weight > weight)
+        weight = bands[j].weight;
+
+      if (bands[j].revisit > 0
+          && (hop->revisit == 0 || bands[j].revisit < hop->revisit))
+        hop->revisit = bands[j].revisit;
+    }
+
+    hop->stride = 1. / (weight > 0 ? weight : 1);
+  }
+}
+
+suscan_sweep_planner_t *
+suscan_sweep_planner_new(
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUFREQ fs,
+    SUFLOAT overlap,
+    const struct suscan_sweep_band *bands,
+    unsigned int band_count)
+{
+  suscan_sweep_planner_t *new = NULL;
+  SUFREQ step, span;
+  SUSCOUNT i;
+
+  SU_TRYCATCH(fs > 0, goto fail);
+  SU_TRYCATCH(max_freq > min_freq, goto fail);
+  SU_TRYCATCH(overlap >= 0 && overlap < 1, goto fail);
+
+  SU_TRYCATCH(new = calloc(1, sizeof(suscan_sweep_planner_t)), goto fail);
+
+  new->min_freq = min_freq;
+  new->max_freq = max_freq;
+  new->fs       = fs;
+
+  /* Centers run from min_freq + fs / 2 to max_freq - fs / 2 */
+  step = fs * (1 - overlap);
+  span = max_freq - min_freq - fs;
+
+  if (span <= 0) {
+    new->hop_count = 1;
+    new->spacing   = fs;
+  } else {
+    new->hop_count = SU_CEIL(span / step) + 1;
+    new->spacing   = span / (new->hop_count - 1);
+  }
+
+  SU_TRYCATCH(
+      new->hops = calloc(new->hop_count, sizeof(struct suscan_sweep_hop)),
+      goto fail);
+
+  for (i = 0; i < new->hop_count; ++i)
+    new->hops[i].fc = span <= 0
+        ? .5 * (min_freq + max_freq)
+        : min_freq + .5 * fs + i * new->spacing;
+
+  suscan_sweep_planner_apply_bands(new, bands, band_count);
+
+  new->current = new->hop_count - 1;
+  new->pending = new->hop_count;
+  new->revisit_credit = 1;
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_sweep_planner_destroy(new);
+
+  return NULL;
+}
+
+/*
+ * Most overdue hop, relative to its revisit target. -1 if none. Hops
+ * never visited count from time 0.
+ */
+SUPRIVATE SUSDIFF
+suscan_sweep_planner_find_overdue(
+    const suscan_sweep_planner_t *self,
+    double now)
+{
+  const struct suscan_sweep_hop *hop;
+  double ratio, best_ratio = 0;
+  SUSDIFF best = -1;
+  SUSCOUNT i;
+
+  for (i = 0; i < self->hop_count; ++i) {
+    hop = self->hops + i;
+
+    if (hop->revisit <= 0)
+      continue;
+
+    ratio = (now - hop->last) / hop->revisit;
+    if (ratio >= 1 && (best == -1 || ratio > best_ratio)) {
+      best_ratio = ratio;
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+SUFREQ
+suscan_sweep_planner_next(suscan_sweep_planner_t *self, double now)
+{
+  struct suscan_sweep_hop *hop;
+  double min_pass;
+  SUSDIFF chosen;
+  SUSCOUNT i, j;
+
+  self->revisit_credit = SU_MIN(
+      self->revisit_credit + SUSCAN_SWEEP_PLANNER_REVISIT_SHARE,
+      1);
+
+  chosen = -1;
+  if (self->revisit_credit >= 1
+      && (chosen = suscan_sweep_planner_find_overdue(self, now)) != -1)
+    self->revisit_credit -= 1;
+
+  if (chosen == -1) {
+    /* Lowest pass, starting right after the current hop */
+    chosen = (self->current + 1) % self->hop_count;
+    for (i = 1; i < self->hop_count; ++i) {
+      j = (self->current + 1 + i) % self->hop_count;
+      if (self->hops[j].pass < self->hops[chosen].pass)
+        chosen = j;
+    }
+  }
+
+  hop = self->hops + chosen;
+  hop->pass += hop->stride;
+  hop->last  = now;
+
+  if (!hop->visited) {
+    hop->visited = SU_TRUE;
+    if (--self->pending == 0) {
+      ++self->sweeps;
+      self->pending = self->hop_count;
+
+      /* Rebase passes, keeping only their relative order */
+      min_pass = self->hops[0].pass;
+      for (i = 1; i < self->hop_count; ++i)
+        if (self->hops[i].pass < min_pass)
+          min_pass = self->hops[i].pass;
+
+      for (i = 0; i < self->hop_count; ++i) {
+        self->hops[i].visited = SU_FALSE;
+        self->hops[i].pass   -= min_pass;
+      }
+    }
+  }
+
+  self->current = chosen;
+
+  return hop->fc;
+}
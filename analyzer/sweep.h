@@ -0,0 +1,116 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _SWEEP_H
+#define _SWEEP_H
+
+#include <sigutils/sigutils.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Largest fraction of hops that may be spent on overdue revisits */
+#define SUSCAN_SWEEP_PLANNER_REVISIT_SHARE .5
+
+/*
+ * Band of interest. Hops overlapping it are visited `weight' times as
+ * often as the rest (weights below 1 make them less frequent) and, if
+ * revisit is nonzero, at least once every `revisit' seconds, as long as
+ * revisits stay within their share of hops.
+ */
+struct suscan_sweep_band {
+  SUFREQ  f_lo;
+  SUFREQ  f_hi;
+  SUFLOAT weight;
+  SUFLOAT revisit;
+};
+
+struct suscan_sweep_hop {
+  SUFREQ   fc;
+  double   stride;   /* Inverse of the hop weight */
+  double   pass;     /* Virtual time of the next visit */
+  double   revisit;  /* Revisit target (0: none) */
+  double   last;     /* Time of the last visit */
+  SUBOOL   visited;  /* Visited in the current sweep */
+};
+
+/*
+ * Deterministic sweep planner. The range is split into equally spaced
+ * hops, overlapping by (at least) the given fraction of the sample rate.
+ * Hops are chosen by stride scheduling: every hop advances its pass by
+ * the inverse of its weight when visited, and the hop with the lowest
+ * pass goes next (ties resolved in frequency order, after the current
+ * hop). With equal weights, this is a plain stepped sweep. In any case,
+ * a hop of weight w is visited at least once every W / w hops, with W
+ * the sum of all weights, so every sweep completes in bounded time.
+ * Passes are rebased after every sweep so they stay small.
+ *
+ * Hops whose revisit target has expired take precedence, the most
+ * overdue first, but only while revisits stay within
+ * SUSCAN_SWEEP_PLANNER_REVISIT_SHARE of all hops, which stretches the
+ * bound above by 1 / (1 - share) at most. Otherwise, a short revisit
+ * target could starve the rest of the range.
+ */
+struct suscan_sweep_planner {
+  SUFREQ   min_freq;
+  SUFREQ   max_freq;
+  SUFREQ   fs;
+  SUFREQ   spacing;
+  SUSCOUNT hop_count;
+  struct suscan_sweep_hop *hops;
+  SUSCOUNT current;
+  SUSCOUNT pending;  /* Hops not visited in the current sweep */
+  SUSCOUNT sweeps;   /* Completed sweeps */
+  double   revisit_credit; /* A revisit is allowed when it reaches 1 */
+};
+
+typedef struct suscan_sweep_planner suscan_sweep_planner_t;
+
+SUINLINE SUSCOUNT
+suscan_sweep_planner_get_hop_count(const suscan_sweep_planner_t *self)
+{
+  return self->hop_count;
+}
+
+SUINLINE SUSCOUNT
+suscan_sweep_planner_get_sweep_count(const suscan_sweep_planner_t *self)
+{
+  return self->sweeps;
+}
+
+suscan_sweep_planner_t *suscan_sweep_planner_new(
+    SUFREQ min_freq,
+    SUFREQ max_freq,
+    SUFREQ fs,
+    SUFLOAT overlap,
+    const struct suscan_sweep_band *bands,
+    unsigned int band_count);
+
+/* Returns the center frequency of the next hop. `now' is in seconds. */
+SUFREQ suscan_sweep_planner_next(suscan_sweep_planner_t *self, double now);
+
+void suscan_sweep_planner_destroy(suscan_sweep_planner_t *self);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _SWEEP_H */
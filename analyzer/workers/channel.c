@@ -87,18 +87,33 @@ suscan_analyzer_feed_baseband_filters(
     const SUCOMPLEX *samples,
     SUSCOUNT length)
 {
+  struct suscan_analyzer_baseband_filter *filter;
+  suscan_sample_buffer_t *buf = NULL;
   unsigned int i;
+  SUBOOL ok = SU_TRUE;
 
-  for (i = 0; i < analyzer->bbfilt_count; ++i)
-    if (analyzer->bbfilt_list[i] != NULL)
-      if (!analyzer->bbfilt_list[i]->func(
-          analyzer->bbfilt_list[i]->privdata,
-          analyzer,
-          samples,
-          length))
-        return SU_FALSE;
+  for (i = 0; i < analyzer->bbfilt_count && ok; ++i) {
+    if ((filter = analyzer->bbfilt_list[i]) == NULL)
+      continue;
 
-  return SU_TRUE;
+    if (filter->tap == NULL) {
+      ok = (filter->func) (filter->privdata, analyzer, samples, length);
+    } else {
+      /* All asynchronous filters share the same copy */
+      if (buf == NULL)
+        SU_TRYCATCH(
+            buf = suscan_sample_buffer_new(samples, length),
+            return SU_FALSE);
+
+      /* Full queues drop the block, the tap keeps count */
+      (void) suscan_bbtap_push(filter->tap, buf);
+    }
+  }
+
+  if (buf != NULL)
+    suscan_sample_buffer_unref(buf);
+
+  return ok;
 }
 
 SUPRIVATE SUBOOL
@@ -152,6 +167,124 @@ suscan_analyzer_feed_inspectors(
   return ok;
 }
 
+SUPRIVATE SUBOOL
+suscan_analyzer_psd_slice_cb(
+    struct suscan_mq *mq_out,
+    void *wk_private,
+    void *cb_private)
+{
+  suscan_parallel_psd_slice_run(
+      (struct suscan_parallel_psd_slice *) cb_private);
+
+  return SU_FALSE;
+}
+
+SUPRIVATE SUBOOL
+suscan_analyzer_feed_parallel_psd(
+    suscan_analyzer_t *analyzer,
+    const SUCOMPLEX *data,
+    SUSCOUNT size)
+{
+  suscan_parallel_psd_t *parpsd = analyzer->parpsd;
+  unsigned int i;
+  SUSCOUNT got;
+  SUBOOL ok = SU_TRUE;
+
+  while (size > 0) {
+    got = suscan_parallel_psd_feed(parpsd, data, size);
+
+    if (suscan_parallel_psd_is_full(parpsd)) {
+      /* One slice per worker, sharing the queues with the inspectors */
+      suscan_analyzer_enter_sched(analyzer);
+
+      for (i = 0; i < suscan_parallel_psd_get_slice_count(parpsd); ++i)
+        if (!suscan_inspsched_queue_job(
+            analyzer->sched,
+            suscan_analyzer_psd_slice_cb,
+            suscan_parallel_psd_get_slice(parpsd, i))) {
+          ok = SU_FALSE;
+          break;
+        }
+
+      /* Queued slices must be done before the batch is reused */
+      if (!suscan_inspsched_sync(analyzer->sched))
+        ok = SU_FALSE;
+
+      suscan_analyzer_leave_sched(analyzer);
+
+      if (!ok)
+        return SU_FALSE;
+
+      suscan_parallel_psd_reduce(parpsd);
+    }
+
+    data += got;
+    size -= got;
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Feeds the PSD consumers (detector and parallel PSD). When overloaded,
+ * only one FFT window out of every `stride' is kept: whole windows are
+ * fed and skipped, so no window mixes samples from unrelated parts of
+ * the stream, whatever the size of the reads.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_feed_detectors(
+    suscan_analyzer_t *analyzer,
+    const SUCOMPLEX *data,
+    SUSCOUNT size)
+{
+  suscan_parallel_psd_t *parpsd = analyzer->parpsd;
+  SUSCOUNT window = analyzer->detector->params.window_size;
+  SUSCOUNT period;
+  SUSCOUNT chunk;
+  SUBOOL feed_detector;
+
+  period = window * suscan_load_controller_get_stride(&analyzer->loadctl);
+
+  /* With a parallel PSD, the detector is only needed for channels */
+  feed_detector = parpsd == NULL || analyzer->interval_channels > 0;
+
+  while (size > 0) {
+    if (analyzer->det_phase >= period)
+      analyzer->det_phase = 0;
+
+    if (analyzer->det_phase < window) {
+      chunk = SU_MIN(size, window - analyzer->det_phase);
+
+      /* A new parallel PSD joins at the start of the next window */
+      if (parpsd != NULL
+          && suscan_parallel_psd_get_window_ptr(parpsd)
+          == analyzer->det_phase)
+        SU_TRYCATCH(
+            suscan_analyzer_feed_parallel_psd(analyzer, data, chunk),
+            return SU_FALSE);
+
+      if (feed_detector)
+        SU_TRYCATCH(
+            su_channel_detector_feed_bulk(
+                analyzer->detector,
+                data,
+                chunk) == chunk,
+            return SU_FALSE);
+    } else {
+      chunk = SU_MIN(size, period - analyzer->det_phase);
+    }
+
+    analyzer->det_phase += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+
+  return SU_TRUE;
+}
+
+/* Defined in analyzer.c */
+SUBOOL suscan_analyzer_control_load(suscan_analyzer_t *self);
+
 /******************** Source worker for channel mode *************************/
 SUBOOL
 suscan_source_channel_wk_cb(
@@ -167,6 +300,7 @@ suscan_source_channel_wk_cb(
   unsigned int i;
   struct timespec sub;
   SUFLOAT seconds;
+  SUSCOUNT read;
 
   SU_TRYCATCH(suscan_analyzer_lock_loop(analyzer), goto done);
   mutex_acquired = SU_TRUE;
@@ -194,6 +328,7 @@ suscan_source_channel_wk_cb(
       analyzer->read_buf,
       read_size)) > 0) {
     suscan_analyzer_process_start(analyzer);
+    read = got;
 
     if (analyzer->iq_rev)
       suscan_analyzer_do_iq_rev(analyzer->read_buf, got);
@@ -208,6 +343,10 @@ suscan_source_channel_wk_cb(
           goto done);
     }
 
+    /* Narrow down to the band of interest, if requested */
+    if (analyzer->frontend != NULL)
+      got = suscan_frontend_feed(analyzer->frontend, analyzer->read_buf, got);
+
     SU_TRYCATCH(
         suscan_analyzer_feed_baseband_filters(
             analyzer,
@@ -215,12 +354,12 @@ suscan_source_channel_wk_cb(
             got),
         goto done);
 
-    /* Feed channel detector! */
+    /* Feed channel detector, skipping windows if overloaded */
     SU_TRYCATCH(
-        su_channel_detector_feed_bulk(
-            analyzer->detector,
+        suscan_analyzer_feed_detectors(
+            analyzer,
             analyzer->read_buf,
-            got) == got,
+            got),
         goto done);
 
     /* Check channel update */
@@ -242,7 +381,8 @@ suscan_source_channel_wk_cb(
       timespecsub(&analyzer->read_start, &analyzer->last_psd, &sub);
       seconds = sub.tv_sec + sub.tv_nsec * 1e-9;
 
-      if (seconds >= analyzer->interval_psd) {
+      if (seconds >= analyzer->interval_psd
+          * suscan_load_controller_get_psd_factor(&analyzer->loadctl)) {
         SU_TRYCATCH(
             suscan_analyzer_send_psd(analyzer, analyzer->detector),
             goto done);
@@ -264,7 +404,7 @@ suscan_source_channel_wk_cb(
 #endif /* SUSCAN_DEBUG_THROTTLE */
       }
 
-      analyzer->measured_samp_count += got;
+      analyzer->measured_samp_count += read;
     }
 
     /* Feed inspectors! */
@@ -272,6 +412,8 @@ suscan_source_channel_wk_cb(
         suscan_analyzer_feed_inspectors(analyzer, analyzer->read_buf, got),
         goto done);
 
+    SU_TRYCATCH(suscan_analyzer_control_load(analyzer), goto done);
+
   } else {
     analyzer->eos = SU_TRUE;
     analyzer->cpu_usage = 0;
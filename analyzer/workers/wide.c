@@ -19,8 +19,14 @@
 */
 
 /*
- * This is the wide spectrum analyzer: walks the whole spectrum randomly,
- * given two limits, and returns PSD messages.
+ * This is the wide spectrum analyzer: sweeps the spectrum between two
+ * limits, as planned by a suscan_sweep_planner, and returns PSD messages,
+ * either one per hop or stitched into a suscan_panorama.
+ *
+ * Several devices may take part in the sweep. Each one is driven by a
+ * sweep unit, running in its own worker and sweeping its own slice of
+ * the range. Unit 0 works on the analyzer's source, detector and source
+ * worker.
  */
 
 #include <stdlib.h>
@@ -40,45 +46,590 @@
 #include "mq.h"
 #include "msg.h"
 
+/*
+ * Sweep state of a single device. Units other than 0 own their source,
+ * detector, read buffer and worker.
+ */
+struct suscan_analyzer_sweep_unit {
+  unsigned int index;
+  SUBOOL owned;
+  SUBOOL failed;
+  suscan_source_t *source;
+  suscan_worker_t *worker;
+  su_channel_detector_t *detector;
+  SUCOMPLEX *read_buf;
+  SUSCOUNT   read_size;
+  unsigned int det_gen;    /* Detector params generation in use */
+
+  /* Sweep plan */
+  unsigned int params_gen; /* Sweep params generation in use */
+  struct suscan_analyzer_sweep_params params;
+  suscan_sweep_planner_t *planner; /* NULL: idle unit */
+  double   sweep_time;     /* Seconds of samples read since planning */
+  SUSCOUNT sweeps;         /* Completed sweeps, protected by sweep_mutex */
+
+  /* Current hop */
+  SUFREQ   curr_freq;
+  suscan_settle_estimator_t *settle;
+  SUSCOUNT hop_discard;    /* Samples left to discard after the last hop */
+  SUBOOL   hop_anchored;   /* Retune instant located in the stream */
+  SUBOOL   hop_settled;
+};
+
+SUINLINE void
+suscan_analyzer_request_sweep_params(suscan_analyzer_t *self)
+{
+  __atomic_add_fetch(&self->sweep_params_gen, 1, __ATOMIC_RELEASE);
+}
+
+SUINLINE su_channel_detector_t *
+suscan_analyzer_sweep_unit_get_detector(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit)
+{
+  return unit->owned ? unit->detector : self->detector;
+}
+
+void
+suscan_analyzer_sweep_unit_destroy(struct suscan_analyzer_sweep_unit *unit)
+{
+  if (unit->worker != NULL)
+    if (!suscan_analyzer_halt_worker(unit->worker)) {
+      SU_ERROR("Sweep unit worker destruction failed, memory leak ahead\n");
+      return;
+    }
+
+  if (unit->owned) {
+    if (unit->source != NULL) {
+      if (suscan_source_is_capturing(unit->source))
+        suscan_source_stop_capture(unit->source);
+      suscan_source_destroy(unit->source);
+    }
+
+    if (unit->detector != NULL)
+      su_channel_detector_destroy(unit->detector);
+
+    if (unit->read_buf != NULL)
+      free(unit->read_buf);
+  }
+
+  if (unit->planner != NULL)
+    suscan_sweep_planner_destroy(unit->planner);
+
+  if (unit->settle != NULL)
+    suscan_settle_estimator_destroy(unit->settle);
+
+  free(unit);
+}
+
+void
+suscan_analyzer_sweep_unit_force_eos(struct suscan_analyzer_sweep_unit *unit)
+{
+  if (unit->owned && unit->source != NULL)
+    suscan_source_force_eos(unit->source);
+}
+
+/* With a NULL config, the unit works on the analyzer's own source */
+struct suscan_analyzer_sweep_unit *
+suscan_analyzer_sweep_unit_new(
+    suscan_analyzer_t *self,
+    suscan_source_config_t *config)
+{
+  struct suscan_analyzer_sweep_unit *new = NULL;
+
+  SU_TRYCATCH(
+      new = calloc(1, sizeof(struct suscan_analyzer_sweep_unit)),
+      goto fail);
+
+  SU_TRYCATCH(new->settle = suscan_settle_estimator_new(), goto fail);
+
+  new->read_size = self->read_size;
+
+  if (config == NULL) {
+    new->source   = self->source;
+    new->read_buf = self->read_buf;
+  } else {
+    new->owned = SU_TRUE;
+
+    SU_TRYCATCH(new->source = suscan_source_new(config), goto fail);
+    SU_TRYCATCH(
+        suscan_source_get_type(new->source) == SUSCAN_SOURCE_TYPE_SDR,
+        goto fail);
+    SU_TRYCATCH(
+        new->read_buf = malloc(new->read_size * sizeof(SUCOMPLEX)),
+        goto fail);
+    SU_TRYCATCH(suscan_source_start_capture(new->source), goto fail);
+
+    /* All devices must provide the same sample rate */
+    if (SU_ABS(suscan_source_get_samp_rate(new->source)
+        - suscan_analyzer_get_samp_rate(self)) >= 1) {
+      SU_ERROR(
+          "Sweep device runs at %g sps (expected %g sps)\n",
+          suscan_source_get_samp_rate(new->source),
+          suscan_analyzer_get_samp_rate(self));
+      goto fail;
+    }
+  }
+
+  return new;
+
+fail:
+  if (new != NULL)
+    suscan_analyzer_sweep_unit_destroy(new);
+
+  return NULL;
+}
+
+/*
+ * Fraction of the sample rate to discard at both sides of every hop, where
+ * the anti-alias filter of the device bends the spectrum. At least half of
+ * the overlap is left, so neighboring hops still overlap.
+ */
+SUINLINE SUFLOAT
+suscan_analyzer_get_sweep_edge(
+    const struct suscan_analyzer_sweep_params *params)
+{
+  return SU_MIN(SUSCAN_PANORAMA_EDGE_FRACTION, .25 * params->overlap);
+}
+
+/* Called with the sweep mutex held */
+SUPRIVATE SUBOOL
+suscan_analyzer_init_signal_catalog(
+    suscan_analyzer_t *self,
+    const struct suscan_analyzer_sweep_params *params)
+{
+  SUFLOAT edge = suscan_analyzer_get_sweep_edge(params);
+
+  if (!params->catalog) {
+    if (self->signal_catalog != NULL) {
+      suscan_signal_catalog_destroy(self->signal_catalog);
+      self->signal_catalog = NULL;
+    }
+  } else if (self->signal_catalog == NULL) {
+    SU_TRYCATCH(
+        self->signal_catalog = suscan_signal_catalog_new(
+            params->catalog_snr,
+            edge),
+        return SU_FALSE);
+  } else {
+    /* Keep what we found so far */
+    suscan_signal_catalog_set_threshold(
+        self->signal_catalog,
+        params->catalog_snr,
+        edge);
+  }
+
+  return SU_TRUE;
+}
+
+/* Called with the sweep mutex held */
+SUPRIVATE SUBOOL
+suscan_analyzer_init_panorama(
+    suscan_analyzer_t *self,
+    const struct suscan_analyzer_sweep_params *params,
+    const su_channel_detector_t *detector)
+{
+  suscan_panorama_t *panorama = NULL;
+  SUSCOUNT size = params->panorama_bins;
+  SUFLOAT fs;
+  SUFLOAT edge;
+
+  if (params->panorama) {
+    /* By default, keep the resolution of the detector */
+    if (size == 0) {
+      fs = detector->params.samp_rate;
+      if (detector->params.decimation > 1)
+        fs /= detector->params.decimation;
+
+      size = (SUSCOUNT) SU_CEIL(
+          (params->max_freq - params->min_freq)
+          * detector->params.window_size / fs);
+    }
+
+    if (size > SUSCAN_PANORAMA_MAX_SIZE)
+      size = SUSCAN_PANORAMA_MAX_SIZE;
+
+    edge = suscan_analyzer_get_sweep_edge(params);
+
+    SU_TRYCATCH(
+        panorama = suscan_panorama_new(
+            params->min_freq,
+            params->max_freq,
+            size,
+            edge),
+        return SU_FALSE);
+  }
+
+  if (self->panorama != NULL)
+    suscan_panorama_destroy(self->panorama);
+
+  self->panorama        = panorama;
+  self->last_panorama   = 0;
+  self->panorama_sweeps = 0;
+
+  return SU_TRUE;
+}
+
+/*
+ * Called with the sweep mutex held. With several devices, a sweep is
+ * complete once every device completed its slice.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_panorama_due(
+    suscan_analyzer_t *self,
+    const struct suscan_analyzer_sweep_unit *unit)
+{
+  const struct suscan_analyzer_sweep_unit *other;
+  SUSCOUNT sweeps = unit->sweeps;
+  unsigned int i;
+
+  if (unit->params.panorama_int > 0) {
+    if (unit->sweep_time < self->last_panorama)
+      self->last_panorama = 0;
+
+    if (unit->sweep_time - self->last_panorama < unit->params.panorama_int)
+      return SU_FALSE;
+
+    self->last_panorama = unit->sweep_time;
+  } else {
+    for (i = 0; i < self->sweep_unit_count; ++i) {
+      other = self->sweep_unit_list[i];
+      if (!other->failed && other->planner != NULL && other->sweeps < sweeps)
+        sweeps = other->sweeps;
+    }
+
+    if (sweeps <= self->panorama_sweeps)
+      return SU_FALSE;
+
+    self->panorama_sweeps = sweeps;
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Called right after retuning. Until the settling time of the device is
+ * known, fft_min_samples are discarded and traced to measure it.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_begin_hop(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit)
+{
+  SUFLOAT settle = suscan_source_get_settle_time(unit->source);
+
+  unit->hop_anchored = SU_FALSE;
+  unit->hop_settled  = SU_FALSE;
+
+  if (settle >= 0) {
+    unit->hop_discard = (SUSCOUNT) SU_CEIL(
+        settle * suscan_source_get_samp_rate(unit->source));
+  } else {
+    unit->hop_discard = unit->params.fft_min_samples;
+    SU_TRYCATCH(
+        suscan_settle_estimator_begin_hop(unit->settle, unit->hop_discard),
+        return SU_FALSE);
+  }
+
+  return SU_TRUE;
+}
+
+/*
+ * Returns how many leading samples of the block belong to the unsettled
+ * part of the hop. If the device timestamps both the stream and the
+ * retune, samples read before the retune are located exactly and the
+ * settling time is counted from the retune instant. Otherwise, it is
+ * counted from the first read after the hop (which is also how it was
+ * measured in that case, so buffered samples are accounted for).
+ */
+SUPRIVATE SUSCOUNT
+suscan_analyzer_settle(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit,
+    const SUCOMPLEX *data,
+    SUSCOUNT len)
+{
+  SUFLOAT fs = suscan_source_get_samp_rate(unit->source);
+  SUBOOL calibrating = suscan_source_get_settle_time(unit->source) < 0;
+  long long t_read, t_retune;
+  SUSDIFF stale;
+  SUSCOUNT skip = 0;
+  SUSCOUNT avail;
+  SUSCOUNT settle;
+
+  if (!unit->hop_anchored) {
+    if (suscan_source_get_retune_time(unit->source, &t_retune)
+        && suscan_source_get_read_time(unit->source, &t_read)) {
+      stale = (SUSDIFF) SU_CEIL((t_retune - t_read) * 1e-9 * fs);
+      if (stale >= (SUSDIFF) len)
+        return len;
+      if (stale > 0)
+        skip = stale;
+    }
+
+    unit->hop_anchored = SU_TRUE;
+  }
+
+  avail = len - skip;
+  if (avail > unit->hop_discard)
+    avail = unit->hop_discard;
+
+  if (calibrating)
+    suscan_settle_estimator_feed(unit->settle, data + skip, avail);
+
+  unit->hop_discard -= avail;
+  skip += avail;
+
+  if (unit->hop_discard == 0) {
+    unit->hop_settled = SU_TRUE;
+
+    if (calibrating) {
+      suscan_settle_estimator_end_hop(unit->settle);
+
+      if (suscan_settle_estimator_is_ready(unit->settle)) {
+        settle = suscan_settle_estimator_get_settle(unit->settle);
+        if (settle > unit->params.fft_min_samples)
+          settle = unit->params.fft_min_samples;
+
+        suscan_source_set_settle_time(unit->source, settle / fs);
+        SU_INFO(
+            "Device #%u: measured settling time: %g ms (%lu samples)\n",
+            unit->index,
+            1e3 * settle / fs,
+            settle);
+      }
+    }
+  }
+
+  return skip;
+}
+
+/*
+ * Called from the unit's worker whenever the sweep parameters or the set
+ * of devices change. The range is split evenly among the devices that
+ * did not fail, with slices overlapping as much as hops do. If slices
+ * would be narrower than the sample rate, some devices stay idle.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_sweep_unit_replan(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit,
+    unsigned int gen)
+{
+  suscan_sweep_planner_t *planner = NULL;
+  SUFLOAT fs = suscan_source_get_samp_rate(unit->source);
+  SUFREQ span, width, guard, min, max;
+  unsigned int i, active = 0, rank = 0;
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  unit->params     = self->pending_sweep_params;
+  unit->params_gen = gen;
+  self->current_sweep_params = unit->params;
+
+  /* First unit to see these parameters rebuilds the shared objects */
+  if (self->panorama_gen != gen) {
+    SU_TRYCATCH(
+        suscan_analyzer_init_panorama(
+            self,
+            &unit->params,
+            suscan_analyzer_sweep_unit_get_detector(self, unit)),
+        goto done);
+    SU_TRYCATCH(
+        suscan_analyzer_init_signal_catalog(self, &unit->params),
+        goto done);
+    self->panorama_gen = gen;
+  }
+
+  for (i = 0; i < self->sweep_unit_count; ++i) {
+    if (self->sweep_unit_list[i] == unit)
+      rank = active;
+    if (!self->sweep_unit_list[i]->failed)
+      ++active;
+  }
+
+  (void) pthread_mutex_unlock(&self->sweep_mutex);
+  mutex_acquired = SU_FALSE;
+
+  span = unit->params.max_freq - unit->params.min_freq;
+
+  if (span / active < fs)
+    active = SU_MAX(1, (unsigned int) SU_FLOOR(span / fs));
+
+  if (rank < active) {
+    width = span / active;
+    guard = .5 * unit->params.overlap * fs;
+    min   = unit->params.min_freq + rank * width - guard;
+    max   = unit->params.min_freq + (rank + 1) * width + guard;
+
+    if (min < unit->params.min_freq)
+      min = unit->params.min_freq;
+    if (max > unit->params.max_freq)
+      max = unit->params.max_freq;
+
+    SU_TRYCATCH(
+        planner = suscan_sweep_planner_new(
+            min,
+            max,
+            fs,
+            unit->params.overlap,
+            unit->params.bands,
+            unit->params.band_count),
+        goto done);
+  }
+
+  if (unit->planner != NULL)
+    suscan_sweep_planner_destroy(unit->planner);
+
+  unit->planner    = planner;
+  unit->sweep_time = 0;
+  unit->sweeps     = 0;
+
+  SU_TRYCATCH(suscan_analyzer_begin_hop(self, unit), goto done);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+/* Follows detector parameter changes of the analyzer */
+SUPRIVATE SUBOOL
+suscan_analyzer_sweep_unit_sync_detector(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit)
+{
+  struct sigutils_channel_detector_params params;
+  su_channel_detector_t *new_detector = NULL;
+  unsigned int gen;
+
+  gen = __atomic_load_n(&self->det_params_gen, __ATOMIC_ACQUIRE);
+  if (gen == unit->det_gen)
+    return SU_TRUE;
+
+  SU_TRYCATCH(suscan_analyzer_lock_loop(self), return SU_FALSE);
+  params = self->detector->params;
+  suscan_analyzer_unlock_loop(self);
+
+  params.samp_rate = suscan_source_get_samp_rate(unit->source);
+  su_channel_params_adjust(&params);
+
+  if (unit->detector == NULL
+      || !su_channel_detector_set_params(unit->detector, &params)) {
+    SU_TRYCATCH(
+        new_detector = su_channel_detector_new(&params),
+        return SU_FALSE);
+
+    if (unit->detector != NULL)
+      su_channel_detector_destroy(unit->detector);
+    unit->detector = new_detector;
+  }
+
+  unit->det_gen = gen;
+
+  return SU_TRUE;
+}
+
 SUINLINE SUBOOL
-suscan_analyzer_hop(suscan_analyzer_t *self)
+suscan_analyzer_hop(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit)
 {
-  SUFLOAT rnd = (SUFLOAT) rand() / (SUFLOAT) RAND_MAX;
-  SUFREQ fs = suscan_analyzer_get_samp_rate(self) / 2;
-  SUFREQ bw =
-      self->current_sweep_params.max_freq - self->current_sweep_params.min_freq;
-  SUFREQ next = rnd * bw + self->current_sweep_params.min_freq;
+  SUFREQ next = suscan_sweep_planner_next(unit->planner, unit->sweep_time);
 
   if (suscan_source_set_freq2(
-      self->source,
+      unit->source,
       next,
       suscan_source_config_get_lnb_freq(
-          suscan_source_get_config(self->source)))) {
-    self->curr_freq = suscan_source_get_freq(self->source);
+          suscan_source_get_config(unit->source)))) {
+    unit->curr_freq = suscan_source_get_freq(unit->source);
     return SU_TRUE;
   }
 
   return SU_FALSE;
 }
 
+/*
+ * Sends (or stitches) the PSD of the current hop. The PSD path touches
+ * state (history, PSD pyramid...) the analyzer thread updates under the
+ * loop mutex, which unit 0 already holds. Lock order: loop, then sweep.
+ */
+SUPRIVATE SUBOOL
+suscan_analyzer_sweep_unit_send_psd(
+    suscan_analyzer_t *self,
+    struct suscan_analyzer_sweep_unit *unit,
+    const su_channel_detector_t *detector)
+{
+  SUBOOL ok = SU_FALSE;
+
+  if (unit->owned)
+    SU_TRYCATCH(suscan_analyzer_lock_loop(self), return SU_FALSE);
+
+  if (pthread_mutex_lock(&self->sweep_mutex) != 0) {
+    SU_ERROR("Failed to acquire sweep mutex\n");
+    if (unit->owned)
+      suscan_analyzer_unlock_loop(self);
+    return SU_FALSE;
+  }
+
+  self->curr_freq = unit->curr_freq;
+  unit->sweeps = suscan_sweep_planner_get_sweep_count(unit->planner);
+
+  if (self->signal_catalog != NULL)
+    SU_TRYCATCH(
+        suscan_analyzer_update_signal_catalog(self, detector),
+        goto done);
+
+  if (self->panorama != NULL) {
+    SU_TRYCATCH(suscan_analyzer_feed_panorama(self, detector), goto done);
+
+    if (suscan_analyzer_panorama_due(self, unit))
+      SU_TRYCATCH(suscan_analyzer_send_panorama(self, detector), goto done);
+  } else {
+    SU_TRYCATCH(suscan_analyzer_send_psd(self, detector), goto done);
+  }
+
+  ok = SU_TRUE;
+
+done:
+  (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  if (unit->owned)
+    suscan_analyzer_unlock_loop(self);
+
+  return ok;
+}
+
 SUBOOL
 suscan_analyzer_set_buffering_size(
     suscan_analyzer_t *self,
     SUSCOUNT size)
 {
+  SUBOOL mutex_acquired = SU_FALSE;
   SUBOOL ok = SU_FALSE;
 
   SU_TRYCATCH(
       self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
       goto done);
 
-  self->pending_sweep_params = self->current_sweep_params;
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
   self->pending_sweep_params.fft_min_samples = size;
-  self->sweep_params_requested = SU_TRUE;
+  suscan_analyzer_request_sweep_params(self);
 
   ok = SU_TRUE;
 
 done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
   return ok;
 }
 
@@ -99,14 +650,196 @@ suscan_analyzer_set_hop_range(
       max - min >= suscan_analyzer_get_samp_rate(self),
       goto done);
 
-  self->pending_sweep_params = self->current_sweep_params;
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
   self->pending_sweep_params.min_freq = min;
   self->pending_sweep_params.max_freq = max;
-  self->sweep_params_requested = SU_TRUE;
+  suscan_analyzer_request_sweep_params(self);
 
   ok = SU_TRUE;
 
 done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_sweep_overlap(
+    suscan_analyzer_t *self,
+    SUFLOAT overlap)
+{
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(overlap >= 0 && overlap < 1, goto done);
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  self->pending_sweep_params.overlap = overlap;
+  suscan_analyzer_request_sweep_params(self);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_sweep_bands(
+    suscan_analyzer_t *self,
+    const struct suscan_sweep_band *bands,
+    unsigned int count)
+{
+  unsigned int i;
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(count <= SUSCAN_ANALYZER_MAX_SWEEP_BANDS, goto done);
+
+  for (i = 0; i < count; ++i) {
+    SU_TRYCATCH(bands[i].f_hi > bands[i].f_lo, goto done);
+    SU_TRYCATCH(bands[i].weight > 0, goto done);
+    SU_TRYCATCH(bands[i].revisit >= 0, goto done);
+  }
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  if (count > 0)
+    memcpy(
+        self->pending_sweep_params.bands,
+        bands,
+        count * sizeof(struct suscan_sweep_band));
+  self->pending_sweep_params.band_count = count;
+  suscan_analyzer_request_sweep_params(self);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_panorama(
+    suscan_analyzer_t *self,
+    SUBOOL enabled,
+    SUSCOUNT bins,
+    SUFLOAT interval)
+{
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(bins <= SUSCAN_PANORAMA_MAX_SIZE, goto done);
+  SU_TRYCATCH(interval >= 0, goto done);
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  self->pending_sweep_params.panorama      = enabled;
+  self->pending_sweep_params.panorama_bins = bins;
+  self->pending_sweep_params.panorama_int  = interval;
+  suscan_analyzer_request_sweep_params(self);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_set_signal_catalog(
+    suscan_analyzer_t *self,
+    SUBOOL enabled,
+    SUFLOAT snr)
+{
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(snr > 0, goto done);
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  self->pending_sweep_params.catalog     = enabled;
+  self->pending_sweep_params.catalog_snr = snr;
+  suscan_analyzer_request_sweep_params(self);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  return ok;
+}
+
+SUBOOL
+suscan_analyzer_get_signal_catalog(
+    suscan_analyzer_t *self,
+    SUFREQ f_lo,
+    SUFREQ f_hi,
+    struct suscan_signal_entry **entries,
+    unsigned int *count)
+{
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  if (self->signal_catalog != NULL) {
+    SU_TRYCATCH(
+        suscan_signal_catalog_query(
+            self->signal_catalog,
+            f_lo,
+            f_hi,
+            entries,
+            count),
+        goto done);
+  } else {
+    *entries = NULL;
+    *count   = 0;
+  }
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
   return ok;
 }
 
@@ -117,38 +850,67 @@ suscan_source_wide_wk_cb(
     void *cb_private)
 {
   suscan_analyzer_t *self = (suscan_analyzer_t *) wk_private;
+  struct suscan_analyzer_sweep_unit *unit =
+      (struct suscan_analyzer_sweep_unit *) cb_private;
+  su_channel_detector_t *detector;
+  const SUCOMPLEX *data;
+  SUSCOUNT len, skip;
+  unsigned int gen;
   SUSDIFF got;
   SUBOOL mutex_acquired = SU_FALSE;
   SUBOOL restart = SU_FALSE;
   struct timespec sub;
 
-  SU_TRYCATCH(suscan_analyzer_lock_loop(self), goto done);
-  mutex_acquired = SU_TRUE;
+  /* Unit 0 shares the detector with the analyzer thread */
+  if (!unit->owned) {
+    SU_TRYCATCH(suscan_analyzer_lock_loop(self), goto done);
+    mutex_acquired = SU_TRUE;
+  } else {
+    SU_TRYCATCH(
+        suscan_analyzer_sweep_unit_sync_detector(self, unit),
+        goto done);
+  }
 
   /* Non real time sources are not allowed. */
   SU_TRYCATCH(suscan_analyzer_is_real_time(self), goto done);
 
-  if (self->sweep_params_requested) {
-    self->current_sweep_params = self->pending_sweep_params;
-    self->sweep_params_requested = SU_FALSE;
-  }
+  gen = __atomic_load_n(&self->sweep_params_gen, __ATOMIC_ACQUIRE);
+  if (gen != unit->params_gen)
+    SU_TRYCATCH(
+        suscan_analyzer_sweep_unit_replan(self, unit, gen),
+        goto done);
+
+  detector = suscan_analyzer_sweep_unit_get_detector(self, unit);
 
   if ((got = suscan_source_read(
-      self->source,
-      self->read_buf,
-      self->read_size)) > 0) {
+      unit->source,
+      unit->read_buf,
+      unit->read_size)) > 0) {
 
     if (self->iq_rev)
-      suscan_analyzer_do_iq_rev(self->read_buf, got);
-    self->fft_samples += got;
+      suscan_analyzer_do_iq_rev(unit->read_buf, got);
+    unit->sweep_time +=
+        (double) got / suscan_source_get_samp_rate(unit->source);
 
-    if (self->fft_samples > self->current_sweep_params.fft_min_samples) {
+    /* Idle units just keep their streams flowing */
+    if (unit->planner == NULL) {
+      restart = SU_TRUE;
+      goto done;
+    }
+
+    data = unit->read_buf;
+    len  = got;
+
+    if (!unit->hop_settled) {
+      skip  = suscan_analyzer_settle(self, unit, data, len);
+      data += skip;
+      len  -= skip;
+    }
+
+    if (len > 0) {
       /* Feed detector (works in spectrum mode only) */
       SU_TRYCATCH(
-          su_channel_detector_feed_bulk(
-              self->detector,
-              self->read_buf,
-              got) == got,
+          su_channel_detector_feed_bulk(detector, data, len) == len,
           goto done);
 
       /*
@@ -157,16 +919,32 @@ suscan_source_wide_wk_cb(
        * of samples at the selected frequency.
        */
 
-      if (su_channel_detector_get_iters(self->detector) > 0) {
+      if (su_channel_detector_get_iters(detector) > 0) {
         SU_TRYCATCH(
-            suscan_analyzer_send_psd(self, self->detector),
+            suscan_analyzer_sweep_unit_send_psd(self, unit, detector),
             goto done);
 
-        self->fft_samples = 0;
-        su_channel_detector_rewind(self->detector);
-        (void) suscan_analyzer_hop(self);
+        su_channel_detector_rewind(detector);
+        (void) suscan_analyzer_hop(self, unit);
+        SU_TRYCATCH(suscan_analyzer_begin_hop(self, unit), goto done);
       }
     }
+  } else if (unit->owned) {
+    /* Drop the device and let the others cover its slice */
+    suscan_analyzer_send_status(
+        self,
+        SUSCAN_ANALYZER_MESSAGE_TYPE_READ_ERROR,
+        got,
+        "Sweep device #%u failed, dropping it",
+        unit->index);
+
+    SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+    unit->failed = SU_TRUE;
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+    suscan_analyzer_request_sweep_params(self);
+
+    goto done;
   } else {
     self->eos = SU_TRUE;
     self->cpu_usage = 0;
@@ -224,3 +1002,54 @@ done:
   return restart;
 }
 
+SUBOOL
+suscan_analyzer_add_sweep_source(
+    suscan_analyzer_t *self,
+    suscan_source_config_t *config)
+{
+  struct suscan_analyzer_sweep_unit *unit = NULL;
+  SUBOOL mutex_acquired = SU_FALSE;
+  SUBOOL ok = SU_FALSE;
+
+  SU_TRYCATCH(
+      self->params.mode == SUSCAN_ANALYZER_MODE_WIDE_SPECTRUM,
+      goto done);
+
+  SU_TRYCATCH(unit = suscan_analyzer_sweep_unit_new(self, config), goto done);
+  SU_TRYCATCH(
+      unit->worker = suscan_worker_new(&self->mq_in, self),
+      goto done);
+
+  SU_TRYCATCH(pthread_mutex_lock(&self->sweep_mutex) == 0, goto done);
+  mutex_acquired = SU_TRUE;
+
+  unit->index = self->sweep_unit_count;
+  SU_TRYCATCH(PTR_LIST_APPEND_CHECK(self->sweep_unit, unit) != -1, goto done);
+
+  /* Owned by the analyzer from now on */
+  if (!suscan_worker_push(unit->worker, suscan_source_wide_wk_cb, unit)) {
+    SU_ERROR("Failed to push sweep unit callback to worker\n");
+    unit->failed = SU_TRUE;
+    unit = NULL;
+    goto done;
+  }
+
+  unit = NULL;
+
+  (void) pthread_mutex_unlock(&self->sweep_mutex);
+  mutex_acquired = SU_FALSE;
+
+  /* Repartition the range */
+  suscan_analyzer_request_sweep_params(self);
+
+  ok = SU_TRUE;
+
+done:
+  if (mutex_acquired)
+    (void) pthread_mutex_unlock(&self->sweep_mutex);
+
+  if (unit != NULL)
+    suscan_analyzer_sweep_unit_destroy(unit);
+
+  return ok;
+}
@@ -0,0 +1,261 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "catalog.h"
+#include "test.h"
+
+#define TEST_FS     1e6
+#define TEST_BINS   100     /* 10 kHz per bin */
+#define TEST_SNR    10.
+#define TEST_EDGE   .05
+
+SUPRIVATE void
+test_catalog_hop(SUFLOAT *psd, SUSCOUNT size)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < size; ++i)
+    psd[i] = 1;
+}
+
+SUPRIVATE void
+test_catalog_signal(SUFLOAT *psd, SUSCOUNT first, SUSCOUNT last, SUFLOAT db)
+{
+  SUSCOUNT i;
+
+  for (i = first; i < last; ++i)
+    psd[i] = SU_POWER_MAG(db);
+}
+
+SUPRIVATE struct timeval
+test_catalog_time(long sec)
+{
+  struct timeval tv = {sec, 0};
+
+  return tv;
+}
+
+SUPRIVATE void
+test_catalog_detection(void)
+{
+  suscan_signal_catalog_t *cat;
+  struct suscan_signal_entry *entries = NULL;
+  SUFLOAT psd[TEST_BINS];
+  struct timeval tv;
+  unsigned int count;
+  long t;
+
+  SUSCAN_TEST_ASSERT(cat = suscan_signal_catalog_new(TEST_SNR, TEST_EDGE));
+
+  /* A 100 kHz wide signal, 20 dB over the floor, hit 3 hops out of 4 */
+  for (t = 1; t <= 4; ++t) {
+    test_catalog_hop(psd, TEST_BINS);
+    if (t != 3)
+      test_catalog_signal(psd, 40, 50, 20);
+
+    tv = test_catalog_time(t);
+    SUSCAN_TEST_ASSERT(
+        suscan_signal_catalog_feed(cat, 100.5e6, TEST_FS, psd, TEST_BINS, &tv));
+  }
+
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 1);
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_query(cat, 0, 0, &entries, &count));
+  SUSCAN_TEST_ASSERT(count == 1);
+
+  /* Bins 40 to 49 span 100.40 MHz to 100.50 MHz */
+  SUSCAN_TEST_ASSERT_CLOSE(entries[0].fc, 100.45e6, 1);
+  SUSCAN_TEST_ASSERT_CLOSE(entries[0].bw, 100e3, 1);
+  SUSCAN_TEST_ASSERT_CLOSE(entries[0].snr, 20, .01);
+  SUSCAN_TEST_ASSERT_CLOSE(entries[0].peak_snr, 20, .01);
+  SUSCAN_TEST_ASSERT(entries[0].first_seen.tv_sec == 1);
+  SUSCAN_TEST_ASSERT(entries[0].last_seen.tv_sec == 4);
+  SUSCAN_TEST_ASSERT(entries[0].hits == 3);
+  SUSCAN_TEST_ASSERT(entries[0].visits == 4);
+  SUSCAN_TEST_ASSERT_CLOSE(
+      suscan_signal_entry_get_duty_cycle(entries + 0),
+      .75,
+      1e-6);
+
+  free(entries);
+  suscan_signal_catalog_destroy(cat);
+}
+
+SUPRIVATE void
+test_catalog_rejections(void)
+{
+  suscan_signal_catalog_t *cat;
+  SUFLOAT psd[TEST_BINS];
+  struct timeval tv = test_catalog_time(1);
+
+  SUSCAN_TEST_ASSERT(cat = suscan_signal_catalog_new(TEST_SNR, TEST_EDGE));
+
+  test_catalog_hop(psd, TEST_BINS);
+  test_catalog_signal(psd, 20, 30, 5);   /* Below the threshold */
+  test_catalog_signal(psd, 60, 61, 30);  /* Too narrow */
+  test_catalog_signal(psd, 0, 4, 30);    /* In the discarded edge */
+  test_catalog_signal(psd, 96, 100, 30); /* Same */
+
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_feed(cat, 100.5e6, TEST_FS, psd, TEST_BINS, &tv));
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 0);
+
+  suscan_signal_catalog_destroy(cat);
+}
+
+SUPRIVATE void
+test_catalog_gaps(void)
+{
+  suscan_signal_catalog_t *cat;
+  SUFLOAT psd[TEST_BINS];
+  struct timeval tv = test_catalog_time(1);
+
+  SUSCAN_TEST_ASSERT(cat = suscan_signal_catalog_new(TEST_SNR, TEST_EDGE));
+
+  /* Short gaps are tolerated... */
+  test_catalog_hop(psd, TEST_BINS);
+  test_catalog_signal(psd, 20, 25, 20);
+  test_catalog_signal(psd, 25 + SUSCAN_SIGNAL_CATALOG_MAX_GAP, 30, 20);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_feed(cat, 100.5e6, TEST_FS, psd, TEST_BINS, &tv));
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 1);
+
+  /* ...but longer ones split the run */
+  suscan_signal_catalog_clear(cat);
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 0);
+
+  test_catalog_hop(psd, TEST_BINS);
+  test_catalog_signal(psd, 20, 25, 20);
+  test_catalog_signal(psd, 26 + SUSCAN_SIGNAL_CATALOG_MAX_GAP, 40, 20);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_feed(cat, 100.5e6, TEST_FS, psd, TEST_BINS, &tv));
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 2);
+
+  suscan_signal_catalog_destroy(cat);
+}
+
+SUPRIVATE void
+test_catalog_query(void)
+{
+  suscan_signal_catalog_t *cat;
+  struct suscan_signal_entry *entries = NULL;
+  SUFLOAT psd[TEST_BINS];
+  struct timeval tv = test_catalog_time(1);
+  unsigned int count, i;
+
+  SUSCAN_TEST_ASSERT(cat = suscan_signal_catalog_new(TEST_SNR, TEST_EDGE));
+
+  /* Two signals per hop, hops fed in descending frequency order */
+  test_catalog_hop(psd, TEST_BINS);
+  test_catalog_signal(psd, 20, 25, 20);
+  test_catalog_signal(psd, 70, 75, 20);
+
+  for (i = 0; i < 5; ++i)
+    SUSCAN_TEST_ASSERT(
+        suscan_signal_catalog_feed(
+            cat,
+            104.5e6 - i * TEST_FS,
+            TEST_FS,
+            psd,
+            TEST_BINS,
+            &tv));
+
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_get_count(cat) == 10);
+
+  /* Entries are returned sorted */
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_query(cat, 0, 0, &entries, &count));
+  SUSCAN_TEST_ASSERT(count == 10);
+  for (i = 1; i < count; ++i)
+    SUSCAN_TEST_ASSERT(entries[i - 1].fc < entries[i].fc);
+  free(entries);
+
+  /* Only hops 101 - 102 MHz and 102 - 103 MHz */
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_query(cat, 101e6, 103e6, &entries, &count));
+  SUSCAN_TEST_ASSERT(count == 4);
+  for (i = 0; i < count; ++i)
+    SUSCAN_TEST_ASSERT(entries[i].fc >= 101e6 && entries[i].fc <= 103e6);
+  free(entries);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_query(cat, 200e6, 300e6, &entries, &count));
+  SUSCAN_TEST_ASSERT(count == 0);
+
+  suscan_signal_catalog_destroy(cat);
+}
+
+/* A full catalog forgets the signals that have been silent for longer */
+SUPRIVATE void
+test_catalog_eviction(void)
+{
+  suscan_signal_catalog_t *cat;
+  struct suscan_signal_entry *entries = NULL;
+  SUFLOAT *psd;
+  SUSCOUNT size = 8192, i;
+  unsigned int count, j, old = 0, per_hop = (size + 4) / 5;
+  struct timeval tv;
+  long t;
+
+  SUSCAN_TEST_ASSERT(psd = malloc(size * sizeof(SUFLOAT)));
+  SUSCAN_TEST_ASSERT(cat = suscan_signal_catalog_new(TEST_SNR, 0));
+
+  /* 2 bins on, 3 off: 1639 signals per hop, 3 hops */
+  for (i = 0; i < size; ++i)
+    psd[i] = i % 5 < 2 ? 100 : 1;
+
+  for (t = 1; t <= 3; ++t) {
+    tv = test_catalog_time(t);
+    SUSCAN_TEST_ASSERT(
+        suscan_signal_catalog_feed(cat, t * 1e9, TEST_FS, psd, size, &tv));
+  }
+
+  SUSCAN_TEST_ASSERT(
+      suscan_signal_catalog_get_count(cat)
+      == SUSCAN_SIGNAL_CATALOG_MAX_ENTRIES);
+
+  SUSCAN_TEST_ASSERT(suscan_signal_catalog_query(cat, 0, 0, &entries, &count));
+  for (j = 0; j < count; ++j) {
+    if (entries[j].last_seen.tv_sec == 1)
+      ++old;
+    if (j > 0)
+      SUSCAN_TEST_ASSERT(entries[j - 1].fc < entries[j].fc);
+  }
+
+  SUSCAN_TEST_ASSERT(old == SUSCAN_SIGNAL_CATALOG_MAX_ENTRIES - 2 * per_hop);
+
+  free(entries);
+  free(psd);
+  suscan_signal_catalog_destroy(cat);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_catalog_detection);
+  SUSCAN_TEST_RUN(test_catalog_rejections);
+  SUSCAN_TEST_RUN(test_catalog_gaps);
+  SUSCAN_TEST_RUN(test_catalog_query);
+  SUSCAN_TEST_RUN(test_catalog_eviction);
+
+  return EXIT_SUCCESS;
+}
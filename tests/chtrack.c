@@ -0,0 +1,226 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "chtrack.h"
+#include "test.h"
+
+#define TEST_FC 100e6
+
+SUPRIVATE void
+test_chtrack_channel(
+    struct sigutils_channel *channel,
+    SUFREQ fc,
+    SUFLOAT bw,
+    SUFLOAT snr)
+{
+  memset(channel, 0, sizeof(struct sigutils_channel));
+
+  channel->fc      = fc;
+  channel->f_lo    = fc - .5 * bw;
+  channel->f_hi    = fc + .5 * bw;
+  channel->bw      = bw;
+  channel->snr     = snr;
+  channel->age     = 100;
+  channel->present = 100;
+}
+
+SUPRIVATE const struct suscan_channel_delta *
+test_chtrack_find(
+    const suscan_channel_tracker_t *self,
+    uint32_t id,
+    enum suscan_channel_delta_kind kind)
+{
+  const struct suscan_channel_delta *deltas;
+  unsigned int count, i;
+
+  deltas = suscan_channel_tracker_get_deltas(self, &count);
+
+  for (i = 0; i < count; ++i)
+    if (deltas[i].id == id && deltas[i].kind == kind)
+      return deltas + i;
+
+  return NULL;
+}
+
+SUPRIVATE unsigned int
+test_chtrack_delta_count(const suscan_channel_tracker_t *self)
+{
+  unsigned int count;
+
+  (void) suscan_channel_tracker_get_deltas(self, &count);
+
+  return count;
+}
+
+SUPRIVATE void
+test_chtrack_lifecycle(void)
+{
+  suscan_channel_tracker_t *tracker;
+  const struct suscan_channel_delta *delta;
+  struct sigutils_channel channels[2];
+  struct sigutils_channel *list[2] = {channels + 0, channels + 1};
+
+  SUSCAN_TEST_ASSERT(tracker = suscan_channel_tracker_new());
+
+  test_chtrack_channel(channels + 0, -100e3, 10e3, 20);
+  test_chtrack_channel(channels + 1, +200e3, 20e3, 15);
+
+  /* New channels are added, relative to the center frequency */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 2);
+  SUSCAN_TEST_ASSERT(
+      delta = test_chtrack_find(tracker, 1, SUSCAN_CHANNEL_DELTA_ADDED));
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.fc, TEST_FC - 100e3, 1e-3);
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.f_lo, TEST_FC - 105e3, 1e-3);
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.ft, TEST_FC, 1e-3);
+  SUSCAN_TEST_ASSERT(
+      delta = test_chtrack_find(tracker, 2, SUSCAN_CHANNEL_DELTA_ADDED));
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.fc, TEST_FC + 200e3, 1e-3);
+
+  /* Same channels again: nothing to report */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 0);
+
+  /* Moves within the tolerances are not reported either */
+  channels[0].fc  += .5 * SUSCAN_CHANNEL_TRACKER_FREQ_TOL * channels[0].bw;
+  channels[0].snr += .5 * SUSCAN_CHANNEL_TRACKER_SNR_TOL;
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 0);
+
+  /* But larger ones are, keeping the ID */
+  channels[0].snr += 2 * SUSCAN_CHANNEL_TRACKER_SNR_TOL;
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 1);
+  SUSCAN_TEST_ASSERT(
+      delta = test_chtrack_find(tracker, 1, SUSCAN_CHANNEL_DELTA_CHANGED));
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.snr, channels[0].snr, 1e-3);
+
+  /* Missing channels are removed, with their last known state */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 1, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 1);
+  SUSCAN_TEST_ASSERT(
+      delta = test_chtrack_find(tracker, 2, SUSCAN_CHANNEL_DELTA_REMOVED));
+  SUSCAN_TEST_ASSERT_CLOSE(delta->channel.fc, TEST_FC + 200e3, 1e-3);
+
+  /* A channel that comes back gets a new ID */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 1);
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 3, SUSCAN_CHANNEL_DELTA_ADDED));
+
+  suscan_channel_tracker_destroy(tracker);
+}
+
+SUPRIVATE void
+test_chtrack_snapshot(void)
+{
+  suscan_channel_tracker_t *tracker;
+  struct sigutils_channel channels[3];
+  struct sigutils_channel *list[3] = {channels + 0, channels + 1, channels + 2};
+
+  SUSCAN_TEST_ASSERT(tracker = suscan_channel_tracker_new());
+
+  test_chtrack_channel(channels + 0, -100e3, 10e3, 20);
+  test_chtrack_channel(channels + 1, 0, 10e3, 20);
+  test_chtrack_channel(channels + 2, +100e3, 10e3, 20);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 3, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 3);
+
+  /* Snapshots list every live channel as added, and nothing else */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_TRUE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 2);
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 1, SUSCAN_CHANNEL_DELTA_ADDED));
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 2, SUSCAN_CHANNEL_DELTA_ADDED));
+
+  /* The IDs survive the snapshot */
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 2, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 0);
+
+  suscan_channel_tracker_destroy(tracker);
+}
+
+SUPRIVATE void
+test_chtrack_matching(void)
+{
+  suscan_channel_tracker_t *tracker;
+  struct sigutils_channel channels[3];
+  struct sigutils_channel invalid;
+  struct sigutils_channel *list[4] =
+    {channels + 0, NULL, &invalid, channels + 1};
+
+  SUSCAN_TEST_ASSERT(tracker = suscan_channel_tracker_new());
+
+  /* Empty and invalid channels are ignored */
+  test_chtrack_channel(channels + 0, 0, 40e3, 20);
+  test_chtrack_channel(channels + 1, 30e3, 40e3, 20);
+  memset(&invalid, 0, sizeof(struct sigutils_channel));
+
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 4, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 2);
+
+  /* Overlapping tracks: each channel claims the closest one */
+  channels[0].fc += 10e3;
+  channels[1].fc += 10e3;
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 4, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 2);
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 1, SUSCAN_CHANNEL_DELTA_CHANGED)
+        ->channel.fc < TEST_FC + 20e3);
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 2, SUSCAN_CHANNEL_DELTA_CHANGED)
+        ->channel.fc > TEST_FC + 20e3);
+
+  /* A channel with no overlapping track is a new one */
+  test_chtrack_channel(channels + 2, 300e3, 10e3, 20);
+  list[1] = channels + 2;
+  SUSCAN_TEST_ASSERT(
+      suscan_channel_tracker_update(tracker, list, 4, TEST_FC, SU_FALSE));
+  SUSCAN_TEST_ASSERT(test_chtrack_delta_count(tracker) == 1);
+  SUSCAN_TEST_ASSERT(
+      test_chtrack_find(tracker, 3, SUSCAN_CHANNEL_DELTA_ADDED));
+
+  suscan_channel_tracker_destroy(tracker);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_chtrack_lifecycle);
+  SUSCAN_TEST_RUN(test_chtrack_snapshot);
+  SUSCAN_TEST_RUN(test_chtrack_matching);
+
+  return EXIT_SUCCESS;
+}
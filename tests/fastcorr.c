@@ -0,0 +1,197 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "inspector/fastcorr.h"
+#include "test.h"
+
+#define TEST_LONG_LEN    63
+#define TEST_SHORT_LEN   31
+#define TEST_SAMPLES     2048
+#define TEST_LONG_POS    300
+#define TEST_SHORT_POS   1100
+#define TEST_NOISE       .1
+
+struct test_fastcorr_peak {
+  SUFLOAT  metric;
+  SUSDIFF  position;
+  int      shift;
+};
+
+SUPRIVATE uint32_t
+test_fastcorr_rand(uint32_t *state)
+{
+  *state = *state * 1103515245u + 12345u;
+  return *state >> 16;
+}
+
+/* QPSK-like sequence, so templates are uncorrelated with each other */
+SUPRIVATE void
+test_fastcorr_sequence(SUCOMPLEX *x, SUSCOUNT len, uint32_t seed)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    x[i] = SU_C_EXP(I * PI / 2 * (test_fastcorr_rand(&seed) & 3));
+}
+
+SUPRIVATE void
+test_fastcorr_noise(SUCOMPLEX *x, SUSCOUNT len)
+{
+  uint32_t seed = 1;
+  SUSCOUNT i;
+  SUFLOAT re, im;
+
+  for (i = 0; i < len; ++i) {
+    re = ((int) (test_fastcorr_rand(&seed) % 2001) - 1000) / 1000.;
+    im = ((int) (test_fastcorr_rand(&seed) % 2001) - 1000) / 1000.;
+    x[i] = TEST_NOISE * (re + I * im);
+  }
+}
+
+/* Feeds the whole input in irregular blocks, keeping each template's peak */
+SUPRIVATE void
+test_fastcorr_scan(
+    suscan_fastcorr_t *corr,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    struct test_fastcorr_peak *peaks)
+{
+  const SUFLOAT *metric;
+  const int *shift;
+  SUSCOUNT p = 0, chunk = 5, got, j;
+  unsigned int t;
+  SUBOOL ready;
+
+  memset(peaks, 0, corr->count * sizeof(struct test_fastcorr_peak));
+
+  while (p < len) {
+    if (chunk > len - p)
+      chunk = len - p;
+
+    got = suscan_fastcorr_feed(corr, x + p, chunk, &ready);
+    p += got;
+    chunk = chunk * 7 % 113 + 1;
+
+    if (!ready)
+      continue;
+
+    for (t = 0; t < corr->count; ++t) {
+      metric = suscan_fastcorr_get_metric(corr, t);
+      shift  = suscan_fastcorr_get_shift(corr, t);
+
+      for (j = 0; j < suscan_fastcorr_get_step(corr); ++j)
+        if (metric[j] > peaks[t].metric) {
+          peaks[t].metric   = metric[j];
+          peaks[t].position = suscan_fastcorr_get_start(corr) + j;
+          peaks[t].shift    = shift[j];
+        }
+    }
+  }
+}
+
+SUPRIVATE void
+test_fastcorr_size(void)
+{
+  SUSCAN_TEST_ASSERT(
+      suscan_fastcorr_size_for_length(1) == SUSCAN_FASTCORR_MIN_SIZE);
+  SUSCAN_TEST_ASSERT(suscan_fastcorr_size_for_length(63) == 128);
+  SUSCAN_TEST_ASSERT(suscan_fastcorr_size_for_length(64) == 128);
+  SUSCAN_TEST_ASSERT(suscan_fastcorr_size_for_length(65) == 256);
+}
+
+SUPRIVATE void
+test_fastcorr_finds_templates(void)
+{
+  SUCOMPLEX t_long[TEST_LONG_LEN], t_short[TEST_SHORT_LEN];
+  const SUCOMPLEX *templates[] = {t_long, t_short};
+  SUSCOUNT lengths[] = {TEST_LONG_LEN, TEST_SHORT_LEN};
+  SUCOMPLEX x[TEST_SAMPLES];
+  struct test_fastcorr_peak peaks[2];
+  suscan_fastcorr_t *corr;
+  SUSCOUNT i;
+
+  test_fastcorr_sequence(t_long, TEST_LONG_LEN, 10);
+  test_fastcorr_sequence(t_short, TEST_SHORT_LEN, 20);
+
+  test_fastcorr_noise(x, TEST_SAMPLES);
+  for (i = 0; i < TEST_LONG_LEN; ++i)
+    x[TEST_LONG_POS + i] += t_long[i];
+  for (i = 0; i < TEST_SHORT_LEN; ++i)
+    x[TEST_SHORT_POS + i] += .5 * t_short[i]; /* Amplitude does not matter */
+
+  SUSCAN_TEST_ASSERT(corr = suscan_fastcorr_new(templates, lengths, 2, 0));
+  SUSCAN_TEST_ASSERT(suscan_fastcorr_get_size(corr) == 128);
+  SUSCAN_TEST_ASSERT(suscan_fastcorr_get_template_length(corr, 1) == 31);
+
+  test_fastcorr_scan(corr, x, TEST_SAMPLES, peaks);
+
+  SUSCAN_TEST_ASSERT(peaks[0].position == TEST_LONG_POS);
+  SUSCAN_TEST_ASSERT(peaks[0].metric > .95 && peaks[0].metric <= 1.001);
+  SUSCAN_TEST_ASSERT(peaks[1].position == TEST_SHORT_POS);
+  SUSCAN_TEST_ASSERT(peaks[1].metric > .9 && peaks[1].metric <= 1.001);
+
+  suscan_fastcorr_destroy(corr);
+}
+
+SUPRIVATE void
+test_fastcorr_frequency_search(void)
+{
+  SUCOMPLEX tmpl[TEST_LONG_LEN];
+  const SUCOMPLEX *templates[] = {tmpl};
+  SUSCOUNT lengths[] = {TEST_LONG_LEN};
+  SUCOMPLEX x[TEST_SAMPLES];
+  struct test_fastcorr_peak peak;
+  suscan_fastcorr_t *corr;
+  SUFLOAT bin;
+  SUSCOUNT i;
+
+  test_fastcorr_sequence(tmpl, TEST_LONG_LEN, 30);
+
+  /* Shifted up by two bins of the correlator FFT */
+  bin = 2 * PI / suscan_fastcorr_size_for_length(TEST_LONG_LEN);
+  test_fastcorr_noise(x, TEST_SAMPLES);
+  for (i = 0; i < TEST_LONG_LEN; ++i)
+    x[TEST_LONG_POS + i] += tmpl[i] * SU_C_EXP(I * 2 * bin * i);
+
+  /* Without frequency search, the match is lost */
+  SUSCAN_TEST_ASSERT(corr = suscan_fastcorr_new(templates, lengths, 1, 0));
+  test_fastcorr_scan(corr, x, TEST_SAMPLES, &peak);
+  SUSCAN_TEST_ASSERT(peak.metric < .7);
+  suscan_fastcorr_destroy(corr);
+
+  SUSCAN_TEST_ASSERT(corr = suscan_fastcorr_new(templates, lengths, 1, 3));
+  test_fastcorr_scan(corr, x, TEST_SAMPLES, &peak);
+  SUSCAN_TEST_ASSERT(peak.position == TEST_LONG_POS);
+  SUSCAN_TEST_ASSERT(peak.shift == 2);
+  SUSCAN_TEST_ASSERT(peak.metric > .95);
+  suscan_fastcorr_destroy(corr);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_fastcorr_size);
+  SUSCAN_TEST_RUN(test_fastcorr_finds_templates);
+  SUSCAN_TEST_RUN(test_fastcorr_frequency_search);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "inspector/mfsampler.h"
+#include "test.h"
+
+#define TEST_PERIOD   8
+#define TEST_SPAN     (8 * TEST_PERIOD + 1)
+#define TEST_SYMBOLS  512
+#define TEST_SAMPLES  (TEST_SYMBOLS * TEST_PERIOD)
+
+SUPRIVATE SUFLOAT
+test_mf_sampler_symbol(unsigned int i)
+{
+  /* Fixed pseudo-random sequence, so failures are reproducible */
+  return (((i * 1103515245u + 12345u) >> 16) & 1) ? 1 : -1;
+}
+
+SUPRIVATE void
+test_mf_sampler_nrz(SUCOMPLEX *x)
+{
+  unsigned int i;
+
+  for (i = 0; i < TEST_SAMPLES; ++i)
+    x[i] = test_mf_sampler_symbol(i / TEST_PERIOD);
+}
+
+/* Every branch is normalized to unity DC gain */
+SUPRIVATE void
+test_mf_sampler_dc_gain(void)
+{
+  suscan_mf_sampler_t mf = suscan_mf_sampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUSCOUNT i, n;
+
+  SUSCAN_TEST_ASSERT(suscan_mf_sampler_init(&mf, 7.3, .35, TEST_SPAN));
+  SUSCAN_TEST_ASSERT(suscan_mf_sampler_is_ready(&mf));
+
+  for (i = 0; i < TEST_SAMPLES; ++i)
+    x[i] = 1;
+
+  n = suscan_mf_sampler_feed(&mf, x, TEST_SAMPLES, y);
+  SUSCAN_TEST_ASSERT(n == (SUSCOUNT) (TEST_SAMPLES / 7.3));
+
+  /* Once the history is full */
+  for (i = TEST_SPAN; i < n; ++i) {
+    SUSCAN_TEST_ASSERT_CLOSE(SU_C_REAL(y[i]), 1, 1e-4);
+    SUSCAN_TEST_ASSERT_CLOSE(SU_C_IMAG(y[i]), 0, 1e-4);
+  }
+
+  suscan_mf_sampler_finalize(&mf);
+  SUSCAN_TEST_ASSERT(!suscan_mf_sampler_is_ready(&mf));
+}
+
+/* Output must not depend on how the input is split */
+SUPRIVATE void
+test_mf_sampler_split_feed(void)
+{
+  suscan_mf_sampler_t a = suscan_mf_sampler_INITIALIZER;
+  suscan_mf_sampler_t b = suscan_mf_sampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], ya[TEST_SAMPLES], yb[TEST_SAMPLES];
+  SUSCOUNT i, p, chunk, na, nb = 0;
+
+  test_mf_sampler_nrz(x);
+
+  SUSCAN_TEST_ASSERT(suscan_mf_sampler_init(&a, 5.7, .25, TEST_SPAN));
+  SUSCAN_TEST_ASSERT(suscan_mf_sampler_init(&b, 5.7, .25, TEST_SPAN));
+
+  na = suscan_mf_sampler_feed(&a, x, TEST_SAMPLES, ya);
+
+  for (p = 0, chunk = 1; p < TEST_SAMPLES; p += chunk, chunk = chunk * 3 % 61) {
+    if (chunk > TEST_SAMPLES - p)
+      chunk = TEST_SAMPLES - p;
+    nb += suscan_mf_sampler_feed(&b, x + p, chunk, yb + nb);
+  }
+
+  SUSCAN_TEST_ASSERT(na == nb);
+  for (i = 0; i < na; ++i)
+    SUSCAN_TEST_ASSERT(ya[i] == yb[i]);
+
+  suscan_mf_sampler_finalize(&a);
+  suscan_mf_sampler_finalize(&b);
+}
+
+/* Symbols come out in order, after the filter delay, with their sign */
+SUPRIVATE void
+test_mf_sampler_recovers_symbols(void)
+{
+  suscan_mf_sampler_t mf = suscan_mf_sampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUSCOUNT i, n, lag;
+  SUBOOL found = SU_FALSE;
+
+  test_mf_sampler_nrz(x);
+
+  SUSCAN_TEST_ASSERT(suscan_mf_sampler_init(&mf, TEST_PERIOD, .35, TEST_SPAN));
+  suscan_mf_sampler_set_phase_addend(&mf, .5);
+
+  n = suscan_mf_sampler_feed(&mf, x, TEST_SAMPLES, y);
+  SUSCAN_TEST_ASSERT(n >= TEST_SYMBOLS - 1);
+
+  for (lag = 0; !found && lag < TEST_SPAN / TEST_PERIOD + 2; ++lag) {
+    found = SU_TRUE;
+    for (i = TEST_SPAN / TEST_PERIOD + 2; i < n; ++i)
+      if (SU_C_REAL(y[i]) * test_mf_sampler_symbol(i - lag) <= .5) {
+        found = SU_FALSE;
+        break;
+      }
+  }
+
+  SUSCAN_TEST_ASSERT(found);
+
+  suscan_mf_sampler_finalize(&mf);
+}
+
+SUPRIVATE void
+test_mf_sampler_rejects_bad_params(void)
+{
+  suscan_mf_sampler_t mf = suscan_mf_sampler_INITIALIZER;
+
+  SUSCAN_TEST_ASSERT(!suscan_mf_sampler_init(&mf, .5, .35, TEST_SPAN));
+  SUSCAN_TEST_ASSERT(!suscan_mf_sampler_is_ready(&mf));
+  SUSCAN_TEST_ASSERT(!suscan_mf_sampler_init(&mf, TEST_PERIOD, .35, 0));
+  SUSCAN_TEST_ASSERT(!suscan_mf_sampler_is_ready(&mf));
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_mf_sampler_dc_gain);
+  SUSCAN_TEST_RUN(test_mf_sampler_split_feed);
+  SUSCAN_TEST_RUN(test_mf_sampler_recovers_symbols);
+  SUSCAN_TEST_RUN(test_mf_sampler_rejects_bad_params);
+
+  return EXIT_SUCCESS;
+}
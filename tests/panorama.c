@@ -0,0 +1,225 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "panorama.h"
+#include "test.h"
+
+#define TEST_MIN_FREQ 100e6
+#define TEST_MAX_FREQ 110e6
+#define TEST_BINS     1000    /* 10 kHz per bin */
+#define TEST_FS       1e6
+#define TEST_HOP_BINS 100     /* 10 kHz per bin, as the panorama */
+#define TEST_EDGE     .05
+
+SUPRIVATE SUSCOUNT
+test_panorama_bin(SUFREQ freq)
+{
+  return (SUSCOUNT) ((freq - TEST_MIN_FREQ) / 10e3);
+}
+
+SUPRIVATE void
+test_panorama_flat(SUFLOAT *psd, SUFLOAT level)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < TEST_HOP_BINS; ++i)
+    psd[i] = level;
+}
+
+/* Overlapping hops leave no gaps, and a flat spectrum stays flat */
+SUPRIVATE void
+test_panorama_coverage(void)
+{
+  suscan_panorama_t *pan;
+  SUFLOAT psd[TEST_HOP_BINS];
+  const SUFLOAT *base;
+  SUFREQ fc;
+  SUSCOUNT i;
+
+  SUSCAN_TEST_ASSERT(
+      pan = suscan_panorama_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_BINS,
+          TEST_EDGE));
+
+  SUSCAN_TEST_ASSERT_CLOSE(suscan_panorama_get_center(pan), 105e6, 1e-3);
+  SUSCAN_TEST_ASSERT_CLOSE(suscan_panorama_get_span(pan), 10e6, 1e-3);
+
+  test_panorama_flat(psd, 2);
+  for (fc = TEST_MIN_FREQ + .5 * TEST_FS;
+      fc <= TEST_MAX_FREQ - .5 * TEST_FS + 1;
+      fc += .75 * TEST_FS)
+    suscan_panorama_feed(pan, fc, TEST_FS, psd, TEST_HOP_BINS);
+
+  SUSCAN_TEST_ASSERT(suscan_panorama_get_updates(pan) == 13);
+
+  base = suscan_psd_pyramid_get_base(suscan_panorama_get_pyramid(pan));
+  for (i = 0; i < TEST_BINS; ++i)
+    SUSCAN_TEST_ASSERT_CLOSE(base[i], 2, 1e-4);
+
+  suscan_panorama_destroy(pan);
+}
+
+SUPRIVATE void
+test_panorama_placement(void)
+{
+  suscan_panorama_t *pan;
+  SUFLOAT psd[TEST_HOP_BINS];
+  SUFLOAT max[10];
+  const SUFLOAT *base;
+  SUSCOUNT i, peak;
+
+  SUSCAN_TEST_ASSERT(
+      pan = suscan_panorama_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_BINS,
+          TEST_EDGE));
+
+  /* psd[30] spans 103.3 MHz to 103.31 MHz */
+  test_panorama_flat(psd, 1);
+  psd[30] = 100;
+  suscan_panorama_feed(pan, 103.5e6, TEST_FS, psd, TEST_HOP_BINS);
+
+  base = suscan_psd_pyramid_get_base(suscan_panorama_get_pyramid(pan));
+
+  peak = 0;
+  for (i = 1; i < TEST_BINS; ++i)
+    if (base[i] > base[peak])
+      peak = i;
+
+  SUSCAN_TEST_ASSERT(peak == test_panorama_bin(103.3e6));
+  SUSCAN_TEST_ASSERT_CLOSE(base[peak], 100, 1e-3);
+
+  /* Guard bands are discarded away from the limits of the range */
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(103.02e6)] == 0);
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(103.97e6)] == 0);
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(103.06e6)] == 1);
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(103.94e6)] == 1);
+
+  /* Coarser levels are rebuilt on demand */
+  SUSCAN_TEST_ASSERT(
+      suscan_psd_pyramid_query(
+          suscan_panorama_get_pyramid(pan),
+          0,
+          TEST_BINS,
+          10,
+          NULL,
+          NULL,
+          max) == 10);
+  SUSCAN_TEST_ASSERT(max[3] == 100);
+  SUSCAN_TEST_ASSERT(max[0] == 0);
+
+  suscan_panorama_destroy(pan);
+}
+
+SUPRIVATE void
+test_panorama_range_limits(void)
+{
+  suscan_panorama_t *pan;
+  SUFLOAT psd[TEST_HOP_BINS];
+  const SUFLOAT *base;
+
+  SUSCAN_TEST_ASSERT(
+      pan = suscan_panorama_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_BINS,
+          TEST_EDGE));
+
+  test_panorama_flat(psd, 1);
+  suscan_panorama_feed(pan, TEST_MIN_FREQ + .5 * TEST_FS, TEST_FS, psd, 100);
+  suscan_panorama_feed(pan, TEST_MAX_FREQ - .5 * TEST_FS, TEST_FS, psd, 100);
+
+  /* Nobody else covers the outer edges, so they are kept */
+  base = suscan_psd_pyramid_get_base(suscan_panorama_get_pyramid(pan));
+  SUSCAN_TEST_ASSERT(base[0] == 1);
+  SUSCAN_TEST_ASSERT(base[TEST_BINS - 1] == 1);
+
+  /* The inner edges are not */
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(100.98e6)] == 0);
+  SUSCAN_TEST_ASSERT(base[test_panorama_bin(109.02e6)] == 0);
+
+  suscan_panorama_destroy(pan);
+}
+
+SUPRIVATE void
+test_panorama_memory(void)
+{
+  suscan_panorama_t *pan;
+  SUFLOAT psd[TEST_HOP_BINS];
+  const SUFLOAT *base;
+  SUSCOUNT center = test_panorama_bin(105e6);
+
+  SUSCAN_TEST_ASSERT(
+      pan = suscan_panorama_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_BINS,
+          TEST_EDGE));
+
+  test_panorama_flat(psd, 1);
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+  test_panorama_flat(psd, 3);
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+
+  /* Same weight both times: (MEMORY * 1 + 3) / (MEMORY + 1) */
+  base = suscan_psd_pyramid_get_base(suscan_panorama_get_pyramid(pan));
+  SUSCAN_TEST_ASSERT_CLOSE(
+      base[center],
+      (SUSCAN_PANORAMA_MEMORY + 3) / (SUSCAN_PANORAMA_MEMORY + 1),
+      1e-4);
+
+  /* Repeated updates converge to the new level */
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+  suscan_panorama_feed(pan, 105e6, TEST_FS, psd, TEST_HOP_BINS);
+  base = suscan_psd_pyramid_get_base(suscan_panorama_get_pyramid(pan));
+  SUSCAN_TEST_ASSERT(base[center] > 2.9 && base[center] < 3);
+
+  suscan_panorama_destroy(pan);
+}
+
+SUPRIVATE void
+test_panorama_rejects_bad_params(void)
+{
+  SUSCAN_TEST_ASSERT(
+      suscan_panorama_new(TEST_MAX_FREQ, TEST_MIN_FREQ, 1, 0) == NULL);
+  SUSCAN_TEST_ASSERT(
+      suscan_panorama_new(TEST_MIN_FREQ, TEST_MAX_FREQ, 0, 0) == NULL);
+  SUSCAN_TEST_ASSERT(
+      suscan_panorama_new(TEST_MIN_FREQ, TEST_MAX_FREQ, 1, .5) == NULL);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_panorama_coverage);
+  SUSCAN_TEST_RUN(test_panorama_placement);
+  SUSCAN_TEST_RUN(test_panorama_range_limits);
+  SUSCAN_TEST_RUN(test_panorama_memory);
+  SUSCAN_TEST_RUN(test_panorama_rejects_bad_params);
+
+  return EXIT_SUCCESS;
+}
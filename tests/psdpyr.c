@@ -0,0 +1,150 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "psdpyr.h"
+#include "test.h"
+
+#define TEST_PSD_SIZE 1024
+
+/* FFT-order PSD whose ascending-order bin i holds i + 1 */
+SUPRIVATE void
+test_psd_pyramid_fill(SUFLOAT *psd, SUSCOUNT size)
+{
+  SUSCOUNT i, half = size / 2;
+
+  for (i = 0; i < size; ++i)
+    psd[(i + size - half) % size] = i + 1;
+}
+
+SUPRIVATE void
+test_psd_pyramid_shift(void)
+{
+  suscan_psd_pyramid_t *pyr;
+  SUFLOAT psd[TEST_PSD_SIZE];
+  const SUFLOAT *base;
+  SUSCOUNT i;
+
+  SUSCAN_TEST_ASSERT(pyr = suscan_psd_pyramid_new(TEST_PSD_SIZE));
+
+  test_psd_pyramid_fill(psd, TEST_PSD_SIZE);
+  suscan_psd_pyramid_update(pyr, psd);
+
+  base = suscan_psd_pyramid_get_base(pyr);
+  for (i = 0; i < TEST_PSD_SIZE; ++i)
+    SUSCAN_TEST_ASSERT(base[i] == i + 1);
+
+  suscan_psd_pyramid_destroy(pyr);
+}
+
+/* Every output bin must summarize exactly its share of the range */
+SUPRIVATE void
+test_psd_pyramid_query_matches_brute_force(void)
+{
+  suscan_psd_pyramid_t *pyr;
+  SUFLOAT psd[TEST_PSD_SIZE];
+  SUFLOAT base[TEST_PSD_SIZE];
+  SUFLOAT min[16], mean[16], max[16];
+  SUFLOAT emin, emax, esum;
+  SUSCOUNT i, j, got;
+
+  SUSCAN_TEST_ASSERT(pyr = suscan_psd_pyramid_new(TEST_PSD_SIZE));
+
+  /* Noise-like profile with an isolated peak */
+  for (i = 0; i < TEST_PSD_SIZE; ++i)
+    psd[i] = 1 + ((i * 37) % 11);
+  psd[100] = 1000;
+
+  suscan_psd_pyramid_update(pyr, psd);
+  memcpy(
+      base,
+      suscan_psd_pyramid_get_base(pyr),
+      TEST_PSD_SIZE * sizeof(SUFLOAT));
+
+  got = suscan_psd_pyramid_query(pyr, 0, TEST_PSD_SIZE, 16, min, mean, max);
+  SUSCAN_TEST_ASSERT(got == 16);
+
+  for (j = 0; j < 16; ++j) {
+    emin = emax = base[j * 64];
+    esum = 0;
+    for (i = j * 64; i < (j + 1) * 64; ++i) {
+      emin  = SU_MIN(emin, base[i]);
+      emax  = SU_MAX(emax, base[i]);
+      esum += base[i];
+    }
+
+    SUSCAN_TEST_ASSERT(min[j] == emin);
+    SUSCAN_TEST_ASSERT(max[j] == emax);
+    SUSCAN_TEST_ASSERT_CLOSE(mean[j], esum / 64, 1e-3);
+  }
+
+  /* The peak survives decimation in the max trace only */
+  SUSCAN_TEST_ASSERT(max[(100 + TEST_PSD_SIZE / 2) / 64] == 1000);
+
+  suscan_psd_pyramid_destroy(pyr);
+}
+
+SUPRIVATE void
+test_psd_pyramid_query_limits(void)
+{
+  suscan_psd_pyramid_t *pyr;
+  SUFLOAT psd[TEST_PSD_SIZE];
+  SUFLOAT mean[64];
+  SUSCOUNT i;
+
+  SUSCAN_TEST_ASSERT(pyr = suscan_psd_pyramid_new(TEST_PSD_SIZE));
+
+  test_psd_pyramid_fill(psd, TEST_PSD_SIZE);
+  suscan_psd_pyramid_update(pyr, psd);
+
+  /* Narrow ranges are returned at full resolution, never upsampled */
+  SUSCAN_TEST_ASSERT(
+      suscan_psd_pyramid_query(pyr, 10, 20, 64, NULL, mean, NULL) == 10);
+  for (i = 0; i < 10; ++i)
+    SUSCAN_TEST_ASSERT(mean[i] == 11 + i);
+
+  /* Empty and out-of-range requests */
+  SUSCAN_TEST_ASSERT(
+      suscan_psd_pyramid_query(pyr, 20, 20, 64, NULL, mean, NULL) == 0);
+  SUSCAN_TEST_ASSERT(
+      suscan_psd_pyramid_query(pyr, 0, 20, 0, NULL, mean, NULL) == 0);
+  SUSCAN_TEST_ASSERT(
+      suscan_psd_pyramid_query(
+          pyr,
+          TEST_PSD_SIZE - 4,
+          2 * TEST_PSD_SIZE,
+          64,
+          NULL,
+          mean,
+          NULL) == 4);
+
+  suscan_psd_pyramid_destroy(pyr);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_psd_pyramid_shift);
+  SUSCAN_TEST_RUN(test_psd_pyramid_query_matches_brute_force);
+  SUSCAN_TEST_RUN(test_psd_pyramid_query_limits);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "inspector/resampler.h"
+#include "test.h"
+
+#define TEST_FS       250000.
+#define TEST_FS_OUT   44100.
+#define TEST_SAMPLES  25000
+#define TEST_SETTLE   200     /* Output samples discarded */
+
+SUPRIVATE void
+test_resampler_tone(SUCOMPLEX *x, SUSCOUNT len, SUFLOAT freq)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < len; ++i)
+    x[i] = SU_C_EXP(I * 2 * PI * freq / TEST_FS * i);
+}
+
+/* Both stages, fed in irregular blocks as the inspectors do */
+SUPRIVATE SUSCOUNT
+test_resampler_run(
+    suscan_resampler_t *rs,
+    const SUCOMPLEX *x,
+    SUSCOUNT len,
+    SUCOMPLEX *y)
+{
+  SUCOMPLEX mid[TEST_SAMPLES];
+  SUSCOUNT p, chunk, got, n = 0;
+
+  for (p = 0, chunk = 7; p < len; p += chunk, chunk = chunk * 5 % 997) {
+    if (chunk > len - p)
+      chunk = len - p;
+
+    memcpy(mid, x + p, chunk * sizeof(SUCOMPLEX));
+    got = suscan_resampler_decimate(rs, mid, chunk, mid);
+    n  += suscan_resampler_interpolate(rs, mid, got, y + n);
+  }
+
+  return n;
+}
+
+SUPRIVATE void
+test_resampler_rates(void)
+{
+  suscan_resampler_t rs = suscan_resampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUFLOAT mid;
+  SUSCOUNT n;
+
+  SUSCAN_TEST_ASSERT(suscan_resampler_init(&rs, TEST_FS, TEST_FS_OUT));
+  SUSCAN_TEST_ASSERT(suscan_resampler_is_ready(&rs));
+
+  /* The intermediate rate stays within 2 and 4 output rates */
+  mid = suscan_resampler_get_mid_rate(&rs);
+  SUSCAN_TEST_ASSERT(mid >= 2 * TEST_FS_OUT && mid < 4 * TEST_FS_OUT);
+
+  test_resampler_tone(x, TEST_SAMPLES, 1000);
+  n = test_resampler_run(&rs, x, TEST_SAMPLES, y);
+
+  SUSCAN_TEST_ASSERT_CLOSE(n, TEST_SAMPLES * TEST_FS_OUT / TEST_FS, 2);
+
+  suscan_resampler_finalize(&rs);
+  SUSCAN_TEST_ASSERT(!suscan_resampler_is_ready(&rs));
+}
+
+SUPRIVATE void
+test_resampler_passband(void)
+{
+  suscan_resampler_t rs = suscan_resampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUFLOAT expected = 2 * PI * 3000 / TEST_FS_OUT;
+  SUSCOUNT i, n;
+
+  SUSCAN_TEST_ASSERT(suscan_resampler_init(&rs, TEST_FS, TEST_FS_OUT));
+
+  test_resampler_tone(x, TEST_SAMPLES, 3000);
+  n = test_resampler_run(&rs, x, TEST_SAMPLES, y);
+  SUSCAN_TEST_ASSERT(n > TEST_SETTLE + 1);
+
+  /* Same amplitude and same frequency, now at the output rate */
+  for (i = TEST_SETTLE; i < n; ++i) {
+    SUSCAN_TEST_ASSERT_CLOSE(SU_C_ABS(y[i]), 1, .02);
+    SUSCAN_TEST_ASSERT_CLOSE(
+        SU_C_ARG(y[i] * SU_C_CONJ(y[i - 1])),
+        expected,
+        .01);
+  }
+
+  suscan_resampler_finalize(&rs);
+}
+
+SUPRIVATE void
+test_resampler_rejects_aliases(void)
+{
+  suscan_resampler_t rs = suscan_resampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUFLOAT power = 0;
+  SUSCOUNT i, n;
+
+  SUSCAN_TEST_ASSERT(suscan_resampler_init(&rs, TEST_FS, TEST_FS_OUT));
+
+  /* Far above the output Nyquist frequency */
+  test_resampler_tone(x, TEST_SAMPLES, 90000);
+  n = test_resampler_run(&rs, x, TEST_SAMPLES, y);
+  SUSCAN_TEST_ASSERT(n > TEST_SETTLE);
+
+  for (i = TEST_SETTLE; i < n; ++i)
+    power += SU_C_REAL(y[i] * SU_C_CONJ(y[i]));
+  power /= n - TEST_SETTLE;
+
+  SUSCAN_TEST_ASSERT(SU_POWER_DB(power) < -30);
+
+  suscan_resampler_finalize(&rs);
+}
+
+SUPRIVATE void
+test_resampler_max_input(void)
+{
+  suscan_resampler_t rs = suscan_resampler_INITIALIZER;
+  SUCOMPLEX x[TEST_SAMPLES], mid[TEST_SAMPLES], y[TEST_SAMPLES];
+  SUSCOUNT len, got, n, k;
+
+  SUSCAN_TEST_ASSERT(suscan_resampler_init(&rs, TEST_FS, TEST_FS_OUT));
+  test_resampler_tone(x, TEST_SAMPLES, 1000);
+
+  /* Whatever the state, the bound on the input bounds the output */
+  for (k = 0; k < 50; ++k) {
+    len = suscan_resampler_get_max_input(&rs, 16 + k);
+    SUSCAN_TEST_ASSERT(len > 0 && len <= TEST_SAMPLES);
+
+    got = suscan_resampler_decimate(&rs, x, len, mid);
+    n   = suscan_resampler_interpolate(&rs, mid, got, y);
+    SUSCAN_TEST_ASSERT(n <= 16 + k);
+  }
+
+  suscan_resampler_finalize(&rs);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_resampler_rates);
+  SUSCAN_TEST_RUN(test_resampler_passband);
+  SUSCAN_TEST_RUN(test_resampler_rejects_aliases);
+  SUSCAN_TEST_RUN(test_resampler_max_input);
+
+  return EXIT_SUCCESS;
+}
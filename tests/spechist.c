@@ -0,0 +1,269 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+#include <unistd.h>
+
+#include "spechist.h"
+#include "test.h"
+
+#define TEST_PSD_SIZE     64
+#define TEST_FRAME_COUNT  600
+#define TEST_CHUNK_FRAMES 256
+#define TEST_FC           100e6
+#define TEST_FS           1e6
+#define TEST_SPIKE_FRAME  300
+#define TEST_SPIKE_BIN    5
+
+struct test_spechist_state {
+  SUSCOUNT frames;
+  SUSCOUNT spikes;
+  SUFLOAT  max_error;   /* dB */
+  uint64_t first_ts;
+  uint64_t last_ts;
+};
+
+SUPRIVATE char test_spechist_path[] = "/tmp/suscan-spechist-XXXXXX";
+
+SUPRIVATE uint64_t
+test_spechist_ts(SUSCOUNT frame)
+{
+  return 1000000000000ull + frame * 100000000ull; /* 10 frames per second */
+}
+
+SUPRIVATE void
+test_spechist_frame(SUSCOUNT frame, SUFLOAT *psd)
+{
+  SUSCOUNT i;
+
+  for (i = 0; i < TEST_PSD_SIZE; ++i)
+    psd[i] = 1e-6 * (1 + .1 * ((i * frame) % 7));
+
+  if (frame == TEST_SPIKE_FRAME)
+    psd[TEST_SPIKE_BIN] = 1e-3;
+}
+
+SUPRIVATE SUBOOL
+test_spechist_check_cb(
+    void *privdata,
+    const struct timespec *ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    const SUFLOAT *psd,
+    SUSCOUNT size)
+{
+  struct test_spechist_state *state = privdata;
+  SUFLOAT expected[TEST_PSD_SIZE];
+  uint64_t ns = ts->tv_sec * 1000000000ull + ts->tv_nsec;
+  SUSCOUNT frame, i;
+  SUFLOAT err;
+
+  SUSCAN_TEST_ASSERT(size == TEST_PSD_SIZE);
+  SUSCAN_TEST_ASSERT(fc == TEST_FC);
+  SUSCAN_TEST_ASSERT(samp_rate == TEST_FS);
+  SUSCAN_TEST_ASSERT((ns - test_spechist_ts(0)) % 100000000ull == 0);
+
+  frame = (ns - test_spechist_ts(0)) / 100000000ull;
+  test_spechist_frame(frame, expected);
+
+  for (i = 0; i < size; ++i) {
+    err = SU_ABS(SU_POWER_DB(psd[i]) - SU_POWER_DB(expected[i]));
+    if (err > state->max_error)
+      state->max_error = err;
+  }
+
+  if (state->frames++ == 0)
+    state->first_ts = ns;
+  state->last_ts = ns;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE SUBOOL
+test_spechist_decimated_cb(
+    void *privdata,
+    const struct timespec *ts,
+    SUFREQ fc,
+    SUFLOAT samp_rate,
+    const SUFLOAT *psd,
+    SUSCOUNT size)
+{
+  struct test_spechist_state *state = privdata;
+
+  ++state->frames;
+
+  /* Max-hold must keep the spike in whatever frame it was merged into */
+  if (SU_POWER_DB(psd[TEST_SPIKE_BIN]) > -31)
+    ++state->spikes;
+
+  return SU_TRUE;
+}
+
+SUPRIVATE void
+test_spechist_write(void)
+{
+  struct suscan_spectrum_history_params params =
+      suscan_spectrum_history_params_INITIALIZER;
+  suscan_spectrum_history_t *hist;
+  SUFLOAT psd[TEST_PSD_SIZE];
+  struct timespec ts;
+  SUSCOUNT k;
+  uint64_t ns;
+  int fd;
+
+  SUSCAN_TEST_ASSERT((fd = mkstemp(test_spechist_path)) != -1);
+  close(fd);
+
+  params.chunk_frames = TEST_CHUNK_FRAMES;
+
+  SUSCAN_TEST_ASSERT(
+      hist = suscan_spectrum_history_create(
+          test_spechist_path,
+          TEST_PSD_SIZE,
+          &params));
+
+  for (k = 0; k < TEST_FRAME_COUNT; ++k) {
+    test_spechist_frame(k, psd);
+    ns = test_spechist_ts(k);
+    ts.tv_sec  = ns / 1000000000ull;
+    ts.tv_nsec = ns % 1000000000ull;
+
+    SUSCAN_TEST_ASSERT(
+        suscan_spectrum_history_append(
+            hist,
+            &ts,
+            TEST_FC,
+            TEST_FS,
+            psd,
+            TEST_PSD_SIZE));
+  }
+
+  suscan_spectrum_history_destroy(hist);
+}
+
+SUPRIVATE void
+test_spechist_round_trip(void)
+{
+  struct suscan_spectrum_history_params params =
+      suscan_spectrum_history_params_INITIALIZER;
+  struct test_spechist_state state;
+  suscan_spectrum_history_t *hist;
+  struct timespec start, end;
+  SUFLOAT step;
+
+  step = (params.db_max - params.db_min) / ((1 << params.bits) - 1);
+
+  SUSCAN_TEST_ASSERT(hist = suscan_spectrum_history_open(test_spechist_path));
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_get_chunk_count(hist)
+      == (TEST_FRAME_COUNT + TEST_CHUNK_FRAMES - 1) / TEST_CHUNK_FRAMES);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_get_time_range(hist, &start, &end));
+
+  memset(&state, 0, sizeof(state));
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_query(
+          hist,
+          &start,
+          &end,
+          0,
+          test_spechist_check_cb,
+          &state));
+
+  SUSCAN_TEST_ASSERT(state.frames == TEST_FRAME_COUNT);
+  SUSCAN_TEST_ASSERT(state.first_ts == test_spechist_ts(0));
+  SUSCAN_TEST_ASSERT(state.last_ts == test_spechist_ts(TEST_FRAME_COUNT - 1));
+  SUSCAN_TEST_ASSERT(state.max_error <= step);
+
+  suscan_spectrum_history_destroy(hist);
+}
+
+SUPRIVATE void
+test_spechist_subrange(void)
+{
+  struct test_spechist_state state;
+  suscan_spectrum_history_t *hist;
+  struct timespec start, end;
+
+  SUSCAN_TEST_ASSERT(hist = suscan_spectrum_history_open(test_spechist_path));
+
+  /* Frames 250 to 270, across a chunk boundary */
+  start.tv_sec  = test_spechist_ts(250) / 1000000000ull;
+  start.tv_nsec = test_spechist_ts(250) % 1000000000ull;
+  end.tv_sec    = test_spechist_ts(270) / 1000000000ull;
+  end.tv_nsec   = test_spechist_ts(270) % 1000000000ull;
+
+  memset(&state, 0, sizeof(state));
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_query(
+          hist,
+          &start,
+          &end,
+          0,
+          test_spechist_check_cb,
+          &state));
+
+  SUSCAN_TEST_ASSERT(state.frames == 21);
+  SUSCAN_TEST_ASSERT(state.first_ts == test_spechist_ts(250));
+  SUSCAN_TEST_ASSERT(state.last_ts == test_spechist_ts(270));
+
+  suscan_spectrum_history_destroy(hist);
+}
+
+SUPRIVATE void
+test_spechist_decimated(void)
+{
+  struct test_spechist_state state;
+  suscan_spectrum_history_t *hist;
+  struct timespec start, end;
+
+  SUSCAN_TEST_ASSERT(hist = suscan_spectrum_history_open(test_spechist_path));
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_get_time_range(hist, &start, &end));
+
+  memset(&state, 0, sizeof(state));
+  SUSCAN_TEST_ASSERT(
+      suscan_spectrum_history_query(
+          hist,
+          &start,
+          &end,
+          10,
+          test_spechist_decimated_cb,
+          &state));
+
+  SUSCAN_TEST_ASSERT(state.frames > 0 && state.frames <= 10);
+  SUSCAN_TEST_ASSERT(state.spikes == 1);
+
+  suscan_spectrum_history_destroy(hist);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_spechist_write);
+  SUSCAN_TEST_RUN(test_spechist_round_trip);
+  SUSCAN_TEST_RUN(test_spechist_subrange);
+  SUSCAN_TEST_RUN(test_spechist_decimated);
+
+  unlink(test_spechist_path);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#include <string.h>
+
+#include "sweep.h"
+#include "test.h"
+
+#define TEST_MIN_FREQ 100e6
+#define TEST_MAX_FREQ 110e6
+#define TEST_FS       1e6
+#define TEST_HOPS     10
+#define TEST_ROUNDS   1000
+
+/* Visits per hop after TEST_ROUNDS hops, one hop every 10 ms */
+SUPRIVATE void
+test_sweep_count(suscan_sweep_planner_t *planner, SUSCOUNT *visits)
+{
+  SUFREQ fc;
+  SUSCOUNT i, hop;
+
+  memset(visits, 0, TEST_HOPS * sizeof(SUSCOUNT));
+
+  for (i = 0; i < TEST_ROUNDS; ++i) {
+    fc = suscan_sweep_planner_next(planner, i * 1e-2);
+    hop = (SUSCOUNT) ((fc - TEST_MIN_FREQ) / TEST_FS);
+    SUSCAN_TEST_ASSERT(hop < TEST_HOPS);
+    ++visits[hop];
+  }
+}
+
+SUPRIVATE void
+test_sweep_layout(void)
+{
+  suscan_sweep_planner_t *planner;
+  SUFREQ fc;
+  SUSCOUNT i;
+
+  SUSCAN_TEST_ASSERT(
+      planner = suscan_sweep_planner_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_FS,
+          0,
+          NULL,
+          0));
+
+  SUSCAN_TEST_ASSERT(suscan_sweep_planner_get_hop_count(planner) == TEST_HOPS);
+
+  /* Equal weights: a plain stepped sweep, edge to edge */
+  for (i = 0; i < 3 * TEST_HOPS; ++i) {
+    fc = suscan_sweep_planner_next(planner, 0);
+    SUSCAN_TEST_ASSERT_CLOSE(
+        fc,
+        TEST_MIN_FREQ + (i % TEST_HOPS + .5) * TEST_FS,
+        1e-3);
+  }
+
+  SUSCAN_TEST_ASSERT(suscan_sweep_planner_get_sweep_count(planner) == 3);
+
+  suscan_sweep_planner_destroy(planner);
+
+  /* Overlapping hops still cover the range exactly */
+  SUSCAN_TEST_ASSERT(
+      planner = suscan_sweep_planner_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_FS,
+          .25,
+          NULL,
+          0));
+  SUSCAN_TEST_ASSERT(suscan_sweep_planner_get_hop_count(planner) == 13);
+  SUSCAN_TEST_ASSERT_CLOSE(
+      suscan_sweep_planner_next(planner, 0),
+      TEST_MIN_FREQ + .5 * TEST_FS,
+      1e-3);
+  for (i = 1; i < 13; ++i)
+    fc = suscan_sweep_planner_next(planner, 0);
+  SUSCAN_TEST_ASSERT_CLOSE(fc, TEST_MAX_FREQ - .5 * TEST_FS, 1e-3);
+
+  suscan_sweep_planner_destroy(planner);
+
+  SUSCAN_TEST_ASSERT(
+      suscan_sweep_planner_new(
+          TEST_MAX_FREQ,
+          TEST_MIN_FREQ,
+          TEST_FS,
+          0,
+          NULL,
+          0) == NULL);
+}
+
+SUPRIVATE void
+test_sweep_weights(void)
+{
+  struct suscan_sweep_band bands[] = {
+    {100.1e6, 100.9e6, 4,   0}, /* Hop 0 */
+    {105.1e6, 108.9e6, .25, 0}  /* Hops 5 to 8 */
+  };
+  suscan_sweep_planner_t *planner;
+  SUSCOUNT visits[TEST_HOPS];
+  SUSCOUNT i;
+
+  SUSCAN_TEST_ASSERT(
+      planner = suscan_sweep_planner_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_FS,
+          0,
+          bands,
+          2));
+
+  test_sweep_count(planner, visits);
+
+  /* Visit ratios follow the weights, including those below 1 */
+  SUSCAN_TEST_ASSERT_CLOSE(visits[0], 4 * visits[1], 8);
+  for (i = 5; i < 9; ++i)
+    SUSCAN_TEST_ASSERT_CLOSE(visits[1], 4 * visits[i], 8);
+
+  /* Every hop is visited, so sweeps keep completing */
+  for (i = 0; i < TEST_HOPS; ++i)
+    SUSCAN_TEST_ASSERT(visits[i] > 0);
+  SUSCAN_TEST_ASSERT(
+      suscan_sweep_planner_get_sweep_count(planner) == visits[5]);
+
+  suscan_sweep_planner_destroy(planner);
+}
+
+SUPRIVATE void
+test_sweep_revisit(void)
+{
+  struct suscan_sweep_band slow[] = {{103.1e6, 103.9e6, 1, .045}};
+  struct suscan_sweep_band fast[] = {{103.1e6, 103.9e6, 1, 1e-3}};
+  suscan_sweep_planner_t *planner;
+  SUSCOUNT visits[TEST_HOPS];
+  SUSCOUNT i;
+
+  /* A 45 ms target, with a hop every 10 ms: one visit out of five */
+  SUSCAN_TEST_ASSERT(
+      planner = suscan_sweep_planner_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_FS,
+          0,
+          slow,
+          1));
+
+  test_sweep_count(planner, visits);
+  SUSCAN_TEST_ASSERT_CLOSE(visits[3], TEST_ROUNDS / 5, 10);
+
+  suscan_sweep_planner_destroy(planner);
+
+  /* An unreachable target must not starve the rest of the range */
+  SUSCAN_TEST_ASSERT(
+      planner = suscan_sweep_planner_new(
+          TEST_MIN_FREQ,
+          TEST_MAX_FREQ,
+          TEST_FS,
+          0,
+          fast,
+          1));
+
+  test_sweep_count(planner, visits);
+  SUSCAN_TEST_ASSERT(
+      visits[3] <= SUSCAN_SWEEP_PLANNER_REVISIT_SHARE * TEST_ROUNDS + 10);
+
+  for (i = 0; i < TEST_HOPS; ++i)
+    if (i != 3)
+      SUSCAN_TEST_ASSERT(visits[i] >= 40);
+
+  suscan_sweep_planner_destroy(planner);
+}
+
+int
+main(int argc, char **argv)
+{
+  SUSCAN_TEST_RUN(test_sweep_layout);
+  SUSCAN_TEST_RUN(test_sweep_weights);
+  SUSCAN_TEST_RUN(test_sweep_revisit);
+
+  return EXIT_SUCCESS;
+}
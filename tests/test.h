@@ -0,0 +1,56 @@
+/*
+
+  Copyright (C) 2020 Gonzalo José Carracedo Carballal
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License as
+  published by the Free Software Foundation, either version 3 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this program.  If not, see
+  <http://www.gnu.org/licenses/>
+
+*/
+
+#ifndef _TESTS_TEST_H
+#define _TESTS_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sigutils/sigutils.h>
+
+/*
+ * Minimal test harness. Every test program is a plain executable that
+ * returns nonzero on the first failed check, which is all CTest needs.
+ */
+#define SUSCAN_TEST_ASSERT(cond)                                  \
+  do {                                                            \
+    if (!(cond)) {                                                \
+      fprintf(                                                    \
+          stderr,                                                 \
+          "%s:%d: check failed: %s\n",                            \
+          __FILE__,                                               \
+          __LINE__,                                               \
+          #cond);                                                 \
+      exit(EXIT_FAILURE);                                         \
+    }                                                             \
+  } while (0)
+
+#define SUSCAN_TEST_ASSERT_CLOSE(a, b, tol)                       \
+  SUSCAN_TEST_ASSERT(fabs((double) (a) - (double) (b)) <= (tol))
+
+#define SUSCAN_TEST_RUN(test)                                     \
+  do {                                                            \
+    fprintf(stderr, "Running %s... ", #test);                     \
+    test();                                                       \
+    fprintf(stderr, "ok\n");                                      \
+  } while (0)
+
+#endif /* _TESTS_TEST_H */